@@ -0,0 +1,48 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int arena_init (struct arena *a, size_t size)
+{
+    a->used = 0;
+    a->size = size;
+    if (!(a->base = malloc(size))) {
+        a->size = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void arena_free (struct arena *a)
+{
+    free(a->base);
+    a->base = NULL;
+    a->size = a->used = 0;
+}
+
+void *arena_alloc (struct arena *a, size_t n)
+{
+    size_t start = ARENA_ROUND(a->used);
+
+    if (start > a->size || n > a->size - start)
+        return NULL;
+    a->used = start + n;
+    return a->base + start;
+}
+
+void *arena_calloc (struct arena *a, size_t n)
+{
+    void *p = arena_alloc(a, n);
+
+    if (p)
+        memset(p, 0, n);
+    return p;
+}
+
+void arena_reset (struct arena *a)
+{
+    a->used = 0;
+}
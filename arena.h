@@ -0,0 +1,31 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* A bump allocator. Everything allocated from an arena goes away at once,
+ * when it is reset, so there is nothing to free one by one. Games keep one
+ * for whatever lasts a single hand. */
+
+/* good enough for any type we have */
+#define ARENA_ALIGN 16
+/* what n bytes really take up in an arena */
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+struct arena {
+    char *base;
+    size_t size;
+    size_t used;
+};
+
+/* returns 0, or -1 if there's no memory */
+int arena_init (struct arena *a, size_t size);
+void arena_free (struct arena *a);
+/* suitably aligned for anything. NULL once the arena is full. */
+void *arena_alloc (struct arena *a, size_t n);
+void *arena_calloc (struct arena *a, size_t n);
+void arena_reset (struct arena *a);
+
+#endif
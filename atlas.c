@@ -0,0 +1,128 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "atlas.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* set up once by atlas_open(), read-only after that */
+static const char *map = NULL;
+static size_t map_size = 0;
+static const uint32_t *offsets;
+static int n_lines = 0;
+
+static int
+check (const char *path)
+{
+    const struct atlas_header *h = (const void *) map;
+    size_t table;
+    uint32_t i, n;
+
+    if (map_size < sizeof *h || memcmp(h->magic, ATLAS_MAGIC, 8) != 0) {
+        fprintf(stderr, "WARNING: %s is not a card atlas.\n", path);
+        return -1;
+    }
+    if (h->size != map_size || h->n_glyphs != ATLAS_GLYPHS || h->n_lines < 1
+            || h->n_lines > 64) {
+        fprintf(stderr, "WARNING: %s is damaged (or from another mkatlas).\n", path);
+        return -1;
+    }
+
+    n = h->n_glyphs * (h->n_lines + 1);
+    table = sizeof *h + n * sizeof (uint32_t);
+    if (table > map_size) {
+        fprintf(stderr, "WARNING: %s is cut short.\n", path);
+        return -1;
+    }
+    offsets = (const void *) (map + sizeof *h);
+    for (i = 0; i < n; i++) {
+        /* every line has to lie within the text, in order */
+        if (offsets[i] < table || offsets[i] > map_size
+                || (i % (h->n_lines + 1) != 0 && offsets[i] < offsets[i - 1])) {
+            fprintf(stderr, "WARNING: %s is damaged.\n", path);
+            return -1;
+        }
+    }
+    n_lines = h->n_lines;
+    return 0;
+}
+
+int
+atlas_open (const char *path)
+{
+    struct stat st;
+    void *m;
+    int fd;
+
+    atlas_close();
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        perror(path);
+        return -1;
+    }
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+
+    map = m;
+    map_size = st.st_size;
+    if (check(path) != 0) {
+        atlas_close();
+        return -1;
+    }
+    return 0;
+}
+
+void
+atlas_close (void)
+{
+    if (map)
+        munmap((void *) map, map_size);
+    map = NULL;
+    map_size = 0;
+    n_lines = 0;
+}
+
+int
+atlas_height (void)
+{
+    return n_lines;
+}
+
+int
+atlas_row (char *buf, int size, int len, const pcard_t cards[], int n,
+           int line)
+{
+    const uint32_t *off;
+    int glyph, l, i;
+
+    if (line < 0 || line >= n_lines)
+        n = 0;
+    for (i = 0; i < n; i++) {
+        if (cards[i] == ATLAS_BACK)
+            glyph = ATLAS_BACK_GLYPH;
+        else
+            glyph = PCARD_SUIT(cards[i]) * 13 + PCARD_RANK(cards[i]);
+        off = &offsets[glyph * (n_lines + 1) + line];
+        l = off[1] - off[0];
+        if (len + l >= size)
+            break;
+        memcpy(buf + len, map + off[0], l);
+        len += l;
+    }
+    if (len < size)
+        buf[len] = '\0';
+    return len;
+}
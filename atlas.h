@@ -0,0 +1,46 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdint.h>
+#include "card.h"
+
+/* The big card pictures from cards/, packed into one file by mkatlas and
+ * mapped into memory as they are. Nothing gets parsed at send time: a row of
+ * cards is a few memcpy()s of lines out of the map.
+ *
+ * The file is a header, then for every glyph (suit * 13 + rank, then the
+ * back of a card) the offsets where each of its lines starts, plus one for
+ * the end of the last line, and then the text. Lines have no newlines. */
+
+#ifndef ATLAS_PATH
+#define ATLAS_PATH "cards.atlas"
+#endif
+
+#define ATLAS_MAGIC "ircpatl1"
+#define ATLAS_GLYPHS 53
+#define ATLAS_BACK_GLYPH 52
+/* deal this as a card to show its back */
+#define ATLAS_BACK ((pcard_t) 0xff)
+
+struct atlas_header {
+    char magic[8];
+    uint32_t n_glyphs;
+    uint32_t n_lines;       /* per glyph */
+    uint32_t size;          /* of the whole file */
+    /* uint32_t offsets[n_glyphs][n_lines + 1], from the start of the file */
+};
+
+/* returns 0, or -1 if there's no usable atlas */
+int atlas_open (const char *path);
+void atlas_close (void);
+/* lines per card, 0 if no atlas is open */
+int atlas_height (void);
+/* appends line `line' of each card, side by side, at buf + len. stops
+ * before a card that doesn't fit, NUL-terminates, returns the new length. */
+int atlas_row (char *buf, int size, int len, const pcard_t cards[], int n,
+               int line);
+
+#endif
@@ -0,0 +1,371 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* benchmarks for the parts of a hand that run all the time: shuffling,
+ * dealing, ranking and comparing hands, sorting the players, settling side
+ * pots, and whole hands through the betting engine. Omaha and the short
+ * deck get their best hands timed too.
+ *
+ * Everything is seeded the same every run. Each benchmark first runs until
+ * a batch of operations takes BATCH_NS (which doubles as the warm-up), then
+ * times SAMPLES batches of that size. ns/op is given for the median, 90th
+ * and 99th percentile batch, and the best one.
+ *
+ * usage: benchmark [-j] [-q] [name...]
+ *   -j  one JSON object per line, for scripts
+ *   -q  fewer, shorter batches
+ * names pick benchmarks by prefix; the default is all of them. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "deck.h"
+#include "engine.h"
+#include "hand.h"
+#include "pot.h"
+
+#define SAMPLES 51
+#define BATCH_NS 2000000.0
+#define N_HANDS 1024    /* random hands to rank, a power of two */
+#define N_PLAYERS 10
+
+struct bench {
+    const char *name;
+    const char *unit;   /* what one operation is */
+    void (*run)(long n);
+};
+
+static game_tp g;
+static game_tp variant_games[N_VARIANTS];
+static pcard_t hands[N_HANDS][7];
+static cardmask_t masks[N_HANDS];
+static uint64_t x = 0x9e3779b97f4a7c15ULL;
+static volatile int sink;
+
+uint64_t next_random()
+{
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+double now_ns()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+void setup()
+{
+    /* a table of ten with cards out, and a pile of random hands */
+    static pcard_t decks[N_HANDS][52];
+    unsigned char key[] = "bench";
+    rng_t rng;
+    char nick[16];
+    int i, p, v;
+
+    rng.interval = 0;
+    rng_seed(&rng, key, sizeof key - 1);
+    for (i = 0; i < N_HANDS; i++)
+        init_deck(decks[i]);
+    shuffle_decks(&rng, decks, N_HANDS);
+    for (i = 0; i < N_HANDS; i++) {
+        memcpy(hands[i], decks[i], sizeof hands[i]);
+        masks[i] = 0;
+        for (p = 0; p < 7; p++)
+            masks[i] |= PCARD_BIT(hands[i][p]);
+    }
+
+    for (v = 0; v < N_VARIANTS; v++) {
+        g = variant_games[v] = new_game(0);
+        set_variant(g, &variants[v]);
+        g->rng.interval = 0;
+        rng_seed(&g->rng, key, sizeof key - 1);
+        for (i = 0; i < N_PLAYERS; i++) {
+            sprintf(nick, "p%d", i);
+            add_player(g, nick);
+            g->players[i].active = 1;
+            g->players[i].chips = 1000;
+        }
+        shuffle_deck(g);
+        for (i = 0; i < N_PLAYERS; i++)
+            deal(g, i);
+        deal_community(g);
+    }
+    g = variant_games[VARIANT_HOLDEM];
+    init_hand_tables();
+}
+
+void bench_shuffle(long n)
+{
+    long i;
+
+    for (i = 0; i < n; i++)
+        shuffle_deck(g);
+}
+
+void bench_deal(long n)
+{
+    /* ten hands and a board, off a deck that's already shuffled */
+    long i;
+    int p;
+
+    for (i = 0; i < n; i++) {
+        undeal(g);
+        for (p = 0; p < N_PLAYERS; p++)
+            deal(g, p);
+        deal_community(g);
+    }
+}
+
+void bench_rank_hand(long n)
+{
+    long i;
+    int s = 0;
+
+    for (i = 0; i < n; i++)
+        s += rank_hand(hands[i & (N_HANDS - 1)]);
+    sink = s;
+}
+
+void bench_handcmp(long n)
+{
+    long i;
+    int s = 0;
+
+    for (i = 0; i < n; i++)
+        s += handcmp(hands[i & (N_HANDS - 1)], hands[(i + 1) & (N_HANDS - 1)]);
+    sink = s;
+}
+
+void bench_eval_hand(long n)
+{
+    /* best of seven */
+    long i;
+    int s = 0;
+
+    for (i = 0; i < n; i++)
+        s += eval_hand(hands[i & (N_HANDS - 1)], 7);
+    sink = s;
+}
+
+void bench_eval_mask(long n)
+{
+    long i;
+    int s = 0;
+
+    for (i = 0; i < n; i++)
+        s += eval_mask(masks[i & (N_HANDS - 1)]);
+    sink = s;
+}
+
+void bench_eval_masks(long n)
+{
+    /* the same hands, a batch at a time */
+    static int strength[N_HANDS];
+    long i;
+    int k;
+
+    for (i = 0; i < n; i += k) {
+        k = n - i < N_HANDS ? n - i : N_HANDS;
+        eval_masks(masks, strength, k);
+    }
+    sink = strength[0];
+}
+
+void bench_best_hand(long n)
+{
+    long i;
+
+    for (i = 0; i < n; i++)
+        get_best_player_hand(g, i % N_PLAYERS);
+}
+
+void bench_omaha_best_hand(long n)
+{
+    long i;
+
+    for (i = 0; i < n; i++)
+        get_best_player_hand(variant_games[VARIANT_OMAHA], i % N_PLAYERS);
+}
+
+void bench_short_best_hand(long n)
+{
+    long i;
+
+    for (i = 0; i < n; i++)
+        get_best_player_hand(variant_games[VARIANT_SHORT_DECK], i % N_PLAYERS);
+}
+
+void bench_player_ranks(long n)
+{
+    player_rank_t ranks[MAX_PLAYERS];
+    long i;
+
+    for (i = 0; i < n; i++)
+        get_player_ranks(g, ranks);
+    sink = ranks[0].player;
+}
+
+void bench_side_pots(long n)
+{
+    /* ten players all in with different stacks: up to ten pots */
+    int strength[N_PLAYERS];
+    long i;
+    int p;
+
+    for (i = 0; i < n; i++) {
+        new_hand(g);
+        for (p = 0; p < N_PLAYERS; p++) {
+            g->players[p].chips = 1 + next_random() % 1000;
+            g->players[p].bet = 0;
+            g->players[p].allin = g->players[p].folded = 0;
+            strength[p] = next_random() % 8;
+        }
+        for (p = 0; p < N_PLAYERS; p++)
+            bet(g, p, 1000);
+        end_betting_round(g);
+        award_pots(g, strength, NULL);
+    }
+}
+
+void bench_engine_hand(long n)
+{
+    /* whole hands, from the blinds to the last award, at random */
+    static const enum action moves[] = {
+        ACT_CHECK, ACT_CALL, ACT_CALL, ACT_CALL, ACT_RAISE, ACT_FOLD
+    };
+    uint64_t r;
+    long i;
+    int p;
+
+    for (i = 0; i < n; i++) {
+        for (p = 0; p < N_PLAYERS; p++)
+            if (g->players[p].chips < 100)
+                g->players[p].chips = 1000;
+        engine_deal(g);
+        engine_drop_events(g);
+        while (engine_waiting(g)) {
+            r = next_random();
+            if (engine_act(g, g->turn, moves[r % 6], (r >> 8) % 50) != ACT_OK)
+                engine_act(g, g->turn, ACT_CALL, 0);
+            engine_drop_events(g);
+        }
+    }
+}
+
+static const struct bench benches[] = {
+    { "shuffle",      "deck",  bench_shuffle },
+    { "deal",         "hand",  bench_deal },
+    { "rank_hand",    "hand",  bench_rank_hand },
+    { "handcmp",      "pair",  bench_handcmp },
+    { "eval_hand",    "hand",  bench_eval_hand },
+    { "eval_mask",    "hand",  bench_eval_mask },
+    { "eval_masks",   "hand",  bench_eval_masks },
+    { "best_hand",    "player", bench_best_hand },
+    { "omaha_best_hand", "player", bench_omaha_best_hand },
+    { "short_best_hand", "player", bench_short_best_hand },
+    { "player_ranks", "table", bench_player_ranks },
+    { "side_pots",    "hand",  bench_side_pots },
+    { "engine_hand",  "hand",  bench_engine_hand }
+};
+
+int cmp_double(const void *a, const void *b)
+{
+    double d = *(const double *) a - *(const double *) b;
+    return (d > 0) - (d < 0);
+}
+
+double percentile(const double s[], int n, double q)
+{
+    return s[(int) (q * (n - 1) + 0.5)];
+}
+
+void measure(const struct bench *b, int samples, double batch_ns, int json)
+{
+    double ns[SAMPLES];
+    double start, t;
+    long batch = 1;
+    int i;
+
+    /* warm up, and find a batch size worth timing */
+    for (;;) {
+        start = now_ns();
+        b->run(batch);
+        if (now_ns() - start >= batch_ns || batch >= 1L << 30)
+            break;
+        batch *= 2;
+    }
+
+    for (i = 0; i < samples; i++) {
+        start = now_ns();
+        b->run(batch);
+        t = now_ns() - start;
+        ns[i] = t / batch;
+    }
+    qsort(ns, samples, sizeof ns[0], cmp_double);
+
+    if (json)
+        printf("{\"bench\":\"%s\",\"unit\":\"%s\",\"batch\":%ld,\"samples\":%d,"
+               "\"ns_p50\":%.2f,\"ns_p90\":%.2f,\"ns_p99\":%.2f,\"ns_min\":%.2f,"
+               "\"per_sec\":%.0f}\n",
+               b->name, b->unit, batch, samples,
+               percentile(ns, samples, 0.5), percentile(ns, samples, 0.9),
+               percentile(ns, samples, 0.99), ns[0],
+               1e9 / percentile(ns, samples, 0.5));
+    else
+        printf("%-13s %10.1f %10.1f %10.1f %10.1f %12.0f %ss/s\n", b->name,
+               percentile(ns, samples, 0.5), percentile(ns, samples, 0.9),
+               percentile(ns, samples, 0.99), ns[0],
+               1e9 / percentile(ns, samples, 0.5), b->unit);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    int json = 0, samples = SAMPLES, picked = 0;
+    double batch_ns = BATCH_NS;
+    int i, a;
+
+    for (a = 1; a < argc && argv[a][0] == '-'; a++) {
+        if (strcmp(argv[a], "-j") == 0) {
+            json = 1;
+        } else if (strcmp(argv[a], "-q") == 0) {
+            samples = 11;
+            batch_ns = BATCH_NS / 4;
+        } else {
+            fprintf(stderr, "usage: benchmark [-j] [-q] [name...]\n");
+            return 2;
+        }
+    }
+
+    setup();
+    if (!json)
+        printf("%-13s %10s %10s %10s %10s %12s\n", "ns/op", "p50", "p90", "p99",
+               "best", "rate (p50)");
+    for (i = 0; i < (int) (sizeof benches / sizeof benches[0]); i++) {
+        int want = a == argc;
+        int k;
+
+        for (k = a; k < argc; k++)
+            if (strncmp(benches[i].name, argv[k], strlen(argv[k])) == 0)
+                want = 1;
+        if (!want)
+            continue;
+        /* every benchmark sees the same random numbers */
+        x = 0x9e3779b97f4a7c15ULL;
+        measure(&benches[i], samples, batch_ns, json);
+        picked++;
+    }
+    free_game(g);
+
+    if (!picked) {
+        fprintf(stderr, "no such benchmark\n");
+        return 2;
+    }
+    return 0;
+}
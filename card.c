@@ -1,17 +1,41 @@
 /* Copyright 2011 Tom Jollans <t@jollybox.de>
  * This code is under the Chicken Dance License v0.1 */
 
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include "card.h"
 
-char *irc_print_card (card_t card, int color, int utf8)
+pcard_t card_pack (card_t card)
+{
+    return PCARD(card.suit, VALUE_TO_RANK(card.value));
+}
+
+card_t card_unpack (pcard_t c)
+{
+    card_t card;
+
+    card.value = RANK_TO_VALUE(PCARD_RANK(c));
+    card.suit = PCARD_SUIT(c);
+    card.idx = card.suit * 13 + card.value - 1;
+    card.dealt = 0;
+    card.cardholder = 0;
+    return card;
+}
+
+/* every card in every style. built once, read-only after. */
+static char glyphs[4][64][CARD_GLYPH_MAX];     /* [color << 1 | utf8][card] */
+static unsigned char glyph_len[4][64];
+static pthread_once_t glyphs_once = PTHREAD_ONCE_INIT;
+
+static int render_card (char *resp, pcard_t c, int color, int utf8)
 {
     static const char *red_start = "\x03" "4 ";
     static const char *red_end = "\x03";
 
-    static char result[32];
-    char *resp = result;
+    char *start = resp;
     int red = 0;
+    card_t card = card_unpack(c);
 
     switch (card.suit) {
         case DIAMONDS:
@@ -66,6 +90,55 @@ char *irc_print_card (card_t card, int color, int utf8)
 
     *resp = '\0';
 
-    return result;
+    return resp - start;
 }
 
+static void build_glyphs (void)
+{
+    int mode, suit, rank;
+    pcard_t c;
+
+    for (mode = 0; mode < 4; mode++) {
+        for (suit = CLUBS; suit <= SPADES; suit++) {
+            for (rank = 0; rank < 13; rank++) {
+                c = PCARD(suit, rank);
+                glyph_len[mode][c] = render_card(glyphs[mode][c], c,
+                                                 mode >> 1, mode & 1);
+            }
+        }
+    }
+}
+
+void init_card_glyphs (void)
+{
+    pthread_once(&glyphs_once, build_glyphs);
+}
+
+const char *irc_print_card (pcard_t c, int color, int utf8)
+{
+    init_card_glyphs();
+    return glyphs[!!color << 1 | !!utf8][c & 0x3f];
+}
+
+int append_cards (char *buf, int size, int len, const pcard_t cards[], int n,
+                  int color, int utf8)
+{
+    int mode = !!color << 1 | !!utf8;
+    int i, l;
+    pcard_t c;
+
+    init_card_glyphs();
+    for (i = 0; i < n; i++) {
+        c = cards[i] & 0x3f;
+        l = glyph_len[mode][c];
+        if (len + (i > 0) + l >= size)
+            break;
+        if (i > 0)
+            buf[len++] = ' ';
+        memcpy(buf + len, glyphs[mode][c], l);
+        len += l;
+    }
+    if (len < size)
+        buf[len] = '\0';
+    return len;
+}
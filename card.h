@@ -4,6 +4,8 @@
 #ifndef CARD_H
 #define CARD_H
 
+#include <stdint.h>
+
 #define COMMUNITY -1 /* if a card_t's cardholder is this, then it's a community card */
 
 typedef enum suit {
@@ -21,7 +23,48 @@ typedef struct card {
     int cardholder; 
 } card_t;
 
-char *irc_print_card (card_t card, int color, int utf8);
+/* The packed card is what the game works with; card_t is only for show.
+ *
+ * A pcard_t is one byte: the suit in bits 4-5, the rank (twos are 0, aces
+ * are 12) in bits 0-3. Used as a bit number, it puts each suit into its own
+ * 16-bit lane of a cardmask_t, so a whole hand is one 64-bit word, a flush
+ * is five bits in one lane and a straight is five bits in a row. */
+typedef unsigned char pcard_t;
+typedef uint64_t cardmask_t;
+
+#define PCARD(suit, rank)   ((pcard_t)((suit) << 4 | (rank)))
+#define PCARD_RANK(c)       ((c) & 0xf)
+#define PCARD_SUIT(c)       ((suit_t)((c) >> 4))
+#define PCARD_BIT(c)        ((cardmask_t)1 << (c))
+
+/* the 13-bit rank mask of one suit */
+#define MASK_SUIT(m, suit)  ((int)((m) >> ((suit) * 16)) & 0x1fff)
+/* the ranks present in any suit */
+#define MASK_RANKS(m)       (MASK_SUIT(m, CLUBS) | MASK_SUIT(m, DIAMONDS) \
+                            | MASK_SUIT(m, HEARTS) | MASK_SUIT(m, SPADES))
+#define MASK_COUNT(m)       __builtin_popcountll(m)
+
+/* card_t values have aces at 1 and kings at 13 */
+#define VALUE_TO_RANK(v)    (((v) + 11) % 13)
+#define RANK_TO_VALUE(r)    (((r) + 1) % 13 + 1)
+
+pcard_t card_pack (card_t card);
+card_t card_unpack (pcard_t card);
+
+/* the longest card, colour codes and all, NUL included */
+#define CARD_GLYPH_MAX 16
+/* room for n cards printed by append_cards() */
+#define CARDS_STR_MAX(n) ((n) * CARD_GLYPH_MAX)
+
+/* renders all cards in all styles. done on first use anyway, but threads
+ * had better not race for it. */
+void init_card_glyphs (void);
+/* points into a read-only table: nothing to free, safe from any thread */
+const char *irc_print_card (pcard_t card, int color, int utf8);
+/* prints n cards, separated by spaces, at buf + len. stops before a card
+ * that doesn't fit into size, and NUL-terminates. returns the new length. */
+int append_cards (char *buf, int size, int len, const pcard_t cards[], int n,
+                  int color, int utf8);
 
 #endif
 
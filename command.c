@@ -1,638 +1,972 @@
 /* Copyright 2011 Tom Jollans <t@jollybox.de>
  * This code is under the Chicken Dance License v0.1 */
 
+#include "atlas.h"
 #include "command.h"
-#include <ctype.h>
+#include "engine.h"
+#include "log.h"
+#include "parse.h"
+#include "sendq.h"
+#include "sim.h"
+#include "stats.h"
+#include "tourney.h"
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
 
-char *
-first_word (const char *txt)
+static void turn_timeout (struct timer *t);
+
+static void
+show_cards (irc_session_t *session, game_tp game, const char *to,
+            const char *what, const pcard_t cards[], int n)
 {
+    /* on one line, or as pictures if the House likes big cards */
+    char row[SENDQ_LINE_MAX];
+    int size = sendq_room(to) + 1;
     int i;
 
-    for (i=0; txt[i] && !isspace(txt[i]); ++i);
+    if (size > (int) sizeof row)
+        size = sizeof row;
 
-    return strndup(txt, i);
+    if (game->big_cards && atlas_height() > 0) {
+        send_msg(session, to, what);
+        for (i = 0; i < atlas_height(); i++) {
+            atlas_row(row, size, 0, cards, n, i);
+            send_art(session, to, row);
+        }
+    } else {
+        append_cards(row, size, 0, cards, n, USE_COLOR, USE_UTF8);
+        send_msgf(session, to, "%s %s", what, row);
+    }
 }
 
-void
-separate_first_word (char **txt, char **restp)
+static void
+start_clock (game_tp game)
 {
-    char *p;
-
-    while (isspace(**txt)) (*txt)++;
-    for (p = *txt; *p && !isspace(*p); ++p);
-    
-    if (*p && *(p+1))
-        *restp = p+1;
-    else /* end of string */
-        *restp = NULL;
+    double t = game->turn_seconds;
 
-    *p = '\0';
+    if (t <= 0 || !game->channel)
+        return;
+    game->turn_warned = t <= TURN_WARNING;
+    game->turn_timer.fn = turn_timeout;
+    timer_add(thread_timers(), &game->turn_timer, timer_now(),
+              game->turn_warned ? t : t - TURN_WARNING);
 }
 
-static void advance_game (irc_session_t *, game_tp, const char *);
+static const char *hand_names[] = {
+    "high card", "one pair", "two pair", "three of a kind", "a straight",
+    "a flush", "a full house", "four of a kind", "a straight flush",
+    "a royal flush"
+};
+
+static const char *street_names[] = {
+    [3] = "Flop. Community cards:",
+    [4] = "Turn. Community cards:",
+    [5] = "River. Community cards:"
+};
 
 static void
-set_turn (irc_session_t *session,
-          game_tp game,
-          const char *channel,
-          int player_id,
-          int new_round)
+tell_event (irc_session_t *session, game_tp game, const char *channel,
+            const struct event *e)
 {
-    char *s;
-
-    int original_player = player_id;
-    int bet;
-    goto do_player;
-skip_player:
-    new_round = 0;
-    player_id = next_player(game, player_id);
-    if (player_id == original_player || player_id == -1) {
-        advance_game(session, game, channel);
-        return;
+    /* what the engine did, in words */
+    const char *nick = e->player >= 0 ? game->players[e->player].nick : NULL;
+    player_t *p = e->player >= 0 ? &game->players[e->player] : NULL;
+    char what[NICK_LEN + 32];
+
+    switch (e->type) {
+        case EV_SMALL_BLIND:
+            send_msgf(session, channel, "%s pays small blind of %d.", nick, e->amount);
+            break;
+        case EV_BIG_BLIND:
+            send_msgf(session, channel, "%s pays big blind of %d.", nick, e->amount);
+            break;
+        case EV_DEALT:
+            show_cards(session, game, nick, "Your cards:", p->hand,
+                       game->variant->n_hole);
+            break;
+        case EV_HANDS_DEALT:
+            send_msg(session, channel, "Hands dealt.");
+            break;
+        case EV_PROMPT_CHECK:
+            send_msgf(session, channel, "No bet. %s, you may check or raise.", nick);
+            break;
+        case EV_PROMPT_CALL:
+            send_msgf(session, channel, "The bet is %d. %s, you may call or raise the bet.",
+                      e->amount, nick);
+            break;
+        case EV_PROMPT_OPTION:
+            send_msgf(session, channel, "The bet is still %d. %s, you may call or raise.",
+                      e->amount, nick);
+            break;
+        case EV_AUTO_FOLD:
+            send_msgf(session, channel, "%s is inactive and folds by default.", nick);
+            break;
+        case EV_ALREADY_ALL_IN:
+            send_msgf(session, channel, "%s is already all in.", nick);
+            break;
+        case EV_CHECK:
+            send_msgf(session, channel, "%s checks.", nick);
+            break;
+        case EV_CALL:
+            send_msgf(session, channel, "%s calls.", nick);
+            break;
+        case EV_RAISE:
+            send_msgf(session, channel, "%s raises by %d to %d.", nick, e->amount, e->total);
+            break;
+        case EV_ALL_IN:
+            send_msgf(session, channel, "%s goes all in.", nick);
+            break;
+        case EV_NOT_ALL_IN:
+            send_msgf(session, channel, "%s should have been all in by now.", nick);
+            break;
+        case EV_FOLD:
+            send_msgf(session, channel, "%s folds.", nick);
+            break;
+        case EV_TIMEOUT_CHECK:
+            send_msgf(session, channel, "%s is out of time and checks. "
+                      "Say 're' to play on.", nick);
+            break;
+        case EV_TIMEOUT_FOLD:
+            send_msgf(session, channel, "%s is out of time and folds. "
+                      "Say 're' to play on.", nick);
+            break;
+        case EV_STREET:
+            show_cards(session, game, channel, street_names[e->amount],
+                       game->community, e->amount);
+            break;
+        case EV_SHOW:
+            snprintf(what, sizeof what, "%s shows %s:", nick,
+                     hand_names[STRENGTH_RANK(e->amount)]);
+            show_cards(session, game, channel, what, p->best_hand, 5);
+            break;
+        case EV_WIN:
+            send_msgf(session, channel, "%s wins %d. They now have a total of %d.",
+                      nick, e->amount, p->chips);
+            break;
+        case EV_WIN_BY_DEFAULT:
+            send_msgf(session, channel, "Everybody else has folded. %s wins by default.",
+                      nick);
+            break;
+        case EV_AWARD:
+            send_msgf(session, channel, "%s is awarded %d. They now have a total of %d.",
+                      nick, e->amount, p->chips);
+            break;
+        case EV_HAND_OVER:
+            if (game->tourney)
+                send_msg(session, channel, "That's the hand.");
+            else
+                send_msg(session, channel, "That's the hand. The House may deal the next one.");
+            break;
+        case EV_TOO_FEW_PLAYERS:
+            send_msg(session, channel, "Two active players required. Aborting.");
+            break;
+        case EV_NO_PLAYER:
+            send_msg(session, channel, "Cannot find player. Aborting.");
+            break;
+        case EV_NOBODY_LEFT:
+            send_msg(session, channel, "No players left? This may be an error, "
+                        "but I'll just go out for a beer with all that cash.");
+            break;
+        case EV_ANOMALOUS_BETS:
+            send_msg(session, channel, "ERROR: Anomalous bets.");
+            break;
+        case EV_TOO_MANY_PLAYERS:
+            send_msgf(session, channel, "There are cards for %d players at most. Aborting.",
+                      e->amount);
+            break;
     }
-do_player:
-    bet = game->pots[game->n_pots-1].bet;
-    player_t *player = & game->players[player_id];
+}
 
-    if (player->folded) {
-        fprintf(stderr, "WARNING: Folded player passed to set_turn(). This should never happen.\n");
-        goto skip_player;
+static void
+play_on (irc_session_t *session, game_tp game, const char *channel)
+{
+    /* after the engine has moved: say what happened, and start the clock
+     * on whoever's turn it is now. a tournament's table may be gone after
+     * the hand. */
+    struct event e;
+    int over = 0;
+
+    while (engine_next_event(game, &e)) {
+        tell_event(session, game, channel, &e);
+        over |= e.type == EV_HAND_OVER;
     }
+    if (engine_waiting(game))
+        start_clock(game);
+    else
+        timer_cancel(&game->turn_timer);
+    if (over)
+        tourney_hand_over(game);
+}
 
-    if (bet < player->bet) {
-        fprintf(stderr, "ERROR: Anomalous bets.\n");
-        irc_cmd_msg(session, channel, "ERROR: Anomalous bets.");
-        goto skip_player;
+static void
+turn_timeout (struct timer *t)
+{
+    /* first a warning, then the player's out of time */
+    game_tp game = (game_tp) ((char *) t - offsetof(struct game, turn_timer));
+
+    if (!game->turn_warned) {
+        send_msgf(game->session, game->channel, "%s, %d seconds left to act.",
+                  game->players[game->turn].nick, TURN_WARNING);
+        game->turn_warned = 1;
+        timer_add(thread_timers(), t, timer_now(), TURN_WARNING);
+        return;
     }
+    engine_act(game, game->turn, ACT_TIMEOUT, 0);
+    play_on(game->session, game, game->channel);
+}
 
-    if (player->allin) {
-        if (asprintf(&s, "%s is already all in.", player->nick) != -1) {
-            irc_cmd_msg(session, channel, s);
-            free(s);
-        }
-        goto skip_player;
+/* what a command handler gets to know */
+struct cmd_ctx {
+    irc_session_t *session;
+    const char *nick;       /* who said it */
+    const char *channel;    /* where, or NULL in a private message */
+    const char *to;         /* where the answer goes */
+    game_tp game;
+    int player_id;          /* table declarations only. -1: not at the table */
+};
+
+static void
+say (struct cmd_ctx *c, const char *fmt, ...)
+{
+    va_list ap;
+    char *resp;
+    int r;
+
+    va_start(ap, fmt);
+    r = vasprintf(&resp, fmt, ap);
+    va_end(ap);
+    if (r != -1) {
+        send_msg(c->session, c->to, resp);
+        free(resp);
     }
+}
+
+static int
+in_tourney (struct cmd_ctx *c)
+{
+    /* nobody is The House at a tournament's table */
+    if (!c->game->tourney)
+        return 0;
+    send_msg(c->session, c->channel, "This table belongs to a tournament.");
+    return 1;
+}
+
+static void
+do_quit (struct cmd_ctx *c, const struct line *l)
+{
+    send_msg(c->session, c->to, "Live long and prosper. Good-bye!");
+    quit_session(c->session, "Fold.");
+}
+
+static void
+do_help (struct cmd_ctx *c, const struct line *l)
+{
+    send_msg(c->session, c->to, "This is ircpoker.");
+    send_msg(c->session, c->to, "List of available bot commands: quit, init, game, set, deal, end, stats, top, tourney, help");
+    send_msg(c->session, c->to, "List of in-game to-the-table declarations: what's the game?, join game, afk, leave game, re, back, odds");
+}
 
-    if (!new_round && bet == 0 && player_id == next_player(game, game->button)) {
-        /* everybody hath checked. How boring. */
-        advance_game(session, game, channel);
+static void
+do_init (struct cmd_ctx *c, const struct line *l)
+{
+    /* new game */
+    game_tp game;
+    int i;
+
+    if (!c->channel) {
+        send_msg(c->session, c->nick, "Games can only be created in channels");
         return;
     }
-
-    if (bet == 0) {
-        game->turn = player_id;
-        if (asprintf(&s, "No bet. %s, you may check or raise.",
-                         player->nick) != -1) {
-            irc_cmd_msg(session, channel, s);
-            free(s);
-        }
-        goto check_active;
+    if (get_channel_game(c->session, c->channel)) {
+        say(c, "%s: There is already a game in this channel.", c->nick);
+        return;
     }
 
-    if (bet > player->bet) {
-        game->turn = player_id;
-        if (asprintf(&s, "The bet is %d. %s, you may call or raise the bet.",
-                         bet, player->nick) != -1) {
-            irc_cmd_msg(session, channel, s);
-            free(s);
-        }
-        goto check_active;
-    }
-
-    if (bet == player->bet) {
-        /* everybody agrees. */
-        if (game->phase == PHASE_PRE_FLOP &&
-            bet == game->big_blind &&
-            player_id == next_player(game, next_player(game, game->button))) {
-            /* pre-flop. Big-blindist may raise. */
-            game->turn = player_id;
-            if (asprintf(&s, "The bet is still %d. %s, you may call or raise.",
-                             bet, player->nick) != -1) {
-                irc_cmd_msg(session, channel, s);
-                free(s);
-            }
-            goto check_active;
-        } else {
-            advance_game(session, game, channel);
-            return;
-        }
+    if (!(game = new_game(0))) {
+        log_msg(LOG_ERROR, "out of memory for a new game.");
+        return;
+    }
+    i = add_player(game, c->nick);
+    game->players[i].active = 1;
+    game->house = &game->players[i];
+    game->session = c->session;
+    game->server = get_server_name(c->session);
+    game->channel = strdup(c->channel);
+    if (registry_add(c->session, c->channel, game) != 0) {
+        log_msg(LOG_ERROR, "could not register game in %s.", c->channel);
+        free_game(game);
+        return;
     }
 
-    fprintf(stderr, "ERROR: set_turn improperly concluded.\n");
-    return;
+    list_game_info(c->session, game, c->channel);
+}
 
-check_active:
-    if (!player->active) {
-        if (asprintf(&s, "%s is inactive and folds by default.",
-                         player->nick) != -1) {
-            irc_cmd_msg(session, channel, s);
-            free(s);
-        }
-        fold(game, player_id);
-        goto skip_player;
+static void
+do_game (struct cmd_ctx *c, const struct line *l)
+{
+    char chan[64];
+
+    if (c->channel) {
+        c->game = get_channel_game(c->session, c->channel);
+    } else if (l->n > 1 && l->tok[1].len < (int) sizeof chan) {
+        /* in private, ask about any channel */
+        memcpy(chan, l->tok[1].s, l->tok[1].len);
+        chan[l->tok[1].len] = '\0';
+        c->game = get_channel_game(c->session, chan);
     }
-    else return;
+
+    if (c->game)
+        list_game_info(c->session, c->game, c->to);
+    else
+        send_msg(c->session, c->to, "No game.");
 }
 
+enum setting { BASE_STOCK, SMALL_BLIND, BIG_BLIND, BIG_CARDS, TURN_TIME };
+
+static const struct {
+    const char *w1, *w2;
+    enum setting which;
+} settings[] = {
+    { "base", "stock", BASE_STOCK },
+    { "small", "blind", SMALL_BLIND },
+    { "big", "blind", BIG_BLIND },
+    { "big", "cards", BIG_CARDS },
+    { "turn", "time", TURN_TIME }
+};
+
 static void
-deal_round (irc_session_t *session,
-            game_tp game,
-            const char *channel)
+set_game_variant (struct cmd_ctx *c, const struct line *l)
 {
-    char *s;
+    /* set variant [=|to] {name} */
+    const struct token *name = &l->tok[2];
+    const struct variant *v;
+
+    if (l->n >= 4 && (token_is(name, "=") || token_is(name, "to")))
+        name = &l->tok[3];
+    if (!(v = variant_named(name->s, name->len))) {
+        send_msg(c->session, c->channel, "Usage: set variant [|=|to] {holdem|omaha|shortdeck}");
+        return;
+    }
+    if (c->game->phase != PHASE_PRE_DEAL) {
+        send_msg(c->session, c->channel, "Not in the middle of a hand.");
+        return;
+    }
+    set_variant(c->game, v);
+    say(c, "The game is %s.", v->title);
+}
 
-    if (!game->phase == PHASE_PRE_DEAL) return;
+static void
+do_set (struct cmd_ctx *c, const struct line *l)
+{
+    /* set {setting} [=|to] {value} */
+    const struct token *val;
+    game_tp game;
+    int i, s;
 
-    undeal(game);
-    int i;
-    for (i=0; i<game->n_players; ++i) {
-        game->players[i].folded = (!game->players[i].active)
-                                || game->players[i].chips == 0;
-        game->players[i].bet = 0;
-        game->players[i].allin = 0;
+    if (!(game = c->game = get_channel_game(c->session, c->channel))) {
+        send_msg(c->session, c->to, "No game.");
+        return;
     }
-    /* get rid of all pots. */
-    for (i=0; i<game->n_pots; ++i) {
-        free(game->pots[i].players);
+    if (in_tourney(c))
+        return;
+    if (strcmp(c->nick, game->house->nick) != 0) {
+        send_msg(c->session, c->channel, "Only The House may change the rules.");
+        return;
     }
-    game->n_pots = 1;
-    game->pots[0].players = NULL;
-    game->pots[0].n_players = 0;
-    game->pots[0].content = 0;
-    game->pots[0].bet = 0;
-    shuffle_deck(game);
-
-    int small = next_player(game, game->button);
-    if (small < 0) {
-        irc_cmd_msg(session, channel, "Two active players required. Aborting.");
+    if (l->n < 2) {
+        send_msg(c->session, c->channel, "Usage: set [base stock|small blind|big blind|big cards|turn time] [|=|to] {value}, or set variant {holdem|omaha|shortdeck}");
         return;
     }
-    int big = next_player(game, small);
-    if (big < 0) {
-        irc_cmd_msg(session, channel, "Cannot find player. Aborting.");
+    if (l->n >= 3 && token_is(&l->tok[1], "variant")) {
+        set_game_variant(c, l);
         return;
     }
 
-    bet (game, small, game->small_blind);
-    if (asprintf(&s, "%s pays small blind of %d.", game->players[small].nick,
-                                                   game->small_blind) != -1) {
-        irc_cmd_msg(session, channel, s);
-        free(s);
+    val = NULL;
+    if (l->n >= 4 && l->tok[3].is_num)
+        val = &l->tok[3];
+    else if (l->n >= 5 && (token_is(&l->tok[3], "=") || token_is(&l->tok[3], "to"))
+                       && l->tok[4].is_num)
+        val = &l->tok[4];
+
+    for (s = 0; s < (int) (sizeof settings / sizeof settings[0]); s++)
+        if (l->n >= 3 && token_is(&l->tok[1], settings[s].w1)
+                      && token_is(&l->tok[2], settings[s].w2))
+            break;
+    if (!val || s == sizeof settings / sizeof settings[0]) {
+        send_msg(c->session, c->channel, "Unknown setting.");
+        send_msg(c->session, c->channel, "Usage: set [base stock|small blind|big blind|big cards|turn time] [|=|to] {value}, or set variant {holdem|omaha|shortdeck}");
+        return;
     }
 
-    bet (game, big, game->big_blind);
-    if (asprintf(&s, "%s pays big blind of %d.", game->players[big].nick,
-                                                 game->big_blind) != -1) {
-        irc_cmd_msg(session, channel, s);
-        free(s);
+    switch (settings[s].which) {
+        case BASE_STOCK:
+            game->base_stock = val->num;
+            for (i=0; i<game->n_players; ++i) {
+                if (game->players[i].chips < val->num) {
+                    int delta = val->num - game->players[i].chips;
+                    game->players[i].chips = val->num;
+                    say(c, "%s given %d in chips.", game->players[i].nick, delta);
+                   
+                }
+            }
+            break;
+        case SMALL_BLIND:
+            game->small_blind = val->num;
+            break;
+        case BIG_BLIND:
+            game->big_blind = val->num;
+            break;
+        case BIG_CARDS:
+            game->big_cards = val->num != 0;
+            if (game->big_cards && atlas_height() == 0)
+                send_msg(c->session, c->channel, "I can't find my big cards. Small ones it is.");
+            break;
+        case TURN_TIME:
+            /* from the next turn on */
+            game->turn_seconds = val->num;
+            break;
     }
+}
 
+static void
+do_end (struct cmd_ctx *c, const struct line *l)
+{
+    if (!(c->game = get_channel_game(c->session, c->channel))) {
+        send_msg(c->session, c->to, "No game.");
+        return;
+    }
+    if (in_tourney(c))
+        return;
+    if (strcmp(c->nick, c->game->house->nick) != 0) {
+        send_msg(c->session, c->channel, "Only The House may end the game.");
+        return;
+    }
+    end_channel_game(c->session, c->channel);
+    send_msg(c->session, c->channel, "Game over. Thanks for playing!");
+}
 
-    int pidx = small;
-    do {
-        deal(game, pidx);
-        char *card1 = strdup(irc_print_card(game->players[pidx].hand[0], USE_COLOR, USE_UTF8));
-        char *card2 = strdup(irc_print_card(game->players[pidx].hand[1], USE_COLOR, USE_UTF8));
-        if (asprintf(&s, "Your cards: %s %s", card1, card2) != -1) {
-            irc_cmd_msg(session, game->players[pidx].nick, s);
-            free(s);
-        }
-        free(card1);
-        free(card2);
-    } while ((pidx = next_player(game, pidx)) != small);
+static void
+do_deal (struct cmd_ctx *c, const struct line *l)
+{
+    if (!(c->game = get_channel_game(c->session, c->channel))) {
+        send_msg(c->session, c->to, "No game.");
+        return;
+    }
+    if (in_tourney(c))
+        return;
+    if (strcmp(c->nick, c->game->house->nick) != 0) {
+        send_msg(c->session, c->channel, "Only The House may call for first deal.");
+        return;
+    }
+    engine_deal(c->game);
+    play_on(c->session, c->game, c->channel);
+}
 
-    game->phase = PHASE_PRE_FLOP;
+#define TOP_DEFAULT 5
+#define TOP_MAX 10
 
-    irc_cmd_msg(session, channel, "Hands dealt.");
-    set_turn(session, game, channel, next_player(game, big), 0);
+static int
+percent (uint32_t n, uint32_t of)
+{
+    return of ? (int) (100.0 * n / of + 0.5) : 0;
 }
 
 static void
-advance_game (irc_session_t *session,
-              game_tp game,
-              const char *channel)
+do_stats (struct cmd_ctx *c, const struct line *l)
 {
-    int i;
-    char *s;
-    char *card1, *card2, *card3, *card4, *card5;
-    int active_players = 0;
-    int last_active = -1;
-
-    /* new betting round. Zero bets. */
-    for (i = 0; i < game->n_players; ++i) {
-        game->players[i].bet = 0;
-        if (!game->players[i].folded) {
-            active_players++;
-            last_active = i;
-        }
+    /* stats [nick] */
+    struct player_stats st;
+    char nick[NICK_LEN];
+
+    if (!c->channel) {
+        send_msg(c->session, c->nick, "Stats are kept per channel. Ask in one.");
+        return;
     }
-    for (i = 0; i < game->n_pots; ++i) {
-        game->pots[i].bet = 0;
+    if (l->n > 1 && l->tok[1].len < NICK_LEN) {
+        memcpy(nick, l->tok[1].s, l->tok[1].len);
+        nick[l->tok[1].len] = '\0';
+    } else {
+        strcpy(nick, c->nick);
     }
+    if (stats_get(c->session, c->channel, nick, &st) != 0) {
+        say(c, "%s hasn't played here.", nick);
+        return;
+    }
+    say(c, "%s: %lu hands, voluntarily in %d%%, raised preflop %d%%, "
+           "won %lu (%d%%), %+lld chips, biggest pot %ld.",
+        st.nick, (unsigned long) st.hands, percent(st.vpip, st.hands),
+        percent(st.raised, st.hands), (unsigned long) st.won,
+        percent(st.won, st.hands), (long long) st.net, (long) st.biggest_pot);
+}
 
-    if (active_players == 0) {
-        irc_cmd_msg(session, channel, "No players left? This may be an error, "
-                    "but I'll just go out for a beer with all that cash.");
+static void
+do_top (struct cmd_ctx *c, const struct line *l)
+{
+    /* top [n] */
+    struct player_stats top[TOP_MAX];
+    char line[SENDQ_LINE_MAX];
+    int size = sendq_room(c->to) + 1;
+    int n = TOP_DEFAULT, len, i;
+
+    if (!c->channel) {
+        send_msg(c->session, c->nick, "Stats are kept per channel. Ask in one.");
         return;
     }
-    if (active_players == 1) {
-        if (asprintf(&s, "Everybody else has folded. %s wins by default.",
-                          game->players[last_active].nick) != -1) {
-            irc_cmd_msg(session, channel, s);
-            free(s);
-        }
-        /* Only one player left => nobody else all-in => one non-empty pot. */
-        if (game->n_pots > 1 && game->pots[1].content != 0) {
-            irc_cmd_msg(session, channel, "Error: There is more than one pot.");
-            fprintf(stderr, "ERROR: There is more than one pot.\n");
+    if (l->n > 1 && l->tok[1].is_num)
+        n = l->tok[1].num;
+    if (n < 1 || n > TOP_MAX)
+        n = n < 1 ? 1 : TOP_MAX;
+    if (!(n = stats_top(c->session, c->channel, top, n))) {
+        send_msg(c->session, c->to, "Nobody has played here yet.");
+        return;
+    }
+
+    if (size > (int) sizeof line)
+        size = sizeof line;
+    len = snprintf(line, size, "Most chips won in %s:", c->channel);
+    for (i = 0; i < n && len < size; i++)
+        len += snprintf(line + len, size - len, "%s %d. %s %+lld",
+                        i ? "," : "", i + 1, top[i].nick, (long long) top[i].net);
+    send_msg(c->session, c->to, line);
+}
+
+static const char *const tourney_errors[] = {
+    [TOURNEY_OK] = "",
+    [TOURNEY_NO_TOURNEY] = "There is no tournament here. Open one with 'tourney open'.",
+    [TOURNEY_ALREADY_ON] = "There is a tournament on here already.",
+    [TOURNEY_NOT_HOUSE] = "Only whoever opened the tournament may do that.",
+    [TOURNEY_NOT_OPEN] = "The tournament isn't taking names.",
+    [TOURNEY_ALREADY_IN] = "You're in already.",
+    [TOURNEY_NOT_IN] = "You aren't in the tournament.",
+    [TOURNEY_TOO_FEW] = "A tournament needs at least two players.",
+    [TOURNEY_BAD_NAME] = "This channel's name is too long for the tables'.",
+    [TOURNEY_NO_MEMORY] = "Out of memory."
+};
+
+static int
+parse_rules (struct cmd_ctx *c, const struct line *l, struct tourney_rules *rules)
+{
+    /* open [seats N] [stack N] [minutes N] [turn N] [variant] */
+    const struct token *t;
+    int i;
+
+    *rules = tourney_defaults;
+    for (i = 2; i < l->n; i++) {
+        t = &l->tok[i];
+        if (i + 1 < l->n && l->tok[i + 1].is_num && l->tok[i + 1].num > 0) {
+            int n = l->tok[i + 1].num;
+
+            if (token_is(t, "seats") && n >= 2) {
+                rules->seats = n;
+                i++;
+                continue;
+            } else if (token_is(t, "stack")) {
+                rules->stack = n;
+                i++;
+                continue;
+            } else if (token_is(t, "minutes")) {
+                rules->level_seconds = 60 * n;
+                i++;
+                continue;
+            } else if (token_is(t, "turn")) {
+                rules->turn_seconds = n;
+                i++;
+                continue;
+            }
         }
-        game->players[last_active].chips += game->pots[0].content;
-        if (asprintf(&s, "%s is awarded %d. They now have a total of %d.",
-                          game->players[last_active].nick,
-                          game->pots[0].content,
-                          game->players[last_active].chips) != -1) {
-            irc_cmd_msg(session, channel, s);
-            free(s);
+        if (variant_named(t->s, t->len)) {
+            rules->variant = variant_named(t->s, t->len);
+            continue;
         }
+        say(c, "Usage: tourney open [seats N] [stack N] [minutes N] [turn N] [variant]");
+        return -1;
+    }
+    if (rules->seats > rules->variant->max_players)
+        rules->seats = rules->variant->max_players;
+    return 0;
+}
 
-        irc_cmd_msg(session, channel, "TODO: next round.");
-        return;
+static void
+show_tourney (struct cmd_ctx *c)
+{
+    struct tourney_info in;
+    int next;
+
+    switch (tourney_get(c->session, c->channel, &in)) {
+        case TOURNEY_NONE:
+            send_msg(c->session, c->to, tourney_errors[TOURNEY_NO_TOURNEY]);
+            break;
+        case TOURNEY_OPEN:
+            say(c, "%s's tournament is taking names: %d so far. Say 'tourney join' to play.",
+                in.house, in.entrants);
+            break;
+        case TOURNEY_RUNNING:
+            next = (int) (in.next_level + 0.5);
+            say(c, "Level %d, blinds %d / %d, the next in %d:%02d. %d of %d left at %d tables.",
+                in.level, in.small_blind, in.big_blind, next / 60, next % 60,
+                in.left, in.entrants, in.tables);
+            if (in.leader_chips >= 0)
+                say(c, "%s leads with %d chips.", in.leader, in.leader_chips);
+            break;
+        case TOURNEY_OVER:
+            say(c, "The tournament is over. 1st %s, 2nd %s, 3rd %s.", in.places[0],
+                in.places[1][0] ? in.places[1] : "nobody",
+                in.places[2][0] ? in.places[2] : "nobody");
+            break;
     }
+}
 
-    switch (game->phase) {
-        case PHASE_PRE_DEAL:
-            /* This should not occur. */
-            fprintf(stderr, "WARNING: Confusion over when to deal, apparently.\n");
-            deal_round(session, game, channel);
-            return;
-        case PHASE_PRE_FLOP:
-            deal_community(game);
-            game->phase = PHASE_FLOP;
-            card1 = strdup(irc_print_card(game->community[0], USE_COLOR, USE_UTF8));
-            card2 = strdup(irc_print_card(game->community[1], USE_COLOR, USE_UTF8));
-            card3 = strdup(irc_print_card(game->community[2], USE_COLOR, USE_UTF8));
-            if (asprintf(&s, "Flop. Community cards: %s %s %s",
-                             card1, card2, card3) != -1) {
-                irc_cmd_msg(session, channel, s);
-                free(s);
-            }
-            free(card1);
-            free(card2);
-            free(card3);
-            break;
-        case PHASE_FLOP:
-            game->phase = PHASE_TURN;
-            card1 = strdup(irc_print_card(game->community[0], USE_COLOR, USE_UTF8));
-            card2 = strdup(irc_print_card(game->community[1], USE_COLOR, USE_UTF8));
-            card3 = strdup(irc_print_card(game->community[2], USE_COLOR, USE_UTF8));
-            card4 = strdup(irc_print_card(game->community[3], USE_COLOR, USE_UTF8));
-            if (asprintf(&s, "Turn. Community cards: %s %s %s %s",
-                             card1, card2, card3, card4) != -1) {
-                irc_cmd_msg(session, channel, s);
-                free(s);
-            }
-            free(card1);
-            free(card2);
-            free(card3);
-            free(card4);
-            break;
-        case PHASE_TURN:
-            game->phase = PHASE_RIVER;
-            card1 = strdup(irc_print_card(game->community[0], USE_COLOR, USE_UTF8));
-            card2 = strdup(irc_print_card(game->community[1], USE_COLOR, USE_UTF8));
-            card3 = strdup(irc_print_card(game->community[2], USE_COLOR, USE_UTF8));
-            card4 = strdup(irc_print_card(game->community[3], USE_COLOR, USE_UTF8));
-            card5 = strdup(irc_print_card(game->community[4], USE_COLOR, USE_UTF8));
-            if (asprintf(&s, "River. Community cards: %s %s %s %s %s",
-                             card1, card2, card3, card4, card5) != -1) {
-                irc_cmd_msg(session, channel, s);
-                free(s);
-            }
-            free(card1);
-            free(card2);
-            free(card3);
-            free(card4);
-            free(card5);
-            break;
-        case PHASE_RIVER:
-            irc_cmd_msg(session, channel, "TODO: showdown");
+static void
+do_tourney (struct cmd_ctx *c, const struct line *l)
+{
+    /* tourney [open ...|join|leave|start|stop|status] */
+    struct tourney_rules rules;
+    const struct token *t = &l->tok[1];
+    enum tourney_result r;
+
+    if (!c->channel) {
+        send_msg(c->session, c->nick, "Tournaments are run from channels. Ask in one.");
+        return;
+    }
+    if (l->n < 2 || token_is(t, "status")) {
+        show_tourney(c);
+        return;
+    }
+    if (token_is(t, "open")) {
+        if (parse_rules(c, l, &rules) != 0)
             return;
+        r = tourney_open(c->session, get_server_name(c->session), c->channel,
+                         c->nick, &rules);
+        if (r == TOURNEY_OK)
+            say(c, "%s opens a tournament: %d chips each, %d to a table, the blinds "
+                   "up every %d minutes. Say 'tourney join' to play.",
+                c->nick, rules.stack, rules.seats, rules.level_seconds / 60);
+    } else if (token_is(t, "join")) {
+        if ((r = tourney_join(c->session, c->channel, c->nick)) == TOURNEY_OK)
+            say(c, "%s is in.", c->nick);
+    } else if (token_is(t, "leave")) {
+        if ((r = tourney_leave(c->session, c->channel, c->nick)) == TOURNEY_OK)
+            say(c, "%s is out.", c->nick);
+    } else if (token_is(t, "start")) {
+        r = tourney_start(c->session, c->channel, c->nick);
+    } else if (token_is(t, "stop")) {
+        r = tourney_stop(c->session, c->channel, c->nick);
+    } else {
+        say(c, "Usage: tourney [open|join|leave|start|stop|status]");
+        return;
     }
-    set_turn(session, game, channel, next_player(game, game->button), 1);
+    if (r != TOURNEY_OK)
+        say(c, "%s: %s", c->nick, tourney_errors[r]);
 }
 
+static const struct verb bot_verbs[] = {
+    { "quit", NULL, do_quit },
+    { "help", NULL, do_help },
+    { "init", NULL, do_init },
+    { "game", NULL, do_game },
+    { "set",  NULL, do_set },
+    { "end",  NULL, do_end },
+    { "deal", NULL, do_deal },
+    { "stats", NULL, do_stats },
+    { "top",  NULL, do_top },
+    { "tourney", NULL, do_tourney }
+};
+static struct verb_table bot_commands = VERB_TABLE(bot_verbs);
+
 void
 process_cmd (irc_session_t *session,
              const char *from, const char *channel,
-             char *cmd)
+             const char *cmd)
 {
-    char *rest;
-    char *resp;
     char from_nick[32];
-    game_tp game;
-    
+    struct cmd_ctx c;
+    struct line l;
+    const struct verb *v;
+
     irc_target_get_nick(from, from_nick, 32);
+    c.session = session;
+    c.nick = from_nick;
+    c.channel = channel;
+    c.to = channel ? channel : from_nick;
+    c.game = NULL;
+    c.player_id = -1;
+
+    if (tokenize(cmd, &l) == 0)
+        return;
+    if ((v = match_verb(&bot_commands, &l)))
+        v->fn(&c, &l);
+    else
+        say(&c, "No such command: %.*s.", l.tok[0].len, l.tok[0].s);
+}
 
-    separate_first_word(&cmd, &rest);
-    
-    if (strcasecmp(cmd, "quit") == 0) {
-        irc_cmd_msg(session, channel ? channel : from_nick, "Live long and prosper. Good-bye!");
-        irc_cmd_quit(session, "Fold.");
-    } else if (strcasecmp(cmd, "help") == 0) {
-        const char *to = channel ? channel : from_nick;
-        irc_cmd_msg(session, to, "This is ircpoker."); usleep(100);
-        irc_cmd_msg(session, to, "List of available bot commands: quit, init, game, set, deal, help"); usleep(100);
-        irc_cmd_msg(session, to, "List of in-game to-the-table declarations: what's the game?, join game, afk, leave game, re, back");
-    } else if (strcasecmp(cmd, "init") == 0) {
-        /* new game */
-        struct channel_game *cgame;
-
-        if (!channel) {
-            irc_cmd_msg(session, from_nick, "Games can only be created in channels");
-            return;
-        }
-        if (get_channel_game(session, channel)) {
-            char *resp;
-            if (asprintf(&resp, "%s: There is already a game in this channel.", from_nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-            return;
-        }
+struct odds_request {
+    irc_session_t *session;
+    char nick[NICK_LEN];
+};
 
-        game = new_game(1);
-        strncpy(game->players[0].nick, from_nick, NICK_LEN);
-        game->players[0].active = 1;
-        game->house = &game->players[0];
-        cgame = malloc(sizeof(struct channel_game));
-        cgame->session = session;
-        cgame->channel = strdup(channel);
-        cgame->game = game;
-        cgame->next = channel_games_list;
-        channel_games_list = cgame;
-
-        list_game_info(session, game, channel);
-    } else if (strcasecmp(cmd, "game") == 0) {
-        const char *chan = channel;
-        if (!(chan = channel))
-            chan = rest;
-
-        if ((game = get_channel_game(session, chan))) {
-            list_game_info(session, game, channel ? channel: from_nick);
-        } else {
-            irc_cmd_msg(session, channel ? channel : from_nick, "No game.");
-        }
-    } else if (strcasecmp(cmd, "set") == 0) {
-        if ((game = get_channel_game(session, channel))) {
-            int val, i;
-            if (strcmp(from_nick, game->house->nick) != 0) {
-                irc_cmd_msg(session, channel, "Only The House may change the rules.");
-                return;
-            }
-            if (!rest) {
-                irc_cmd_msg(session, channel, "Usage: set [base stock|small blind|big blind] [|=|to] {value}");
-                return;
-            }
-            if        (   sscanf(rest, "base stock %d", &val) > 0
-                       || sscanf(rest, "base stock = %d", &val) > 0
-                       || sscanf(rest, "base stock to %d", &val) > 0 ) {
-                game->base_stock = val;
-                for (i=0; i<game->n_players; ++i) {
-                    if (game->players[i].chips < val) {
-                        int delta = val - game->players[i].chips;
-                        game->players[i].chips = val;
-                        if (asprintf(&resp, "%s given %d in chips.", 
-                                     game->players[i].nick, delta) != -1) {
-                            irc_cmd_msg(session, channel, resp); usleep(100);
-                            free(resp);
-                        }
-                    }
-                }
-            } else if (   sscanf(rest, "small blind %d", &val) > 0
-                       || sscanf(rest, "small blind = %d", &val) > 0
-                       || sscanf(rest, "small blind to %d", &val) > 0 ) {
-                game->small_blind = val;
-            } else if (   sscanf(rest, "big blind %d", &val) > 0
-                       || sscanf(rest, "big blind = %d", &val) > 0
-                       || sscanf(rest, "big blind to %d", &val) > 0 ) {
-                game->big_blind = val;
-            } else {
-                irc_cmd_msg(session, channel, "Unknown setting."); usleep(100);
-                irc_cmd_msg(session, channel, "Usage: set [base stock|small blind|big blind] [|=|to] {value}");
-            }
-        } else {
-            irc_cmd_msg(session, channel ? channel : from_nick, "No game.");
-        }
-    } else if (strcasecmp(cmd, "deal") == 0) {
-        if ((game = get_channel_game(session, channel))) {
-            if (strcmp(from_nick, game->house->nick) != 0) {
-                irc_cmd_msg(session, channel, "Only The House may call for first deal.");
-            }
-            deal_round(session, game, channel);
-        } else {
-            irc_cmd_msg(session, channel ? channel : from_nick, "No game.");
-        }
-    } else {
-        if (asprintf(&resp, "No such command: %s.", cmd) != -1) {
-            irc_cmd_msg(session, channel ? channel : from_nick, resp);
-            free(resp);
-        }
+static void
+odds_done (struct equity_job *ej)
+{
+    struct odds_request *req = ej->data;
+    char *resp;
+
+    if (ej->failed) {
+        send_msg(req->session, req->nick, "Cannot work out the odds right now.");
+    } else if (asprintf(&resp, "Against %d opponent%s: %.1f%% to win, %.1f%% to tie "
+                               "(%s %ld deals).", ej->q.n_unknown,
+                               ej->q.n_unknown == 1 ? "" : "s",
+                               100 * ej->res.win[0], 100 * ej->res.tie[0],
+                               ej->res.exhaustive ? "all" : "sampled",
+                               ej->res.trials) != -1) {
+        send_msg(req->session, req->nick, resp);
+        free(resp);
     }
+    free(req);
 }
 
-void
-process_bet_cmd (irc_session_t *session,
-                 const char *from, const char *channel, game_tp game,
-                 char *cmd)
+static void
+send_odds (irc_session_t *session, game_tp game, int player_id,
+           const char *nick)
 {
-    char *resp;
-    char from_nick[32];
-    int i, val;
-    irc_target_get_nick(from, from_nick, 32);
+    /* tells a player their chances against everybody still in the hand.
+     * only uses what the player can see: their own cards and the board.
+     * the answer comes from the worker pool, later. */
+    struct equity_query q;
+    struct odds_request *req;
+    int i;
 
-    int player_id = -1;
+    if (player_id == -1 || game->phase == PHASE_PRE_DEAL
+            || game->players[player_id].folded) {
+        send_msg(session, nick, "You are not in a hand.");
+        return;
+    }
+    if (game->variant != &variants[VARIANT_HOLDEM]) {
+        /* the equity calculator only knows Hold'em */
+        send_msg(session, nick, "I only know the odds in Hold'em.");
+        return;
+    }
 
-    for (i=0; i<game->n_players; ++i) {
-        if (strcmp(game->players[i].nick, from_nick) == 0) {
-            player_id = i;
-        }
+    q.hole[0][0] = game->players[player_id].hand[0];
+    q.hole[0][1] = game->players[player_id].hand[1];
+    q.n_known = 1;
+    q.n_unknown = -1;
+    for (i = 0; i < game->n_players; ++i)
+        if (!game->players[i].folded)
+            q.n_unknown++;
+    memcpy(q.board, game->community, sizeof q.board);
+    q.n_board = game->n_community;
+    q.dead = 0;
+    q.max_trials = EQUITY_TRIALS;
+    q.max_seconds = EQUITY_SECONDS;
+    q.seed = 0; /* the workers pick their own */
+
+    if (!(req = malloc(sizeof *req)))
+        return;
+    req->session = session;
+    strncpy(req->nick, nick, NICK_LEN);
+    if (submit_equity(&q, odds_done, req) != 0)
+        free(req);
+}
+
+static void
+bet_whats_the_game (struct cmd_ctx *c, const struct line *l)
+{
+    list_game_info(c->session, c->game, c->nick);
+}
+
+static void
+bet_join (struct cmd_ctx *c, const struct line *l)
+{
+    game_tp game = c->game;
+    int i;
+
+    if (c->player_id != -1) {
+        game->players[c->player_id].active = 1;
+        say(c, "Player %s is active.", c->nick);
+        return;
+    }
+    if (game->tourney) {
+        say(c, "Sorry %s, this table belongs to a tournament.", c->nick);
+        return;
     }
+    if ((i = add_player(game, c->nick)) < 0) {
+        say(c, "Sorry %s, the table is full.", c->nick);
+        return;
+    }
+    game->players[i].chips = game->base_stock;
+    game->players[i].active = 1;
+    game->players[i].folded = 1;
+    say(c, "Draw up a chair, %s!", c->nick);
+}
 
-    if (strcasecmp(cmd, "what's the game?") == 0) {
-        list_game_info(session, game, from_nick);
-    } else if (strcasecmp(cmd, "join game") == 0) {
-        if (player_id != -1) {
-            game->players[player_id].active = 1;
-            if (asprintf(&resp, "Player %s is active.", from_nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-            return;
-        }
-        game->players = realloc(game->players,
-                                (game->n_players+1) * sizeof(player_t));
-        game->players[game->n_players].chips = game->base_stock;
-        game->players[game->n_players].bet = 0;
-        game->players[game->n_players].active = 1;
-        game->players[game->n_players].folded = 1;
-        game->players[game->n_players].allin = 0;
-        strncpy(game->players[game->n_players].nick, from_nick, NICK_LEN);
-        game->n_players ++;
-        if (asprintf(&resp, "Draw up a chair, %s!", from_nick) != -1) {
-            irc_cmd_msg(session, channel, resp);
-            free(resp);
-        }
-    } else if (strcasecmp(cmd, "leave game") == 0
-            || strcasecmp(cmd, "afk") == 0) {
-        if (player_id != -1) {
-            game->players[player_id].active = 0;
-            if (asprintf(&resp, "Player %s is inactive.", from_nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        }
-    } else if (strcasecmp(cmd, "re") == 0
-            || strcasecmp(cmd, "back") == 0) {
-        if (player_id != -1) {
-            game->players[player_id].active = 1;
-            if (asprintf(&resp, "Player %s is active.", from_nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        }
+static void
+bet_leave (struct cmd_ctx *c, const struct line *l)
+{
+    c->game->players[c->player_id].active = 0;
+    say(c, "Player %s is inactive.", c->nick);
+}
 
-    } else if (strcasecmp(cmd, "check") == 0) {
-        if (game->turn != player_id) goto wrong_player;
-        if (game->pots[game->n_pots-1].bet == 0) {
-            if (asprintf(&resp, "%s checks.",
-                             game->players[player_id].nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-            set_turn(session, game, channel, next_player(game, player_id), 0);
-        } else {
-            irc_cmd_msg(session, channel,
+static void
+bet_back (struct cmd_ctx *c, const struct line *l)
+{
+    c->game->players[c->player_id].active = 1;
+    say(c, "Player %s is active.", c->nick);
+}
+
+static void
+bet_odds (struct cmd_ctx *c, const struct line *l)
+{
+    send_odds(c->session, c->game, c->player_id, c->nick);
+}
+
+static void
+act (struct cmd_ctx *c, enum action a, int amount)
+{
+    switch (engine_act(c->game, c->player_id, a, amount)) {
+        case ACT_OK:
+            play_on(c->session, c->game, c->channel);
+            break;
+        case ACT_NO_HAND:
+        case ACT_NOT_YOUR_TURN:
+            say(c, "%s, it is not your turn!", c->nick);
+            break;
+        case ACT_CANNOT_CHECK:
+            send_msg(c->session, c->channel,
                         "The bet is not 0. You cannot check. To call, say 'call'.");
-        }
+            break;
+        case ACT_TOO_LOW:
+            send_msg(c->session, c->channel, "You must at least match the bet or fold.");
+            break;
+    }
+}
 
-    } else if (strcasecmp(cmd, "call") == 0) {
-        if (game->turn != player_id) goto wrong_player;
-        if (game->pots[game->n_pots-1].bet == 0) {
-            if (asprintf(&resp, "%s checks.",
-                             game->players[player_id].nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        } else {
-            bet(game, player_id, game->pots[game->n_pots-1].bet);
-            if (game->players[player_id].allin) {
-                if (asprintf(&resp, "%s goes all in.",
-                                 game->players[player_id].nick) != -1) {
-                    irc_cmd_msg(session, channel, resp);
-                    free(resp);
-                }
-            } else {
-                if (asprintf(&resp, "%s calls.",
-                                 game->players[player_id].nick) != -1) {
-                    irc_cmd_msg(session, channel, resp);
-                    free(resp);
-                }
-            }
-        }
-        set_turn(session, game, channel, next_player(game, player_id), 0);
-
-    } else if (sscanf(cmd, "raise %d", &val) == 1) {
-        if (game->turn != player_id) goto wrong_player;
-        int betval = game->pots[game->n_pots-1].bet + val;
-        bet(game, player_id, betval);
-        if (game->players[player_id].allin) {
-            if (asprintf(&resp, "%s goes all in.",
-                             game->players[player_id].nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        } else {
-            if (asprintf(&resp, "%s raises by %d to %d.",
-                             game->players[player_id].nick, val, betval) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        }
-        set_turn(session, game, channel, next_player(game, player_id), 0);
+static void
+bet_check (struct cmd_ctx *c, const struct line *l)
+{
+    act(c, ACT_CHECK, 0);
+}
 
-    } else if (strcasecmp(cmd, "raise") == 0) {
-        /* TODO: betting unit */
-    } else if (sscanf(cmd, "bet %d", &val) == 1) {
-        if (game->turn != player_id) goto wrong_player;
-        if (game->pots[game->n_pots-1].bet > val) {
-            irc_cmd_msg(session, channel, "You must at least match the bet or fold.");
-        } else {
-            int raise = val - game->pots[game->n_pots-1].bet;
-            bet(game, player_id, val);
-            if (game->players[player_id].allin) {
-                if (asprintf(&resp, "%s goes all in.",
-                                 game->players[player_id].nick) != -1) {
-                    irc_cmd_msg(session, channel, resp);
-                    free(resp);
-                }
-            } else if (raise == 0) {
-                if (asprintf(&resp, "%s calls.",
-                                 game->players[player_id].nick) != -1) {
-                    irc_cmd_msg(session, channel, resp);
-                    free(resp);
-                }
-            } else {
-                if (asprintf(&resp, "%s raises by %d to %d.",
-                                 game->players[player_id].nick, raise, val) != -1) {
-                    irc_cmd_msg(session, channel, resp);
-                    free(resp);
-                }
-            }
-            set_turn(session, game, channel, next_player(game, player_id), 0);
-        }
-    } else if (strcasecmp(cmd, "all in") == 0) {
-        if (game->turn != player_id) goto wrong_player;
-        bet(game, player_id, game->players[player_id].chips
-                           + game->players[player_id].bet);
-        if (game->players[player_id].allin) {
-            if (asprintf(&resp, "%s goes all in.",
-                             game->players[player_id].nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        } else {
-            if (asprintf(&resp, "%s should have been all in by now.",
-                             game->players[player_id].nick) != -1) {
-                irc_cmd_msg(session, channel, resp);
-                free(resp);
-            }
-        }
-        set_turn(session, game, channel, next_player(game, player_id), 0);
-
-    } else if (strcasecmp(cmd, "fold") == 0) {
-        if (game->turn != player_id) goto wrong_player;
-        fold (game, player_id);
-        if (asprintf(&resp, "%s folds.",
-                         game->players[player_id].nick) != -1) {
-            irc_cmd_msg(session, channel, resp);
-            free(resp);
-        }
-        set_turn(session, game, channel, next_player(game, player_id), 0);
+static void
+bet_call (struct cmd_ctx *c, const struct line *l)
+{
+    act(c, ACT_CALL, 0);
+}
 
+static void
+bet_raise (struct cmd_ctx *c, const struct line *l)
+{
+    /* raise {amount} */
+    if (l->n < 2 || !l->tok[1].is_num) {
+        /* TODO: betting unit */
+        return;
     }
+    act(c, ACT_RAISE, l->tok[1].num);
+}
 
-    return;
-wrong_player:
-    if (asprintf(&resp, "%s, it is not your turn!",
-                     game->players[player_id].nick) != -1) {
-        irc_cmd_msg(session, channel, resp);
-        free(resp);
-    }
+static void
+bet_bet (struct cmd_ctx *c, const struct line *l)
+{
+    /* bet {total} */
+    if (l->n < 2 || !l->tok[1].is_num)
+        return;
+    act(c, ACT_BET, l->tok[1].num);
+}
+
+static void
+bet_all_in (struct cmd_ctx *c, const struct line *l)
+{
+    act(c, ACT_ALL_IN, 0);
+}
+
+static void
+bet_fold (struct cmd_ctx *c, const struct line *l)
+{
+    act(c, ACT_FOLD, 0);
+}
+
+static const struct verb table_verbs[] = {
+    { "what's", "the game?", bet_whats_the_game },
+    { "join",   "game",      bet_join },
+    { "leave",  "game",      bet_leave },
+    { "afk",    "",          bet_leave },
+    { "re",     "",          bet_back },
+    { "back",   "",          bet_back },
+    { "odds",   "",          bet_odds },
+    { "check",  "",          bet_check },
+    { "call",   "",          bet_call },
+    { "raise",  NULL,        bet_raise },
+    { "bet",    NULL,        bet_bet },
+    { "all",    "in",        bet_all_in },
+    { "fold",   "",          bet_fold }
+};
+static struct verb_table table_declarations = VERB_TABLE(table_verbs);
+
+static void
+tourney_say (void *session, const char *to, const char *text)
+{
+    send_msg(session, to, text);
+}
+
+static void
+tourney_opened (game_tp game)
+{
+    join_channel(game->session, game->channel);
+}
+
+static void
+tourney_dealt (game_tp game)
+{
+    play_on(game->session, game, game->channel);
+}
+
+void
+init_commands (void)
+{
+    static const struct tourney_hooks hooks = {
+        tourney_say, tourney_opened, tourney_dealt
+    };
+
+    build_verb_table(&bot_commands);
+    build_verb_table(&table_declarations);
+    tourney_set_hooks(&hooks);
+}
+
+void
+process_bet_cmd (irc_session_t *session,
+                 const char *from, const char *channel, game_tp game,
+                 const char *cmd)
+{
+    char from_nick[32];
+    struct cmd_ctx c;
+    struct token first;
+    struct line l;
+    const struct verb *v;
+    const char *p = cmd;
+
+    /* most of what gets said isn't meant for the dealer */
+    if (!next_token(&p, &first) || !find_verb(&table_declarations, &first))
+        return;
+    tokenize(cmd, &l);
+    if (!(v = match_verb(&table_declarations, &l)))
+        return;
+
+    irc_target_get_nick(from, from_nick, 32);
+    c.session = session;
+    c.nick = from_nick;
+    c.channel = channel;
+    c.to = channel;
+    c.game = game;
+    c.player_id = find_player(game, from_nick);
+
+    /* from anybody not at the table, only these two mean anything. */
+    if (c.player_id == -1 && v->fn != bet_join && v->fn != bet_whats_the_game)
+        return;
+
+    v->fn(&c, &l);
 }
 
 void
@@ -644,20 +978,26 @@ list_game_info (irc_session_t *session, game_tp game, const char *dest)
 
     s = malloc(sizeof(char) * (game->n_players * (NICK_LEN+2) + 42));
 
-    irc_cmd_msg(session, dest, "The game is Texas Hold'em, nothing wild."); usleep(100);
+    send_msgf(session, dest, "The game is %s.", game->variant->title);
     if (game->small_blind || game->big_blind) {
         if (sprintf(s, "Small/big blinds are %d / %d.", game->small_blind,
                                                         game->big_blind) != -1)
-            irc_cmd_msg(session, dest, s); usleep(100);
+            send_msg(session, dest, s);
     } else {
-        irc_cmd_msg(session, dest, "No blinds."); usleep(100);
+        send_msg(session, dest, "No blinds.");
     }
 
     if (sprintf(s, "Base chip stock is %d.", game->base_stock) != -1)
-        irc_cmd_msg(session, dest, s); usleep(100);
+        send_msg(session, dest, s);
+
+    if (game->turn_seconds > 0)
+        send_msgf(session, dest, "Players have %d seconds to act.",
+                  game->turn_seconds);
 
-    if (sprintf(s, "The House is represented by %s.", game->house->nick) != -1)
-        irc_cmd_msg(session, dest, s); usleep(100);
+    if (!game->house)
+        send_msg(session, dest, "This is a tournament's table.");
+    else if (sprintf(s, "The House is represented by %s.", game->house->nick) != -1)
+        send_msg(session, dest, s);
 
     strcpy(s, "Active players: ");
     for (i=0; i<game->n_players; ++i) {
@@ -669,7 +1009,7 @@ list_game_info (irc_session_t *session, game_tp game, const char *dest)
             strcat(s, game->players[i].nick);
         }
     }
-    irc_cmd_msg(session, dest, s); usleep(100);
+    send_msg(session, dest, s);
 
     free(s);
 }
@@ -14,13 +14,14 @@
 #define USE_UTF8 1
 #endif
 
-char *first_word (const char *txt);
+/* before the first command, and before any shards start */
+void init_commands (void);
 
 void process_cmd (irc_session_t *session, const char *from,
-                  const char *channel, char *cmd);
+                  const char *channel, const char *cmd);
 
 void process_bet_cmd (irc_session_t *session, const char *from,
-                      const char *channel, game_tp game, char *cmd);
+                      const char *channel, game_tp game, const char *cmd);
 
 void list_game_info (irc_session_t *session, game_tp game, const char *dest);
 
@@ -0,0 +1,109 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "config.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int
+add_server (struct config *conf, const char *host, const char *port,
+            const char *nick)
+{
+    struct server_conf *s;
+    char *end;
+    long p;
+
+    if (conf->n_servers == MAX_SERVERS) {
+        fprintf(stderr, "ERROR: no more than %d servers.\n", MAX_SERVERS);
+        return -1;
+    }
+    p = strtol(port, &end, 10);
+    if (*port == '\0' || *end != '\0' || p < 1 || p > 65535) {
+        fprintf(stderr, "ERROR: %s is not a port.\n", port);
+        return -1;
+    }
+    if (strlen(host) >= HOST_LEN || strlen(nick) >= NICK_LEN || !*nick) {
+        fprintf(stderr, "ERROR: host or nick too long.\n");
+        return -1;
+    }
+
+    s = &conf->servers[conf->n_servers++];
+    strcpy(s->host, host);
+    s->port = p;
+    strcpy(s->nick, nick);
+    return 0;
+}
+
+int
+read_config (const char *path, struct config *conf)
+{
+    char line[1024];
+    char *word[5], *p;
+    int n, lineno = 0;
+    FILE *f;
+
+    if (!(f = fopen(path, "r"))) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof line, f)) {
+        lineno++;
+        if ((p = strchr(line, '#')))
+            *p = '\0';
+
+        n = 0;
+        for (p = strtok(line, " \t\r\n"); p && n < 5; p = strtok(NULL, " \t\r\n"))
+            word[n++] = p;
+        if (n == 0)
+            continue;
+
+        if (n == 4 && strcmp(word[0], "server") == 0) {
+            if (add_server(conf, word[1], word[2], word[3]) != 0) {
+                fprintf(stderr, "%s:%d: bad server.\n", path, lineno);
+                fclose(f);
+                return -1;
+            }
+        } else if (n == 2 && strcmp(word[0], "shards") == 0) {
+            conf->n_shards = strtol(word[1], &p, 10);
+            if (*p != '\0' || conf->n_shards < 1 || conf->n_shards > MAX_SHARDS) {
+                fprintf(stderr, "%s:%d: between 1 and %d shards, please.\n",
+                        path, lineno, MAX_SHARDS);
+                fclose(f);
+                return -1;
+            }
+        } else if (n == 2 && (strcmp(word[0], "history") == 0
+                              || strcmp(word[0], "snapshot") == 0
+                              || strcmp(word[0], "metrics") == 0)) {
+            if (strlen(word[1]) >= PATH_LEN) {
+                fprintf(stderr, "%s:%d: path too long.\n", path, lineno);
+                fclose(f);
+                return -1;
+            }
+            strcpy(word[0][0] == 'h' ? conf->history
+                   : word[0][0] == 's' ? conf->snapshot : conf->metrics, word[1]);
+        } else if (n == 2 && strcmp(word[0], "log") == 0) {
+            if ((conf->log_level = log_level_named(word[1])) < 0) {
+                fprintf(stderr, "%s:%d: debug, info, warning or error, please.\n",
+                        path, lineno);
+                fclose(f);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "%s:%d: don't know what to do with this.\n",
+                    path, lineno);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+
+    if (conf->n_servers == 0) {
+        fprintf(stderr, "%s: no servers.\n", path);
+        return -1;
+    }
+    return 0;
+}
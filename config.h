@@ -0,0 +1,67 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "player.h"
+#include "shard.h"
+
+/* The configuration file lists the servers to play on, one per line:
+ *
+ *     # comment
+ *     server irc.example.net 6667 pokerbot
+ *
+ * that is, host, port and nick. Games are spread over one thread unless
+ * there's a line like
+ *
+ *     shards 4
+ *
+ * and hands aren't recorded (see history.h) unless there's a directory for
+ * them:
+ *
+ *     history /var/lib/ircpoker/hands
+ *
+ * Nobody keeps their chips over a restart (see snapshot.h) without a file
+ * for the tables:
+ *
+ *     snapshot /var/lib/ircpoker/tables
+ *
+ * The log (see log.h) says what's going on from "info" up, unless there's
+ * a line like
+ *
+ *     log debug
+ *
+ * and the counters (see metrics.h) are written for Prometheus' textfile
+ * collector if they have a file to go to:
+ *
+ *     metrics /var/lib/node_exporter/ircpoker.prom
+ */
+
+#define MAX_SERVERS 16
+#define HOST_LEN 256
+#define PATH_LEN 1024
+
+struct server_conf {
+    char host[HOST_LEN];
+    int port;
+    char nick[NICK_LEN];
+};
+
+struct config {
+    struct server_conf servers[MAX_SERVERS];
+    int n_servers;
+    int n_shards;           /* 0 if not given */
+    char history[PATH_LEN]; /* "" if not given */
+    char snapshot[PATH_LEN];    /* the same */
+    char metrics[PATH_LEN];     /* the same */
+    int log_level;              /* enum log_level, 0 if not given */
+};
+
+/* returns 0, or -1 after complaining to stderr */
+int read_config (const char *path, struct config *conf);
+/* for one server given on the command line */
+int add_server (struct config *conf, const char *host, const char *port,
+                const char *nick);
+
+#endif
@@ -1,84 +1,114 @@
 /* Copyright 2011 Tuna <tuna@supertunaman.com
  * This code is under the Chicken Dance License v0.1 */
 #include "deck.h"
+#include "log.h"
+#include "metrics.h"
 
-void rc4_init(unsigned char *key, unsigned int key_length);
-unsigned char rc4_output();
+pcard_t draw_card(game_tp g)
+{
+    /* takes the top card off the shuffled deck */
+    if (g->next_card >= g->variant->n_deck) {
+        log_msg(LOG_ERROR, "out of cards. Too many players?");
+        return g->deck[g->variant->n_deck - 1];
+    }
+    return g->deck[g->next_card++];
+}
 
+void burn_card(game_tp g)
+{
+    draw_card(g);
+}
 
 void deal(game_tp g, int playeridx)
 {
-    /* finds next available card and "gives" it to the player */
+    /* "gives" the player their hole cards off the top */
     int i;
-    int c = 0;
-    for (i = 0; i < 52; i++)
-    {
-        if (!g->deck[i].dealt) {
-            g->deck[i].dealt = 1;
-            g->deck[i].cardholder = playeridx;
-            g->players[playeridx].hand[c] = g->deck[i];
-            c++;
-        }
-        if (c > 1)
-            break;
-    }
+
+    for (i = 0; i < g->variant->n_hole; i++)
+        g->players[playeridx].hand[i] = draw_card(g);
 }
 
-void init_deck(card_t deck[])
+void init_deck(pcard_t deck[])
 {
-    /* intializes deck, assigns values, suits and sets dealt to 0 */
+    /* intializes deck in card_t idx order: ace to king of clubs, then
+     * diamonds, hearts and spades */
     int i;
     for (i = 0; i < 52; i++)
-    {
-        deck[i].idx = i;
+        deck[i] = PCARD(i / 13, VALUE_TO_RANK(i % 13 + 1));
+}
+
+static int
+fisher_yates(pcard_t deck[], int *i, const unsigned char *rnd, int len)
+{
+    /* carries on with a fisher-yates shuffle of deck[0..*i-1], one byte per
+     * swap. bytes that would favour the low cards are thrown away. returns
+     * the number of bytes used. */
+    int used;
+    int j;
+    pcard_t tmp;
 
-        if ((i + 1) % 13 != 0)
-            deck[i].value = (i + 1) % 13;
-        else
-            deck[i].value = 13;
-        
-        deck[i].suit = i / 13;
-        deck[i].dealt = 0;
+    for (used = 0; *i > 1 && used < len; used++)
+    {
+        /* largest multiple of *i that fits in a byte */
+        if (rnd[used] >= 256 - 256 % *i)
+            continue;
+        j = rnd[used] % *i;
+        tmp = deck[j];
+        deck[j] = deck[*i - 1];
+        deck[*i - 1] = tmp;
+        (*i)--;
     }
+    return used;
 }
 
-void shuffle_deck(game_tp g)
+int shuffle_with_bytes(pcard_t deck[], int n, const unsigned char *rnd, int len)
 {
-    /* uses RC4 as an RNG to fisher-yates shuffle the deck */
-    int i;
-    int j;
-    struct card tmp;
+    int used = fisher_yates(deck, &n, rnd, len);
+
+    return n > 1 ? -1 : used;
+}
 
-    /* read in a few bytes from /dev/urandom */
-    /* TODO: clean this up a bit, no need to read a file and initialize RC4 every time the deck is shuffled */
-    FILE *urandom = fopen("/dev/urandom", "rb");
-    unsigned char key_buf[KEY_LEN + 1];
-    fgets((char *)key_buf, KEY_LEN + 1, urandom);
-    fclose(urandom);
-    
-    /* initialize RC4 KSA */
-    rc4_init(key_buf, KEY_LEN);
-    
-    /* discard 256 bytes, like a good boy */
-    for (i = 0; i < 256; i++) 
-        rc4_output();
+static void
+shuffle_cards(rng_t *rng, pcard_t decks[][52], int n_decks, int n_cards)
+{
+    /* the first n_cards of each deck */
+    unsigned char buf[SHUFFLE_BUF];
+    int len = 0;
+    int pos = 0;
+    int d, i;
 
-    /* Fisher-Yates shuffle using RC4 as an RNG */
-    for (i = 52; i > 1; i--)
+    METRIC_ADD(C_SHUFFLES, n_decks);
+    for (d = 0; d < n_decks; d++)
     {
-        j = rc4_output() % i;
-        tmp = g->deck[j];
-        g->deck[j] = g->deck[i - 1];
-        g->deck[i - 1] = tmp;
+        i = n_cards;
+        while (i > 1) {
+            if (pos == len) {
+                /* enough for the remaining decks, give or take */
+                len = (n_decks - d) * SHUFFLE_BYTES_PER_DECK;
+                if (len > SHUFFLE_BUF)
+                    len = SHUFFLE_BUF;
+                rng_bytes(rng, buf, len);
+                pos = 0;
+            }
+            pos += fisher_yates(decks[d], &i, &buf[pos], len - pos);
+        }
     }
 }
 
-void undeal(game_tp g)
+void shuffle_decks(rng_t *rng, pcard_t decks[][52], int n_decks)
 {
-    int i;
+    shuffle_cards(rng, decks, n_decks, 52);
+}
 
-    for (i=0; i<52; ++i) {
-        g->deck[i].dealt = 0;
-    }
+void shuffle_deck(game_tp g)
+{
+    shuffle_cards(&g->rng, &g->deck, 1, g->variant->n_deck);
+}
+
+void undeal(game_tp g)
+{
+    /* puts all cards back. shuffle before dealing again. */
+    g->next_card = 0;
+    g->n_community = 0;
 }
 
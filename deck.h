@@ -8,13 +8,26 @@
 #include "card.h"
 #include "game.h"
 #include "player.h"
-
-#define KEY_LEN 10 /* used to key RC4 for the shuffle. loloverkill */
+#include "rng.h"
 
 /* card_t deck[52]; */
 
+/* random bytes fetched at a time by shuffle_decks() */
+#define SHUFFLE_BUF 4096
+/* about what one 52-card shuffle uses, counting rejected bytes */
+#define SHUFFLE_BYTES_PER_DECK 56
+
+pcard_t draw_card(game_tp);
+void burn_card(game_tp);
 void deal(game_tp, int playeridx);
-void init_deck(card_t deck[]);
+void init_deck(pcard_t deck[]);
+/* unbiased fisher-yates shuffle of deck[0..n-1] using the bytes in rnd.
+ * returns the number of bytes used, or -1 if they ran out first, in which
+ * case the deck is only partly shuffled: shuffle it again. */
+int shuffle_with_bytes(pcard_t deck[], int n, const unsigned char *rnd, int len);
+/* shuffles n_decks decks in a row, fetching random bytes in bulk */
+void shuffle_decks(rng_t *rng, pcard_t decks[][52], int n_decks);
+/* the variant's cards in the game's deck */
 void shuffle_deck(game_tp);
 void undeal(game_tp g);
 
@@ -0,0 +1,369 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#include "engine.h"
+#include "history.h"
+#include "log.h"
+#include "pot.h"
+#include "stats.h"
+
+#include <string.h>
+
+/* what comes after each phase's round of betting. no deal: showdown. */
+static const struct street {
+    void (*deal) (game_tp);
+    enum game_phase next;
+} streets[] = {
+    [PHASE_PRE_DEAL] = { NULL,       PHASE_PRE_DEAL },
+    [PHASE_PRE_FLOP] = { deal_flop,  PHASE_FLOP },
+    [PHASE_FLOP]     = { deal_turn,  PHASE_TURN },
+    [PHASE_TURN]     = { deal_river, PHASE_RIVER },
+    [PHASE_RIVER]    = { NULL,       PHASE_PRE_DEAL }
+};
+
+static void emit(game_tp g, int type, int player, int amount, int total)
+{
+    struct event *e;
+
+    if (g->ev_tail - g->ev_head == EVENT_QUEUE) {
+        log_msg(LOG_WARNING, "event queue full. Nobody's listening?");
+        return;
+    }
+    e = &g->events[g->ev_tail++ % EVENT_QUEUE];
+    e->type = type;
+    e->player = player;
+    e->amount = amount;
+    e->total = total;
+    history_event(g, e);
+    stats_event(g, e);
+}
+
+int engine_next_event(game_tp g, struct event *e)
+{
+    if (g->ev_head == g->ev_tail)
+        return 0;
+    *e = g->events[g->ev_head++ % EVENT_QUEUE];
+    return 1;
+}
+
+void engine_drop_events(game_tp g)
+{
+    g->ev_head = g->ev_tail;
+}
+
+int engine_waiting(game_tp g)
+{
+    return g->state == ENGINE_WAITING;
+}
+
+static void start_turns(game_tp g, int player_id, int new_round)
+{
+    /* go round the table from player_id */
+    g->to_act = g->first_to_act = player_id;
+    g->new_round = new_round;
+    g->state = player_id < 0 ? ENGINE_ROUND_OVER : ENGINE_TURN;
+}
+
+static void skip(game_tp g)
+{
+    /* on to the next player, unless we're back where we started */
+    g->new_round = 0;
+    g->to_act = next_player(g, g->to_act);
+    if (g->to_act == g->first_to_act || g->to_act == -1)
+        g->state = ENGINE_ROUND_OVER;
+}
+
+static void hand_over(game_tp g)
+{
+    int next = next_player(g, g->button);
+
+    g->phase = PHASE_PRE_DEAL;
+    if (next >= 0)
+        g->button = next;
+    g->turn = -1;
+    g->state = ENGINE_IDLE;
+    emit(g, EV_HAND_OVER, -1, 0, 0);
+    history_end(g);
+    stats_end(g);
+}
+
+static int start_hand(game_tp g)
+{
+    int i, small, big, in_hand = 0;
+
+    undeal(g);
+    for (i = 0; i < g->n_players; ++i) {
+        g->players[i].folded = !g->players[i].active || g->players[i].chips == 0;
+        g->players[i].bet = 0;
+        g->players[i].allin = 0;
+        in_hand += !g->players[i].folded;
+    }
+    /* get rid of all pots. */
+    new_hand(g);
+    shuffle_deck(g);
+
+    if ((small = next_player(g, g->button)) < 0) {
+        emit(g, EV_TOO_FEW_PLAYERS, -1, 0, 0);
+        return -1;
+    }
+    if ((big = next_player(g, small)) < 0) {
+        emit(g, EV_NO_PLAYER, -1, 0, 0);
+        return -1;
+    }
+    if (in_hand > g->variant->max_players) {
+        emit(g, EV_TOO_MANY_PLAYERS, -1, g->variant->max_players, 0);
+        return -1;
+    }
+    g->hands++;
+    history_begin(g);
+    stats_begin(g);
+
+    bet(g, small, g->small_blind);
+    emit(g, EV_SMALL_BLIND, small, g->small_blind, 0);
+    bet(g, big, g->big_blind);
+    emit(g, EV_BIG_BLIND, big, g->big_blind, 0);
+
+    i = small;
+    do {
+        deal(g, i);
+        emit(g, EV_DEALT, i, 0, 0);
+    } while ((i = next_player(g, i)) != small);
+
+    g->phase = PHASE_PRE_FLOP;
+    emit(g, EV_HANDS_DEALT, -1, 0, 0);
+    start_turns(g, next_player(g, big), 0);
+    return 0;
+}
+
+static int players_in_hand(game_tp g)
+{
+    int i, n = 0;
+
+    for (i = 0; i < g->n_players; ++i)
+        n += !g->players[i].folded;
+    return n;
+}
+
+static void find_turn(game_tp g)
+{
+    /* does to_act have anything to decide? */
+    int player_id = g->to_act;
+    player_t *player = &g->players[player_id];
+    int bet = g->round_bet;
+    int prompt;
+
+    if (players_in_hand(g) < 2) {
+        /* the last one left wins, and doesn't get to fold first */
+        g->state = ENGINE_ROUND_OVER;
+        return;
+    }
+
+    if (player->folded) {
+        log_msg(LOG_WARNING, "folded player up for a turn. This should never happen.");
+        skip(g);
+        return;
+    }
+    if (bet < player->bet) {
+        log_msg(LOG_ERROR, "anomalous bets.");
+        emit(g, EV_ANOMALOUS_BETS, player_id, 0, 0);
+        skip(g);
+        return;
+    }
+    if (player->allin) {
+        emit(g, EV_ALREADY_ALL_IN, player_id, 0, 0);
+        skip(g);
+        return;
+    }
+
+    if (!g->new_round && bet == 0 && player_id == next_player(g, g->button)) {
+        /* everybody hath checked. How boring. */
+        g->state = ENGINE_ROUND_OVER;
+        return;
+    }
+    if (bet == 0) {
+        prompt = EV_PROMPT_CHECK;
+    } else if (bet > player->bet) {
+        prompt = EV_PROMPT_CALL;
+    } else if (g->phase == PHASE_PRE_FLOP && bet == g->big_blind
+               && player_id == next_player(g, next_player(g, g->button))) {
+        /* pre-flop. Big-blindist may raise. */
+        prompt = EV_PROMPT_OPTION;
+    } else {
+        /* everybody agrees. */
+        g->state = ENGINE_ROUND_OVER;
+        return;
+    }
+
+    g->turn = player_id;
+    emit(g, prompt, player_id, bet, 0);
+    if (!player->active) {
+        emit(g, EV_AUTO_FOLD, player_id, 0, 0);
+        fold(g, player_id);
+        skip(g);
+        return;
+    }
+    g->state = ENGINE_WAITING;
+}
+
+static void showdown(game_tp g)
+{
+    int strength[MAX_PLAYERS];
+    int won[MAX_PLAYERS];
+    int i;
+
+    for (i = 0; i < g->n_players; ++i) {
+        strength[i] = -1;
+        won[i] = 0;
+        if (g->players[i].folded)
+            continue;
+        get_best_player_hand(g, i);
+        strength[i] = g->players[i].strength;
+        emit(g, EV_SHOW, i, strength[i], 0);
+    }
+
+    award_pots(g, strength, won);
+    for (i = 0; i < g->n_players; ++i)
+        if (won[i])
+            emit(g, EV_WIN, i, won[i], 0);
+}
+
+static void end_round(game_tp g)
+{
+    const struct street *street = &streets[g->phase];
+    int strength[MAX_PLAYERS];
+    int won[MAX_PLAYERS];
+    int in_hand = 0;
+    int last = -1;
+    int i;
+
+    /* new betting round. Zero bets. */
+    end_betting_round(g);
+    for (i = 0; i < g->n_players; ++i) {
+        strength[i] = -1;
+        won[i] = 0;
+        if (!g->players[i].folded) {
+            in_hand++;
+            last = i;
+        }
+    }
+
+    if (in_hand == 0) {
+        emit(g, EV_NOBODY_LEFT, -1, 0, 0);
+        hand_over(g);
+        return;
+    }
+    if (in_hand == 1) {
+        emit(g, EV_WIN_BY_DEFAULT, last, 0, 0);
+        strength[last] = 0;
+        award_pots(g, strength, won);
+        for (i = 0; i < g->n_players; ++i)
+            if (won[i])
+                emit(g, EV_AWARD, i, won[i], 0);
+        hand_over(g);
+        return;
+    }
+
+    if (g->phase == PHASE_PRE_DEAL) {
+        /* This should not occur. */
+        log_msg(LOG_WARNING, "confusion over when to deal, apparently.");
+        if (start_hand(g) != 0)
+            g->state = ENGINE_IDLE;
+        return;
+    }
+    if (!street->deal) {
+        showdown(g);
+        hand_over(g);
+        return;
+    }
+
+    street->deal(g);
+    g->phase = street->next;
+    emit(g, EV_STREET, -1, g->n_community, 0);
+    start_turns(g, next_player(g, g->button), 1);
+}
+
+static void (*const steps[]) (game_tp) = {
+    [ENGINE_TURN] = find_turn,
+    [ENGINE_ROUND_OVER] = end_round
+};
+
+static void run(game_tp g)
+{
+    while (g->state != ENGINE_WAITING && g->state != ENGINE_IDLE)
+        steps[g->state](g);
+}
+
+int engine_deal(game_tp g)
+{
+    if (g->phase != PHASE_PRE_DEAL || g->state != ENGINE_IDLE)
+        return -1;
+    if (start_hand(g) != 0)
+        return -1;
+    run(g);
+    return 0;
+}
+
+enum act_result engine_act(game_tp g, int player_id, enum action a, int amount)
+{
+    player_t *player;
+    int to, owed;
+
+    if (g->state != ENGINE_WAITING)
+        return ACT_NO_HAND;
+    if (player_id != g->turn)
+        return ACT_NOT_YOUR_TURN;
+    player = &g->players[player_id];
+
+    switch (a) {
+        case ACT_CHECK:
+            if (g->round_bet != 0)
+                return ACT_CANNOT_CHECK;
+            emit(g, EV_CHECK, player_id, 0, 0);
+            break;
+        case ACT_CALL:
+            if (g->round_bet == player->bet) {
+                /* nothing to call: the big blind's option, say */
+                emit(g, EV_CHECK, player_id, 0, 0);
+                break;
+            }
+            bet(g, player_id, g->round_bet);
+            emit(g, player->allin ? EV_ALL_IN : EV_CALL, player_id, 0, 0);
+            break;
+        case ACT_RAISE:
+        case ACT_BET:
+            to = a == ACT_RAISE ? g->round_bet + amount : amount;
+            if (to < g->round_bet)
+                return ACT_TOO_LOW;
+            amount = to - g->round_bet;
+            owed = to - player->bet;
+            bet(g, player_id, to);
+            if (player->allin)
+                emit(g, EV_ALL_IN, player_id, 0, 0);
+            else if (amount == 0)
+                emit(g, owed ? EV_CALL : EV_CHECK, player_id, 0, 0);
+            else
+                emit(g, EV_RAISE, player_id, amount, to);
+            break;
+        case ACT_ALL_IN:
+            bet(g, player_id, player->chips + player->bet);
+            emit(g, player->allin ? EV_ALL_IN : EV_NOT_ALL_IN, player_id, 0, 0);
+            break;
+        case ACT_FOLD:
+            fold(g, player_id);
+            emit(g, EV_FOLD, player_id, 0, 0);
+            break;
+        case ACT_TIMEOUT:
+            /* away, by the looks of it. sits out until they're back. */
+            player->active = 0;
+            if (g->round_bet == player->bet) {
+                emit(g, EV_TIMEOUT_CHECK, player_id, 0, 0);
+            } else {
+                fold(g, player_id);
+                emit(g, EV_TIMEOUT_FOLD, player_id, 0, 0);
+            }
+            break;
+    }
+
+    start_turns(g, next_player(g, player_id), 0);
+    run(g);
+    return ACT_OK;
+}
@@ -0,0 +1,90 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "game.h"
+
+/* The betting engine.
+ *
+ * A hand is a state machine: the engine looks for the next player to act
+ * (ENGINE_TURN), waits for them (ENGINE_WAITING), and at the end of each
+ * round of betting turns up the next street, or has the showdown
+ * (ENGINE_ROUND_OVER). engine_deal() and engine_act() run it until it has
+ * to wait for somebody again, or the hand is over, in a loop: however many
+ * players are all in or away, the stack stays flat.
+ *
+ * Whatever happens goes into the game's event queue, in order. The IRC
+ * side turns events into messages. Anybody else (a simulator, a test) may
+ * read them or throw them away, but has to do one or the other after every
+ * call: the queue only holds EVENT_QUEUE of them. */
+
+enum engine_state {
+    ENGINE_IDLE,        /* between hands */
+    ENGINE_TURN,
+    ENGINE_WAITING,     /* for game->turn */
+    ENGINE_ROUND_OVER
+};
+
+enum event_type {
+    EV_SMALL_BLIND,     /* player, amount */
+    EV_BIG_BLIND,
+    EV_DEALT,           /* player got their hole cards */
+    EV_HANDS_DEALT,
+    EV_PROMPT_CHECK,    /* player may check or raise */
+    EV_PROMPT_CALL,     /* ...call amount or raise */
+    EV_PROMPT_OPTION,   /* the big blind may raise their own amount */
+    EV_AUTO_FOLD,       /* player is away */
+    EV_ALREADY_ALL_IN,
+    EV_CHECK,
+    EV_CALL,
+    EV_RAISE,           /* by amount, to total */
+    EV_ALL_IN,
+    EV_NOT_ALL_IN,      /* all in didn't work out. shouldn't happen. */
+    EV_FOLD,
+    EV_TIMEOUT_CHECK,   /* out of time, see ACT_TIMEOUT */
+    EV_TIMEOUT_FOLD,
+    EV_STREET,          /* amount: community cards, 3 to 5 */
+    EV_SHOW,            /* player's best_hand, amount: its strength */
+    EV_WIN,             /* at the showdown: player wins amount */
+    EV_WIN_BY_DEFAULT,  /* everybody but player folded */
+    EV_AWARD,           /* ...so they get amount */
+    EV_HAND_OVER,
+    /* things that went wrong */
+    EV_TOO_FEW_PLAYERS,
+    EV_NO_PLAYER,
+    EV_NOBODY_LEFT,
+    EV_ANOMALOUS_BETS,
+    EV_TOO_MANY_PLAYERS     /* for the variant's deck, amount: how many it takes */
+};
+
+enum action {
+    ACT_CHECK,
+    ACT_CALL,
+    ACT_RAISE,          /* by amount */
+    ACT_BET,            /* to amount */
+    ACT_ALL_IN,
+    ACT_FOLD,
+    ACT_TIMEOUT         /* check if possible, else fold, and go away */
+};
+
+enum act_result {
+    ACT_OK,
+    ACT_NO_HAND,
+    ACT_NOT_YOUR_TURN,
+    ACT_CANNOT_CHECK,   /* there's a bet */
+    ACT_TOO_LOW         /* a bet below the one to call */
+};
+
+/* starts a hand. returns -1 if there's one going on, or it can't be
+ * dealt (the events say why). */
+int engine_deal(game_tp);
+enum act_result engine_act(game_tp, int player_id, enum action, int amount);
+/* 1 if the engine is waiting for game->turn */
+int engine_waiting(game_tp);
+
+/* the oldest event, if there is one. returns 0 when there's none left. */
+int engine_next_event(game_tp, struct event *);
+void engine_drop_events(game_tp);
+
+#endif
@@ -0,0 +1,281 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#include "equity.h"
+#include "hand.h"
+
+#include <string.h>
+#include <time.h>
+
+/*
+ * Win odds, the brute-force way: deal out the rest of the board (and the
+ * unknown opponents' hole cards), see who wins, repeat.
+ *
+ * The cards still in play go into rem[]. Every outcome takes `need' of them:
+ * the missing board cards first, then two per unknown opponent. When all
+ * outcomes fit into the trial budget, walk() visits each one exactly once.
+ * Otherwise we sample: a partial shuffle of rem[] puts a random outcome at
+ * its front.
+ *
+ * Sampling doesn't need to be unpredictable, only fast and fair, so it uses
+ * xorshift64* rather than the game's RC4 stream.
+ *
+ * Outcomes aren't scored one by one: score() queues every hand's cards, and
+ * tally() runs a whole batch through eval_masks() at once.
+ */
+
+/* check the clock this often while sampling */
+#define CLOCK_INTERVAL 4096
+/* outcomes per eval_masks() call */
+#define BATCH 64
+
+struct equity_state {
+    const struct equity_query *q;
+    cardmask_t hole[EQUITY_MAX_HANDS];  /* known, then unknown hands */
+    cardmask_t board;
+    pcard_t rem[52];
+    int used[52];
+    int n_rem;
+    int n_board_missing;
+    /* per known hand: outcomes won outright, outcomes split, pot share */
+    double wins[EQUITY_MAX_HANDS];
+    double ties[EQUITY_MAX_HANDS];
+    double shares[EQUITY_MAX_HANDS];
+    long trials;
+    uint64_t x;     /* xorshift state */
+    /* outcomes waiting for tally(), every hand's cards in a row */
+    cardmask_t queue[BATCH * EQUITY_MAX_HANDS];
+    int strength[BATCH * EQUITY_MAX_HANDS];
+    int n_queued;
+};
+
+static void
+tally (struct equity_state *st)
+{
+    /* the queued outcomes: who has the best hand? */
+    int n_hands = st->q->n_known + st->q->n_unknown;
+    int best, n_best, k, i;
+    int *strength;
+
+    eval_masks(st->queue, st->strength, st->n_queued * n_hands);
+    for (k = 0; k < st->n_queued; k++) {
+        strength = &st->strength[k * n_hands];
+        best = -1;
+        n_best = 0;
+        for (i = 0; i < n_hands; i++) {
+            if (strength[i] > best) {
+                best = strength[i];
+                n_best = 1;
+            } else if (strength[i] == best) {
+                n_best++;
+            }
+        }
+
+        for (i = 0; i < st->q->n_known; i++) {
+            if (strength[i] != best)
+                continue;
+            if (n_best == 1)
+                st->wins[i]++;
+            else
+                st->ties[i]++;
+            st->shares[i] += 1.0 / n_best;
+        }
+    }
+    st->trials += st->n_queued;
+    st->n_queued = 0;
+}
+
+static void
+score (struct equity_state *st, cardmask_t board)
+{
+    /* one outcome, for tally() */
+    int n_hands = st->q->n_known + st->q->n_unknown;
+    cardmask_t *q = &st->queue[st->n_queued * n_hands];
+    int i;
+
+    for (i = 0; i < n_hands; i++)
+        q[i] = st->hole[i] | board;
+    if (++st->n_queued == BATCH)
+        tally(st);
+}
+
+static void
+walk (struct equity_state *st, int group, int start, int left, cardmask_t acc)
+{
+    /* group 0 is the rest of the board, group n is unknown opponent n.
+     * picks `left' more cards for the group, in increasing order within the
+     * group so every combination comes up once. */
+    int i;
+
+    if (left == 0) {
+        if (group == 0)
+            st->board = acc;
+        else
+            st->hole[st->q->n_known + group - 1] = acc;
+
+        if (group == st->q->n_unknown)
+            score(st, st->board);
+        else
+            walk(st, group + 1, 0, 2, 0);
+        return;
+    }
+
+    for (i = start; i <= st->n_rem - left; i++) {
+        if (st->used[i])
+            continue;
+        st->used[i] = 1;
+        walk(st, group, i + 1, left - 1, acc | PCARD_BIT(st->rem[i]));
+        st->used[i] = 0;
+    }
+}
+
+static uint64_t
+next_random (struct equity_state *st)
+{
+    st->x ^= st->x >> 12;
+    st->x ^= st->x << 25;
+    st->x ^= st->x >> 27;
+    return st->x * 0x2545f4914f6cdd1dULL;
+}
+
+static double
+now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void
+sample (struct equity_state *st, int need)
+{
+    const struct equity_query *q = st->q;
+    double deadline = now() + q->max_seconds;
+    cardmask_t board;
+    pcard_t tmp;
+    long t;
+    int i, j;
+
+    for (t = 0; t < q->max_trials; t++) {
+        if (t % CLOCK_INTERVAL == CLOCK_INTERVAL - 1 && now() > deadline)
+            break;
+
+        /* partial fisher-yates: a random outcome ends up in rem[0..need-1].
+         * the multiply-and-shift range reduction is off by at most 2^-32. */
+        for (i = 0; i < need; i++) {
+            j = i + (int)(((next_random(st) >> 32) * (st->n_rem - i)) >> 32);
+            tmp = st->rem[i];
+            st->rem[i] = st->rem[j];
+            st->rem[j] = tmp;
+        }
+
+        board = st->board;
+        for (i = 0; i < st->n_board_missing; i++)
+            board |= PCARD_BIT(st->rem[i]);
+        for (j = 0; j < q->n_unknown; j++, i += 2)
+            st->hole[q->n_known + j] = PCARD_BIT(st->rem[i])
+                                     | PCARD_BIT(st->rem[i + 1]);
+        score(st, board);
+    }
+}
+
+static double
+choose (int n, int k)
+{
+    double c = 1;
+    int i;
+
+    for (i = 0; i < k; i++)
+        c = c * (n - i) / (i + 1);
+    return c;
+}
+
+static int
+prepare (const struct equity_query *q, struct equity_state *st)
+{
+    /* checks the query, and sorts out which cards are left. returns the
+     * number of cards each outcome takes, or -1. */
+    cardmask_t seen = q->dead;
+    int i, c;
+
+    if (q->n_known < 1 || q->n_unknown < 0
+            || q->n_known + q->n_unknown > EQUITY_MAX_HANDS
+            || q->n_board < 0 || q->n_board > 5)
+        return -1;
+
+    st->q = q;
+    for (i = 0; i < q->n_known; i++) {
+        st->hole[i] = PCARD_BIT(q->hole[i][0]) | PCARD_BIT(q->hole[i][1]);
+        if ((seen & st->hole[i]) || MASK_COUNT(st->hole[i]) != 2)
+            return -1;
+        seen |= st->hole[i];
+    }
+    for (i = 0; i < q->n_board; i++) {
+        if (st->board & PCARD_BIT(q->board[i]))
+            return -1;
+        st->board |= PCARD_BIT(q->board[i]);
+    }
+    if (seen & st->board)
+        return -1;
+    seen |= st->board;
+
+    for (i = 0; i < 52; i++) {
+        c = PCARD(i / 13, i % 13);
+        if (!(seen & PCARD_BIT(c)))
+            st->rem[st->n_rem++] = c;
+    }
+
+    st->n_board_missing = 5 - q->n_board;
+    if (st->n_board_missing + 2 * q->n_unknown > st->n_rem)
+        return -1;
+    return st->n_board_missing + 2 * q->n_unknown;
+}
+
+static double
+outcomes (const struct equity_state *st)
+{
+    double n = choose(st->n_rem, st->n_board_missing);
+    int i;
+
+    for (i = 0; i < st->q->n_unknown; i++)
+        n *= choose(st->n_rem - st->n_board_missing - 2 * i, 2);
+    return n;
+}
+
+double
+count_outcomes (const struct equity_query *q)
+{
+    static struct equity_state zero;
+    struct equity_state st = zero;
+
+    if (prepare(q, &st) < 0)
+        return -1;
+    return outcomes(&st);
+}
+
+int
+calc_equity (const struct equity_query *q, struct equity_result *res)
+{
+    static struct equity_state zero;
+    struct equity_state st = zero;
+    int need, i;
+
+    if ((need = prepare(q, &st)) < 0)
+        return -1;
+
+    res->exhaustive = outcomes(&st) <= q->max_trials;
+    if (res->exhaustive) {
+        walk(&st, 0, 0, st.n_board_missing, st.board);
+    } else {
+        st.x = q->seed ? q->seed : 0x9e3779b97f4a7c15ULL;
+        sample(&st, need);
+    }
+    tally(&st);
+
+    res->trials = st.trials;
+    for (i = 0; i < q->n_known; i++) {
+        res->win[i] = st.trials ? st.wins[i] / st.trials : 0;
+        res->tie[i] = st.trials ? st.ties[i] / st.trials : 0;
+        res->equity[i] = st.trials ? st.shares[i] / st.trials : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef EQUITY_H
+#define EQUITY_H
+
+#include <stdint.h>
+#include "card.h"
+
+#define EQUITY_MAX_HANDS 23 /* known and unknown hands together */
+
+/* default budget for one calculation. the engine stops at whichever comes
+ * first, so it never holds up the bot for long. */
+#ifndef EQUITY_TRIALS
+#define EQUITY_TRIALS 200000
+#endif
+#ifndef EQUITY_SECONDS
+#define EQUITY_SECONDS 0.05
+#endif
+
+struct equity_query {
+    pcard_t hole[EQUITY_MAX_HANDS][2];  /* the known hole cards */
+    int n_known;
+    int n_unknown;          /* opponents whose cards nobody knows */
+    pcard_t board[5];
+    int n_board;
+    cardmask_t dead;        /* cards that are gone, but in nobody's hand */
+    long max_trials;
+    double max_seconds;
+    uint64_t seed;          /* for the sampling. same seed, same result. */
+};
+
+struct equity_result {
+    /* per known hand, as fractions of all outcomes */
+    double win[EQUITY_MAX_HANDS];       /* wins outright */
+    double tie[EQUITY_MAX_HANDS];       /* splits the pot */
+    double equity[EQUITY_MAX_HANDS];    /* share of the pot, on average */
+    long trials;
+    int exhaustive;         /* 1 if every possible outcome was counted */
+};
+
+/* Counts every outcome when there are no more than max_trials of them
+ * (usually from the turn on), and samples outcomes at random otherwise.
+ * returns 0, or -1 if the query makes no sense (duplicate cards, not
+ * enough cards left, &c.). */
+int calc_equity(const struct equity_query *q, struct equity_result *res);
+/* how many outcomes calc_equity() would count, or -1 */
+double count_outcomes(const struct equity_query *q);
+
+#endif
@@ -1,25 +1,43 @@
 /* Copyright 2011 Tuna <tuna@supertunaman.com
  * This code is under the Chicken Dance License v0.1 */
+#include "engine.h"
 #include "game.h"
+#include "tourney.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+void deal_flop(game_tp g)
+{
+    burn_card(g);
+    g->community[0] = draw_card(g);
+    g->community[1] = draw_card(g);
+    g->community[2] = draw_card(g);
+    g->n_community = 3;
+}
+
+void deal_turn(game_tp g)
+{
+    burn_card(g);
+    g->community[3] = draw_card(g);
+    g->n_community = 4;
+}
+
+void deal_river(game_tp g)
+{
+    burn_card(g);
+    g->community[4] = draw_card(g);
+    g->n_community = 5;
+}
 
 void deal_community(game_tp g)
 {
-    /* Gives 5 cards to COMMUNITY */
-    int i;
-    int c = 0;
-    for (i = 0; i < 52; i++)
-    {
-        if (!g->deck[i].dealt) {
-            g->deck[i].dealt = 1;
-            g->deck[i].cardholder = COMMUNITY;
-            g->community[c] = g->deck[i];
-            c++;
-        }
-        if (c > 4)
-            break;
-    }
+    if (g->n_community < 3)
+        deal_flop(g);
+    if (g->n_community < 4)
+        deal_turn(g);
+    if (g->n_community < 5)
+        deal_river(g);
 }
 
 struct game *
@@ -34,41 +52,92 @@ new_game (int n_players)
      * allin = 0
      *  &c.
      */
-    g->players = calloc(n_players, sizeof (player_t));
+    if (n_players > MAX_PLAYERS)
+        n_players = MAX_PLAYERS;
+    g->players = calloc(MAX_PLAYERS, sizeof (player_t));
     g->n_players = n_players;
-    g->pots = calloc(1, sizeof (pot_t));
-    g->n_pots = 1;
-    /* players are added to the pot by betting. */
-    g->pots[0].players = NULL;
-    g->pots[0].n_players = 0;
-    g->pots[0].content = 0;
-    g->pots[0].bet = 0;
+    /* players without a nick aren't in the index. see add_player(). */
+    memset(g->seats, 0, sizeof g->seats);
+    if (arena_init(&g->hand, ARENA_ROUND(MAX_POTS * sizeof (pot_t))
+                               + HAND_SCRATCH) != 0) {
+        free(g->players);
+        free(g);
+        return NULL;
+    }
+    new_hand(g);
 
     /* defaults */
+    g->variant = &variants[VARIANT_HOLDEM];
     g->small_blind = 1;
     g->big_blind = 2;
     g->betting_unit = 0;
     g->base_stock = 0;
+    g->big_cards = 0;
+    g->turn_seconds = TURN_SECONDS;
+
+    memset(&g->turn_timer, 0, sizeof g->turn_timer);
+    g->turn_warned = 0;
+    g->session = NULL;
+    g->channel = NULL;
+    g->server = NULL;
+    g->hands = 0;
 
     g->phase = PHASE_PRE_DEAL;
-    g->turn = 0;
+    g->turn = -1;
+    g->state = ENGINE_IDLE;
+    g->ev_head = g->ev_tail = 0;
+    g->history = NULL;
+    g->tally = NULL;
+    g->tourney = NULL;
+    g->house = NULL;
     g->button = 0;
 
-    init_deck(g->deck);
+    variant_deck(g->variant, g->deck);
+    g->next_card = 0;
+    g->n_community = 0;
+    rng_init(&g->rng, RESEED_INTERVAL);
 
     return g;
 }
 
+void set_variant(game_tp g, const struct variant *v)
+{
+    g->variant = v;
+    variant_deck(v, g->deck);
+    g->next_card = 0;
+}
+
 void free_game (game_tp g)
 {
-    int i;
-    for (i=0; i<g->n_pots; ++i)
-        free(g->pots[i].players);
-    free(g->pots);
+    tourney_forget(g);
+    timer_cancel(&g->turn_timer);
+    free(g->channel);
+    free(g->history);
+    free(g->tally);
+    arena_free(&g->hand);
     free(g->players);
     free(g);
 }
 
+void new_hand (game_tp g)
+{
+    int i;
+
+    for (i = 0; i < g->n_players; i++)
+        g->players[i].committed = 0;
+    g->round_bet = 0;
+
+    arena_reset(&g->hand);
+    /* players are added to the pot by betting. */
+    g->pots = arena_calloc(&g->hand, MAX_POTS * sizeof (pot_t));
+    g->n_pots = 1;
+}
+
+void *hand_alloc (game_tp g, size_t size)
+{
+    return arena_alloc(&g->hand, size);
+}
+
 int
 next_player (game_tp g, int playeridx)
 {
@@ -5,15 +5,53 @@
 
 typedef struct game *game_tp;
 
+#include <stdint.h>
+
+#include "arena.h"
 #include "card.h"
 #include "deck.h"
 #include "player.h"
+#include "rng.h"
+#include "timer.h"
+#include "variant.h"
+
+/* 22 hands, a board and three burns take up the whole deck. fewer in
+ * some variants, see variant.h */
+#define MAX_PLAYERS 22
+/* open addressing for the nick index: a power of two, well over
+ * MAX_PLAYERS so probes stay short */
+#define SEAT_SLOTS 64
+
+/* every all-in can split off a side pot */
+#define MAX_POTS (MAX_PLAYERS + 1)
+/* per-hand memory besides the pots */
+#define HAND_SCRATCH 4096
+
+/* seconds a player has to act, and how long before that they're warned */
+#ifndef TURN_SECONDS
+#define TURN_SECONDS 60
+#endif
+#define TURN_WARNING 15
+
+/* a set of players, by index */
+typedef uint32_t seatmask_t;
+#define SEAT_BIT(i) ((seatmask_t)1 << (i))
+#if MAX_PLAYERS > 32
+#error "MAX_PLAYERS doesn't fit into a seatmask_t"
+#endif
+
+/* what the betting engine has to say, see engine.h */
+struct event {
+    int type;
+    int player;         /* or -1 */
+    int amount, total;
+};
+#define EVENT_QUEUE 256     /* a power of two */
 
 typedef struct pot {
     int content;
     int bet;
-    player_t **players;
-    int n_players;
+    seatmask_t seats;   /* who has a claim on it */
 } pot_t;
 
 enum game_phase {
@@ -26,32 +64,70 @@ enum game_phase {
 
 struct game {
     /* infrastructure */
-    card_t deck[52];
-    card_t community[5];    /* the community cards */
-    player_t *players;
+    pcard_t deck[52];       /* or fewer cards, see the variant */
+    rng_t rng;              /* shuffles the deck */
+    int next_card;          /* deck[next_card] is the top of the deck */
+    pcard_t community[5];   /* the community cards */
+    int n_community;        /* how many of them are on the table */
+    player_t *players;      /* room for MAX_PLAYERS, so pointers stay put */
     int n_players;
-    pot_t *pots;
+    unsigned char seats[SEAT_SLOTS];    /* nick hash -> player index + 1 */
+    struct arena hand;      /* everything that only lasts this hand */
+    pot_t *pots;            /* room for MAX_POTS, from hand */
     int n_pots;
+    int round_bet;          /* the bet to call in this round */
+    /* the clock on whoever's turn it is, on the wheel of the thread the
+     * game lives on, and where to complain when it runs out */
+    struct timer turn_timer;
+    int turn_warned;
+    void *session;
+    char *channel;
+    const char *server;     /* its name, for the records. not ours. */
+    unsigned hands;         /* dealt at this table */
+    /* the betting state machine, see engine.h */
+    int state;
+    int to_act;             /* the player the engine looks at */
+    int first_to_act;       /* and the one it started with */
+    int new_round;
+    struct event events[EVENT_QUEUE];
+    unsigned ev_head, ev_tail;
+    struct history_log *history;    /* for the hand history, see history.h */
+    struct hand_tally *tally;       /* for the stats, see stats.h */
+    struct tourney_table *tourney;  /* if it's a tournament's, see tourney.h */
 
     /* rules */
+    const struct variant *variant;
     int small_blind, big_blind;
     int betting_unit;
     int base_stock;
+    int big_cards;  /* show the board as pictures, see atlas.h */
+    int turn_seconds;   /* 0: take all the time you want */
     /* TODO: limits */
 
     player_t *house; /* overlord */
 
     /* situation */
     enum game_phase phase;
-    int turn;
+    int turn;       /* -1 while nobody's */
     int button;
 };
 
 
+/* each burns a card, then turns up the street */
+void deal_flop(game_tp);
+void deal_turn(game_tp);
+void deal_river(game_tp);
+/* deals whichever streets are still missing */
 void deal_community(game_tp);
 
 game_tp new_game(int n_players);
+/* between hands: the deck changes with it */
+void set_variant(game_tp, const struct variant *);
 void free_game(game_tp);
+/* forgets the last hand: one empty pot, and the arena starts over */
+void new_hand(game_tp);
+/* per-hand memory. gone at the next new_hand(). */
+void *hand_alloc(game_tp, size_t size);
 
 int next_player(game_tp, int playeridx);
 
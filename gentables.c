@@ -0,0 +1,276 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* works out the evaluator's lookup tables (see hand.c) and writes them out
+ * as C, for handtables.c. the bot itself then has nothing to compute: the
+ * tables are const data, mapped straight out of the executable and shared
+ * between every process running it.
+ *
+ * usage: gentables [output file]   (default handtables.c) */
+
+#include <stdio.h>
+#include "hand.h"
+#define GENTABLES
+#include "handtables.h"
+
+/* combos[n][s]: the number of n-digit histograms adding up to s cards */
+static int combos[RANKS + 1][MAX_CARDS + 1];
+/* the rest as in handtables.h */
+static int hash_dp[RANKS][5][MAX_CARDS + 1];
+static int hash_base[MAX_CARDS + 1];
+static int flush_table[1 << RANKS];
+static int noflush_table[NOFLUSH_SIZE];
+
+static int
+hash_histogram (const int hist[], int n)
+{
+    /* ranks a histogram of n cards among all n-card histograms */
+    int i;
+    int idx = hash_base[n];
+
+    for (i = RANKS - 1; i >= 0 && n > 0; i--) {
+        idx += hash_dp[i][hist[i]][n];
+        n -= hist[i];
+    }
+    return idx;
+}
+
+static int
+straight_high (int mask)
+{
+    /* rank of the top card of the best straight in mask, or -1 */
+    int m = mask & (mask << 1) & (mask << 2) & (mask << 3) & (mask << 4);
+
+    if (m)
+        return 31 - __builtin_clz(m);
+    if ((mask & 0x100f) == 0x100f)  /* 5 4 3 2 A */
+        return 3;
+    return -1;
+}
+
+static int
+make_strength (ranks_t rank, const int cards[], int n)
+{
+    int i;
+    int s = rank << 20;
+
+    for (i = 0; i < n; i++)
+        s |= cards[i] << (16 - 4 * i);
+    return s;
+}
+
+static int
+top_ranks (const int hist[], int exclude1, int exclude2, int cards[], int n)
+{
+    /* fills cards with the n highest ranks present, skipping the excluded */
+    int r;
+    int c = 0;
+
+    for (r = RANKS - 1; r >= 0 && c < n; r--)
+        if (hist[r] && r != exclude1 && r != exclude2)
+            cards[c++] = r;
+    return c;
+}
+
+static int
+eval_flush_mask (int mask)
+{
+    /* strength of the best hand in a suit holding the ranks in mask */
+    int hist[RANKS];
+    int cards[5];
+    int r;
+
+    if (__builtin_popcount(mask) < 5)
+        return 0;
+
+    if ((cards[0] = straight_high(mask)) >= 0)
+        return make_strength(cards[0] == 12 ? ROYALFLUSH : STRAIGHTFLUSH,
+                             cards, 1);
+
+    for (r = 0; r < RANKS; r++)
+        hist[r] = (mask >> r) & 1;
+    top_ranks(hist, -1, -1, cards, 5);
+    return make_strength(FLUSH, cards, 5);
+}
+
+static int
+eval_histogram (const int hist[])
+{
+    /* strength of the best hand without a flush, the slow way */
+    int cards[5] = { 0 };  /* always filled, but compilers can't tell */
+    int r;
+    int mask = 0;
+    int quad = -1, trip = -1, pair1 = -1, pair2 = -1;
+
+    for (r = RANKS - 1; r >= 0; r--) {
+        if (hist[r])
+            mask |= 1 << r;
+        if (hist[r] == 4 && quad < 0)
+            quad = r;
+        else if (hist[r] == 3 && trip < 0)
+            trip = r;
+        else if (hist[r] >= 2 && pair1 < 0)
+            pair1 = r; /* a second three of a kind counts as a pair */
+        else if (hist[r] >= 2 && pair2 < 0)
+            pair2 = r;
+    }
+
+    if (quad >= 0) {
+        cards[0] = quad;
+        top_ranks(hist, quad, -1, &cards[1], 1);
+        return make_strength(FOURKIND, cards, 2);
+    }
+    if (trip >= 0 && pair1 >= 0) {
+        cards[0] = trip;
+        cards[1] = pair1;
+        return make_strength(FULLHOUSE, cards, 2);
+    }
+    if ((cards[0] = straight_high(mask)) >= 0)
+        return make_strength(STRAIGHT, cards, 1);
+    if (trip >= 0) {
+        cards[0] = trip;
+        top_ranks(hist, trip, -1, &cards[1], 2);
+        return make_strength(THREEKIND, cards, 3);
+    }
+    if (pair2 >= 0) {
+        cards[0] = pair1;
+        cards[1] = pair2;
+        top_ranks(hist, pair1, pair2, &cards[2], 1);
+        return make_strength(TWOPAIR, cards, 3);
+    }
+    if (pair1 >= 0) {
+        cards[0] = pair1;
+        top_ranks(hist, pair1, -1, &cards[1], 3);
+        return make_strength(ONEPAIR, cards, 4);
+    }
+    top_ranks(hist, -1, -1, cards, 5);
+    return make_strength(HIGHCARD, cards, 5);
+}
+
+static void
+fill_noflush (int hist[], int rank, int left, int n)
+{
+    /* recursively visits every histogram of n cards */
+    int d;
+
+    if (rank < 0) {
+        if (left == 0)
+            noflush_table[hash_histogram(hist, n)] = eval_histogram(hist);
+        return;
+    }
+    for (d = 0; d <= 4 && d <= left; d++) {
+        hist[rank] = d;
+        fill_noflush(hist, rank - 1, left - d, n);
+    }
+    hist[rank] = 0;
+}
+
+static void
+build_tables (void)
+{
+    int hist[RANKS];
+    int i, d, dd, s, n;
+
+    /* count histograms, digit by digit */
+    for (s = 0; s <= MAX_CARDS; s++)
+        combos[0][s] = (s == 0);
+    for (i = 1; i <= RANKS; i++)
+        for (s = 0; s <= MAX_CARDS; s++) {
+            combos[i][s] = 0;
+            for (d = 0; d <= 4 && d <= s; d++)
+                combos[i][s] += combos[i - 1][s - d];
+        }
+
+    /* a histogram with d cards of rank i comes after all those that have
+     * fewer cards of rank i (and the same above it) */
+    for (i = 0; i < RANKS; i++)
+        for (d = 0; d <= 4; d++)
+            for (s = 0; s <= MAX_CARDS; s++) {
+                hash_dp[i][d][s] = 0;
+                for (dd = 0; dd < d && dd <= s; dd++)
+                    hash_dp[i][d][s] += combos[i][s - dd];
+            }
+
+    for (n = 0, i = 0; n <= MAX_CARDS; n++) {
+        hash_base[n] = i;
+        if (n >= 5)
+            i += combos[RANKS][n];
+    }
+
+    for (i = 0; i < (1 << RANKS); i++)
+        flush_table[i] = eval_flush_mask(i);
+
+    for (i = 0; i < RANKS; i++)
+        hist[i] = 0;
+    for (n = 5; n <= MAX_CARDS; n++)
+        fill_noflush(hist, RANKS - 1, n, n);
+}
+
+static void
+write_ints (FILE *f, const int *v, const int dims[], int n_dims, int depth)
+{
+    /* one level of braces per dimension, eight numbers to a line */
+    int i, size = 1;
+
+    for (i = 1; i < n_dims; i++)
+        size *= dims[i];
+
+    fprintf(f, "%*s{", 4 * depth, "");
+    if (n_dims == 1 && dims[0] <= 8) {
+        for (i = 0; i < dims[0]; i++)
+            fprintf(f, " %d%s", v[i], i < dims[0] - 1 ? "," : " }");
+        return;
+    }
+    if (n_dims == 1) {
+        for (i = 0; i < dims[0]; i++)
+            fprintf(f, "%s%d%s", i % 8 ? " " : "\n    ",
+                    v[i], i < dims[0] - 1 ? "," : "\n");
+    } else {
+        fputs("\n", f);
+        for (i = 0; i < dims[0]; i++) {
+            write_ints(f, v + i * size, dims + 1, n_dims - 1, depth + 1);
+            fputs(i < dims[0] - 1 ? ",\n" : "\n", f);
+        }
+    }
+    fprintf(f, "%*s}", 4 * depth, "");
+}
+
+static void
+write_table (FILE *f, const char *decl, const int *v, const int dims[],
+             int n_dims)
+{
+    fprintf(f, "\nconst int %s = ", decl);
+    write_ints(f, v, dims, n_dims, 0);
+    fputs(";\n", f);
+}
+
+int main(int argc, char **argv)
+{
+    static const int dp_dims[] = { RANKS, 5, MAX_CARDS + 1 };
+    static const int base_dims[] = { MAX_CARDS + 1 };
+    static const int flush_dims[] = { 1 << RANKS };
+    static const int noflush_dims[] = { NOFLUSH_SIZE };
+    const char *out = argc > 1 ? argv[1] : "handtables.c";
+    FILE *f;
+
+    build_tables();
+
+    if (!(f = fopen(out, "w"))) {
+        perror(out);
+        return 1;
+    }
+    fputs("/* made by gentables. don't edit, change gentables.c instead. */\n"
+          "#include \"handtables.h\"\n", f);
+    write_table(f, "hash_dp[RANKS][5][MAX_CARDS + 1]", &hash_dp[0][0][0],
+                dp_dims, 3);
+    write_table(f, "hash_base[MAX_CARDS + 1]", hash_base, base_dims, 1);
+    write_table(f, "flush_table[1 << RANKS]", flush_table, flush_dims, 1);
+    write_table(f, "noflush_table[NOFLUSH_SIZE]", noflush_table,
+                noflush_dims, 1);
+
+    if (fclose(f) != 0) {
+        perror(out);
+        return 1;
+    }
+    return 0;
+}
@@ -1,467 +1,247 @@
 /* Copyright 2011 Tuna <tuna@supertunaman.com
  * This code is under the Chicken Dance License v0.1 */
 #include "hand.h"
+#include "handtables.h"
+#include "metrics.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_EVAL
+#endif
 
 /*
- * Queso, this file is where all the hand-evaluating magic is. It is based on
- * a description of an algorithm by Nick Sayer.
- *
- * http://nsayer.blogspot.com/2007/07/algorithm-for-evaluating-poker-hands.html
+ * Queso, this file is where all the hand-evaluating magic is. It used to be
+ * based on a description of an algorithm by Nick Sayer, which compared two
+ * five-card hands at a time and had to be run on all 21 five-card hands a
+ * player can make. It is now table driven, and looks at all of a player's
+ * cards (5 to 7) at once.
  *
- * Its method of operation is fairly simple.
+ *  1.  Every hand is boiled down to a single int, its strength (see hand.h).
+ *      Comparing two hands is comparing two ints.
  *
- *  1.  Two five-card hands are ranked. That is, they are passed to rank_hand() 
- *      which finds out if the hand is a pair, straight, flush, or whatever. 
- *      This is an operation in and of itself.
- *  
- *      * A histogram is made of the cards in the hand. If there are four of 
- *          one card, it's a four of a kind. If there are three of one card, 
- *          it's a three of a kind or a full house if there is also another
- *          pair, etc. A value is returned if any sort of pair or multiple is 
- *          found.
- *      * Failing that, we check for a flush by checking the cards' suits. If 
- *          it is a flush, a value is not yet returned, because it could be 
- *          a straight or a royal flush.
- *      * The hand is tested for a straight. Since the possibility of multiples 
- *          has been ruled out, the hand is sorted and the top value is 
- *          subtracted from the low value. If that equals 4, it's a straight. 
- *          If the test for a flush succeeded, then it's a straight flush.
- *          If there is an ace in the deck, and its value is promoted to 14,
- *          and the low card is 10, and the flush test succeeded, then it's a 
- *          royal flush. Otherwise, either flush or high card is returned.
+ *  2.  The cards come as a cardmask_t (see card.h), one 16-bit lane per suit.
+ *      If five or more bits of a lane are set, the hand is a flush (or
+ *      better). With 7 cards or fewer, a flush rules out four of a kind and
+ *      full houses, so the ranks in that suit are all we need: the lane
+ *      indexes flush_table, which knows the best flush, straight
+ *      flush or royal flush in every possible mask.
  *
- *  2.  If the hand ranks differ, then a result is returned.
- *  3.  If the hand rank is a royal flush, 0 is returned, indicating that the 
- *      hands are equal.
- *  4.  If the hands are straights or straith flushes, the high card is 
- *      compared.
- *  5.  If the hands are Flushes or High Cards, then we iterate down the sorted 
- *      lists and compare each card.
- *  6.  If the hand is a four of a kind, then the third card in the sorted 
- *      lists are compared, and then the kicker (determined to be element 0 or 
- *      4 in either).
- *  7.  For a full house, element 2 is compared again, and then the other pairs
- *      are found and compared.
- *  8.  Three of a kind is similar to a full house, except the other two cards 
- *      are not a pair.
- *  9.  For a two pair, the two pairs are each found and compared, and then the
- *      kicker.
- *  10. In the case of a one pair, the pair is found and compared at first, 
- *      and then the third, fourth, and fifth cards.
+ *  3.  Otherwise, suits don't matter at all. A histogram of the ranks (how
+ *      many twos, how many threes, &c.) is a 13-digit number in base 5,
+ *      of which there are only 73775 that add up to 5, 6 or 7 cards.
+ *      A perfect hash maps each of those to its own slot in noflush_table,
+ *      which holds the strength of the best hand.
  *
- *  And that's how it works. Some notes:
+ *  Both tables are worked out at build time by gentables, using the slow
+ *  and obvious method: find the multiples, then the straights, then the
+ *  kickers. They end up in handtables.c as const data, so there's nothing
+ *  to do at startup.
  *
- *  For some reason, I have aces hold a value of 0 by default, and raise its 
- *  value to 14 when it's worth more than other cards (which is most of the 
- *  time) rather than dropping to 0 when it's a low card.
+ *  eval_masks() does the same for a whole array of hands. With AVX2, four
+ *  hands (one per 64-bit lane) go through at a time: the rank counts come
+ *  from shifts and adds across the suit lanes, the table lookups are
+ *  gathers, and the flush lanes are looked up in flush_table all four at
+ *  once. A lane that isn't a flush holds fewer than five ranks, for which
+ *  flush_table has 0, and a hand with a flush can't hold anything better
+ *  than a straight otherwise, so the best of the five lookups is the
+ *  strength. Which loop runs is decided once, by init_hand_tables().
  *
- *  I think I handled straights incorrectly, in that a 10 J Q K A straight 
- *  would not be recognized as a straight unless it actually turns out to be a 
- *  royal flush. Will investigate later.
+ *  Aces are high (rank 12) everywhere except in the 5-4-3-2-A straight,
+ *  which is a five-high straight. Other than the old code, 10 J Q K A is now
+ *  a straight even when it isn't a royal flush.
  */
 
-int handcmp(card_t hand1[], card_t hand2[])
-{
-    /* compares two 5-card hands
-     * returns -1 if hand1 is lesser, 0 if it's equal, and 1 if it's greater than hand2 */
-    ranks_t rank1 = rank_hand(hand1);
-    ranks_t rank2 = rank_hand(hand2);
-    int handvals1[5];
-    int handvals2[5];
-    int i;
-    int first_pair1 = 0;
-    int first_pair2 = 0;
-    int second_pair1 = 0;
-    int second_pair2 = 0;
-    int third_card1;
-    int third_card2;
-    int fourth_card1;
-    int fourth_card2;
-    int fifth_card1;
-    int fifth_card2;
-    int full_of1;
-    int full_of2;
-    int histogram1[15];
-    int histogram2[15];
-    int tmp;
-
-    /* set all histogram values to 0 */
-    for (i = 0; i < 15; i++) { 
-        histogram1[i] = 0; 
-        histogram2[i] = 0; 
-    }
-    
-    /* put values of cards into handvals arrays and sort */
-    for (i = 0; i < 5; i++) {
-        handvals1[i] = hand1[i].value;
-        handvals2[i] = hand2[i].value;
-    }
-    sort(handvals1, 5);
-    sort(handvals2, 5);
-
-    /* return result if ranks differ */
-    if (rank1 < rank2)
-        return -1;
-    if (rank1 > rank2)
-        return 1;
-
-    /* Ranks are the same, so now we get to work */
-    switch (rank1)
-    {
-        case ROYALFLUSH:
-            return 0;   /* A royal flush is a royal flush */
-
-        /* same process for straight and straight flush */
-        case STRAIGHT:
-        case STRAIGHTFLUSH:
-            /* promote ace if it's ace high */
-            if (handvals1[4] == 13) /* after sorting, the last card will be king in an ace-high straight */
-                promote_aces(handvals1);
-            if (handvals2[4] == 13)
-                promote_aces(handvals2);
-            sort(handvals1, 5);
-            sort(handvals2, 5);
-
-            /* compare the last (highest) element of each array */
-            if (handvals1[4] < handvals2[4])
-                return -1;
-            if (handvals1[4] > handvals2[4])
-                return 1;
-            return 0;
-
-        /* test which hand has the higher card(s) */
-        case FLUSH:
-        case HIGHCARD:
-            promote_aces(handvals1);    /* turn all values of 1 to 14 */
-            promote_aces(handvals2);
-
-            /* loop down both lists and try to find a higher card */
-            for (i = 4; i >= 0; i--) {
-                if (handvals1[i] < handvals2[i])
-                    return -1;
-                if (handvals1[i] > handvals2[i])
-                    return 1;
-            }
-            return 0;
-
-        case FOURKIND:
-            promote_aces(handvals1);
-            promote_aces(handvals2);
-
-            /* find out which majority is greater */
-            if (handvals1[2] < handvals2[2])
-                return -1;
-            if (handvals1[2] > handvals2[2])
-                return 1;
-
-            /* if the four of a kind is all in the community, test fifth card */
-            /* the fifth card will either be [0] or [4] after sorting */
-            if (handvals1[0] != handvals1[2])
-                fifth_card1 = handvals1[0];
-            else
-                fifth_card1 = handvals1[4];
-
-            if (handvals2[0] != handvals2[2])
-                fifth_card2 = handvals2[0];
-            else
-                fifth_card2 = handvals2[4];
-
-            if (fifth_card1 < fifth_card2)
-                return -1;
-            if (fifth_card1 > fifth_card2)
-                return 1;
-            
-            return 0;
-
-        case FULLHOUSE:
-            promote_aces(handvals1);
-            promote_aces(handvals2);
-
-            /* compare the three of a kind */
-            if (handvals1[2] < handvals2[2])
-                return -1;
-            if (handvals1[2] > handvals2[2])
-                return 1;
-            
-            /* find out where the "full of" pair is */
-            if (handvals1[1] != handvals1[2])
-                full_of1 = handvals1[1];
-            else
-                full_of1 = handvals1[3];
-            
-            if (handvals2[1] != handvals2[2])
-                full_of2 = handvals2[1];
-            else
-                full_of2 = handvals2[3];
-
-            /* compare the "full of" cards */
-            if (full_of1 < full_of2)
-                return -1;
-            if (full_of1 > full_of2)
-                return 1;
-
-            return 0;
-
-        case THREEKIND:
-            promote_aces(handvals1);
-            promote_aces(handvals2);
-
-            /* compare the three of a kind */
-            if (handvals1[2] < handvals2[2])
-                return -1;
-            if (handvals1[2] > handvals2[2])
-                return 1;
-            
-            /* find the fourth and fifth cards and compare them */
-            if (handvals1[0] == handvals1[2]) {
-                fourth_card1 = handvals1[4];
-                fifth_card1 = handvals1[3];
-            } else {
-                fifth_card1 = handvals1[0];
-            }
-            if (handvals1[1] == handvals1[2])
-                fourth_card1 = handvals1[4];
-            else
-                fourth_card1 = handvals1[1];
-
-            if (handvals2[0] == handvals2[2]) {
-                fourth_card2 = handvals2[4];
-                fifth_card2 = handvals2[3];
-            } else {
-                fifth_card2 = handvals2[0];
-            }
-            if (handvals2[1] == handvals2[2])
-                fourth_card2 = handvals2[4];
-            else
-                fourth_card2 = handvals2[1];
-
-            if (fourth_card1 < fourth_card2)
-                return -1;
-            if (fourth_card1 > fourth_card2)
-                return 1;
-
-            if (fifth_card1 < fifth_card2)
-                return -1;
-            if (fifth_card1 > fifth_card2)
-                return 1;
-
-            return 0;
-
-        case TWOPAIR:
-            promote_aces(handvals1);
-            promote_aces(handvals2);
-
-            /* put values into the histograms */
-            for (i = 0; i < 5; i++) {
-                histogram1[handvals1[i]]++;
-                histogram2[handvals2[i]]++;
-            }
-
-            /* go through both histograms and figure out the pairs and fifth card */
-            for (i = 2; i < 15; i++) {
-                if (histogram1[i] == 1) 
-                    fifth_card1 = i;
-                if (histogram1[i] == 2) {
-                    if (first_pair1)
-                        second_pair1 = i;
-                    else
-                        first_pair1 = i;
-                }
-                
-                if (histogram2[i] == 1) 
-                    fifth_card2 = i;
-                if (histogram2[i] == 2) {
-                    if (first_pair2)
-                        second_pair2 = i;
-                    else
-                        first_pair2 = i;
-                }
-            }
-
-            /* make sure the first pair is higher than the second pair */
-            if (first_pair1 < second_pair1) {
-                tmp = first_pair1;
-                first_pair1 = second_pair1;
-                second_pair1 = tmp;
-            }
-            if (first_pair2 < second_pair2) {
-                tmp = first_pair2;
-                first_pair2 = second_pair2;
-                second_pair2 = tmp;
-            }
-
-            /* finally compare the pairs and the fifth card */
-            if (first_pair1 < first_pair2)
-                return -1;
-            if (first_pair1 > first_pair2)
-                return 1;
+static int tables_ready = 0;
 
-            if (second_pair1 < second_pair2)
-                return -1;
-            if (second_pair1 > second_pair2)
-                return 1;
+static void eval_masks_scalar(const cardmask_t cards[], int strength[], int n);
+static void (*eval_masks_impl)(const cardmask_t [], int [], int) = eval_masks_scalar;
 
-            if (fifth_card1 < fifth_card2)
-                return -1;
-            if (fifth_card1 > fifth_card2)
-                return 1;
-            
-            return 0;
-
-        case ONEPAIR:
-            promote_aces(handvals1);
-            promote_aces(handvals2);
-
-            for (i = 0; i < 5; i++) {
-                histogram1[handvals1[i]]++;
-                histogram2[handvals2[i]]++;
-            }
-
-            /* find both pairs and then break */
-            for (i = 2; i < 15; i++) {
-                if (histogram1[i] == 2) 
-                    first_pair1 = i;
-                if (histogram2[i] == 2)
-                    first_pair2 = i;
-                if (first_pair1 && first_pair2)
-                    break;
-            }
-            
-            /* compare the pairs */
-            if (first_pair1 != first_pair2)
-                return (first_pair1 > first_pair2);
-
-            /* find third, fourth, and fifth cards */
-            for (i = 0; i < 5; i++) {
-                if (handvals1[i] != first_pair1) {
-                    if (!fifth_card1)
-                        fifth_card1 = handvals1[i];
-                    else if (!fourth_card1)
-                        fourth_card1 = handvals1[i];
-                    else
-                        third_card1 = handvals1[i];
-                }
-                if (handvals2[i] != first_pair2) {
-                    if (!fifth_card2)
-                        fifth_card2 = handvals2[i];
-                    else if (!fourth_card2)
-                        fourth_card2 = handvals2[i];
-                    else
-                        third_card2 = handvals2[i];
-                }
-            }
-
-            /* compare third fourth and fifth cards */
-            if (third_card1 < third_card2)
-                return -1;
-            if (third_card1 > third_card2)
-                return 1;
+#ifdef HAVE_AVX2_EVAL
+__attribute__((target("avx2")))
+static void
+eval_masks_avx2 (const cardmask_t cards[], int strength[], int n)
+{
+    const __m256i ones = _mm256_set1_epi64x(0x0001000100010001LL);
+    const __m256i low13 = _mm256_set1_epi64x(0x1fff);
+    const __m256i low3 = _mm256_set1_epi64x(7);
+    /* popcount of a nibble, for counting the cards */
+    const __m256i nibble = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                            1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3,
+                                            1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low4 = _mm256_set1_epi8(0x0f);
+    int i, r, k;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m256i m = _mm256_loadu_si256((const __m256i *) &cards[i]);
+        __m256i left, c, at;
+        __m128i idx, s;
+
+        /* cards per hand */
+        left = _mm256_add_epi8(
+                _mm256_shuffle_epi8(nibble, _mm256_and_si256(m, low4)),
+                _mm256_shuffle_epi8(nibble,
+                       _mm256_and_si256(_mm256_srli_epi64(m, 4), low4)));
+        left = _mm256_sad_epu8(left, _mm256_setzero_si256());
+
+        /* hash_histogram(), a rank at a time. hash_dp[r][c][left] is
+         * element (r * 5 + c) * 8 + left. */
+        idx = _mm256_i64gather_epi32(hash_base, left, 4);
+        for (r = RANKS - 1; r >= 0; r--) {
+            c = _mm256_and_si256(_mm256_srli_epi64(m, r), ones);
+            c = _mm256_add_epi64(c, _mm256_srli_epi64(c, 32));
+            c = _mm256_and_si256(_mm256_add_epi64(c, _mm256_srli_epi64(c, 16)),
+                                 low3);
+            at = _mm256_add_epi64(_mm256_slli_epi64(c, 3), left);
+            at = _mm256_add_epi64(at, _mm256_set1_epi64x(r * 5 * 8));
+            idx = _mm_add_epi32(idx,
+                                _mm256_i64gather_epi32(&hash_dp[0][0][0], at, 4));
+            left = _mm256_sub_epi64(left, c);
+        }
+        s = _mm_i32gather_epi32(noflush_table, idx, 4);
 
-            if (fourth_card1 < fourth_card2)
-                return -1;
-            if (fourth_card1 > fourth_card2)
-                return 1;
+        for (k = 0; k < 4; k++) {
+            at = _mm256_and_si256(_mm256_srli_epi64(m, 16 * k), low13);
+            s = _mm_max_epi32(s, _mm256_i64gather_epi32(flush_table, at, 4));
+        }
+        _mm_storeu_si128((__m128i *) &strength[i], s);
+    }
+    eval_masks_scalar(&cards[i], &strength[i], n - i);
+}
+#endif
 
-            if (fifth_card1 < fifth_card2)
-                return -1;
-            if (fifth_card1 > fifth_card2)
-                return 1;
+void init_hand_tables(void)
+{
+    /* the tables are ready made. this only picks the batch loop. */
+#ifdef HAVE_AVX2_EVAL
+    if (__builtin_cpu_supports("avx2"))
+        eval_masks_impl = eval_masks_avx2;
+#endif
+    tables_ready = 1;
+}
 
-            return 0;
+static int eval_one(cardmask_t cards)
+{
+    int lane[4];
+    int n = MASK_COUNT(cards);
+    int idx, i, r, c;
+
+    for (i = 0; i < 4; i++) {
+        lane[i] = MASK_SUIT(cards, i);
+        if (__builtin_popcount(lane[i]) >= 5)
+            return flush_table[lane[i]];
+    }
 
-        default:    /* shouldn't happen */
-            return 0;
+    /* the perfect hash (hash_histogram() in gentables.c), counting cards of
+     * each rank across the lanes */
+    idx = hash_base[n];
+    for (r = RANKS - 1; r >= 0 && n > 0; r--) {
+        c = ((lane[0] >> r) & 1) + ((lane[1] >> r) & 1)
+          + ((lane[2] >> r) & 1) + ((lane[3] >> r) & 1);
+        idx += hash_dp[r][c][n];
+        n -= c;
     }
+    return noflush_table[idx];
 }
 
-void promote_aces(int handvals[])
+int eval_mask(cardmask_t cards)
+{
+    METRIC_INC(C_EVALS);
+    return eval_one(cards);
+}
+
+static void
+eval_masks_scalar (const cardmask_t cards[], int strength[], int n)
 {
-    /* Aces have a value of 0. This makes them "worth" more than other cards, where high card is important. */
     int i;
-    
-    for (i = 0; i < 5; i++) {
-        if (handvals[i] == 1)
-            handvals[i] = 14;
-    }
-    sort(handvals, 5);
+
+    for (i = 0; i < n; i++)
+        strength[i] = eval_one(cards[i]);
 }
 
-void sort(int a[], int n)
+void eval_masks(const cardmask_t cards[], int strength[], int n)
 {
-    int i, j, value;
-    
-    for (i = 1; i < n; i++)
-    {
-        value = a[i];
-        for (j = i - 1; j >= 0 && a[j] > value; j--) {
-            a[j + 1] = a[j];
-        }
-        a[j + 1] = value;
-    }
+    if (!tables_ready)
+        init_hand_tables();
+    METRIC_ADD(C_EVALS, n);
+    eval_masks_impl(cards, strength, n);
 }
 
-ranks_t rank_hand(card_t hand[])
+int eval_hand(const pcard_t cards[], int n)
 {
-    /* gives hand a rank, such as two pair or flush. */
-    int handvals[5];
-    int histogram[13];
+    cardmask_t mask = 0;
     int i;
-    int flush = 1;
-    
-    /* set all histogram values to 0 */
-    for (i = 0; i < 13; i++) { histogram[i] = 0; }
 
-    /* generate histogram of multiples */
-    for (i = 0; i < 5; i++)
-        histogram[hand[i].value - 1]++;
-    sort(histogram, 13);
-    
-    /* evaluate sorted histogram */
-    switch (histogram[12]) {
-        case 4:
-            return FOURKIND;
-        case 3:
-            if (histogram[11] == 2)
-                return FULLHOUSE;
-            else
-                return THREEKIND;
-        case 2:
-            if (histogram[11] == 2)
-                return TWOPAIR;
-            else
-                return ONEPAIR;
-    }
-    
-    /* test for a flush */
-    for (i = 1; i < 5; i++) {
-        if (hand[i].suit == hand[0].suit)
-            flush++;    /* will amount to 5 if it's a flush */
-    }
-
-    /* test for straight and straight flush */
-    for (i = 0; i < 5; i++) { handvals[i] = hand[i].value; }
-    sort(handvals, 5);
-
-    straights:
+    for (i = 0; i < n; i++)
+        mask |= PCARD_BIT(cards[i]);
+    return eval_mask(mask);
+}
 
-    if (handvals[4] - handvals[0] == 4 && flush == 5) 
-        return STRAIGHTFLUSH;
-    if (handvals[4] - handvals[0] == 4)
-        return STRAIGHT;
+/* how many cards of each rank in a strength make up the hand */
+static const int multiples[ROYALFLUSH + 1][5] = {
+    [HIGHCARD]      = { 1, 1, 1, 1, 1 },
+    [ONEPAIR]       = { 2, 1, 1, 1 },
+    [TWOPAIR]       = { 2, 2, 1 },
+    [THREEKIND]     = { 3, 1, 1 },
+    [STRAIGHT]      = { 1, 1, 1, 1, 1 },
+    [FLUSH]         = { 1, 1, 1, 1, 1 },
+    [FULLHOUSE]     = { 3, 2 },
+    [FOURKIND]      = { 4, 1 },
+    [STRAIGHTFLUSH] = { 1, 1, 1, 1, 1 },
+    [ROYALFLUSH]    = { 1, 1, 1, 1, 1 }
+};
+
+void eval_best_hand(cardmask_t cards, int strength, pcard_t best[])
+{
+    /* works out which ranks make up the strength, then picks matching
+     * cards out of the mask */
+    ranks_t rank = STRENGTH_RANK(strength);
+    int want[5];
+    int suit, g, k;
+    int c = 0;
+
+    for (g = 0; g < 5; g++) {
+        if (rank == STRAIGHT || rank == STRAIGHTFLUSH || rank == ROYALFLUSH)
+            /* only the top card is stored. wraps around to the ace. */
+            want[g] = (STRENGTH_CARD(strength, 0) - g + RANKS) % RANKS;
+        else
+            want[g] = STRENGTH_CARD(strength, g);
+    }
 
-    if (handvals[0] == 1) {
-        promote_aces(handvals);
-        goto straights;
+    if (rank == FLUSH || rank == STRAIGHTFLUSH || rank == ROYALFLUSH)
+        /* only look at the flush suit */
+        for (suit = 0; suit < 4; suit++)
+            if (__builtin_popcount(MASK_SUIT(cards, suit)) >= 5)
+                cards &= (cardmask_t)0xffff << (suit * 16);
+
+    if (rank == STRAIGHT || rank == STRAIGHTFLUSH)
+        /* in a short deck, the ace stands in for the five: see variant.h */
+        for (g = 0; g < 5; g++)
+            if (!(MASK_RANKS(cards) & 1 << want[g]))
+                want[g] = RANKS - 1;
+
+    for (g = 0; g < 5 && multiples[rank][g]; g++) {
+        for (k = 0, suit = 0; suit < 4 && k < multiples[rank][g]; suit++) {
+            if (cards & PCARD_BIT(PCARD(suit, want[g]))) {
+                best[c++] = PCARD(suit, want[g]);
+                k++;
+            }
+        }
     }
-    
-    /* test for flush and royal flush */
-    handvals[0] = 14;
-    sort(handvals, 5);
-    if (handvals[4] - handvals[0] == 4 && flush == 5)
-        return ROYALFLUSH; /* OMG :O */
-    if (flush == 5)
-        return FLUSH;
+}
+
+int handcmp(pcard_t hand1[], pcard_t hand2[])
+{
+    /* compares two 5-card hands
+     * returns -1 if hand1 is lesser, 0 if it's equal, and 1 if it's greater than hand2 */
+    int s1 = eval_hand(hand1, 5);
+    int s2 = eval_hand(hand2, 5);
 
-    return HIGHCARD;
+    return (s1 > s2) - (s1 < s2);
 }
 
+ranks_t rank_hand(pcard_t hand[])
+{
+    /* gives hand a rank, such as two pair or flush. */
+    return STRENGTH_RANK(eval_hand(hand, 5));
+}
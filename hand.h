@@ -22,16 +22,27 @@ typedef enum ranks {
     ROYALFLUSH
 } ranks_t;
 
-typedef struct hand {
-    card_t cards[5];
-    int cardholder;
-    int equal_to[10];
-} hand_t;
+/* A hand strength is one int: the rank (ranks_t) in bits 20-23, followed by
+ * up to five card ranks (2 = 0 ... ace = 12) in decreasing order of
+ * significance, four bits each. A bigger strength is a better hand, equal
+ * strengths split the pot. A variant that orders the ranks its own way puts
+ * that order above them, from bit 24 (see variant.h). */
+#define STRENGTH_RANK(s)        ((ranks_t)(((s) >> 20) & 0xf))
+#define STRENGTH_CARD(s, n)     (((s) >> (16 - 4 * (n))) & 0xf)
 
-int handcmp(card_t hand1[], card_t hand2[]);
-void promote_aces(int handvals[]);
-void sort(int a[], int n);
-ranks_t rank_hand(card_t hand[]);
+int handcmp(pcard_t hand1[], pcard_t hand2[]);
+ranks_t rank_hand(pcard_t hand[]);
 
-#endif
+/* evaluates the best 5-card hand out of 5 to 7 cards */
+int eval_mask(cardmask_t cards);
+int eval_hand(const pcard_t cards[], int n);
+/* eval_mask() for n hands at once, with SIMD where the CPU has it */
+void eval_masks(const cardmask_t cards[], int strength[], int n);
+/* picks the 5 cards out of cards that make up strength, best first. cards
+ * from the short deck are fine too. */
+void eval_best_hand(cardmask_t cards, int strength, pcard_t best[]);
+/* picks the fastest eval_masks() loop for this CPU. called on first use if
+ * you don't. the tables themselves are built in, see handtables.h. */
+void init_hand_tables(void);
 
+#endif
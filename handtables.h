@@ -0,0 +1,25 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef HANDTABLES_H
+#define HANDTABLES_H
+
+/* The evaluator's lookup tables, for hand.c. They are made at build time:
+ * gentables writes them out as handtables.c. See hand.c for what's in
+ * them. */
+
+#define RANKS 13
+#define MAX_CARDS 7
+#define NOFLUSH_SIZE (6175 + 18395 + 49205) /* histograms of 5, 6 and 7 cards */
+
+#ifndef GENTABLES  /* which has them writable, for filling in */
+/* hash_dp[i][d][s]: how many histograms come before one with d cards of
+ * rank i, given that ranks i and below add up to s cards. */
+extern const int hash_dp[RANKS][5][MAX_CARDS + 1];
+/* index of the first n-card histogram in noflush_table */
+extern const int hash_base[MAX_CARDS + 1];
+
+extern const int flush_table[1 << RANKS];
+extern const int noflush_table[NOFLUSH_SIZE];
+#endif
+
+#endif
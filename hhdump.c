@@ -0,0 +1,120 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* prints hand histories (see history.h) as text.
+ *
+ * usage: hhdump [-d] file...
+ *   -d  also print the deck as it was shuffled
+ *
+ * stops at the first broken record in a file, which is where a crash cut
+ * it short, and says so. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "engine.h"
+#include "hand.h"
+#include "history.h"
+
+/* event, then nick, amount and total */
+static const char *const says[] = {
+    [EV_SMALL_BLIND]    = "%s posts the small blind of %d",
+    [EV_BIG_BLIND]      = "%s posts the big blind of %d",
+    [EV_AUTO_FOLD]      = "%s is away, and folds",
+    [EV_CHECK]          = "%s checks",
+    [EV_CALL]           = "%s calls",
+    [EV_RAISE]          = "%s raises by %d to %d",
+    [EV_ALL_IN]         = "%s goes all in",
+    [EV_NOT_ALL_IN]     = "%s tries to go all in, and can't",
+    [EV_FOLD]           = "%s folds",
+    [EV_TIMEOUT_CHECK]  = "%s runs out of time, and checks",
+    [EV_TIMEOUT_FOLD]   = "%s runs out of time, and folds",
+    [EV_WIN]            = "%s wins %d",
+    [EV_WIN_BY_DEFAULT] = "everybody else folded to %s",
+    [EV_AWARD]          = "%s gets %d",
+    [EV_TOO_FEW_PLAYERS] = "too few players",
+    [EV_NO_PLAYER]      = "no player",
+    [EV_NOBODY_LEFT]    = "nobody left",
+    [EV_ANOMALOUS_BETS] = "anomalous bets at %s",
+    [EV_TOO_MANY_PLAYERS] = "too many players"
+};
+#define N_SAYS ((int) (sizeof says / sizeof *says))
+
+static const char *const hand_names[] = {
+    "high card", "one pair", "two pair", "three of a kind", "a straight",
+    "a flush", "a full house", "four of a kind", "a straight flush",
+    "a royal flush"
+};
+
+static const char *const street_names[] = {
+    [3] = "Flop", [4] = "Turn", [5] = "River"
+};
+
+static int show_deck = 0;
+
+const char *cards(const pcard_t c[], int n)
+{
+    static char buf[CARDS_STR_MAX(52)];
+
+    if (n == 0 || c[0] == HISTORY_NO_CARD)
+        return " (none)";
+    append_cards(buf, sizeof buf, 0, c, n, 0, 1);
+    return buf;
+}
+
+void print_record(const struct hand_record *r, void *data)
+{
+    char when[64];
+    time_t t = r->time;
+    const char *nick;
+    int i, n;
+
+    strftime(when, sizeof when, "%Y-%m-%d %H:%M:%S UTC", gmtime(&t));
+    printf("Hand %u in %s on %s, %s\n", r->hand,
+           *r->channel ? r->channel : "(no channel)",
+           *r->server ? r->server : "(no server)", when);
+    printf("%s\n", variants[r->variant].title);
+    for (n = 0; n < 52 && r->deck[n] != HISTORY_NO_CARD; n++)
+        ;
+    if (show_deck)
+        printf("Deck:%s\n", cards(r->deck, n));
+    for (i = 0; i < r->n_seats; i++)
+        printf("Seat %d: %s, %d chips (%d after),%s%s\n", i, r->seats[i].nick,
+               r->seats[i].chips, r->seats[i].chips_after,
+               cards(r->seats[i].hole, r->n_hole), i == r->button ? " (button)" : "");
+
+    for (i = 0; i < r->n_events; i++) {
+        const struct event *e = &r->events[i];
+
+        nick = e->player >= 0 && e->player < r->n_seats
+             ? r->seats[e->player].nick : "?";
+        if (e->type == EV_STREET && e->amount >= 3 && e->amount <= r->n_board)
+            printf("%s:%s\n", street_names[e->amount], cards(r->board, e->amount));
+        else if (e->type == EV_SHOW)
+            printf("%s shows %s\n", nick,
+                   hand_names[STRENGTH_RANK(e->amount) % 10]);
+        else if (e->type >= 0 && e->type < N_SAYS && says[e->type]) {
+            printf(says[e->type], nick, e->amount, e->total);
+            putchar('\n');
+        }
+    }
+    putchar('\n');
+}
+
+int main(int argc, char **argv)
+{
+    int i, failed = 0;
+
+    i = 1;
+    if (argc > 1 && strcmp(argv[1], "-d") == 0) {
+        show_deck = 1;
+        i++;
+    }
+    if (i == argc) {
+        fprintf(stderr, "usage: hhdump [-d] file...\n");
+        return 1;
+    }
+    for (; i < argc; i++)
+        failed |= history_read(argv[i], print_record, NULL) != 0;
+    return failed;
+}
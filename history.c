@@ -0,0 +1,598 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "history.h"
+#include "engine.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* what a game notes down while the hand is on */
+struct history_log {
+    int recording;
+    uint64_t time;
+    pcard_t deck[52];
+    int chips[MAX_PLAYERS];
+    int button;
+    seatmask_t dealt;
+    int n_events;
+    struct event events[HISTORY_EVENTS];
+};
+
+/* a packed record on its way to the writer */
+struct entry {
+    struct entry *next;
+    time_t time;
+    size_t len;
+    unsigned char data[];
+};
+
+#define RECORD_MAX (4 + 4 + 8 + 4 + 1 + HOST_LEN + 1 + HISTORY_CHANNEL_LEN \
+                    + 52 + 2 + MAX_PLAYERS * (1 + NICK_LEN + 4 + 4 + 2) \
+                    + 1 + 5 + 2 + HISTORY_EVENTS * 10 \
+                    + 2 + MAX_PLAYERS * (MAX_HOLE - 2))
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static struct entry *head = NULL, *tail = NULL;
+static pthread_t writer;
+static int running = 0;
+static int stopping = 0;
+static char *dir = NULL;
+
+/* the writer's own */
+static int fd = -1;
+static int day = -1;
+static int dirty = 0;
+static double last_sync = 0;
+
+static uint32_t
+fnv1a (const unsigned char *p, size_t n)
+{
+    uint32_t h = 2166136261u;
+
+    while (n--)
+        h = (h ^ *p++) * 16777619u;
+    return h;
+}
+
+static unsigned char *
+put_str (unsigned char *p, const char *s, size_t max)
+{
+    size_t n = strlen(s);
+
+    if (n >= max)
+        n = max - 1;
+    *p++ = n;
+    memcpy(p, s, n);
+    return p + n;
+}
+
+static unsigned char *
+put (unsigned char *p, uint64_t v, int n)
+{
+    while (n--) {
+        *p++ = v & 0xff;
+        v >>= 8;
+    }
+    return p;
+}
+
+static uint64_t
+get (const unsigned char *p, int n)
+{
+    uint64_t v = 0;
+
+    while (n--)
+        v = v << 8 | p[n];
+    return v;
+}
+
+static double
+now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void
+sync_file (void)
+{
+    if (fd >= 0 && fsync(fd) != 0)
+        perror("history: fsync");
+    dirty = 0;
+    last_sync = now();
+}
+
+static off_t
+trim_tail (const char *path)
+{
+    /* a record cut short, by a crash say, would hide every one appended
+     * after it: cut it off before appending. returns where the file ends. */
+    unsigned char h[4];
+    off_t end = lseek(fd, 0, SEEK_END), off = 8;
+    uint64_t size;
+
+    if (end < 8) {
+        off = 0;
+    } else {
+        while (end - off >= 8 && pread(fd, h, 4, off) == 4) {
+            size = get(h, 4);
+            if (size < 8 || size > RECORD_MAX)
+                return end;     /* not just cut short. leave it be */
+            if ((off_t) size > end - off)
+                break;
+            off += size;
+        }
+    }
+    if (off == end)
+        return end;
+    fprintf(stderr, "%s: cutting off a broken record at byte %ld.\n", path,
+            (long) off);
+    if (ftruncate(fd, off) != 0) {
+        perror(path);
+        return end;
+    }
+    return off;
+}
+
+static int
+open_day (time_t t)
+{
+    /* makes sure fd is the file for t's day */
+    char path[1024];
+    struct tm tm;
+    int d;
+
+    gmtime_r(&t, &tm);
+    d = (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+    if (d == day && fd >= 0)
+        return 0;
+
+    if (fd >= 0) {
+        sync_file();
+        close(fd);
+    }
+    day = d;
+    snprintf(path, sizeof path, "%s/%08d.hh", dir, d);
+    if ((fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) < 0) {
+        perror(path);
+        return -1;
+    }
+    if (trim_tail(path) == 0
+            && write(fd, HISTORY_MAGIC, 8) != 8) {
+        perror(path);
+        close(fd);
+        fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void
+write_entry (struct entry *e)
+{
+    size_t done = 0;
+    ssize_t n;
+    off_t end;
+
+    if (open_day(e->time) != 0)
+        return;
+    end = lseek(fd, 0, SEEK_END);
+    while (done < e->len) {
+        if ((n = write(fd, e->data + done, e->len - done)) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("history: write");
+            /* no half records: the next one would be lost behind it */
+            if (done && ftruncate(fd, end) != 0)
+                perror("history: ftruncate");
+            return;
+        }
+        done += n;
+    }
+    dirty = 1;
+}
+
+static void *
+write_all (void *arg)
+{
+    struct entry *batch, *e;
+    struct timespec until;
+    double t;
+    int stop;
+
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        if (!head && !stopping) {
+            if (dirty) {
+                /* nothing new: sync when it's time */
+                t = last_sync + HISTORY_SYNC;
+                until.tv_sec = (time_t) t;
+                until.tv_nsec = (long) ((t - until.tv_sec) * 1e9);
+                pthread_cond_timedwait(&cond, &lock, &until);
+            } else {
+                pthread_cond_wait(&cond, &lock);
+            }
+        }
+        batch = head;
+        head = tail = NULL;
+        stop = stopping;
+        pthread_mutex_unlock(&lock);
+
+        while ((e = batch)) {
+            batch = e->next;
+            write_entry(e);
+            free(e);
+        }
+        if (dirty && (stop || now() >= last_sync + HISTORY_SYNC))
+            sync_file();
+
+        pthread_mutex_lock(&lock);
+        if (stop && !head)
+            break;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+    day = -1;
+    return NULL;
+}
+
+int
+history_start (const char *path)
+{
+    if (running)
+        return 0;
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror(path);
+        return -1;
+    }
+    if (!(dir = strdup(path)))
+        return -1;
+
+    stopping = 0;
+    last_sync = now();
+    if (pthread_create(&writer, NULL, write_all, NULL) != 0) {
+        perror("history: pthread_create");
+        free(dir);
+        dir = NULL;
+        return -1;
+    }
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void
+history_stop (void)
+{
+    if (!running)
+        return;
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(writer, NULL);
+
+    free(dir);
+    dir = NULL;
+}
+
+static void
+post (struct entry *e)
+{
+    e->next = NULL;
+    pthread_mutex_lock(&lock);
+    if (tail)
+        tail->next = e;
+    else
+        head = e;
+    tail = e;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void
+history_begin (game_tp g)
+{
+    struct history_log *log = g->history;
+    int i;
+
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        if (log)
+            log->recording = 0;
+        return;
+    }
+    if (!log && !(log = g->history = calloc(1, sizeof *log)))
+        return;
+
+    log->recording = 1;
+    log->time = time(NULL);
+    memcpy(log->deck, g->deck, sizeof log->deck);
+    for (i = 0; i < g->n_players; i++)
+        log->chips[i] = g->players[i].chips;
+    log->button = g->button;
+    log->dealt = 0;
+    log->n_events = 0;
+}
+
+void
+history_event (game_tp g, const struct event *e)
+{
+    struct history_log *log = g->history;
+
+    if (!log || !log->recording)
+        return;
+    if (e->type == EV_DEALT)
+        log->dealt |= SEAT_BIT(e->player);
+    if (log->n_events < HISTORY_EVENTS)
+        log->events[log->n_events++] = *e;
+}
+
+void
+history_end (game_tp g)
+{
+    struct history_log *log = g->history;
+    struct entry *e;
+    unsigned char *p;
+    int i, k;
+
+    if (!log || !log->recording)
+        return;
+    log->recording = 0;
+    if (!(e = malloc(sizeof *e + RECORD_MAX)))
+        return;
+
+    p = e->data + 8;
+    p = put(p, log->time, 8);
+    p = put(p, g->hands, 4);
+    p = put_str(p, g->server ? g->server : "", HOST_LEN);
+    p = put_str(p, g->channel ? g->channel : "", HISTORY_CHANNEL_LEN);
+    memcpy(p, log->deck, 52);
+    p += 52;
+
+    *p++ = log->button;
+    *p++ = g->n_players;
+    for (i = 0; i < g->n_players; i++) {
+        player_t *pl = &g->players[i];
+
+        p = put_str(p, pl->nick, NICK_LEN);
+        p = put(p, (uint32_t) log->chips[i], 4);
+        p = put(p, (uint32_t) pl->chips, 4);
+        for (k = 0; k < 2; k++)
+            *p++ = log->dealt & SEAT_BIT(i) ? pl->hand[k] : HISTORY_NO_CARD;
+    }
+
+    *p++ = g->n_community;
+    for (i = 0; i < 5; i++)
+        *p++ = i < g->n_community ? g->community[i] : HISTORY_NO_CARD;
+
+    p = put(p, log->n_events, 2);
+    for (i = 0; i < log->n_events; i++) {
+        const struct event *ev = &log->events[i];
+
+        *p++ = ev->type;
+        *p++ = ev->player < 0 ? 0xff : ev->player;
+        p = put(p, (uint32_t) ev->amount, 4);
+        p = put(p, (uint32_t) ev->total, 4);
+    }
+
+    *p++ = g->variant - variants;
+    *p++ = g->variant->n_hole;
+    for (i = 0; i < g->n_players; i++)
+        for (k = 2; k < g->variant->n_hole; k++)
+            *p++ = log->dealt & SEAT_BIT(i) ? g->players[i].hand[k] : HISTORY_NO_CARD;
+
+    e->len = p - e->data;
+    e->time = log->time;
+    put(e->data, e->len, 4);
+    put(e->data + 4, fnv1a(e->data + 8, e->len - 8), 4);
+    post(e);
+}
+
+long
+history_unpack (const unsigned char *buf, size_t len, struct hand_record *r)
+{
+    const unsigned char *p = buf, *end;
+    size_t size;
+    int i, k, n;
+
+    if (len < 8)
+        return 0;
+    size = get(p, 4);
+    if (size < 8 || size > RECORD_MAX)
+        return -1;
+    if (size > len)
+        return 0;
+    if (fnv1a(buf + 8, size - 8) != get(p + 4, 4))
+        return -1;
+    end = buf + size;
+    p += 8;
+
+/* the rest has to fit */
+#define NEED(k) do { if (end - p < (long) (k)) return -1; } while (0)
+/* a string of at most max - 1 bytes */
+#define GET_STR(s, max) do { \
+        NEED(1); \
+        n = *p++; \
+        NEED(n); \
+        if (n >= (max)) \
+            return -1; \
+        memcpy(s, p, n); \
+        (s)[n] = '\0'; \
+        p += n; \
+    } while (0)
+    NEED(8 + 4);
+    r->time = get(p, 8);
+    r->hand = get(p + 8, 4);
+    p += 12;
+    GET_STR(r->server, HOST_LEN);
+    GET_STR(r->channel, HISTORY_CHANNEL_LEN);
+    NEED(52 + 2);
+    memcpy(r->deck, p, 52);
+    p += 52;
+
+    r->button = *p++;
+    r->n_seats = *p++;
+    if (r->n_seats > MAX_PLAYERS)
+        return -1;
+    for (i = 0; i < r->n_seats; i++) {
+        struct history_seat *s = &r->seats[i];
+
+        GET_STR(s->nick, NICK_LEN);
+        NEED(4 + 4 + 2);
+        s->chips = (int32_t) get(p, 4);
+        s->chips_after = (int32_t) get(p + 4, 4);
+        s->hole[0] = p[8];
+        s->hole[1] = p[9];
+        p += 10;
+    }
+
+    NEED(1 + 5 + 2);
+    r->n_board = *p++;
+    if (r->n_board > 5)
+        return -1;
+    memcpy(r->board, p, 5);
+    p += 5;
+
+    r->n_events = get(p, 2);
+    p += 2;
+    if (r->n_events > HISTORY_EVENTS)
+        return -1;
+    NEED(r->n_events * 10);
+    for (i = 0; i < r->n_events; i++) {
+        struct event *ev = &r->events[i];
+
+        ev->type = p[0];
+        ev->player = p[1] == 0xff ? -1 : p[1];
+        ev->amount = (int32_t) get(p + 2, 4);
+        ev->total = (int32_t) get(p + 6, 4);
+        p += 10;
+    }
+
+    r->variant = VARIANT_HOLDEM;
+    r->n_hole = 2;
+    if (p < end) {
+        NEED(2);
+        r->variant = p[0];
+        r->n_hole = p[1];
+        p += 2;
+        if (r->variant >= N_VARIANTS || r->n_hole < 2 || r->n_hole > MAX_HOLE)
+            return -1;
+        NEED(r->n_seats * (r->n_hole - 2));
+        for (i = 0; i < r->n_seats; i++)
+            for (k = 2; k < r->n_hole; k++)
+                r->seats[i].hole[k] = *p++;
+    }
+#undef GET_STR
+#undef NEED
+    return size;
+}
+
+int
+history_read (const char *path,
+              void (*fn) (const struct hand_record *, void *), void *data)
+{
+    static __thread struct hand_record r;
+    unsigned char *buf;
+    size_t size, off;
+    long n;
+    FILE *f;
+
+    if (!(f = fopen(path, "rb"))) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    if (!(buf = malloc(size + 1)) || fread(buf, 1, size, f) != size) {
+        perror(path);
+        fclose(f);
+        free(buf);
+        return -1;
+    }
+    fclose(f);
+
+    if (size < 8 || memcmp(buf, HISTORY_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s: not a hand history.\n", path);
+        free(buf);
+        return -1;
+    }
+    for (off = 8; off < size; off += n) {
+        if ((n = history_unpack(buf + off, size - off, &r)) <= 0) {
+            fprintf(stderr, "%s: broken record at byte %lu.\n", path,
+                    (unsigned long) off);
+            free(buf);
+            return -1;
+        }
+        fn(&r, data);
+    }
+    free(buf);
+    return 0;
+}
+
+static int
+by_name (const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+int
+history_scan (const char *path, uint64_t since,
+              void (*fn) (const struct hand_record *, void *), void *data)
+{
+    /* the files are named by day, so the names sort by time */
+    char **names = NULL, first[32], file[1024];
+    time_t t = since;
+    struct dirent *d;
+    struct tm tm;
+    int n = 0, size = 0, i, failed = 0;
+    DIR *dh;
+    char **p;
+
+    if (!(dh = opendir(path))) {
+        perror(path);
+        return -1;
+    }
+    gmtime_r(&t, &tm);
+    snprintf(first, sizeof first, "%04d%02d%02d.hh", tm.tm_year + 1900,
+             tm.tm_mon + 1, tm.tm_mday);
+    while ((d = readdir(dh))) {
+        if (strlen(d->d_name) != 11 || strcmp(d->d_name + 8, ".hh") != 0
+                || strcmp(d->d_name, first) < 0)
+            continue;
+        if (n == size) {
+            size = size ? 2 * size : 16;
+            if (!(p = realloc(names, size * sizeof *names)))
+                break;
+            names = p;
+        }
+        if ((names[n] = strdup(d->d_name)))
+            n++;
+    }
+    closedir(dh);
+
+    qsort(names, n, sizeof *names, by_name);
+    for (i = 0; i < n; i++) {
+        snprintf(file, sizeof file, "%s/%s", path, names[i]);
+        failed |= history_read(file, fn, data) != 0;
+        free(names[i]);
+    }
+    free(names);
+    return failed ? -1 : 0;
+}
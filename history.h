@@ -0,0 +1,100 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "game.h"
+
+/* Hand histories, for settling arguments.
+ *
+ * While a hand is played, the engine notes down everything it emits (see
+ * engine.h). When the hand is over, the game's thread packs it into one
+ * record and queues it for a writer thread, which appends it to the day's
+ * file in the history directory (HISTORY_DIR/YYYYMMDD.hh, UTC) and fsyncs
+ * at most every HISTORY_SYNC seconds. The game never waits for the disk.
+ *
+ * A file is HISTORY_MAGIC, then records. All numbers are little-endian:
+ *
+ *     u32 size             of the whole record
+ *     u32 sum              FNV-1a of everything after it
+ *     u64 time             when the hand was dealt, Unix time
+ *     u32 hand             hands dealt at this table so far
+ *     u8 n, n bytes        the server
+ *     u8 n, n bytes        the channel
+ *     52 cards             the deck as shuffled. says what anybody got.
+ *     u8 button, u8 n_seats
+ *         per seat: u8 n, n bytes nick, u32 chips before the hand,
+ *                   u32 chips after it, 2 cards (0xff: none)
+ *     u8 n_board, 5 cards
+ *     u16 n_events
+ *         per event: u8 type, u8 player (0xff: none), u32 amount, u32 total
+ *     u8 variant, u8 n_hole    see variant.h
+ *         per seat: n_hole - 2 more cards
+ *
+ * The variant comes last so that records from before there were any still
+ * read, as Hold'em.
+ *
+ * hhdump turns the files into text. */
+
+#ifndef HISTORY_DIR
+#define HISTORY_DIR "hands"
+#endif
+#define HISTORY_SYNC 1.0
+#define HISTORY_MAGIC "ircphh02"
+#define HISTORY_CHANNEL_LEN 64
+/* more than any hand takes. the rest gets lost. */
+#define HISTORY_EVENTS 512
+#define HISTORY_NO_CARD 0xff
+
+struct history_seat {
+    char nick[NICK_LEN];
+    int chips, chips_after;
+    pcard_t hole[MAX_HOLE];
+};
+
+/* a record, unpacked */
+struct hand_record {
+    uint64_t time;
+    uint32_t hand;
+    char server[HOST_LEN];
+    char channel[HISTORY_CHANNEL_LEN];
+    pcard_t deck[52];           /* 0xff after the variant's last card */
+    int variant;                /* an enum variant_id */
+    int n_hole;
+    int button;
+    int n_seats;
+    struct history_seat seats[MAX_PLAYERS];
+    pcard_t board[5];
+    int n_board;
+    int n_events;
+    struct event events[HISTORY_EVENTS];
+};
+
+/* starts the writer. returns -1 if dir won't do. */
+int history_start (const char *dir);
+/* writes out whatever is queued, then stops the writer */
+void history_stop (void);
+
+/* for the engine. they do nothing while there's no writer. */
+void history_begin (game_tp g);     /* after the shuffle */
+void history_event (game_tp g, const struct event *e);
+void history_end (game_tp g);       /* the hand is over */
+
+/* unpacks the record at buf. returns its size, 0 if len is too short for
+ * it, or -1 if it's garbage. */
+long history_unpack (const unsigned char *buf, size_t len,
+                     struct hand_record *r);
+/* passes every record in the file to fn. returns 0, or -1 after complaining
+ * about a file that's broken, but only after the records before the break. */
+int history_read (const char *path,
+                  void (*fn) (const struct hand_record *, void *), void *data);
+/* the same for every file in the directory from the day of since (Unix
+ * time) on, oldest first */
+int history_scan (const char *dir, uint64_t since,
+                  void (*fn) (const struct hand_record *, void *), void *data);
+
+#endif
@@ -1,46 +1,872 @@
 /* Copyright 2011 Tom Jollans <t@jollybox.de>
  * This code is under the Chicken Dance License v0.1 */
 
+#include "atlas.h"
 #include "command.h"
+#include "config.h"
+#include "history.h"
+#include "log.h"
+#include "metrics.h"
+#include "parse.h"
+#include "pool.h"
+#include "sendq.h"
+#include "shard.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "timer.h"
+#include "tourney.h"
 
 #include <libircclient.h>
 #include <libirc_rfcnumeric.h>
 
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <time.h>
 
 void on_connect (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
 void on_privmsg (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
 void on_chanmsg (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
 void on_invite  (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
+void on_part    (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
+void on_nick    (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
+void on_kick    (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
 
 void on_generic (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count);
 void on_numeric (irc_session_t *session, unsigned event, const char *origin, const char **params, unsigned count);
 
-static char *irc_nick;
-struct channel_game *channel_games_list = NULL;
+/* one per server. hangs off its session (irc_get_ctx), and stays around
+ * after disconnecting: jobs in the pool may still want to talk to it. */
+struct server {
+    irc_session_t *session;
+    const struct server_conf *conf;
+    char *nick;
+    struct sendq *outq;
+    char *quit_reason;      /* quit once everything's been said */
+    int live;               /* still in the event loop */
+    char **rejoin;          /* channels with a game from the snapshot */
+    int n_rejoin;
+};
+
+static struct config config;
+static struct server servers[MAX_SERVERS];
+
+static struct server *
+get_server (irc_session_t *session)
+{
+    return irc_get_ctx(session);
+}
 
-/* might want different nicks on different servers some day. */
 const char *
 get_irc_nick (irc_session_t *session)
 {
-    return irc_nick;
+    return get_server(session)->nick;
+}
+
+const char *
+get_server_name (irc_session_t *session)
+{
+    return get_server(session)->conf->host;
+}
+
+static void
+set_irc_nick (irc_session_t *session, const char *nick)
+{
+    struct server *s = get_server(session);
+    char *old_nick = s->nick;
+
+    s->nick = strdup(nick);
+    free(old_nick);
+}
+
+static void
+send_privmsg (void *arg, const char *target, const char *text)
+{
+    METRIC_INC(C_LINES_OUT);
+    irc_cmd_msg(arg, target, text);
+}
+
+/* Lines go from the IRC thread to the shard owning the channel, and what
+ * the shards say comes back to the IRC thread, which owns the sessions and
+ * their send queues. */
+enum task_op {
+    /* to a shard */
+    TASK_CMD,       /* addressed to me */
+    TASK_CHAT,      /* said on a channel, maybe a bet */
+    TASK_END,       /* I left the channel */
+    TASK_NICK,      /* nick -> text, everywhere */
+    TASK_DROP,      /* the server is gone */
+    TASK_SNAPSHOT,  /* every game and the stats into records, for snap */
+    TASK_RESTORE,   /* a game from the snap_table in data */
+    TASK_STATS,     /* a channel's stats from the n snap_stats in data */
+    TASK_TALLY,     /* a hand_tally in data, for the stats */
+    /* back to the IRC thread */
+    TASK_MSG,
+    TASK_ART,
+    TASK_QUIT,
+    TASK_JOIN,      /* a tournament's new table */
+    TASK_SNAPPED    /* a shard's part of snap, a snap_part in data */
+};
+
+struct snap_part {
+    struct snap_table *tables;
+    int n_tables;
+    struct snap_stat *stats;
+    int n_stats;
+    int lost;               /* some are missing */
+};
+
+/* a snapshot, collected from the shards, then written by the pool */
+struct snap_job {
+    struct job job;
+    struct snap_part all;
+    int n_parts, n_asked;   /* one from every shard asked */
+    time_t time;            /* when the shards were asked */
+};
+
+struct irc_task {
+    struct task task;
+    enum task_op op;
+    irc_session_t *session;
+    char *nick, *channel, *text;    /* in the same block, or NULL */
+    struct snap_job *snap;          /* for the snapshot tasks */
+    void *data;                     /* malloc()ed, whoever gets it frees it */
+    int n;
+    double received;                /* timer_now() of the line answered, or 0 */
+};
+
+static int snaps_pending;   /* collected or written, but not done */
+static int stopping;
+
+/* the line the shard is working on, until it has been answered */
+static __thread double answering;
+static struct job metrics_job;
+static int metrics_pending;
+
+static void run_task (struct task *task);
+
+static char *
+copy_str (char **p, const char *s)
+{
+    char *r = *p;
+
+    if (!s)
+        return NULL;
+    strcpy(r, s);
+    *p += strlen(s) + 1;
+    return r;
+}
+
+static struct irc_task *
+new_task (enum task_op op, irc_session_t *session, const char *nick,
+          const char *channel, const char *text)
+{
+    size_t size = sizeof (struct irc_task);
+    struct irc_task *t;
+    char *p;
+
+    size += nick ? strlen(nick) + 1 : 0;
+    size += channel ? strlen(channel) + 1 : 0;
+    size += text ? strlen(text) + 1 : 0;
+    if (!(t = malloc(size))) {
+        log_msg(LOG_ERROR, "out of memory, dropping a line.");
+        return NULL;
+    }
+
+    p = (char *) (t + 1);
+    t->task.run = run_task;
+    t->op = op;
+    t->session = session;
+    t->nick = copy_str(&p, nick);
+    t->channel = copy_str(&p, channel);
+    t->text = copy_str(&p, text);
+    t->snap = NULL;
+    t->data = NULL;
+    t->n = 0;
+    t->received = 0;
+    return t;
+}
+
+static void
+post_task_to (const char *where, enum task_op op, irc_session_t *session,
+              const char *nick, const char *channel, const char *text)
+{
+    struct irc_task *t = new_task(op, session, nick, channel, text);
+
+    if (t) {
+        t->received = timer_now();
+        shard_post(shard_of(session, where), &t->task);
+    }
+}
+
+static void
+post_task (enum task_op op, irc_session_t *session, const char *nick,
+           const char *channel, const char *text)
+{
+    /* channel or no channel, a line from one nick always goes to the same
+     * shard */
+    post_task_to(channel ? channel : nick, op, session, nick, channel, text);
+}
+
+static void
+post_everywhere (enum task_op op, irc_session_t *session, const char *nick,
+                 const char *text)
+{
+    struct irc_task *t;
+    int i;
+
+    for (i = 0; i < shard_count(); i++)
+        if ((t = new_task(op, session, nick, NULL, text)))
+            shard_post(i, &t->task);
+}
+
+static void
+post_back (enum task_op op, irc_session_t *session, const char *target,
+           const char *text)
+{
+    struct irc_task *t = new_task(op, session, NULL, target, text);
+
+    if (t) {
+        t->received = answering;
+        answering = 0;
+        main_post(&t->task);
+    }
+}
+
+struct nick_change {
+    irc_session_t *session;
+    const char *old_nick, *new_nick;
+};
+
+static void
+rename_in_game (struct channel_game *cg, void *data)
+{
+    struct nick_change *nc = data;
+
+    if (cg->session == nc->session)
+        rename_player(cg->game, nc->old_nick, nc->new_nick);
+}
+
+static void
+snapshot_game (struct channel_game *cg, void *data)
+{
+    struct snap_part *part = data;
+
+    /* a tournament's tables don't outlast it */
+    if (!cg->game->tourney)
+        snapshot_table(cg->game, &part->tables[part->n_tables++]);
+}
+
+static void
+snapshot_row (const char *server, const char *channel,
+              const struct player_stats *row, void *data)
+{
+    struct snap_part *part = data;
+
+    snapshot_stat(server, channel, row, &part->stats[part->n_stats++]);
+}
+
+static void
+run_snapshot (struct irc_task *t)
+{
+    /* on the shard, which posts its part back in the task that came with
+     * the request, so there's always one to answer with */
+    struct irc_task *back = t->data;
+    struct snap_part *part = back->data;
+
+    if ((registry_count() > 0
+         && !(part->tables = malloc(registry_count() * sizeof *part->tables)))
+            || (stats_count() > 0
+                && !(part->stats = malloc(stats_count() * sizeof *part->stats)))) {
+        part->lost = 1;
+    } else {
+        registry_foreach(snapshot_game, part);
+        stats_foreach(snapshot_row, part);
+    }
+    main_post(&back->task);
+}
+
+static void
+run_restore (struct irc_task *t)
+{
+    game_tp game;
+
+    if (!(game = snapshot_restore(t->data))) {
+        log_msg(LOG_ERROR, "out of memory, %s is lost.", t->channel);
+    } else {
+        game->session = t->session;
+        game->server = get_server_name(t->session);
+        if (registry_add(t->session, t->channel, game) != 0)
+            free_game(game);
+    }
+    free(t->data);
+}
+
+static void
+run_stats (struct irc_task *t)
+{
+    const struct snap_stat *rows = t->data;
+    struct player_stats *s;
+    int i;
+
+    if (!(s = malloc(t->n * sizeof *s))) {
+        log_msg(LOG_ERROR, "out of memory, the stats for %s are lost.", t->channel);
+        free(t->data);
+        return;
+    }
+    for (i = 0; i < t->n; i++)
+        s[i] = rows[i].stats;
+    if (stats_restore(t->session, get_server_name(t->session), t->channel,
+                      s, t->n) != 0)
+        log_msg(LOG_ERROR, "out of memory, the stats for %s are lost.", t->channel);
+    free(s);
+    free(t->data);
+}
+
+static void
+run_tally (struct irc_task *t)
+{
+    if (stats_add(t->session, get_server_name(t->session), t->channel,
+                  t->data) != 0)
+        log_msg(LOG_ERROR, "out of memory, a hand is missing from the stats.");
+    free(t->data);
+}
+
+static void
+write_snap (struct job *job, struct worker *w)
+{
+    struct snap_job *snap = (struct snap_job *) job;
+
+    snapshot_write(config.snapshot, snap->all.tables, snap->all.n_tables,
+                   snap->all.stats, snap->all.n_stats, snap->time);
+}
+
+static void
+free_part (struct snap_part *part)
+{
+    free(part->tables);
+    free(part->stats);
+}
+
+static void
+free_snap (struct job *job)
+{
+    struct snap_job *snap = (struct snap_job *) job;
+
+    free_part(&snap->all);
+    free(snap);
+    snaps_pending--;
+}
+
+static void *
+append (void *to, int *n, const void *from, int m, size_t size, int *lost)
+{
+    void *p;
+
+    if (m == 0 || *lost)
+        return to;
+    if (!(p = realloc(to, (*n + m) * size))) {
+        *lost = 1;
+        return to;
+    }
+    memcpy((char *) p + *n * size, from, m * size);
+    *n += m;
+    return p;
+}
+
+static void
+write_metrics (struct job *job, struct worker *w)
+{
+    metrics_write_file(config.metrics);
+}
+
+static void
+metrics_written (struct job *job)
+{
+    metrics_pending = 0;
+}
+
+static void
+take_snapshot (void)
+{
+    struct snap_job *snap;
+    struct irc_task *t, *back;
+    int i;
+
+    if (!(snap = calloc(1, sizeof *snap))) {
+        log_msg(LOG_ERROR, "out of memory, no snapshot.");
+        return;
+    }
+    snap->job.run = write_snap;
+    snap->job.done = free_snap;
+    snap->time = time(NULL);
+    snaps_pending++;
+    for (i = 0; i < shard_count(); i++) {
+        back = NULL;
+        if (!(t = new_task(TASK_SNAPSHOT, NULL, NULL, NULL, NULL))
+                || !(back = new_task(TASK_SNAPPED, NULL, NULL, NULL, NULL))
+                || !(back->data = calloc(1, sizeof (struct snap_part)))) {
+            free(t);
+            free(back);
+            snap->all.lost = 1;
+            continue;
+        }
+        back->snap = t->snap = snap;
+        t->data = back;
+        snap->n_asked++;
+        shard_post(i, &t->task);
+    }
+    if (snap->n_asked == 0)
+        free_snap(&snap->job);
+}
+
+static void
+add_snap_part (struct irc_task *t)
+{
+    struct snap_job *snap = t->snap;
+    struct snap_part *part = t->data;
+    struct snap_part *all = &snap->all;
+
+    all->lost |= part->lost;
+    all->tables = append(all->tables, &all->n_tables, part->tables,
+                         part->n_tables, sizeof *part->tables, &all->lost);
+    all->stats = append(all->stats, &all->n_stats, part->stats,
+                        part->n_stats, sizeof *part->stats, &all->lost);
+    free_part(part);
+    free(part);
+    if (++snap->n_parts < snap->n_asked)
+        return;
+    if (all->lost) {
+        /* better the last one than one that's missing games */
+        log_msg(LOG_ERROR, "out of memory, no snapshot.");
+        free_snap(&snap->job);
+    } else if (stopping) {
+        /* nothing left to wait for */
+        write_snap(&snap->job, NULL);
+        free_snap(&snap->job);
+    } else {
+        pool_submit(&snap->job);
+    }
+}
+
+static void
+push_line (struct server *s, const char *target, const char *text, int solo,
+           double received)
+{
+    if (solo)
+        sendq_push_solo(s->outq, target, text);
+    else
+        sendq_push(s->outq, target, text);
+    if (received > 0)
+        metric_observe(H_RESPONSE, timer_now() - received);
+    metric_observe(H_SENDQ, sendq_pending(s->outq));
+}
+
+static void
+run_task (struct task *task)
+{
+    struct irc_task *t = (struct irc_task *) task;
+    struct server *s = t->session ? get_server(t->session) : NULL;
+    /* without shards, a line may be answered right inside of here */
+    double outer = answering, start;
+    struct nick_change nc;
+    game_tp game;
+
+    switch (t->op) {
+        case TASK_CMD:
+            answering = t->received;
+            start = timer_now();
+            process_cmd(t->session, t->nick, t->channel, t->text);
+            metric_observe(H_DISPATCH, timer_now() - start);
+            METRIC_INC(C_COMMANDS);
+            break;
+        case TASK_CHAT:
+            /* is there a game on the channel? If so, check all messages
+             * for betting-round commands */
+            if ((game = get_channel_game(t->session, t->channel))) {
+                answering = t->received;
+                start = timer_now();
+                process_bet_cmd(t->session, t->nick, t->channel, game, t->text);
+                metric_observe(H_DISPATCH, timer_now() - start);
+            }
+            break;
+        case TASK_END:
+            end_channel_game(t->session, t->channel);
+            break;
+        case TASK_NICK:
+            /* players keep their seats */
+            nc.session = t->session;
+            nc.old_nick = t->nick;
+            nc.new_nick = t->text;
+            registry_foreach(rename_in_game, &nc);
+            break;
+        case TASK_DROP:
+            registry_drop_session(t->session, free_game);
+            stats_drop_session(t->session);
+            tourney_drop_session(t->session);
+            break;
+        case TASK_SNAPSHOT:
+            run_snapshot(t);
+            break;
+        case TASK_RESTORE:
+            run_restore(t);
+            break;
+        case TASK_STATS:
+            run_stats(t);
+            break;
+        case TASK_TALLY:
+            run_tally(t);
+            break;
+        case TASK_MSG:
+        case TASK_ART:
+            push_line(s, t->channel, t->text, t->op == TASK_ART, t->received);
+            break;
+        case TASK_QUIT:
+            free(s->quit_reason);
+            s->quit_reason = strdup(t->text);
+            break;
+        case TASK_JOIN:
+            irc_cmd_join(t->session, t->channel, NULL);
+            break;
+        case TASK_SNAPPED:
+            add_snap_part(t);
+            break;
+    }
+    answering = outer;
+    free(t);
+}
+
+void
+send_msg (irc_session_t *session, const char *target, const char *text)
+{
+    if (current_shard() >= 0) {
+        post_back(TASK_MSG, session, target, text);
+    } else {
+        push_line(get_server(session), target, text, 0, answering);
+        answering = 0;
+    }
+}
+
+void
+send_art (irc_session_t *session, const char *target, const char *text)
+{
+    if (current_shard() >= 0) {
+        post_back(TASK_ART, session, target, text);
+    } else {
+        push_line(get_server(session), target, text, 1, answering);
+        answering = 0;
+    }
+}
+
+void
+send_msgf (irc_session_t *session, const char *target, const char *fmt, ...)
+{
+    va_list ap;
+    char *s;
+    int r;
+
+    va_start(ap, fmt);
+    r = vasprintf(&s, fmt, ap);
+    va_end(ap);
+    if (r != -1) {
+        send_msg(session, target, s);
+        free(s);
+    }
+}
+
+void
+quit_session (irc_session_t *session, const char *reason)
+{
+    struct server *s = get_server(session);
+
+    if (current_shard() >= 0) {
+        post_back(TASK_QUIT, session, NULL, reason);
+        return;
+    }
+    free(s->quit_reason);
+    s->quit_reason = strdup(reason);
+}
+
+void
+join_channel (irc_session_t *session, const char *channel)
+{
+    if (current_shard() >= 0)
+        post_back(TASK_JOIN, session, channel, NULL);
+    else
+        irc_cmd_join(session, channel, NULL);
+}
+
+static void
+server_down (struct server *s)
+{
+    /* the games on it can't go on. the rest of the servers can. */
+    if (irc_errno(s->session))
+        log_msg(LOG_ERROR, "on %s: %s", s->conf->host,
+                irc_strerror(irc_errno(s->session)));
+    log_msg(LOG_INFO, "*** %s: DISCONNECTED. ***", s->conf->host);
+    irc_disconnect(s->session);
+    post_everywhere(TASK_DROP, s->session, NULL, NULL);
+    s->live = 0;
+}
+
+static double
+flush_server (struct server *s, double t)
+{
+    /* returns how long until the send queue may go on, or -1 */
+    double wait = sendq_flush(s->outq, t);
+
+    if (s->quit_reason && !sendq_pending(s->outq)) {
+        irc_cmd_quit(s->session, s->quit_reason);
+        free(s->quit_reason);
+        s->quit_reason = NULL;
+    }
+    return wait;
+}
+
+static int
+run_servers (void)
+{
+    /* irc_run(), but for all servers at once. also wakes up for jobs coming
+     * back from the pool or the shards, and whenever a send queue may go
+     * on.
+     *
+     * libircclient only hands out its descriptors as fd_sets, so this is
+     * a select() loop: with a handful of servers, epoll wouldn't buy
+     * anything. */
+    fd_set in, out;
+    struct timeval tv;
+    int maxfd, n_live, i;
+    int pool_fd = pool_completion_fd();
+    int main_fd = main_mailbox_fd();
+    struct timer_wheel *timers = thread_timers();
+    double wait, w, last_snapshot = timer_now(), last_metrics = timer_now();
+
+    for (;;) {
+        if (*config.metrics && !metrics_pending
+                && timer_now() - last_metrics >= METRICS_SECONDS) {
+            metrics_pending = 1;
+            pool_submit(&metrics_job);
+            last_metrics = timer_now();
+        }
+        /* one at a time: a slow disk shouldn't pile them up */
+        if (*config.snapshot && snaps_pending == 0
+                && timer_now() - last_snapshot >= SNAPSHOT_SECONDS) {
+            take_snapshot();
+            last_snapshot = timer_now();
+        }
+
+        FD_ZERO(&in);
+        FD_ZERO(&out);
+        FD_SET(pool_fd, &in);
+        maxfd = pool_fd;
+        if (main_fd >= 0) {
+            FD_SET(main_fd, &in);
+            if (main_fd > maxfd)
+                maxfd = main_fd;
+        }
+        /* without shards, the games' timers are on this thread too */
+        wait = timer_next(timers, timer_now());
+        if (wait < 0 || wait > 0.25)
+            wait = 0.25;
+        n_live = 0;
+
+        for (i = 0; i < config.n_servers; i++) {
+            struct server *s = &servers[i];
+
+            if (!s->live)
+                continue;
+            w = flush_server(s, timer_now());
+            if (w >= 0 && w < wait)
+                wait = w;
+            if (!irc_is_connected(s->session)
+                    || irc_add_select_descriptors(s->session, &in, &out, &maxfd) != 0) {
+                server_down(s);
+                continue;
+            }
+            n_live++;
+        }
+        if (n_live == 0)
+            return 0;
+
+        tv.tv_sec = 0;
+        tv.tv_usec = wait * 1e6;
+        if (select(maxfd + 1, &in, &out, NULL, &tv) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("select");
+            return 1;
+        }
+
+        if (FD_ISSET(pool_fd, &in))
+            pool_drain();
+        if (main_fd >= 0 && FD_ISSET(main_fd, &in))
+            main_drain();
+        timer_run(timers, timer_now());
+        for (i = 0; i < config.n_servers; i++)
+            if (servers[i].live
+                    && irc_process_select_descriptors(servers[i].session, &in, &out) != 0)
+                server_down(&servers[i]);
+    }
+}
+
+static int
+start_server (struct server *s, const struct server_conf *conf,
+              irc_callbacks_t *callbacks)
+{
+    s->conf = conf;
+    if (!(s->session = irc_create_session(callbacks))) {
+        log_msg(LOG_ERROR, "creating session handle.");
+        return -1;
+    }
+    irc_set_ctx(s->session, s);
+    if (!(s->outq = sendq_new(send_privmsg, s->session))
+            || !(s->nick = strdup(conf->nick))) {
+        log_msg(LOG_ERROR, "creating send queue.");
+        return -1;
+    }
+
+    log_msg(LOG_INFO, "%s: nick '%s'", conf->host, conf->nick);
+    if (irc_connect(s->session, conf->host, conf->port, NULL,
+                    conf->nick, conf->nick, "IRC Poker")
+            != 0) {
+        log_msg(LOG_ERROR, "connecting to server %s on port %d: %s",
+                conf->host, conf->port, irc_strerror(irc_errno(s->session)));
+        return -1;
+    }
+    s->live = 1;
+    return 0;
+}
+
+static int
+add_rejoin (struct server *s, const char *channel)
+{
+    char **rejoin = realloc(s->rejoin, (s->n_rejoin + 1) * sizeof *rejoin);
+
+    if (!rejoin)
+        return -1;
+    s->rejoin = rejoin;
+    if (!(s->rejoin[s->n_rejoin] = strdup(channel)))
+        return -1;
+    s->n_rejoin++;
+    return 0;
+}
+
+static struct server *
+server_named (const char *host)
+{
+    int i;
+
+    for (i = 0; i < config.n_servers; i++)
+        if (servers[i].live && strcmp(config.servers[i].host, host) == 0)
+            return &servers[i];
+    return NULL;
+}
+
+static int
+post_copy (enum task_op op, struct server *s, const char *channel,
+           const void *data, size_t size, int n)
+{
+    /* a task for the channel's shard, with a copy of n things of size */
+    struct irc_task *t;
+
+    if (!(t = new_task(op, s->session, NULL, channel, NULL))
+            || !(t->data = malloc(n * size))) {
+        free(t);
+        return -1;
+    }
+    memcpy(t->data, data, n * size);
+    t->n = n;
+    shard_post(shard_of(s->session, channel), &t->task);
+    return 0;
+}
+
+static void
+replay_stats (const struct hand_record *r, void *data)
+{
+    /* a hand since the snapshot. the stats for the channel went to its
+     * shard first, so it comes in after them. */
+    static struct hand_tally tally;
+    struct server *s;
+
+    if (!(s = server_named(r->server)))
+        return;
+    tally_record(&tally, r);
+    if (post_copy(TASK_TALLY, s, r->channel, &tally, sizeof tally, 1) != 0)
+        log_msg(LOG_ERROR, "out of memory, a hand is missing from the stats.");
+}
+
+static void
+restore_tables (void)
+{
+    /* the games and the stats from the last snapshot, caught up with the
+     * hand history, go back to their shards before anybody can say
+     * anything to them */
+    struct snapshot snap;
+    struct timeval t0, t1;
+    const struct snap_table *t;
+    const struct snap_stat *row;
+    struct server *s;
+    int i, k, n_hands = 0, n_games = 0;
+
+    gettimeofday(&t0, NULL);
+    if (snapshot_open(config.snapshot, &snap) != 0)
+        return;
+
+    for (i = 0; i < snap.n_stats; i = k) {
+        row = &snap.stats[i];
+        for (k = i + 1; k < snap.n_stats; k++)
+            if (strcmp(snap.stats[k].server, row->server) != 0
+                    || irc_casecmp(snap.stats[k].channel, row->channel) != 0)
+                break;
+        if ((s = server_named(row->server))
+                && post_copy(TASK_STATS, s, row->channel, row, sizeof *row,
+                             k - i) != 0)
+            log_msg(LOG_ERROR, "out of memory, the stats for %s are lost.",
+                    row->channel);
+    }
+    if (*config.history)
+        n_hands = snapshot_replay(&snap, config.history, replay_stats, NULL);
+
+    for (i = 0; i < snap.n_tables; i++) {
+        t = &snap.tables[i];
+        if (!(s = server_named(t->server))) {
+            log_msg(LOG_WARNING, "not on %s, the game in %s is lost.",
+                    t->server, t->channel);
+            continue;
+        }
+        if (add_rejoin(s, t->channel) != 0
+                || post_copy(TASK_RESTORE, s, t->channel, t, sizeof *t, 1) != 0) {
+            log_msg(LOG_ERROR, "out of memory, the game in %s is lost.",
+                    t->channel);
+            continue;
+        }
+        n_games++;
+    }
+    gettimeofday(&t1, NULL);
+    log_msg(LOG_INFO, "restored %d games, %d hands since the snapshot, in %.1f ms.",
+            n_games, n_hands,
+            (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_usec - t0.tv_usec) / 1e3);
+    snapshot_close(&snap);
 }
 
 int
 main (int argc, char **argv)
 {
-    /* Basic single-server single-thread IRC bot. */
+    /* IRC bot for any number of servers. Everything but the number
+     * crunching happens on this thread. */
     irc_callbacks_t callbacks = {
-        .event_nick = &on_generic,
+        .event_nick = &on_nick,
         .event_quit = &on_generic,
         .event_join = &on_generic,
-        .event_part = &on_generic,
+        .event_part = &on_part,
         .event_mode = &on_generic,
         .event_umode = &on_generic,
         .event_topic = &on_generic,
-        .event_kick = &on_generic,
+        .event_kick = &on_kick,
         .event_notice = &on_generic,
         /* .event_channel_notice = &on_generic, */
         .event_ctcp_req = &on_generic,
@@ -55,46 +881,101 @@ main (int argc, char **argv)
         .event_invite  = &on_invite
     };
 
-    irc_session_t *session;
-    char *server, *nick;
-    int port;
+    int i, k, n_started = 0;
+    int status = 0;
 
-    if (argc != 4) {
-        fprintf(stderr, "usage: ircpoker [server] [port] [nick]\n");
+    if (argc == 3 && strcmp(argv[1], "-c") == 0) {
+        if (read_config(argv[2], &config) != 0)
+            return 2;
+    } else if (argc != 4 || add_server(&config, argv[1], argv[2], argv[3]) != 0) {
+        fprintf(stderr, "usage: ircpoker [server] [port] [nick]\n"
+                        "       ircpoker -c [config file]\n");
         return 2;
     }
-    /* TODO: configuration file */
-    server = argv[1];
-    port = atoi(argv[2]); /* TODO: value checking */
-    nick = argv[3];
-    irc_nick = strdup(nick);
 
-    session = irc_create_session(&callbacks);
-    if (!session) {
-        fprintf(stderr, "ERROR creating session handle. Quitting.\n");
+    if (config.log_level)
+        log_level = config.log_level;
+    if (log_start() != 0)
         return 1;
-    }
+    metrics_job.run = write_metrics;
+    metrics_job.done = metrics_written;
 
-    printf("nick: '%s'\n", nick);
-    if (irc_connect(session, server, port, NULL,
-                    nick, nick, "IRC Poker")
-            != 0) {
-        fprintf(stderr, "ERROR connecting to server %s on port %d: %s\n",
-                        server, port, irc_strerror(irc_errno(session)));
+    if (atlas_open(ATLAS_PATH) != 0)
+        log_msg(LOG_WARNING, "no big cards without %s.", ATLAS_PATH);
+
+    if (pool_start(0) != 0) {
+        log_msg(LOG_ERROR, "starting worker threads. Quitting.");
+        return 1;
+    }
+    init_commands();
+    if (*config.history && history_start(config.history) != 0) {
+        log_msg(LOG_ERROR, "starting the hand history. Quitting.");
+        return 1;
+    }
+    if (shards_start(config.n_shards ? config.n_shards : 1) != 0) {
+        log_msg(LOG_ERROR, "starting shards. Quitting.");
         return 1;
     }
 
-    /* error checking might be nice */
-    irc_run(session);
-    irc_destroy_session(session);
-    return 0;
+    /* one server not answering is no reason to leave the others alone */
+    for (i = 0; i < config.n_servers; i++)
+        if (start_server(&servers[i], &config.servers[i], &callbacks) == 0)
+            n_started++;
+    if (n_started == 0) {
+        log_msg(LOG_ERROR, "no servers to play on. Quitting.");
+        status = 1;
+    } else {
+        if (*config.snapshot)
+            restore_tables();
+        status = run_servers();
+    }
+
+    /* a last snapshot, before the games go. stopping: it's written as soon
+     * as it's complete, as is any still on its way back from the shards,
+     * after one the pool may be writing. */
+    if (*config.snapshot && n_started > 0) {
+        stopping = 1;
+        take_snapshot();
+    }
+    /* let running jobs finish, but don't answer anybody anymore */
+    for (i = 0; i < config.n_servers; i++)
+        if (servers[i].session)
+            post_everywhere(TASK_DROP, servers[i].session, NULL, NULL);
+    shards_stop();
+    pool_stop();
+    main_drain();
+    pool_drain();
+    history_stop();
+    if (*config.metrics)
+        metrics_write_file(config.metrics);
+    for (i = 0; i < config.n_servers; i++) {
+        if (!servers[i].session)
+            continue;
+        for (k = 0; k < servers[i].n_rejoin; k++)
+            free(servers[i].rejoin[k]);
+        free(servers[i].rejoin);
+        if (servers[i].outq)
+            sendq_free(servers[i].outq);
+        free(servers[i].nick);
+        free(servers[i].quit_reason);
+        irc_destroy_session(servers[i].session);
+    }
+    atlas_close();
+    log_stop();
+    return status;
 }
 
 void
 on_connect (irc_session_t *session, const char *event,
             const char *origin, const char **params, unsigned count)
 {
-    printf("*** CONNECTION ESTABLISHED. ***\n");
+    struct server *s = get_server(session);
+    int i;
+
+    log_msg(LOG_INFO, "*** %s: CONNECTION ESTABLISHED. ***", s->conf->host);
+    /* back to the games we had before the restart */
+    for (i = 0; i < s->n_rejoin; i++)
+        irc_cmd_join(session, s->rejoin[i], NULL);
 }
 
 void
@@ -102,59 +983,52 @@ on_privmsg (irc_session_t *session, const char *event,
             const char *origin, const char **params, unsigned count)
 {
     const char *dest = params[0];
-    /* process_cmd needs to be able to modify the cmd string */
-    char *msg = strdup(params[1]);
+    const char *msg = params[1];
+    char chan[64];
 
-    printf("privmsg: %s --> %s: \"%s\"\n", origin, dest, msg);
+    log_msg(LOG_DEBUG, "privmsg: %s --> %s: \"%s\"", origin, dest, msg);
+    METRIC_INC(C_LINES_IN);
 
-    /* private messages are always seen as commands. */
-    process_cmd(session, origin, NULL, msg);
-    free(msg);
+    /* private messages are always seen as commands. one about a channel's
+     * game is answered where the game is. */
+    if (private_channel(msg, chan, sizeof chan))
+        post_task_to(chan, TASK_CMD, session, origin, NULL, msg);
+    else
+        post_task(TASK_CMD, session, origin, NULL, msg);
 }
 
 void
 on_chanmsg (irc_session_t *session, const char *event,
             const char *origin, const char **params, unsigned count)
 {
-    int len;
     const char *dest = params[0];
-    /* process_cmd needs to be able to modify the cmd string */
-    char *msg = strdup(params[1]);
-    char *firstword;
+    const char *msg = params[1];
+    const char *rest = msg;
+    const char *me = get_irc_nick(session);
+    struct token first;
+    int len;
 
-    if (strcmp(dest, get_irc_nick(session)) == 0) {
+    if (strcmp(dest, me) == 0) {
         /* the lib can get confused when the server silently changes the nick) */
         on_privmsg(session, event, origin, params, count);
-        free(msg);
         return;
     }
 
-    printf("%s in %s: \"%s\"\n", origin, dest, msg);
+    log_msg(LOG_DEBUG, "%s in %s: \"%s\"", origin, dest, msg);
+    METRIC_INC(C_LINES_IN);
+
+    if (!next_token(&rest, &first))
+        return;
 
     /* treat messages prefixed with my name as commands: */
-    firstword = first_word(msg);
-    len = strlen(firstword);
+    len = first.len;
     /* name may be postfixed with colon or comma */
-    switch(firstword[len-1]) {
-        case ':':
-        case ',':
-            firstword[len-1] = '\0';
-    }
-    if (strcmp(firstword, get_irc_nick(session)) == 0) {
-        process_cmd(session, origin, dest, &msg[len+1]);
-    } else {
-        /* is there a game on the channel? If so, check all messages for 
-         * betting-round commands */
-        game_tp game;
-        
-        if ((game = get_channel_game(session, dest))) {
-            process_bet_cmd(session, origin, dest, game, msg);
-        }
-    }
-    free(firstword);
-
-
-    free(msg);
+    if (len > 0 && (first.s[len-1] == ':' || first.s[len-1] == ','))
+        len--;
+    if (len == (int) strlen(me) && strncmp(first.s, me, len) == 0)
+        post_task(TASK_CMD, session, origin, dest, rest);
+    else
+        post_task(TASK_CHAT, session, origin, dest, msg);
 }
 
 void
@@ -165,50 +1039,103 @@ on_invite (irc_session_t *session, const char *event,
     const char *invitee = params[0];
     const char *channel = params[1];
 
-    printf("invitation for %s to join %s, from %s. Vamos!\n", invitee, channel, origin);
+    log_msg(LOG_INFO, "invitation for %s to join %s, from %s. Vamos!",
+            invitee, channel, origin);
     irc_cmd_join(session, channel, NULL);
 }
 
+void
+on_part (irc_session_t *session, const char *event,
+         const char *origin, const char **params, unsigned count)
+{
+    char nick[32];
+
+    on_generic(session, event, origin, params, count);
+    irc_target_get_nick(origin, nick, sizeof nick);
+    /* no point keeping a game around in a channel I'm not in */
+    if (count >= 1 && irc_casecmp(nick, get_irc_nick(session)) == 0)
+        post_task(TASK_END, session, NULL, params[0], NULL);
+}
 
 void
-on_generic (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count)
+on_nick (irc_session_t *session, const char *event,
+         const char *origin, const char **params, unsigned count)
+{
+    char old_nick[32];
+
+    on_generic(session, event, origin, params, count);
+    if (count < 1)
+        return;
+    irc_target_get_nick(origin, old_nick, sizeof old_nick);
+
+    if (strcmp(old_nick, get_irc_nick(session)) == 0)
+        set_irc_nick(session, params[0]);
+
+    post_everywhere(TASK_NICK, session, old_nick, params[0]);
+}
+
+void
+on_kick (irc_session_t *session, const char *event,
+         const char *origin, const char **params, unsigned count)
 {
+    on_generic(session, event, origin, params, count);
+    /* params: channel, who got kicked, reason */
+    if (count >= 2 && irc_casecmp(params[1], get_irc_nick(session)) == 0)
+        post_task(TASK_END, session, NULL, params[0], NULL);
+}
+
+static void
+log_event (const char *event, const char *origin, const char **params,
+           unsigned count)
+{
+    char line[LOG_LINE];
     unsigned i;
+    int n = 0;
 
-    printf("-- [%s] -- (%s) -- ", event, origin);
-    for (i=0; i<count; ++i)
-        printf("%s -- ", params[i]);
-    printf("\n");
+    if (log_level > LOG_DEBUG)
+        return;
+    line[0] = '\0';
+    for (i = 0; i < count && n < (int) sizeof line; ++i)
+        n += snprintf(line + n, sizeof line - n, "%s -- ", params[i]);
+    log_msg(LOG_DEBUG, "-- [%s] -- (%s) -- %s", event, origin, line);
+}
+
+void
+on_generic (irc_session_t *session, const char *event, const char *origin, const char **params, unsigned count)
+{
+    log_event(event, origin, params, count);
 }
 
 void
 on_numeric (irc_session_t *session, unsigned event, const char *origin, const char **params, unsigned count)
 {
-    unsigned i;
+    char num[16];
 
-    printf("-- [%d] -- (%s) -- ", event, origin);
-    for (i=0; i<count; ++i)
-        printf("%s -- ", params[i]);
-    printf("\n");
+    if (log_level <= LOG_DEBUG) {
+        snprintf(num, sizeof num, "%u", event);
+        log_event(num, origin, params, count);
+    }
 
     if (event == LIBIRC_RFC_RPL_WELCOME && count == 2) {
         /* get the actual nick (in case the server changed it) */
-        char *old_irc_nick = irc_nick;
-        irc_nick = strdup(params[0]);
-        free(old_irc_nick);
+        set_irc_nick(session, params[0]);
     }
 }
 
 game_tp
 get_channel_game (irc_session_t *session, const char *channel)
 {
-    struct channel_game *cg;
+    return registry_get(session, channel);
+}
 
-    if (!channel) return NULL;
-    for (cg = channel_games_list; cg; cg = cg->next)
-        if (cg->session == session && !strcasecmp(cg->channel, channel))
-            return cg->game;
+void
+end_channel_game (irc_session_t *session, const char *channel)
+{
+    game_tp game;
 
-    return NULL;
+    if ((game = registry_remove(session, channel))) {
+        log_msg(LOG_INFO, "game in %s is over.", channel);
+        free_game(game);
+    }
 }
 
@@ -8,20 +8,25 @@
 #include <libirc_rfcnumeric.h>
 
 #include "game.h"
+#include "registry.h"
 
 const char *get_irc_nick (irc_session_t *session);
-
-
-extern
-struct channel_game {
-    irc_session_t *session;
-    char *channel;
-    game_tp game;
-    struct channel_game *next;
-} 
-    * channel_games_list;
+/* the host, as configured. stays put as long as the bot runs. */
+const char *get_server_name (irc_session_t *session);
+
+/* queued, see sendq.h. never blocks. */
+void send_msg (irc_session_t *session, const char *target, const char *text);
+void send_msgf (irc_session_t *session, const char *target, const char *fmt, ...);
+/* never merged with the lines around it */
+void send_art (irc_session_t *session, const char *target, const char *text);
+/* after the send queue has run dry */
+void quit_session (irc_session_t *session, const char *reason);
+/* from a shard too */
+void join_channel (irc_session_t *session, const char *channel);
 
 game_tp get_channel_game (irc_session_t *session, const char *channel);
+/* forgets the channel's game and frees it */
+void end_channel_game (irc_session_t *session, const char *channel);
 
 #endif
 
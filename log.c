@@ -0,0 +1,166 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "log.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+enum log_level log_level = LOG_INFO;
+
+static const char *const level_names[] = {
+    [LOG_DEBUG] = "debug",
+    [LOG_INFO] = "info",
+    [LOG_WARNING] = "warning",
+    [LOG_ERROR] = "error"
+};
+
+struct line {
+    enum log_level level;
+    char text[LOG_LINE];
+};
+
+/* lines [first, first + count) are queued. the writer reads the ones it
+ * has taken without the lock: nobody writes a slot until it's given back. */
+static struct line ring[LOG_RING];
+static unsigned first = 0, count = 0;
+static unsigned long dropped = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+static int running = 0;
+static int stopping = 0;
+
+static void
+write_line (const struct line *l)
+{
+    FILE *f = l->level >= LOG_WARNING ? stderr : stdout;
+
+    fputs(l->text, f);
+    putc('\n', f);
+}
+
+static void *
+write_all (void *arg)
+{
+    unsigned long reported = 0, lost;
+    unsigned n, i;
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (count == 0 && !stopping)
+            pthread_cond_wait(&cond, &lock);
+        if (count == 0)
+            break;
+        n = count;
+        lost = dropped - reported;
+        reported = dropped;
+        pthread_mutex_unlock(&lock);
+
+        for (i = 0; i < n; i++)
+            write_line(&ring[(first + i) % LOG_RING]);
+        if (lost)
+            fprintf(stderr, "WARNING: %lu log lines dropped.\n", lost);
+        fflush(stdout);
+        fflush(stderr);
+
+        pthread_mutex_lock(&lock);
+        first = (first + n) % LOG_RING;
+        count -= n;
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int
+log_start (void)
+{
+    pthread_mutex_lock(&lock);
+    stopping = 0;
+    if (pthread_create(&writer, NULL, write_all, NULL) != 0) {
+        pthread_mutex_unlock(&lock);
+        perror("log: pthread_create");
+        return -1;
+    }
+    running = 1;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+void
+log_stop (void)
+{
+    pthread_mutex_lock(&lock);
+    if (!running) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    stopping = 1;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(writer, NULL);
+    pthread_mutex_lock(&lock);
+    running = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+void
+log_msg (enum log_level level, const char *fmt, ...)
+{
+    struct line l;
+    struct timespec ts;
+    struct tm tm;
+    va_list ap;
+    int n;
+
+    if (level < log_level)
+        return;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    localtime_r(&ts.tv_sec, &tm);
+    n = strftime(l.text, sizeof l.text, "%Y-%m-%d %H:%M:%S", &tm);
+    n += snprintf(l.text + n, sizeof l.text - n, ".%03ld %-7s ",
+                  ts.tv_nsec / 1000000, level_names[level]);
+    va_start(ap, fmt);
+    vsnprintf(l.text + n, sizeof l.text - n, fmt, ap);
+    va_end(ap);
+    l.level = level;
+
+    pthread_mutex_lock(&lock);
+    if (!running) {
+        /* no writer: straight out, in order all the same */
+        write_line(&l);
+    } else if (count == LOG_RING) {
+        dropped++;
+    } else {
+        ring[(first + count) % LOG_RING] = l;
+        if (count++ == 0)
+            pthread_cond_signal(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+int
+log_level_named (const char *name)
+{
+    int i;
+
+    for (i = LOG_DEBUG; i <= LOG_ERROR; i++)
+        if (strcmp(name, level_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+unsigned long
+log_dropped (void)
+{
+    unsigned long n;
+
+    pthread_mutex_lock(&lock);
+    n = dropped;
+    pthread_mutex_unlock(&lock);
+    return n;
+}
@@ -0,0 +1,44 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef LOG_H
+#define LOG_H
+
+/* Log lines, written by a thread of their own.
+ *
+ * log_msg() formats the line on the caller's thread, stamps it and drops it
+ * into a ring of LOG_RING lines; the writer takes them out in batches and
+ * writes warnings and errors to stderr, the rest to stdout. Nobody waits
+ * for a terminal or a pipe: when the ring is full, the line is dropped and
+ * counted, and the writer says how many went missing. Below log_level,
+ * nothing is even formatted.
+ *
+ * Until log_start() and after log_stop(), lines are written right away. */
+
+#ifndef LOG_RING
+#define LOG_RING 1024
+#endif
+#define LOG_LINE 512        /* longer lines are cut short */
+
+enum log_level {
+    LOG_DEBUG = 1,          /* every IRC event */
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+extern enum log_level log_level;    /* LOG_INFO unless set */
+
+/* returns -1 if the writer won't start */
+int log_start (void);
+/* writes whatever is queued, then stops the writer */
+void log_stop (void);
+
+void log_msg (enum log_level level, const char *fmt, ...)
+    __attribute__ ((format (printf, 2, 3)));
+/* "debug", "info", "warning" or "error". returns -1 for anything else. */
+int log_level_named (const char *name);
+/* lines lost to a full ring so far */
+unsigned long log_dropped (void);
+
+#endif
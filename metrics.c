@@ -0,0 +1,138 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "metrics.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+__thread struct metrics *thread_metrics = NULL;
+
+/* if a thread can't have its own, it shares this one, and may now and
+ * then lose a count to another thread */
+static struct metrics spare;
+static struct metrics *all = &spare;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const struct {
+    const char *name, *help;
+} counters[N_COUNTERS] = {
+    [C_LINES_IN] = { "lines_in_total", "Lines said to the bot or on its channels." },
+    [C_LINES_OUT] = { "lines_out_total", "Lines sent, merged ones counting once." },
+    [C_COMMANDS] = { "commands_total", "Commands run." },
+    [C_EVALS] = { "evals_total", "Hands evaluated." },
+    [C_SHUFFLES] = { "shuffles_total", "Decks shuffled." }
+};
+
+static const struct {
+    const char *name, *help;
+    double smallest;            /* the first bucket's bound */
+} histograms[N_HISTOGRAMS] = {
+    [H_RESPONSE] = { "response_seconds",
+                     "From a line coming in to the first answer queued.", 1e-6 },
+    [H_DISPATCH] = { "dispatch_seconds", "Time spent in a command.", 1e-6 },
+    [H_SENDQ] = { "sendq_depth", "Lines waiting to go out, after each push.", 1 }
+};
+
+struct metrics *
+metrics_attach (void)
+{
+    struct metrics *m = calloc(1, sizeof *m);
+
+    if (!m)
+        return thread_metrics = &spare;
+    pthread_mutex_lock(&lock);
+    m->next = all;
+    all = m;
+    pthread_mutex_unlock(&lock);
+    return thread_metrics = m;
+}
+
+void
+metric_observe (enum histogram h, double value)
+{
+    struct metrics *m = METRICS_HERE();
+    double bound = histograms[h].smallest;
+    int i;
+
+    for (i = 0; i < METRIC_BUCKETS && value > bound; i++)
+        bound *= 2;
+    m->buckets[h][i]++;
+    m->sums[h] += value;
+}
+
+void
+metrics_write (FILE *f)
+{
+    struct metrics total;
+    const struct metrics *m;
+    unsigned long n;
+    double bound;
+    int i, k;
+
+    memset(&total, 0, sizeof total);
+    pthread_mutex_lock(&lock);
+    for (m = all; m; m = m->next) {
+        for (i = 0; i < N_COUNTERS; i++)
+            total.counters[i] += m->counters[i];
+        for (i = 0; i < N_HISTOGRAMS; i++) {
+            for (k = 0; k <= METRIC_BUCKETS; k++)
+                total.buckets[i][k] += m->buckets[i][k];
+            total.sums[i] += m->sums[i];
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    for (i = 0; i < N_COUNTERS; i++) {
+        fprintf(f, "# HELP ircpoker_%s %s\n", counters[i].name, counters[i].help);
+        fprintf(f, "# TYPE ircpoker_%s counter\n", counters[i].name);
+        fprintf(f, "ircpoker_%s %lu\n", counters[i].name, total.counters[i]);
+    }
+    fprintf(f, "# HELP ircpoker_log_dropped_total Log lines lost to a full ring.\n");
+    fprintf(f, "# TYPE ircpoker_log_dropped_total counter\n");
+    fprintf(f, "ircpoker_log_dropped_total %lu\n", log_dropped());
+
+    for (i = 0; i < N_HISTOGRAMS; i++) {
+        fprintf(f, "# HELP ircpoker_%s %s\n", histograms[i].name, histograms[i].help);
+        fprintf(f, "# TYPE ircpoker_%s histogram\n", histograms[i].name);
+        bound = histograms[i].smallest;
+        for (k = 0, n = 0; k < METRIC_BUCKETS; k++, bound *= 2) {
+            n += total.buckets[i][k];
+            fprintf(f, "ircpoker_%s_bucket{le=\"%g\"} %lu\n",
+                    histograms[i].name, bound, n);
+        }
+        n += total.buckets[i][METRIC_BUCKETS];
+        fprintf(f, "ircpoker_%s_bucket{le=\"+Inf\"} %lu\n", histograms[i].name, n);
+        fprintf(f, "ircpoker_%s_sum %g\n", histograms[i].name, total.sums[i]);
+        fprintf(f, "ircpoker_%s_count %lu\n", histograms[i].name, n);
+    }
+}
+
+int
+metrics_write_file (const char *path)
+{
+    char tmp[1040];
+    FILE *f;
+
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    if (!(f = fopen(tmp, "w"))) {
+        perror(tmp);
+        return -1;
+    }
+    metrics_write(f);
+    if (ferror(f) | fclose(f)) {
+        perror(tmp);
+        unlink(tmp);
+        return -1;
+    }
+    if (rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+/* Counters and histograms, cheap enough for the evaluator's loop.
+ *
+ * Every thread counts into a block of its own, so counting is an add to
+ * memory nobody else writes. The blocks are never freed: what a thread
+ * counted stays in the totals after it's gone. metrics_write() adds them
+ * all up in Prometheus' text format, reading the other threads' blocks as
+ * they are; a count that's one behind is as good as the next.
+ *
+ * Histograms have power-of-two buckets, from the histogram's smallest
+ * bucket up to METRIC_BUCKETS of them, and one for anything beyond. */
+
+#define METRIC_BUCKETS 24
+#ifndef METRICS_SECONDS
+#define METRICS_SECONDS 15      /* how often the bot writes them out */
+#endif
+
+enum counter {
+    C_LINES_IN,         /* said to the bot or on its channels */
+    C_LINES_OUT,        /* sent, merged lines counting once */
+    C_COMMANDS,
+    C_EVALS,            /* hands evaluated */
+    C_SHUFFLES,         /* decks shuffled */
+    N_COUNTERS
+};
+
+enum histogram {
+    H_RESPONSE,         /* seconds from a line to the first answer queued */
+    H_DISPATCH,         /* seconds spent in a command */
+    H_SENDQ,            /* lines waiting to go out, after every push */
+    N_HISTOGRAMS
+};
+
+struct metrics {
+    unsigned long counters[N_COUNTERS];
+    unsigned long buckets[N_HISTOGRAMS][METRIC_BUCKETS + 1];
+    double sums[N_HISTOGRAMS];
+    struct metrics *next;
+};
+
+extern __thread struct metrics *thread_metrics;
+/* this thread's block, the first time there's something to count */
+struct metrics *metrics_attach (void);
+#define METRICS_HERE() (thread_metrics ? thread_metrics : metrics_attach())
+
+#define METRIC_ADD(c, n) (METRICS_HERE()->counters[c] += (n))
+#define METRIC_INC(c) METRIC_ADD(c, 1)
+void metric_observe (enum histogram h, double value);
+
+/* the totals, with HELP and TYPE lines */
+void metrics_write (FILE *f);
+/* the same into path, by way of a temporary file: for a textfile
+ * collector, which must never see half of it. returns 0, or -1 after
+ * complaining. */
+int metrics_write_file (const char *path);
+
+#endif
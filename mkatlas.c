@@ -0,0 +1,127 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* packs the card pictures into the atlas the bot maps at startup.
+ *
+ * usage: mkatlas [card directory] [atlas]
+ *
+ * cards are named after suit and value, like h01.txt for the ace of hearts
+ * or s13.txt for the king of spades. back.txt is the back. all of them have
+ * to be the same number of lines high. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atlas.h"
+
+#define MAX_LINES 64
+
+static char *text = NULL;
+static size_t text_len = 0, text_size = 0;
+
+int read_glyph(const char *dir, const char *name, size_t starts[], int *n)
+{
+    /* appends the file's lines to text. returns 0, or -1. */
+    char path[1024];
+    FILE *f;
+    int c, lines = 0;
+    size_t start = text_len;
+
+    snprintf(path, sizeof path, "%s/%s", dir, name);
+    if (!(f = fopen(path, "rb"))) {
+        perror(path);
+        return -1;
+    }
+
+    starts[lines++] = text_len;
+    while ((c = getc(f)) != EOF) {
+        if (text_len == text_size) {
+            text_size = text_size ? 2 * text_size : 65536;
+            if (!(text = realloc(text, text_size))) {
+                perror("mkatlas");
+                exit(1);
+            }
+        }
+        if (c == '\r')
+            continue;
+        if (c == '\n') {
+            if (lines == MAX_LINES) {
+                fprintf(stderr, "%s: too many lines.\n", path);
+                fclose(f);
+                return -1;
+            }
+            starts[lines++] = text_len;
+            continue;
+        }
+        text[text_len++] = c;
+    }
+    fclose(f);
+
+    /* a newline at the very end doesn't start another line */
+    if (lines > 1 && starts[lines - 1] == text_len)
+        lines--;
+    if (text_len == start) {
+        fprintf(stderr, "%s: empty.\n", path);
+        return -1;
+    }
+    starts[lines] = text_len;
+    *n = lines;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const char suits[] = "cdhs";     /* same order as suit_t */
+    static size_t starts[ATLAS_GLYPHS][MAX_LINES + 1];
+    struct atlas_header h;
+    const char *dir = argc > 1 ? argv[1] : "cards";
+    const char *out = argc > 2 ? argv[2] : ATLAS_PATH;
+    char name[16];
+    uint32_t off;
+    size_t table;
+    FILE *f;
+    int g, i, n, height = 0;
+
+    for (g = 0; g < ATLAS_GLYPHS; g++) {
+        if (g == ATLAS_BACK_GLYPH)
+            strcpy(name, "back.txt");
+        else
+            sprintf(name, "%c%02d.txt", suits[g / 13],
+                    RANK_TO_VALUE(g % 13));
+        if (read_glyph(dir, name, starts[g], &n) != 0)
+            return 1;
+        if (height && n != height) {
+            fprintf(stderr, "%s/%s: %d lines instead of %d.\n", dir, name,
+                    n, height);
+            return 1;
+        }
+        height = n;
+    }
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, ATLAS_MAGIC, 8);
+    h.n_glyphs = ATLAS_GLYPHS;
+    h.n_lines = height;
+    table = sizeof h + (size_t) ATLAS_GLYPHS * (height + 1) * sizeof off;
+    h.size = table + text_len;
+
+    if (!(f = fopen(out, "wb"))) {
+        perror(out);
+        return 1;
+    }
+    fwrite(&h, sizeof h, 1, f);
+    for (g = 0; g < ATLAS_GLYPHS; g++) {
+        for (i = 0; i <= height; i++) {
+            off = table + starts[g][i];
+            fwrite(&off, sizeof off, 1, f);
+        }
+    }
+    fwrite(text, 1, text_len, f);
+    if (fclose(f) != 0) {
+        perror(out);
+        return 1;
+    }
+    printf("%s: %d cards of %d lines, %u bytes.\n", out, ATLAS_GLYPHS, height,
+           (unsigned) h.size);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "parse.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+int
+next_token (const char **p, struct token *t)
+{
+    const char *s = *p;
+    long num = 0;
+
+    while (isspace((unsigned char) *s))
+        s++;
+    if (!*s) {
+        *p = s;
+        return 0;
+    }
+
+    t->s = s;
+    t->is_num = 1;
+    for (; *s && !isspace((unsigned char) *s); s++) {
+        if (t->is_num && isdigit((unsigned char) *s) && num <= INT_MAX)
+            num = num * 10 + (*s - '0');
+        else
+            t->is_num = 0;
+    }
+    t->len = s - t->s;
+    t->is_num = t->is_num && num <= INT_MAX;
+    t->num = t->is_num ? (int) num : 0;
+
+    *p = s;
+    return 1;
+}
+
+int
+tokenize (const char *s, struct line *l)
+{
+    l->n = 0;
+    while (l->n < MAX_TOKENS && next_token(&s, &l->tok[l->n]))
+        l->n++;
+    return l->n;
+}
+
+int
+token_is (const struct token *t, const char *word)
+{
+    return strncasecmp(t->s, word, t->len) == 0 && word[t->len] == '\0';
+}
+
+static unsigned
+verb_hash (const char *s, int len, unsigned seed)
+{
+    /* FNV-1a on the lower case, then spread over the slots */
+    unsigned h = 2166136261u ^ seed;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        h ^= tolower((unsigned char) s[i]);
+        h *= 16777619u;
+    }
+    return (h * 2654435769u) >> 26;     /* 64 slots */
+}
+
+int
+build_verb_table (struct verb_table *vt)
+{
+    /* try seeds until no two verbs share a slot */
+    unsigned seed;
+    unsigned h;
+    int i;
+
+    for (seed = 1; seed < 100000; seed++) {
+        memset(vt->slot, -1, sizeof vt->slot);
+        for (i = 0; i < vt->n; i++) {
+            h = verb_hash(vt->verbs[i].word, strlen(vt->verbs[i].word), seed);
+            if (vt->slot[h] >= 0)
+                break;
+            vt->slot[h] = i;
+        }
+        if (i == vt->n) {
+            vt->seed = seed;
+            return 0;
+        }
+    }
+    fprintf(stderr, "ERROR: no perfect hash for the verb table.\n");
+    return -1;
+}
+
+const struct verb *
+find_verb (struct verb_table *vt, const struct token *t)
+{
+    int i;
+
+    if (!vt->seed && build_verb_table(vt) != 0)
+        return NULL;
+    if ((i = vt->slot[verb_hash(t->s, t->len, vt->seed)]) < 0)
+        return NULL;
+    return token_is(t, vt->verbs[i].word) ? &vt->verbs[i] : NULL;
+}
+
+const struct verb *
+match_verb (struct verb_table *vt, const struct line *l)
+{
+    const struct verb *v;
+    const char *tail;
+    struct token t;
+    int i;
+
+    if (l->n == 0 || !(v = find_verb(vt, &l->tok[0])))
+        return NULL;
+    if (!v->tail)
+        return v;
+
+    tail = v->tail;
+    for (i = 1; i < l->n; i++)
+        if (!next_token(&tail, &t) || t.len != l->tok[i].len
+                || strncasecmp(t.s, l->tok[i].s, t.len) != 0)
+            return NULL;
+    return next_token(&tail, &t) ? NULL : v;
+}
+
+int
+private_channel (const char *s, char *chan, int size)
+{
+    struct line l;
+
+    if (tokenize(s, &l) < 2 || !token_is(&l.tok[0], "game")
+            || l.tok[1].len >= size)
+        return 0;
+    memcpy(chan, l.tok[1].s, l.tok[1].len);
+    chan[l.tok[1].len] = '\0';
+    return 1;
+}
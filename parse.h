@@ -0,0 +1,70 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef PARSE_H
+#define PARSE_H
+
+/* Chat lines, taken apart without copying them.
+ *
+ * A token is a run of non-blank characters, pointing into the line it came
+ * from (so it is not NUL-terminated). Numbers are converted while
+ * tokenizing, once.
+ *
+ * Commands are looked up by their first word in a verb table: a perfect
+ * hash built the first time the table is used. */
+
+#define MAX_TOKENS 8
+#define VERB_SLOTS 64   /* power of two. no table has more than a dozen verbs */
+
+struct token {
+    const char *s;
+    int len;
+    int is_num;     /* all digits, and small enough for an int */
+    int num;
+};
+
+struct line {
+    struct token tok[MAX_TOKENS];
+    int n;
+};
+
+/* reads the token at *p and moves *p past it. returns 0 at the end. */
+int next_token (const char **p, struct token *t);
+/* up to MAX_TOKENS of them. returns how many. */
+int tokenize (const char *s, struct line *l);
+/* case-insensitive */
+int token_is (const struct token *t, const char *word);
+
+struct cmd_ctx;     /* whatever the handlers need. up to the caller */
+
+struct verb {
+    const char *word;
+    /* the rest of the line has to be these words, exactly. NULL: anything
+     * goes, the handler sorts out the arguments. */
+    const char *tail;
+    void (*fn) (struct cmd_ctx *, const struct line *);
+};
+
+struct verb_table {
+    const struct verb *verbs;
+    int n;
+    unsigned seed;
+    signed char slot[VERB_SLOTS];   /* index into verbs, -1 for none */
+};
+
+#define VERB_TABLE(verbs) { verbs, sizeof verbs / sizeof verbs[0], 0, { 0 } }
+
+/* find_verb() builds the table the first time it's needed. a table shared
+ * between threads has to be built before they start. returns -1 if it
+ * can't be done. */
+int build_verb_table (struct verb_table *vt);
+/* the verb with this word, or NULL */
+const struct verb *find_verb (struct verb_table *vt, const struct token *t);
+/* the verb matching the whole line, tail and all, or NULL */
+const struct verb *match_verb (struct verb_table *vt, const struct line *l);
+
+/* the channel a private line asks about, "game <channel>", which has to be
+ * answered on that channel's shard. copies it to chan, or returns 0. */
+int private_channel (const char *s, char *chan, int size);
+
+#endif
@@ -3,188 +3,179 @@
 #include "player.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-void bet(game_tp g, int player_id, int amount)
+static unsigned
+nick_hash(const char *nick)
 {
-    /* sets player's bet to amount */
-    /* TODO: implement pots, and handle that here as well */
-    int old_bet = g->players[player_id].bet;
-    int raise = amount - old_bet;
-    int D, i, j;
-    pot_t sidepot;
-
-    if (raise >= g->players[player_id].chips) {
-        g->players[player_id].allin = 1;
-        g->players[player_id].bet += g->players[player_id].chips;
-        raise = g->players[player_id].bet- old_bet;
-        g->players[player_id].chips = 0;
-    } else {
-        g->players[player_id].bet += raise;
-        g->players[player_id].chips -= raise;
+    /* FNV-1a */
+    unsigned h = 2166136261u;
+
+    while (*nick) {
+        h ^= (unsigned char) *nick++;
+        h *= 16777619u;
     }
+    return h;
+}
 
-    for (i = 0; i < g->n_pots; ++i) {
-        int hasme = 0;
-        /* register interest in pot. */
-        for (j = 0; j < g->pots[i].n_players; ++j) {
-            if (g->pots[i].players[j] == &g->players[player_id]) {
-                hasme = 1;
-                break;
-            }
-        }
-        if (!hasme) {
-            g->pots[i].players = realloc(g->pots[i].players,
-                                         ++(g->pots[i].n_players) * sizeof(player_t*));
-            g->pots[i].players[g->pots[i].n_players-1] = & g->players[player_id];
-        }
-        /* do the math. */
-        if ((D = (g->pots[i].bet - old_bet)) > 0) {
-            /* match the bet, if possible. */
-            if (D <= raise) {
-                g->pots[i].content += D;
-                raise -= D;
-                old_bet = g->pots[i].bet;
-            } else {
-                /* new side pot. */
-                sidepot.content = 0;
-                sidepot.bet = g->pots[i].bet;
-                sidepot.players = NULL;
-                sidepot.n_players = 0;
-                g->pots[i].bet = g->players[player_id].bet;
-                int DD;
-                /* transfer higher bets */
-                for (j = 0; j < g->pots[i].n_players; ++j) {
-                    if ((DD = g->pots[i].players[j]->bet - g->pots[i].bet) > 0) {
-                        g->pots[i].content -= DD;
-                        sidepot.content += DD;
-                    }
-                }
-                /* move higher pots along and insert side pot into array. */
-                g->pots = realloc (g->pots, ++(g->n_pots) * sizeof(pot_t));
-                for (j = i; j < g->n_pots-1; ++j)
-                    g->pots[j+1] = g->pots[j];
-                g->pots[i+1] = sidepot;
-
-                /* all in. Ignore higher pots. */
-                break;
-            }
-        }
-        if (i == g->n_pots-1 && raise > 0) {
-            /* current pot, I can raise. */
-            g->pots[i].content += raise;
-            raise = 0;
-            old_bet = g->pots[i].bet = g->players[player_id].bet;
-            if (g->players[player_id].allin) {
-                /* new, empty, side-pot */
-                sidepot.content = 0;
-                sidepot.bet = g->pots[i].bet;
-                sidepot.players = NULL;
-                sidepot.n_players = 0;
-                g->pots = realloc (g->pots, ++(g->n_pots) * sizeof(pot_t));
-                g->pots[g->n_pots-1] = sidepot;
-                break; 
-            }
-        }
+static int
+seat_slot(game_tp g, const char *nick)
+{
+    /* the slot holding nick, or the empty slot where it would go */
+    unsigned i = nick_hash(nick) & (SEAT_SLOTS - 1);
+    int seat;
+
+    while ((seat = g->seats[i]) != 0) {
+        if (strcmp(g->players[seat - 1].nick, nick) == 0)
+            break;
+        i = (i + 1) & (SEAT_SLOTS - 1);
     }
+    return i;
 }
 
-void fold(game_tp g, int player_id)
+int find_player(game_tp g, const char *nick)
 {
-    /* removes player from the current hand */
-    g->players[player_id].folded = 1;
+    return (int) g->seats[seat_slot(g, nick)] - 1;
 }
 
-void get_best_player_hand(game_tp g, int player_id)
+int add_player(game_tp g, const char *nick)
 {
-    /* finds the best possible 5-card hand for players[player_id] */
-    card_t last_hand[5];
-    card_t cur_hand[5];
+    player_t *p;
     int i;
-    int j;
-    int k;
-
-    /* compare to the community cards first */
-    for (i = 0; i < 5; i++)
-        last_hand[i] = g->community[i];
-
-    /* replace two of the community cards at a time with the pocket cards */
-    for (i = 0; i < 5; i++) {
-         for (j = 0; j < i; j++) {
-             for (k = 0; k < 5; k++)
-                 cur_hand[k] = g->community[k];
-             cur_hand[i] = g->players[player_id].hand[0];
-             cur_hand[j] = g->players[player_id].hand[1];
-
-             /* if cur_hand beats last_hand, set last_hand's values to cur_hand's */
-             if (handcmp(cur_hand, last_hand) > 0)
-                 for (k = 0; k < 5; k++)
-                     last_hand[k] = cur_hand[k];
-         }
-    }
-
-    /* now replace one card at a time and compare */
-    for (i = 0; i < 5; i++) {
-        for (j = 0; j < 5; j++)
-            cur_hand[j] = g->community[j];
-        cur_hand[i] = g->players[player_id].hand[0];
 
-        if (handcmp(cur_hand, last_hand) > 0)
-            for (j = 0; j < 5; j++)
-                last_hand[j] = cur_hand[j];
+    if ((i = find_player(g, nick)) >= 0)
+        return i;
+    if (g->n_players >= MAX_PLAYERS)
+        return -1;
 
-        for (j = 0; j < 5; j++)
-            cur_hand[j] = g->community[j];
-        cur_hand[i] = g->players[player_id].hand[1];
+    i = g->n_players++;
+    p = &g->players[i];
+    memset(p, 0, sizeof *p);
+    strncpy(p->nick, nick, NICK_LEN - 1);
+    g->seats[seat_slot(g, p->nick)] = i + 1;
+    return i;
+}
 
-        if (handcmp(cur_hand, last_hand) > 0)
-            for (j = 0; j < 5; j++)
-                last_hand[j] = cur_hand[j];
-    }
+static void
+index_seats(game_tp g)
+{
+    int i;
 
-    /* by now, last_hand should be the best possible hand */
-    for (i = 0; i < 5; i++)
-        g->players[player_id].best_hand[i] = last_hand[i];
+    memset(g->seats, 0, sizeof g->seats);
+    for (i = 0; i < g->n_players; i++)
+        if (g->players[i].nick[0])
+            g->seats[seat_slot(g, g->players[i].nick)] = i + 1;
 }
 
-/* TODO: stop using qsort and get rid of this evil.
- * We might want thread safety some day. */
-static game_tp _current_game;
+void remove_player(game_tp g, int i)
+{
+    if (i < 0 || i >= g->n_players)
+        return;
+    if (g->house == &g->players[i])
+        g->house = NULL;
+    else if (g->house > &g->players[i])
+        g->house--;
+    memmove(&g->players[i], &g->players[i + 1],
+            (g->n_players - i - 1) * sizeof g->players[0]);
+    g->n_players--;
+
+    if (i <= g->button)
+        g->button = g->button > 0 ? g->button - 1 : g->n_players - 1;
+    if (g->button < 0)
+        g->button = 0;
+    index_seats(g);
+}
 
-int playercmp(const void * player1, const void * player2)
+int rename_player(game_tp g, const char *old_nick, const char *new_nick)
 {
-    /* compares two players in a way that is usable by qsort() */
-    if (_current_game->players[*(int *)player1].active == 0 ||
-            _current_game->players[*(int *)player1].folded == 1)
+    /* nick changes are rare: just build the index again */
+    int i = find_player(g, old_nick);
+
+    if (i < 0)
         return -1;
-    if (_current_game->players[*(int *)player2].active == 0 ||
-            _current_game->players[*(int *)player2].folded == 1)
-        return 1;
+    strncpy(g->players[i].nick, new_nick, NICK_LEN - 1);
+    g->players[i].nick[NICK_LEN - 1] = '\0';
+    index_seats(g);
+    return i;
+}
 
-    return handcmp( _current_game->players[ *(int *)player1 ].best_hand,
-                    _current_game->players[ *(int *)player2 ].best_hand);
+void bet(game_tp g, int player_id, int amount)
+{
+    /* sets player's bet to amount. the pots are sorted out at the end of
+     * the round, by collect_pots(). */
+    player_t *p = &g->players[player_id];
+    int raise = amount - p->bet;
+
+    if (raise >= p->chips) {
+        p->allin = 1;
+        raise = p->chips;
+    }
+    if (raise <= 0)
+        return;
+    p->chips -= raise;
+    p->bet += raise;
+    p->committed += raise;
+    if (p->bet > g->round_bet)
+        g->round_bet = p->bet;
+}
+
+void fold(game_tp g, int player_id)
+{
+    /* removes player from the current hand */
+    g->players[player_id].folded = 1;
+}
+
+void get_best_player_hand(game_tp g, int player_id)
+{
+    /* finds the best possible 5-card hand for players[player_id], by the
+     * rules of the variant */
+    player_t *p = &g->players[player_id];
+    cardmask_t cards;
+
+    p->strength = g->variant->eval(p->hand, g->community, g->n_community, &cards);
+    eval_best_hand(cards, p->strength, p->best_hand);
 }
 
 /* pass array long enough for all players */
-void get_player_ranks(game_tp g, int ranking_array[])
+int get_player_ranks(game_tp g, player_rank_t ranking[])
 {
-    int i;
+    /* every player's hand is evaluated once. the strengths then get
+     * insertion-sorted: there are never many players. */
+    player_rank_t r;
+    int i, j;
+    int groups = 0;
 
     for (i = 0; i < g->n_players; i++) {
-        ranking_array[i] = i;
-        get_best_player_hand(g, i);
-    }
+        r.player = i;
+        r.strength = -1;
+        if (g->players[i].active && !g->players[i].folded) {
+            get_best_player_hand(g, i);
+            r.strength = g->players[i].strength;
+        }
 
-    _current_game = g;
+        for (j = i; j > 0 && ranking[j - 1].strength < r.strength; j--)
+            ranking[j] = ranking[j - 1];
+        ranking[j] = r;
+    }
 
-    qsort(ranking_array, g->n_players, sizeof(int), playercmp);
+    for (i = 0; i < g->n_players; i++) {
+        if (ranking[i].strength < 0)
+            ranking[i].group = -1;
+        else if (i > 0 && ranking[i].strength == ranking[i - 1].strength)
+            ranking[i].group = ranking[i - 1].group;
+        else
+            ranking[i].group = groups++;
+    }
+    return groups;
 }
 
 /* free result with free() when done. */
-int *alloc_player_ranks(game_tp g)
+player_rank_t *alloc_player_ranks(game_tp g, int *n_groups)
 {
-    int *ranking_array = malloc(sizeof (int) * g->n_players);
-    get_player_ranks(g, ranking_array);
-    return ranking_array;
-}
-
+    player_rank_t *ranking = malloc(sizeof (player_rank_t) * g->n_players);
+    int groups = get_player_ranks(g, ranking);
 
+    if (n_groups)
+        *n_groups = groups;
+    return ranking;
+}
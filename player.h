@@ -6,13 +6,17 @@
 #include "card.h"
 
 #define NICK_LEN 32
+/* hole cards, in Omaha. the variant says how many, see variant.h */
+#define MAX_HOLE 4
 
 typedef struct player {
-    card_t hand[2];
-    card_t best_hand[5];
+    pcard_t hand[MAX_HOLE];
+    pcard_t best_hand[5];
+    int strength;   /* of best_hand, see hand.h */
     char nick[NICK_LEN];
     int chips;
-    int bet;
+    int bet;        /* this round of betting */
+    int committed;  /* this hand, all rounds together */
     int active;
     int allin;
     int folded;
@@ -22,15 +26,32 @@ typedef struct player {
 #include "game.h"
 #include "hand.h"
 
-/* sounds like a local variable? we'll see */
-/* int player_ranks[10]; */ /* used for sorting players to find best hand(s) */
+typedef struct player_rank {
+    int player;     /* index into the game's players */
+    int strength;   /* of the player's best hand, -1 if not in the hand */
+    int group;      /* equal hands share a group. the winners are group 0, the
+                     * runners-up group 1, &c. -1 if not in the hand. */
+} player_rank_t;
 
+/* seats a new player with an empty stack. returns the new player's index,
+ * or -1 if the table is full. */
+int add_player(game_tp, const char *nick);
+/* between hands: the players after it move down a seat, and the button
+ * stays where it was, so the same player is next in line */
+void remove_player(game_tp, int player_id);
+/* returns the index of the player with that nick, or -1 */
+int find_player(game_tp, const char *nick);
+/* after a NICK change. returns the player's index, or -1 */
+int rename_player(game_tp, const char *old_nick, const char *new_nick);
+
+/* raises the player's bet to amount, or as far as their chips go. see pot.h */
 void bet(game_tp, int player_id, int amount);
 void fold(game_tp, int player_id);
 void get_best_player_hand(game_tp, int player_id);
-/* pass array long enough for all players */
-void get_player_ranks(game_tp, int ranking_array[]);
+/* sorts the players, best hand first. pass array long enough for all
+ * players. returns the number of groups. */
+int get_player_ranks(game_tp, player_rank_t ranking[]);
 /* free result with free() when done. */
-int *alloc_player_ranks(game_tp);
+player_rank_t *alloc_player_ranks(game_tp, int *n_groups);
 
 #endif
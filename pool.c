@@ -0,0 +1,297 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "pool.h"
+#include "hand.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Every worker has its own queue. pool_submit() deals jobs out round-robin,
+ * and a worker whose queue is empty steals from the others before it goes
+ * to sleep. The queues have a lock each, so workers only ever wait on each
+ * other while stealing.
+ *
+ * Finished jobs go onto one lock-free queue (Dmitry Vyukov's intrusive
+ * MPSC queue): any number of workers push, only pool_drain() pops. A byte
+ * written to a pipe wakes up the event loop, but only if nobody has since
+ * the last drain.
+ */
+
+#define MAX_WORKERS 64
+
+struct worker {
+    int id;
+    pthread_t thread;
+    rng_t rng;
+    pthread_mutex_t lock;   /* for the queue */
+    struct job *head, *tail;
+};
+
+static struct worker workers[MAX_WORKERS];
+static int n_workers = 0;
+static unsigned next_worker = 0;
+
+/* for sleeping workers */
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static int queued = 0;      /* jobs in all queues */
+static int stopping = 0;
+
+/* the completion queue. cq_tail is only touched by pool_drain(). */
+static struct job stub;
+static struct job *cq_head = &stub;
+static struct job *cq_tail = &stub;
+static int wake_pipe[2] = { -1, -1 };
+static int signalled = 0;
+
+/* runs jobs when there are no workers */
+static struct worker inline_worker;
+static int inline_ready = 0;
+
+static void
+cq_push (struct job *job)
+{
+    struct job *prev;
+
+    __atomic_store_n(&job->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&cq_head, job, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, job, __ATOMIC_RELEASE);
+}
+
+static struct job *
+cq_pop (void)
+{
+    struct job *tail = cq_tail;
+    struct job *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &stub) {
+        if (!next)
+            return NULL;
+        cq_tail = tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+    if (next) {
+        cq_tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&cq_head, __ATOMIC_ACQUIRE))
+        return NULL;    /* a push is half done. it will wake us up. */
+
+    cq_push(&stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        cq_tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+void
+pool_complete (struct job *job)
+{
+    cq_push(job);
+    if (__atomic_exchange_n(&signalled, 1, __ATOMIC_SEQ_CST) == 0)
+        if (write(wake_pipe[1], "", 1) < 0)
+            perror("pool: write");
+}
+
+void
+pool_drain (void)
+{
+    char buf[64];
+    struct job *job;
+
+    while (read(wake_pipe[0], buf, sizeof buf) > 0);
+    __atomic_store_n(&signalled, 0, __ATOMIC_SEQ_CST);
+
+    while ((job = cq_pop()))
+        job->done(job);
+}
+
+int
+pool_completion_fd (void)
+{
+    return wake_pipe[0];
+}
+
+static struct job *
+take (struct worker *w)
+{
+    /* own queue first, then everybody else's */
+    struct job *job = NULL;
+    int i;
+
+    for (i = 0; i < n_workers && !job; i++) {
+        struct worker *v = &workers[(w->id + i) % n_workers];
+
+        pthread_mutex_lock(&v->lock);
+        if ((job = v->head)) {
+            v->head = job->next;
+            if (!v->head)
+                v->tail = NULL;
+        }
+        pthread_mutex_unlock(&v->lock);
+    }
+
+    if (job)
+        __atomic_sub_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+    return job;
+}
+
+static void
+run_job (struct job *job, struct worker *w)
+{
+    /* a job that completes its parent may be gone once run() returns */
+    void (*done) (struct job *) = job->done;
+
+    job->run(job, w);
+    if (done)
+        pool_complete(job);
+}
+
+static void *
+work (void *arg)
+{
+    struct worker *w = arg;
+    struct job *job;
+    int stop;
+
+    for (;;) {
+        if ((job = take(w))) {
+            run_job(job, w);
+            continue;
+        }
+
+        pthread_mutex_lock(&idle_lock);
+        while (__atomic_load_n(&queued, __ATOMIC_SEQ_CST) == 0 && !stopping)
+            pthread_cond_wait(&idle_cond, &idle_lock);
+        stop = stopping && __atomic_load_n(&queued, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock(&idle_lock);
+
+        if (stop)
+            return NULL;
+    }
+}
+
+static int
+open_pipe (void)
+{
+    if (wake_pipe[0] >= 0)
+        return 0;
+    if (pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("pool: pipe");
+        return -1;
+    }
+    return 0;
+}
+
+int
+pool_start (int n)
+{
+    int i;
+
+    if (n <= 0)
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n <= 0)
+        n = 1;
+    if (n > MAX_WORKERS)
+        n = MAX_WORKERS;
+
+    if (open_pipe() != 0)
+        return -1;
+
+    /* the tables are read-only once built, so workers can share them */
+    init_hand_tables();
+    init_card_glyphs();
+
+    stopping = 0;
+    for (i = 0; i < n; i++) {
+        workers[i].id = i;
+        workers[i].head = workers[i].tail = NULL;
+        pthread_mutex_init(&workers[i].lock, NULL);
+        rng_init(&workers[i].rng, RESEED_INTERVAL);
+    }
+    n_workers = n;
+    for (i = 0; i < n; i++) {
+        if (pthread_create(&workers[i].thread, NULL, work, &workers[i]) != 0) {
+            perror("pool: pthread_create");
+            n_workers = i;
+            pool_stop();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void
+pool_stop (void)
+{
+    int i;
+
+    pthread_mutex_lock(&idle_lock);
+    stopping = 1;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+
+    for (i = 0; i < n_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        pthread_mutex_destroy(&workers[i].lock);
+    }
+    n_workers = 0;
+}
+
+int
+pool_size (void)
+{
+    return n_workers ? n_workers : 1;
+}
+
+void
+pool_submit (struct job *job)
+{
+    struct worker *w;
+
+    if (n_workers == 0) {
+        /* no threads (yet): run it right here */
+        if (open_pipe() != 0)
+            return;
+        if (!inline_ready) {
+            rng_init(&inline_worker.rng, RESEED_INTERVAL);
+            inline_ready = 1;
+        }
+        run_job(job, &inline_worker);
+        return;
+    }
+
+    w = &workers[__atomic_fetch_add(&next_worker, 1, __ATOMIC_RELAXED) % n_workers];
+    job->next = NULL;
+    pthread_mutex_lock(&w->lock);
+    if (w->tail)
+        w->tail->next = job;
+    else
+        w->head = job;
+    w->tail = job;
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_mutex_lock(&idle_lock);
+    __atomic_add_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+rng_t *
+worker_rng (struct worker *w)
+{
+    return &w->rng;
+}
+
+int
+worker_id (struct worker *w)
+{
+    return w->id;
+}
@@ -0,0 +1,41 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "rng.h"
+
+/* A pool of worker threads for anything too slow for the IRC thread.
+ *
+ * Jobs are posted from the IRC thread (or from other jobs), run on some
+ * worker, and then handed back: pool_completion_fd() becomes readable, and
+ * pool_drain() calls each finished job's done() on the thread that drains. */
+
+struct worker;
+
+struct job {
+    void (*run) (struct job *, struct worker *);   /* on a worker */
+    void (*done) (struct job *);    /* after pool_drain(). NULL: don't */
+    struct job *next;               /* for the pool's queues */
+};
+
+/* starts n workers, or one per core if n is 0. returns -1 on failure. */
+int pool_start (int n);
+/* finishes all queued jobs, then stops the workers. */
+void pool_stop (void);
+int pool_size (void);
+
+void pool_submit (struct job *job);
+/* hands job to pool_drain() without running it. for jobs that are split
+ * into parts: the last part to finish completes the whole. */
+void pool_complete (struct job *job);
+
+int pool_completion_fd (void);
+void pool_drain (void);
+
+/* every worker has its own stream, so simulations share nothing. */
+rng_t *worker_rng (struct worker *w);
+int worker_id (struct worker *w);
+
+#endif
@@ -0,0 +1,134 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#include "pot.h"
+
+static int min (int a, int b)
+{
+    return a < b ? a : b;
+}
+
+void collect_pots(game_tp g)
+{
+    int levels[MAX_PLAYERS + 1];
+    int n_levels = 0;
+    int top = 0;
+    int prev, level, content;
+    seatmask_t seats;
+    player_t *p;
+    int i, j, k;
+
+    /* the all-in levels, bottom up. insertion sort: there are never many */
+    for (i = 0; i < g->n_players; i++) {
+        p = &g->players[i];
+        if (p->committed > top)
+            top = p->committed;
+        if (!p->allin || p->folded || p->committed == 0)
+            continue;
+        for (j = n_levels; j > 0 && levels[j - 1] > p->committed; j--)
+            levels[j] = levels[j - 1];
+        levels[j] = p->committed;
+        n_levels++;
+    }
+    /* the top pot takes whatever is above the last all-in */
+    levels[n_levels++] = top;
+
+    g->n_pots = 0;
+    prev = 0;
+    for (k = 0; k < n_levels; k++) {
+        if ((level = levels[k]) == prev)
+            continue;
+
+        content = 0;
+        seats = 0;
+        for (i = 0; i < g->n_players; i++) {
+            p = &g->players[i];
+            content += min(p->committed, level) - min(p->committed, prev);
+            if (!p->folded && p->committed >= level)
+                seats |= SEAT_BIT(i);
+        }
+        if (!seats) {
+            /* nobody left to call it: it goes back where it came from */
+            for (i = 0; i < g->n_players; i++)
+                if (g->players[i].committed >= level)
+                    seats |= SEAT_BIT(i);
+        }
+
+        if (g->n_pots > 0 && g->pots[g->n_pots - 1].seats == seats) {
+            /* same players as the pot below: one pot */
+            g->pots[g->n_pots - 1].content += content;
+            g->pots[g->n_pots - 1].bet = level;
+        } else {
+            g->pots[g->n_pots].content = content;
+            g->pots[g->n_pots].bet = level;
+            g->pots[g->n_pots].seats = seats;
+            g->n_pots++;
+        }
+        prev = level;
+    }
+
+    if (g->n_pots == 0) {
+        g->pots[0].content = g->pots[0].bet = 0;
+        g->pots[0].seats = 0;
+        g->n_pots = 1;
+    }
+}
+
+void end_betting_round(game_tp g)
+{
+    int i;
+
+    collect_pots(g);
+    for (i = 0; i < g->n_players; i++)
+        g->players[i].bet = 0;
+    g->round_bet = 0;
+}
+
+void award_pots(game_tp g, const int strength[], int won[])
+{
+    seatmask_t seats, winners;
+    int best, n, share, odd;
+    int i, k, seat;
+
+    for (k = 0; k < g->n_pots; k++) {
+        if (g->pots[k].content == 0)
+            continue;
+
+        best = -1;
+        winners = 0;
+        for (seats = g->pots[k].seats; seats; seats &= seats - 1) {
+            i = __builtin_ctz(seats);
+            if (strength[i] > best) {
+                best = strength[i];
+                winners = SEAT_BIT(i);
+            } else if (strength[i] == best) {
+                winners |= SEAT_BIT(i);
+            }
+        }
+        if (!winners)
+            continue;
+
+        n = __builtin_popcount(winners);
+        share = g->pots[k].content / n;
+        odd = g->pots[k].content % n;
+        /* going round the table from the button */
+        for (i = 1; i <= g->n_players; i++) {
+            seat = (g->button + i) % g->n_players;
+            if (!(winners & SEAT_BIT(seat)))
+                continue;
+            g->players[seat].chips += share + (odd > 0);
+            if (won)
+                won[seat] += share + (odd > 0);
+            odd--;
+        }
+        g->pots[k].content = 0;
+    }
+}
+
+int pot_total(game_tp g)
+{
+    int i, total = 0;
+
+    for (i = 0; i < g->n_players; i++)
+        total += g->players[i].committed;
+    return total;
+}
@@ -0,0 +1,32 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef POT_H
+#define POT_H
+
+#include "game.h"
+
+/* The pot engine.
+ *
+ * While a round of betting goes on, bet() only moves chips from a player's
+ * stack to their bet, and counts them as committed to the hand. Pots don't
+ * change until the round is over. Then collect_pots() builds them anew from
+ * what everybody has committed: the different all-in amounts, sorted, are
+ * the levels at which pots are capped. Every player who is still in and
+ * has committed at least up to a pot's cap has a claim on that pot.
+ *
+ * At the showdown, award_pots() goes through the pots once and gives each
+ * one to the best hand with a claim on it. */
+
+/* builds game->pots from the players' commitments */
+void collect_pots(game_tp);
+/* collects the pots and clears the bets, for the next round */
+void end_betting_round(game_tp);
+/* strength[i] is player i's hand (see hand.h), or -1 if they can't win.
+ * splits every pot among its best hands, the odd chips going to the first
+ * winners left of the button. adds the winnings to the players' chips,
+ * and to won[i] if won isn't NULL. */
+void award_pots(game_tp, const int strength[], int won[]);
+/* all chips committed to this hand, this round's bets included */
+int pot_total(game_tp);
+
+#endif
@@ -1,33 +1,35 @@
-/* copypasta from wikipedia */
-unsigned char S[256];
-unsigned int i, j;
+/* copypasta from wikipedia, with the state moved into a struct */
+#include "rng.h"
 
-void swap(unsigned char *s, unsigned int i, unsigned int j) {
+static void swap(unsigned char *s, unsigned int i, unsigned int j) {
     unsigned char temp = s[i];
     s[i] = s[j];
     s[j] = temp;
 }
 
 /* KSA */
-void rc4_init(unsigned char *key, unsigned int key_length) {
+void rc4_init(struct rc4 *rc4, const unsigned char *key, unsigned int key_length) {
+    unsigned int i, j;
+
     for (i = 0; i < 256; i++)
-        S[i] = i;
+        rc4->S[i] = i;
 
     for (i = j = 0; i < 256; i++) {
-        j = (j + key[i % key_length] + S[i]) & 255;
-        swap(S, i, j);
+        j = (j + key[i % key_length] + rc4->S[i]) & 255;
+        swap(rc4->S, i, j);
     }
 
-    i = j = 0;
+    rc4->i = rc4->j = 0;
 }
 
 /* PRGA */
-unsigned char rc4_output() {
-    i = (i + 1) & 255;
-    j = (j + S[i]) & 255;
+unsigned char rc4_output(struct rc4 *rc4) {
+    unsigned char *S = rc4->S;
 
-    swap (S, i, j);
+    rc4->i = (rc4->i + 1) & 255;
+    rc4->j = (rc4->j + S[rc4->i]) & 255;
 
-    return S[(S[i] + S[j]) & 255];
-}
+    swap (S, rc4->i, rc4->j);
 
+    return S[(S[rc4->i] + S[rc4->j]) & 255];
+}
@@ -0,0 +1,188 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "registry.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* chained buckets, a power of two of them. the table doubles once there
+ * are more games than buckets. */
+#define MIN_BUCKETS 16
+
+/* one table per thread: every shard keeps its own games (see shard.h) */
+static __thread struct channel_game **buckets = NULL;
+static __thread unsigned long n_buckets = 0;
+static __thread int n_games = 0;
+
+int
+irc_tolower (int c)
+{
+    if (c >= 'A' && c <= '^')   /* A-Z [ \ ] ^ */
+        return c + ('a' - 'A');
+    return c;
+}
+
+int
+irc_casecmp (const char *a, const char *b)
+{
+    int ca, cb;
+
+    do {
+        ca = irc_tolower((unsigned char) *a++);
+        cb = irc_tolower((unsigned char) *b++);
+    } while (ca == cb && ca);
+    return ca - cb;
+}
+
+unsigned long
+registry_hash (const void *session, const char *channel)
+{
+    /* FNV-1a over the folded name, then the session thrown in */
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (*channel) {
+        h ^= irc_tolower((unsigned char) *channel++);
+        h *= 0x100000001b3ULL;
+    }
+    h ^= (uintptr_t) session;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return (unsigned long) (h ^ (h >> 32));
+}
+
+static struct channel_game **
+find (const void *session, const char *channel, unsigned long hash)
+{
+    /* the link pointing to the entry, or to the NULL at the bucket's end */
+    struct channel_game **link;
+
+    if (!buckets)
+        return NULL;
+    for (link = &buckets[hash & (n_buckets - 1)]; *link; link = &(*link)->next)
+        if ((*link)->hash == hash && (*link)->session == session
+                && irc_casecmp((*link)->channel, channel) == 0)
+            break;
+    return link;
+}
+
+static int
+grow (void)
+{
+    unsigned long n = n_buckets ? 2 * n_buckets : MIN_BUCKETS;
+    struct channel_game **b = calloc(n, sizeof *b);
+    struct channel_game *cg, *next;
+    unsigned long i;
+
+    if (!b)
+        return -1;
+    for (i = 0; i < n_buckets; i++) {
+        for (cg = buckets[i]; cg; cg = next) {
+            next = cg->next;
+            cg->next = b[cg->hash & (n - 1)];
+            b[cg->hash & (n - 1)] = cg;
+        }
+    }
+    free(buckets);
+    buckets = b;
+    n_buckets = n;
+    return 0;
+}
+
+int
+registry_add (const void *session, const char *channel, game_tp game)
+{
+    unsigned long hash = registry_hash(session, channel);
+    struct channel_game **link = find(session, channel, hash);
+    struct channel_game *cg;
+
+    if (link && *link)
+        return -1;
+    if ((unsigned long) n_games >= n_buckets && grow() != 0)
+        return -1;
+
+    if (!(cg = malloc(sizeof *cg)))
+        return -1;
+    if (!(cg->channel = strdup(channel))) {
+        free(cg);
+        return -1;
+    }
+    cg->session = session;
+    cg->game = game;
+    cg->hash = hash;
+    cg->next = buckets[hash & (n_buckets - 1)];
+    buckets[hash & (n_buckets - 1)] = cg;
+    n_games++;
+    return 0;
+}
+
+game_tp
+registry_get (const void *session, const char *channel)
+{
+    struct channel_game **link;
+
+    if (!channel || !n_games)
+        return NULL;
+    link = find(session, channel, registry_hash(session, channel));
+    return *link ? (*link)->game : NULL;
+}
+
+game_tp
+registry_remove (const void *session, const char *channel)
+{
+    struct channel_game **link, *cg;
+    game_tp game;
+
+    if (!channel || !n_games)
+        return NULL;
+    link = find(session, channel, registry_hash(session, channel));
+    if (!(cg = *link))
+        return NULL;
+
+    *link = cg->next;
+    game = cg->game;
+    free(cg->channel);
+    free(cg);
+    n_games--;
+    return game;
+}
+
+void
+registry_foreach (void (*fn) (struct channel_game *, void *), void *data)
+{
+    struct channel_game *cg;
+    unsigned long i;
+
+    for (i = 0; i < n_buckets; i++)
+        for (cg = buckets[i]; cg; cg = cg->next)
+            fn(cg, data);
+}
+
+int
+registry_count (void)
+{
+    return n_games;
+}
+
+void
+registry_drop_session (const void *session, void (*fn) (game_tp))
+{
+    struct channel_game **link, *cg;
+    unsigned long i;
+
+    for (i = 0; i < n_buckets; i++) {
+        link = &buckets[i];
+        while ((cg = *link)) {
+            if (cg->session != session) {
+                link = &cg->next;
+                continue;
+            }
+            *link = cg->next;
+            if (fn)
+                fn(cg->game);
+            free(cg->channel);
+            free(cg);
+            n_games--;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "game.h"
+
+/* Which game is running on which channel.
+ *
+ * A hash table keyed by session and channel name. Channel names are
+ * compared the way IRC servers compare them (RFC 1459: "[]\^" are the
+ * upper case of "{}|~"), so "#Poker" and "#poker" are the same channel. The
+ * session is only ever compared, never dereferenced.
+ *
+ * Every thread sees a table of its own. */
+
+struct channel_game {
+    const void *session;
+    char *channel;
+    game_tp game;
+    unsigned long hash;
+    struct channel_game *next;      /* in the same bucket */
+};
+
+/* returns -1 if there already is a game on the channel */
+int registry_add (const void *session, const char *channel, game_tp game);
+game_tp registry_get (const void *session, const char *channel);
+/* forgets about the channel's game and returns it, or NULL if there was
+ * none. freeing it is up to the caller. */
+game_tp registry_remove (const void *session, const char *channel);
+/* fn may not add or remove games */
+void registry_foreach (void (*fn) (struct channel_game *, void *), void *data);
+int registry_count (void);
+/* what the table is keyed by. also picks the shard. */
+unsigned long registry_hash (const void *session, const char *channel);
+/* forgets every game on the session, passing each to fn (if not NULL).
+ * for when the connection is gone. */
+void registry_drop_session (const void *session, void (*fn) (game_tp));
+
+/* RFC 1459 case mapping */
+int irc_tolower (int c);
+int irc_casecmp (const char *a, const char *b);
+
+#endif
@@ -0,0 +1,96 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#include "rng.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+
+static int
+get_key (unsigned char *key, size_t len)
+{
+    /* fills key from the kernel's pool. returns 0 on success. */
+    ssize_t r;
+
+    while (len > 0) {
+        r = getrandom(key, len, 0);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        key += r;
+        len -= r;
+    }
+    return 0;
+}
+
+void
+rng_seed (rng_t *rng, const unsigned char *key, unsigned int key_length)
+{
+    int i;
+
+    rc4_init(&rng->rc4, key, key_length);
+
+    /* discard the start of the keystream, like a good boy */
+    for (i = 0; i < RC4_DROP; i++)
+        rc4_output(&rng->rc4);
+
+    rng->left = rng->interval;
+}
+
+void
+rng_init (rng_t *rng, unsigned long interval)
+{
+    unsigned char key[KEY_LEN];
+
+    rng->interval = interval;
+    if (get_key(key, KEY_LEN) != 0) {
+        fprintf(stderr, "ERROR: getrandom: %s. Refusing to deal.\n",
+                        strerror(errno));
+        exit(1);
+    }
+    rng_seed(rng, key, KEY_LEN);
+}
+
+void
+rng_bytes (rng_t *rng, unsigned char *buf, size_t n)
+{
+    unsigned char key[KEY_LEN];
+    size_t i;
+
+    if (rng->interval) {
+        if (rng->left < n) {
+            if (get_key(key, KEY_LEN) == 0)
+                rng_seed(rng, key, KEY_LEN);
+            else
+                log_msg(LOG_WARNING, "getrandom: %s. Not reseeding.",
+                        strerror(errno));
+            rng->left = rng->interval;
+        }
+        rng->left -= n < rng->left ? n : rng->left;
+    }
+
+    for (i = 0; i < n; i++)
+        buf[i] = rc4_output(&rng->rc4);
+}
+
+uint32_t
+rng_below (rng_t *rng, uint32_t n)
+{
+    /* the first 2^32 % n of the 32 bit numbers would make the low ones
+     * come up once more than the rest: skip them */
+    uint32_t skip = (uint32_t) -n % n;
+    unsigned char b[4];
+    uint32_t r;
+
+    do {
+        rng_bytes(rng, b, sizeof b);
+        r = (uint32_t) b[0] | (uint32_t) b[1] << 8 | (uint32_t) b[2] << 16
+            | (uint32_t) b[3] << 24;
+    } while (r < skip);
+    return r % n;
+}
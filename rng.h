@@ -0,0 +1,42 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef RNG_H
+#define RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KEY_LEN 32      /* bytes of getrandom() used to key RC4 */
+#define RC4_DROP 3072   /* keystream bytes thrown away after keying */
+
+/* bytes of keystream handed out before the stream is rekeyed from
+ * getrandom(). about 1000 shuffles. */
+#ifndef RESEED_INTERVAL
+#define RESEED_INTERVAL 65536
+#endif
+
+struct rc4 {
+    unsigned char S[256];
+    unsigned char i, j;
+};
+
+/* One stream per game, so nothing is shared between tables. */
+typedef struct rng {
+    struct rc4 rc4;
+    unsigned long left;     /* bytes until the next reseed */
+    unsigned long interval; /* bytes between reseeds, 0 for never */
+} rng_t;
+
+void rc4_init(struct rc4 *rc4, const unsigned char *key, unsigned int key_length);
+unsigned char rc4_output(struct rc4 *rc4);
+
+/* seeds from getrandom(). */
+void rng_init(rng_t *rng, unsigned long interval);
+/* seeds from key. same key, same stream (until the next reseed). */
+void rng_seed(rng_t *rng, const unsigned char *key, unsigned int key_length);
+void rng_bytes(rng_t *rng, unsigned char *buf, size_t n);
+/* uniform in 0..n-1, n > 0: draws that would favour the low numbers are
+ * thrown away, as in the shuffle */
+uint32_t rng_below(rng_t *rng, uint32_t n);
+
+#endif
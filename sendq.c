@@ -0,0 +1,230 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "sendq.h"
+#include "registry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct sendq_line {
+    struct sendq_line *next;
+    int len;
+    int solo;       /* never merged with others */
+    char text[];
+};
+
+struct sendq_target {
+    struct sendq_target *next;      /* in line for the next turn */
+    struct sendq_line *head, *tail;
+    char name[];
+};
+
+struct sendq {
+    void (*send) (void *, const char *, const char *);
+    void *arg;
+    double tokens, last;
+    int started;
+    int pending;    /* lines, all targets together */
+    /* targets with something to send, in the order they get their turn */
+    struct sendq_target *head, *tail;
+};
+
+struct sendq *
+sendq_new (void (*send) (void *, const char *, const char *), void *arg)
+{
+    struct sendq *q;
+
+    if (!(q = calloc(1, sizeof *q)))
+        return NULL;
+    q->send = send;
+    q->arg = arg;
+    q->tokens = SENDQ_BURST;
+    return q;
+}
+
+static void
+free_target (struct sendq_target *t)
+{
+    struct sendq_line *l, *next;
+
+    for (l = t->head; l; l = next) {
+        next = l->next;
+        free(l);
+    }
+    free(t);
+}
+
+void
+sendq_free (struct sendq *q)
+{
+    struct sendq_target *t, *next;
+
+    if (!q)
+        return;
+    for (t = q->head; t; t = next) {
+        next = t->next;
+        free_target(t);
+    }
+    free(q);
+}
+
+int
+sendq_room (const char *target)
+{
+    /* "PRIVMSG <target> :<text>\r\n" */
+    return SENDQ_LINE_MAX - SENDQ_PREFIX_MAX
+         - (int) (strlen("PRIVMSG ") + strlen(target) + strlen(" :") + 2);
+}
+
+static void
+push (struct sendq *q, const char *target, const char *text, int solo)
+{
+    struct sendq_target *t;
+    struct sendq_line *l;
+    int len = strlen(text);
+
+    /* only targets that have something waiting are on the list, and there
+     * are never many of those */
+    for (t = q->head; t; t = t->next)
+        if (irc_casecmp(t->name, target) == 0)
+            break;
+    if (!t) {
+        if (!(t = malloc(sizeof *t + strlen(target) + 1)))
+            return;
+        strcpy(t->name, target);
+        t->head = t->tail = NULL;
+        t->next = NULL;
+        if (q->tail)
+            q->tail->next = t;
+        else
+            q->head = t;
+        q->tail = t;
+    }
+
+    if (!(l = malloc(sizeof *l + len + 1)))
+        return;
+    memcpy(l->text, text, len + 1);
+    l->len = len;
+    l->solo = solo;
+    l->next = NULL;
+    if (t->tail)
+        t->tail->next = l;
+    else
+        t->head = l;
+    t->tail = l;
+    q->pending++;
+}
+
+void
+sendq_push (struct sendq *q, const char *target, const char *text)
+{
+    push(q, target, text, 0);
+}
+
+void
+sendq_push_solo (struct sendq *q, const char *target, const char *text)
+{
+    push(q, target, text, 1);
+}
+
+static void
+send_one (struct sendq *q, struct sendq_target *t)
+{
+    /* merges as many of t's lines as fit into one message. a line too long
+     * for a message of its own is cut, preferably at a space, and the rest
+     * waits for the next turn. */
+    char buf[SENDQ_LINE_MAX];
+    int room = sendq_room(t->name);
+    int sep = strlen(SENDQ_SEPARATOR);
+    int len = 0, cut, solo;
+    struct sendq_line *l;
+
+    if (room > (int) sizeof buf - 1)
+        room = sizeof buf - 1;
+    if (room < 1)
+        room = 1;
+
+    while ((l = t->head)) {
+        if (len == 0 && l->len > room) {
+            for (cut = room; cut > room / 2 && l->text[cut] != ' '; cut--);
+            if (l->text[cut] != ' ')
+                cut = room;
+            memcpy(buf, l->text, cut);
+            len = cut;
+            while (l->text[cut] == ' ')
+                cut++;
+            memmove(l->text, l->text + cut, l->len - cut + 1);
+            l->len -= cut;
+            break;
+        }
+        if (len > 0 && (l->solo || len + sep + l->len > room))
+            break;
+
+        if (len > 0) {
+            memcpy(buf + len, SENDQ_SEPARATOR, sep);
+            len += sep;
+        }
+        memcpy(buf + len, l->text, l->len);
+        len += l->len;
+
+        t->head = l->next;
+        solo = l->solo;
+        free(l);
+        q->pending--;
+        if (solo)
+            break;
+    }
+    if (!t->head)
+        t->tail = NULL;
+
+    buf[len] = '\0';
+    q->send(q->arg, t->name, buf);
+}
+
+double
+sendq_flush (struct sendq *q, double now)
+{
+    struct sendq_target *t;
+
+    if (!q->started) {
+        q->last = now;
+        q->started = 1;
+    }
+    q->tokens += (now - q->last) / SENDQ_INTERVAL;
+    if (q->tokens > SENDQ_BURST)
+        q->tokens = SENDQ_BURST;
+    q->last = now;
+
+    while (q->head && q->tokens >= 1) {
+        t = q->head;
+        q->head = t->next;
+        if (!q->head)
+            q->tail = NULL;
+
+        send_one(q, t);
+        q->tokens -= 1;
+
+        /* back of the line */
+        if (t->head) {
+            t->next = NULL;
+            if (q->tail)
+                q->tail->next = t;
+            else
+                q->head = t;
+            q->tail = t;
+        } else {
+            free(t);
+        }
+    }
+
+    if (!q->head)
+        return -1;
+    return (1 - q->tokens) * SENDQ_INTERVAL;
+}
+
+int
+sendq_pending (const struct sendq *q)
+{
+    return q->pending;
+}
@@ -0,0 +1,49 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef SENDQ_H
+#define SENDQ_H
+
+/* Outgoing messages, paced to stay clear of the server's flood limits.
+ *
+ * Lines wait in one queue per target. Targets take turns, one IRC line
+ * each, so one busy table can't hold up everybody else. When a target has
+ * several lines waiting, as many as fit go out as one message, separated
+ * by " | ". Lines are paid for from a token bucket: SENDQ_BURST of them
+ * right away, then one every SENDQ_INTERVAL seconds. */
+
+#ifndef SENDQ_BURST
+#define SENDQ_BURST 5
+#endif
+#ifndef SENDQ_INTERVAL
+#define SENDQ_INTERVAL 1.0
+#endif
+
+/* 512 bytes per line, CR LF included, and the server puts our
+ * nick!user@host in front of it for everybody else. Leave room for that. */
+#define SENDQ_LINE_MAX 512
+#define SENDQ_PREFIX_MAX 100
+#define SENDQ_SEPARATOR " | "
+
+struct sendq;
+
+/* send() gets each merged line. arg is passed through. */
+struct sendq *sendq_new (void (*send) (void *arg, const char *target,
+                                       const char *text),
+                         void *arg);
+void sendq_free (struct sendq *q);
+
+/* copies text */
+void sendq_push (struct sendq *q, const char *target, const char *text);
+/* a line that goes out on its own, like a line of a picture */
+void sendq_push_solo (struct sendq *q, const char *target, const char *text);
+/* sends what the bucket allows at time now (in seconds, any clock that
+ * doesn't jump). returns how long until there's more to do, or -1 if the
+ * queues are empty. */
+double sendq_flush (struct sendq *q, double now);
+int sendq_pending (const struct sendq *q);
+
+/* how much text fits into one message to target */
+int sendq_room (const char *target);
+
+#endif
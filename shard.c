@@ -0,0 +1,228 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "shard.h"
+#include "registry.h"
+#include "timer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * A mailbox is a locked list of tasks and a pipe. Like the pool's
+ * completion queue, only the first post since the last drain writes to
+ * the pipe. The lock is only ever held for a couple of pointer moves.
+ */
+
+struct mailbox {
+    pthread_mutex_t lock;
+    struct task *head, *tail;
+    int wake[2];
+    int signalled;
+};
+
+struct shard {
+    int id;
+    pthread_t thread;
+    struct mailbox inbox;
+    struct task stop;
+};
+
+static struct shard shards[MAX_SHARDS];
+static int n_shards = 0;
+static struct mailbox main_box = { .wake = { -1, -1 } };
+
+static __thread int this_shard = -1;
+static __thread int stopping = 0;
+
+static int
+mailbox_init (struct mailbox *mb)
+{
+    mb->head = mb->tail = NULL;
+    mb->signalled = 0;
+    if (pipe2(mb->wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("shard: pipe");
+        return -1;
+    }
+    pthread_mutex_init(&mb->lock, NULL);
+    return 0;
+}
+
+static void
+mailbox_free (struct mailbox *mb)
+{
+    close(mb->wake[0]);
+    close(mb->wake[1]);
+    mb->wake[0] = mb->wake[1] = -1;
+    pthread_mutex_destroy(&mb->lock);
+}
+
+static void
+mailbox_post (struct mailbox *mb, struct task *task)
+{
+    int wake;
+
+    task->next = NULL;
+    pthread_mutex_lock(&mb->lock);
+    if (mb->tail)
+        mb->tail->next = task;
+    else
+        mb->head = task;
+    mb->tail = task;
+    wake = !mb->signalled;
+    mb->signalled = 1;
+    pthread_mutex_unlock(&mb->lock);
+
+    if (wake && write(mb->wake[1], "", 1) < 0)
+        perror("shard: write");
+}
+
+static void
+mailbox_drain (struct mailbox *mb)
+{
+    char buf[64];
+    struct task *task, *next;
+
+    while (read(mb->wake[0], buf, sizeof buf) > 0);
+    pthread_mutex_lock(&mb->lock);
+    task = mb->head;
+    mb->head = mb->tail = NULL;
+    mb->signalled = 0;
+    pthread_mutex_unlock(&mb->lock);
+
+    for (; task; task = next) {
+        next = task->next;
+        task->run(task);
+    }
+}
+
+static void
+stop_shard (struct task *task)
+{
+    stopping = 1;
+}
+
+static void *
+shard_loop (void *arg)
+{
+    /* sleeps until there's mail or a timer is due */
+    struct shard *s = arg;
+    struct timer_wheel *timers = thread_timers();
+    struct pollfd pfd;
+    double wait;
+
+    this_shard = s->id;
+    pfd.fd = s->inbox.wake[0];
+    pfd.events = POLLIN;
+    while (!stopping) {
+        wait = timer_next(timers, timer_now());
+        if (poll(&pfd, 1, wait < 0 ? -1 : (int) (wait * 1000) + 1) < 0
+                && errno != EINTR) {
+            perror("shard: poll");
+            break;
+        }
+        mailbox_drain(&s->inbox);
+        timer_run(timers, timer_now());
+    }
+    return NULL;
+}
+
+int
+shards_start (int n)
+{
+    int i;
+
+    if (n > MAX_SHARDS)
+        n = MAX_SHARDS;
+    if (n <= 0)
+        return 0;
+    if (main_box.wake[0] < 0 && mailbox_init(&main_box) != 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        shards[i].id = i;
+        shards[i].stop.run = stop_shard;
+        if (mailbox_init(&shards[i].inbox) != 0)
+            break;
+        if (pthread_create(&shards[i].thread, NULL, shard_loop, &shards[i]) != 0) {
+            perror("shard: pthread_create");
+            mailbox_free(&shards[i].inbox);
+            break;
+        }
+    }
+    n_shards = i;
+    if (i < n) {
+        shards_stop();
+        return -1;
+    }
+    return 0;
+}
+
+void
+shards_stop (void)
+{
+    int i;
+
+    for (i = 0; i < n_shards; i++)
+        mailbox_post(&shards[i].inbox, &shards[i].stop);
+    for (i = 0; i < n_shards; i++) {
+        pthread_join(shards[i].thread, NULL);
+        mailbox_free(&shards[i].inbox);
+    }
+    n_shards = 0;
+}
+
+int
+shard_count (void)
+{
+    return n_shards ? n_shards : 1;
+}
+
+int
+shard_of (const void *session, const char *channel)
+{
+    if (n_shards == 0)
+        return 0;
+    return registry_hash(session, channel) % n_shards;
+}
+
+void
+shard_post (int shard, struct task *task)
+{
+    if (n_shards == 0)
+        task->run(task);
+    else
+        mailbox_post(&shards[shard % n_shards].inbox, task);
+}
+
+int
+current_shard (void)
+{
+    return this_shard;
+}
+
+void
+main_post (struct task *task)
+{
+    if (main_box.wake[0] < 0)
+        task->run(task);
+    else
+        mailbox_post(&main_box, task);
+}
+
+int
+main_mailbox_fd (void)
+{
+    return main_box.wake[0];
+}
+
+void
+main_drain (void)
+{
+    if (main_box.wake[0] >= 0)
+        mailbox_drain(&main_box);
+}
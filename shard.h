@@ -0,0 +1,45 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+/* Games, spread over event-loop threads.
+ *
+ * Every channel's game lives on one shard, picked by hashing the session
+ * and channel the way the registry does, and is only ever touched on that
+ * shard's thread, so the game code needs no locks. The registry has a
+ * table per thread for the same reason.
+ *
+ * The IRC thread owns the connections. It hands each line to its shard as
+ * a task, and the shards send back what they have to say the same way,
+ * through the IRC thread's own mailbox. Anything that concerns all games
+ * (a nick change, a lost server) is posted to every shard.
+ *
+ * Each shard also drives its thread's timer wheel (see timer.h), so a
+ * game's timers go off on the game's own thread. */
+
+#define MAX_SHARDS 64
+
+struct task {
+    void (*run) (struct task *);    /* on the receiving thread. frees it. */
+    struct task *next;
+};
+
+/* starts n shards, or none if n is 0: then tasks run right where they're
+ * posted. returns -1 on failure. */
+int shards_start (int n);
+/* runs whatever is still queued, then stops the threads */
+void shards_stop (void);
+int shard_count (void);
+int shard_of (const void *session, const char *channel);
+void shard_post (int shard, struct task *task);
+/* the shard running on this thread, or -1 */
+int current_shard (void);
+
+/* the IRC thread's mailbox */
+void main_post (struct task *task);
+int main_mailbox_fd (void);
+void main_drain (void);
+
+#endif
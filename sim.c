@@ -0,0 +1,113 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct equity_part {
+    struct job job;
+    struct equity_job *parent;
+    struct equity_query q;
+    struct equity_result res;
+    int failed;
+};
+
+static void
+merge_parts (struct equity_job *ej)
+{
+    /* weighs each part by the number of trials it managed */
+    struct equity_result *res = &ej->res;
+    int i, k;
+
+    memset(res, 0, sizeof *res);
+    res->exhaustive = ej->n_parts == 1 && ej->parts[0].res.exhaustive;
+    for (k = 0; k < ej->n_parts; k++) {
+        struct equity_part *part = &ej->parts[k];
+
+        if (part->failed) {
+            ej->failed = 1;
+            continue;
+        }
+        for (i = 0; i < ej->q.n_known; i++) {
+            res->win[i] += part->res.win[i] * part->res.trials;
+            res->tie[i] += part->res.tie[i] * part->res.trials;
+            res->equity[i] += part->res.equity[i] * part->res.trials;
+        }
+        res->trials += part->res.trials;
+    }
+    for (i = 0; i < ej->q.n_known && res->trials; i++) {
+        res->win[i] /= res->trials;
+        res->tie[i] /= res->trials;
+        res->equity[i] /= res->trials;
+    }
+}
+
+static void
+run_part (struct job *job, struct worker *w)
+{
+    struct equity_part *part = (struct equity_part *) job;
+    struct equity_job *ej = part->parent;
+
+    rng_bytes(worker_rng(w), (unsigned char *) &part->q.seed, sizeof part->q.seed);
+    part->failed = calc_equity(&part->q, &part->res) != 0;
+
+    if (__atomic_sub_fetch(&ej->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        merge_parts(ej);
+        pool_complete(&ej->job);
+    }
+}
+
+static void
+equity_done (struct job *job)
+{
+    struct equity_job *ej = (struct equity_job *) job;
+
+    ej->callback(ej);
+    free(ej->parts);
+    free(ej);
+}
+
+int
+submit_equity (const struct equity_query *q,
+               void (*callback) (struct equity_job *), void *data)
+{
+    struct equity_job *ej;
+    struct equity_part *parts;
+    double outcomes = count_outcomes(q);
+    int n, k;
+
+    if (!(ej = calloc(1, sizeof *ej)))
+        return -1;
+    ej->q = *q;
+    ej->callback = callback;
+    ej->data = data;
+    ej->job.done = equity_done;
+
+    /* counting can't be split up; neither can nonsense */
+    ej->n_parts = (outcomes < 0 || outcomes <= q->max_trials) ? 1 : pool_size();
+    if (!(ej->parts = calloc(ej->n_parts, sizeof *ej->parts))) {
+        free(ej);
+        return -1;
+    }
+    ej->pending = ej->n_parts;
+
+    for (k = 0; k < ej->n_parts; k++) {
+        struct equity_part *part = &ej->parts[k];
+
+        part->parent = ej;
+        part->q = *q;
+        if (ej->n_parts > 1)
+            part->q.max_trials = q->max_trials / ej->n_parts;
+        part->job.run = run_part;
+        part->job.done = NULL;
+    }
+    /* submit only once everything is set up, and don't touch ej after the
+     * last part is in: it may be done (and freed) by then. */
+    parts = ej->parts;
+    n = ej->n_parts;
+    for (k = 0; k < n; k++)
+        pool_submit(&parts[k].job);
+    return 0;
+}
@@ -0,0 +1,34 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "equity.h"
+#include "pool.h"
+
+/* Simulations, run on the worker pool. */
+
+struct equity_part;
+
+struct equity_job {
+    struct job job;
+    struct equity_query q;
+    struct equity_result res;
+    int failed;         /* calc_equity() said no */
+    /* called from pool_drain(). the job is freed afterwards. */
+    void (*callback) (struct equity_job *);
+    void *data;         /* for the callback */
+
+    int n_parts;
+    int pending;
+    struct equity_part *parts;
+};
+
+/* Samples are split evenly over all workers, each seeding from its own
+ * stream. When all outcomes get counted, one worker does it. returns -1
+ * if out of memory, in which case callback is never called. */
+int submit_equity (const struct equity_query *q,
+                   void (*callback) (struct equity_job *), void *data);
+
+#endif
@@ -0,0 +1,313 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "snapshot.h"
+#include "engine.h"
+#include "registry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FNV_BASIS 2166136261u
+
+static uint32_t
+fnv1a (const unsigned char *p, size_t n, uint32_t h)
+{
+    while (n--)
+        h = (h ^ *p++) * 16777619u;
+    return h;
+}
+
+static void
+copy_name (char *to, const char *from, size_t size)
+{
+    if (!from)
+        from = "";
+    strncpy(to, from, size - 1);
+    to[size - 1] = '\0';
+}
+
+void
+snapshot_table (game_tp g, struct snap_table *t)
+{
+    int in_hand = g->state != ENGINE_IDLE;
+    int i;
+
+    memset(t, 0, sizeof *t);
+    copy_name(t->server, g->server, sizeof t->server);
+    copy_name(t->channel, g->channel, sizeof t->channel);
+    t->hands = g->hands - in_hand;
+    t->small_blind = g->small_blind;
+    t->big_blind = g->big_blind;
+    t->betting_unit = g->betting_unit;
+    t->base_stock = g->base_stock;
+    t->big_cards = g->big_cards;
+    t->turn_seconds = g->turn_seconds;
+    t->variant = g->variant - variants;
+    t->button = g->button;
+    t->house = g->house ? g->house - g->players : -1;
+    t->n_seats = g->n_players;
+    for (i = 0; i < g->n_players; i++) {
+        player_t *p = &g->players[i];
+
+        copy_name(t->seats[i].nick, p->nick, sizeof t->seats[i].nick);
+        /* a hand that isn't over is called off */
+        t->seats[i].chips = p->chips + (in_hand ? p->committed : 0);
+        t->seats[i].active = p->active;
+    }
+}
+
+static int
+write_all (int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write(fd, p, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void
+sync_dir (const char *path)
+{
+    /* so the rename sticks, too */
+    char dir[1024];
+    char *slash;
+    int fd;
+
+    copy_name(dir, path, sizeof dir);
+    if ((slash = strrchr(dir, '/')))
+        *(slash == dir ? slash + 1 : slash) = '\0';
+    else
+        strcpy(dir, ".");
+    if ((fd = open(dir, O_RDONLY | O_CLOEXEC)) >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+void
+snapshot_stat (const char *server, const char *channel,
+               const struct player_stats *s, struct snap_stat *out)
+{
+    memset(out, 0, sizeof *out);
+    copy_name(out->server, server, sizeof out->server);
+    copy_name(out->channel, channel, sizeof out->channel);
+    memcpy(&out->stats, s, sizeof *s);
+}
+
+int
+snapshot_write (const char *path, const struct snap_table *tables, int n,
+                const struct snap_stat *stats, int n_stats, uint64_t taken)
+{
+    struct snap_header h;
+    char tmp[1024];
+    int fd;
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, SNAPSHOT_MAGIC, 8);
+    h.version = SNAPSHOT_VERSION;
+    h.table_size = sizeof *tables;
+    h.n_tables = n;
+    h.stat_size = sizeof *stats;
+    h.n_stats = n_stats;
+    h.sum = fnv1a((const unsigned char *) tables, n * sizeof *tables, FNV_BASIS);
+    h.sum = fnv1a((const unsigned char *) stats, n_stats * sizeof *stats, h.sum);
+    h.time = taken;
+
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+        perror(tmp);
+        return -1;
+    }
+    if (write_all(fd, &h, sizeof h) != 0
+            || write_all(fd, tables, n * sizeof *tables) != 0
+            || write_all(fd, stats, n_stats * sizeof *stats) != 0
+            || fsync(fd) != 0) {
+        perror(tmp);
+        close(fd);
+        unlink(tmp);
+        return -1;
+    }
+    close(fd);
+    if (rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        return -1;
+    }
+    sync_dir(path);
+    return 0;
+}
+
+int
+snapshot_open (const char *path, struct snapshot *s)
+{
+    const struct snap_header *h;
+    const unsigned char *body;
+    struct stat st;
+    size_t size;
+    void *m;
+    int fd;
+
+    memset(s, 0, sizeof *s);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        if (errno != ENOENT)
+            perror(path);
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof *h) {
+        fprintf(stderr, "WARNING: %s is too short for a snapshot.\n", path);
+        close(fd);
+        return -1;
+    }
+    /* private and writable: replaying changes our copy, not the file */
+    m = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+
+    h = m;
+    body = (const unsigned char *) (h + 1);
+    size = (size_t) h->n_tables * h->table_size
+           + (size_t) h->n_stats * h->stat_size;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, 8) != 0
+            || h->version != SNAPSHOT_VERSION
+            || h->table_size != sizeof (struct snap_table)
+            || h->stat_size != sizeof (struct snap_stat)
+            || (size_t) st.st_size != sizeof *h + size
+            || fnv1a(body, size, FNV_BASIS) != h->sum) {
+        fprintf(stderr, "WARNING: %s is no snapshot of mine.\n", path);
+        munmap(m, st.st_size);
+        return -1;
+    }
+
+    s->map = m;
+    s->size = st.st_size;
+    s->time = h->time;
+    s->n_tables = h->n_tables;
+    s->tables = (struct snap_table *) body;
+    s->n_stats = h->n_stats;
+    s->stats = (struct snap_stat *) (s->tables + s->n_tables);
+    return 0;
+}
+
+void
+snapshot_close (struct snapshot *s)
+{
+    if (s->map)
+        munmap(s->map, s->size);
+    memset(s, 0, sizeof *s);
+}
+
+struct replay {
+    struct snapshot *s;
+    int n_hands;
+    void (*fn) (const struct hand_record *, void *);
+    void *data;
+};
+
+static void
+replay_hand (const struct hand_record *r, void *data)
+{
+    /* players are only ever added at the end, so seats match by index */
+    struct replay *rp = data;
+    struct snap_table *t;
+    int i;
+
+    for (i = 0; i < rp->s->n_tables; i++) {
+        t = &rp->s->tables[i];
+        if (strcmp(t->server, r->server) == 0
+                && irc_casecmp(t->channel, r->channel) == 0)
+            break;
+    }
+    if (i == rp->s->n_tables) {
+        /* no table then, but maybe stats: anything dealt since is new */
+        if (r->time >= rp->s->time && rp->fn)
+            rp->fn(r, rp->data);
+        return;
+    }
+    if (r->hand <= t->hands)
+        return;
+    if (rp->fn)
+        rp->fn(r, rp->data);
+
+    for (i = 0; i < r->n_seats; i++) {
+        if (i >= t->n_seats) {
+            t->seats[i].active = 1;
+            t->n_seats = i + 1;
+        }
+        copy_name(t->seats[i].nick, r->seats[i].nick, sizeof t->seats[i].nick);
+        t->seats[i].chips = r->seats[i].chips_after;
+    }
+    t->hands = r->hand;
+    /* the button moves on after every hand. near enough: the next seat. */
+    t->button = r->n_seats ? (r->button + 1) % r->n_seats : 0;
+    rp->n_hands++;
+}
+
+int
+snapshot_replay (struct snapshot *s, const char *dir,
+                 void (*fn) (const struct hand_record *, void *), void *data)
+{
+    struct replay rp;
+
+    rp.s = s;
+    rp.n_hands = 0;
+    rp.fn = fn;
+    rp.data = data;
+    /* a hand dealt the day before may have ended after the snapshot */
+    history_scan(dir, s->time > 86400 ? s->time - 86400 : 0, replay_hand, &rp);
+    return rp.n_hands;
+}
+
+game_tp
+snapshot_restore (const struct snap_table *t)
+{
+    game_tp g;
+    int i, k;
+
+    if (!(g = new_game(0)))
+        return NULL;
+    if (!(g->channel = strdup(t->channel))) {
+        free_game(g);
+        return NULL;
+    }
+    g->small_blind = t->small_blind;
+    g->big_blind = t->big_blind;
+    g->betting_unit = t->betting_unit;
+    g->base_stock = t->base_stock;
+    g->big_cards = t->big_cards;
+    g->turn_seconds = t->turn_seconds;
+    if (t->variant >= 0 && t->variant < N_VARIANTS)
+        set_variant(g, &variants[t->variant]);
+    g->hands = t->hands;
+
+    for (i = 0; i < t->n_seats && i < MAX_PLAYERS; i++) {
+        if ((k = add_player(g, t->seats[i].nick)) < 0)
+            break;
+        g->players[k].chips = t->seats[i].chips;
+        g->players[k].active = t->seats[i].active;
+    }
+    if (t->house >= 0 && t->house < g->n_players)
+        g->house = &g->players[t->house];
+    if (t->button >= 0 && t->button < g->n_players)
+        g->button = t->button;
+    return g;
+}
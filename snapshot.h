@@ -0,0 +1,108 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "game.h"
+#include "history.h"
+#include "stats.h"
+
+/* Snapshots of every table, so a restart doesn't cost anybody their chips.
+ *
+ * A snapshot is a flat file: a header, one fixed-size record per table,
+ * then one per row of the stats (see stats.h), in the host's own byte
+ * order, so it can be mapped and used in place. It is written to a
+ * temporary file, fsynced and renamed over the old one: a crash leaves the
+ * old snapshot or the new one, never half.
+ *
+ * Its time is when the tables and the stats were taken, not when the file
+ * was written: a channel with no table in it gets every hand dealt since
+ * from the history.
+ *
+ * Chips are as of the last hand that's over. A hand still going on when
+ * the snapshot is taken is called off: everybody gets back what they'd put
+ * in. At startup, the tables and the stats catch up on every hand finished
+ * since, from the hand history, and the bot joins the channels again. */
+
+#define SNAPSHOT_MAGIC "ircpsnp1"
+#define SNAPSHOT_VERSION 3
+/* how often the bot takes one */
+#ifndef SNAPSHOT_SECONDS
+#define SNAPSHOT_SECONDS 60
+#endif
+
+struct snap_seat {
+    char nick[NICK_LEN];
+    int32_t chips;
+    int32_t active;
+};
+
+struct snap_table {
+    char server[HOST_LEN];
+    char channel[HISTORY_CHANNEL_LEN];
+    uint32_t hands;             /* all of which are in the chips */
+    int32_t small_blind, big_blind;
+    int32_t betting_unit, base_stock;
+    int32_t big_cards, turn_seconds;
+    int32_t variant;            /* an enum variant_id */
+    int32_t button;
+    int32_t house;              /* a seat, or -1 */
+    int32_t n_seats;
+    struct snap_seat seats[MAX_PLAYERS];
+};
+
+/* a channel's rows come one after the other */
+struct snap_stat {
+    char server[HOST_LEN];
+    char channel[HISTORY_CHANNEL_LEN];
+    struct player_stats stats;
+};
+
+struct snap_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t table_size;        /* sizeof (struct snap_table) */
+    uint32_t n_tables;
+    uint32_t stat_size;         /* sizeof (struct snap_stat) */
+    uint32_t n_stats;
+    uint32_t sum;               /* FNV-1a of the tables and the stats */
+    uint64_t time;              /* Unix time */
+};
+
+struct snapshot {
+    void *map;
+    size_t size;
+    uint64_t time;
+    int n_tables;
+    struct snap_table *tables;  /* in the map. private: changes are ours. */
+    int n_stats;
+    struct snap_stat *stats;
+};
+
+/* a game into its record */
+void snapshot_table (game_tp g, struct snap_table *t);
+/* a row of stats into its record */
+void snapshot_stat (const char *server, const char *channel,
+                    const struct player_stats *s, struct snap_stat *out);
+/* taken: Unix time, from before any of it was. returns 0, or -1 after
+ * complaining */
+int snapshot_write (const char *path, const struct snap_table *tables, int n,
+                    const struct snap_stat *stats, int n_stats, uint64_t taken);
+
+/* returns 0, or -1 if there's no snapshot there, or it's no good */
+int snapshot_open (const char *path, struct snapshot *s);
+void snapshot_close (struct snapshot *s);
+/* plays back every hand the history in dir has on the snapshot's tables
+ * since it was taken, and passes each hand since, on any channel, to fn
+ * (if not NULL) for the stats. returns the number of hands. */
+int snapshot_replay (struct snapshot *s, const char *dir,
+                     void (*fn) (const struct hand_record *, void *),
+                     void *data);
+/* a new game from a record. session and server are up to the caller. */
+game_tp snapshot_restore (const struct snap_table *t);
+
+#endif
@@ -0,0 +1,457 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "stats.h"
+#include "engine.h"
+#include "registry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* chained, a fixed number of buckets: a thread has a few dozen channels */
+#define STATS_BUCKETS 64
+#define MIN_ROWS 16
+
+struct chan_stats {
+    struct chan_stats *next;        /* in the same bucket */
+    const void *session;
+    const char *server;
+    char *channel;
+    int n, cap;
+    /* the columns, cap long */
+    char (*nick)[NICK_LEN];
+    uint32_t *hands, *vpip, *raised, *won;
+    int64_t *net;
+    int32_t *biggest_pot;
+    /* the leaderboard: every row's next row on each level, -1 at the end */
+    int (*link)[STATS_LEVELS];
+    int head[STATS_LEVELS];
+    unsigned rnd;
+    /* nick -> row + 1, 0 for none: open addressing, 2 * cap of them */
+    int *slot;
+};
+
+static __thread struct chan_stats *buckets[STATS_BUCKETS];
+static __thread int n_rows;
+
+void
+tally_begin (struct hand_tally *t, game_tp g)
+{
+    int i;
+
+    memset(t, 0, sizeof *t);
+    t->n_seats = g->n_players;
+    for (i = 0; i < g->n_players; i++) {
+        memcpy(t->nick[i], g->players[i].nick, NICK_LEN);
+        t->chips[i] = g->players[i].chips;
+    }
+}
+
+void
+tally_event (struct hand_tally *t, const struct event *e)
+{
+    seatmask_t bit = e->player >= 0 && e->player < MAX_PLAYERS
+                     ? SEAT_BIT(e->player) : 0;
+
+    switch (e->type) {
+        case EV_DEALT:
+            t->dealt |= bit;
+            break;
+        case EV_RAISE:
+            if (t->street == 0)
+                t->raised |= bit;
+            /* fall through */
+        case EV_CALL:
+        case EV_ALL_IN:
+            if (t->street == 0)
+                t->vpip |= bit;
+            break;
+        case EV_STREET:
+            t->street = e->amount;
+            break;
+        case EV_WIN:
+        case EV_AWARD:
+            if (bit) {
+                t->won |= bit;
+                t->pot_won[e->player] += e->amount;
+            }
+            break;
+    }
+}
+
+void
+tally_end (struct hand_tally *t, game_tp g)
+{
+    int i;
+
+    for (i = 0; i < t->n_seats && i < g->n_players; i++)
+        t->chips_after[i] = g->players[i].chips;
+}
+
+void
+tally_record (struct hand_tally *t, const struct hand_record *r)
+{
+    int i;
+
+    memset(t, 0, sizeof *t);
+    t->n_seats = r->n_seats;
+    for (i = 0; i < r->n_seats; i++) {
+        memcpy(t->nick[i], r->seats[i].nick, NICK_LEN);
+        t->chips[i] = r->seats[i].chips;
+        t->chips_after[i] = r->seats[i].chips_after;
+    }
+    for (i = 0; i < r->n_events; i++)
+        tally_event(t, &r->events[i]);
+}
+
+void
+stats_begin (game_tp g)
+{
+    if (!g->channel)
+        return;
+    if (!g->tally && !(g->tally = malloc(sizeof *g->tally)))
+        return;
+    tally_begin(g->tally, g);
+}
+
+void
+stats_event (game_tp g, const struct event *e)
+{
+    if (g->tally)
+        tally_event(g->tally, e);
+}
+
+void
+stats_end (game_tp g)
+{
+    if (!g->tally)
+        return;
+    tally_end(g->tally, g);
+    stats_add(g->session, g->server, g->channel, g->tally);
+}
+
+static unsigned
+nick_hash (const char *nick)
+{
+    /* FNV-1a, folded */
+    unsigned h = 2166136261u;
+
+    while (*nick) {
+        h ^= irc_tolower((unsigned char) *nick++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int *
+nick_slot (struct chan_stats *cs, const char *nick)
+{
+    /* the slot holding nick, or the empty one where it would go */
+    unsigned mask = 2 * cs->cap - 1;
+    unsigned i = nick_hash(nick) & mask;
+
+    while (cs->slot[i] && irc_casecmp(cs->nick[cs->slot[i] - 1], nick) != 0)
+        i = (i + 1) & mask;
+    return &cs->slot[i];
+}
+
+static struct chan_stats **
+find (const void *session, const char *channel)
+{
+    struct chan_stats **link;
+
+    link = &buckets[registry_hash(session, channel) & (STATS_BUCKETS - 1)];
+    for (; *link; link = &(*link)->next)
+        if ((*link)->session == session && irc_casecmp((*link)->channel, channel) == 0)
+            break;
+    return link;
+}
+
+#define GROW(col, cap) \
+    ((p = realloc(cs->col, (cap) * sizeof *cs->col)) ? (cs->col = p, 0) : -1)
+
+static int
+grow (struct chan_stats *cs)
+{
+    int cap = cs->cap ? 2 * cs->cap : MIN_ROWS;
+    int *slot;
+    void *p;
+    int i;
+
+    if (GROW(nick, cap) || GROW(hands, cap) || GROW(vpip, cap)
+            || GROW(raised, cap) || GROW(won, cap) || GROW(net, cap)
+            || GROW(biggest_pot, cap) || GROW(link, cap))
+        return -1;
+    if (!(slot = calloc(2 * cap, sizeof *slot)))
+        return -1;
+    free(cs->slot);
+    cs->slot = slot;
+    cs->cap = cap;
+    for (i = 0; i < cs->n; i++)
+        *nick_slot(cs, cs->nick[i]) = i + 1;
+    return 0;
+}
+
+static struct chan_stats *
+get_table (const void *session, const char *server, const char *channel)
+{
+    struct chan_stats **link = find(session, channel);
+    struct chan_stats *cs;
+    int i;
+
+    if (*link)
+        return *link;
+    if (!(cs = calloc(1, sizeof *cs)))
+        return NULL;
+    if (!(cs->channel = strdup(channel)) || grow(cs) != 0) {
+        free(cs->channel);
+        free(cs);
+        return NULL;
+    }
+    cs->session = session;
+    cs->server = server;
+    cs->rnd = 2463534242u;
+    for (i = 0; i < STATS_LEVELS; i++)
+        cs->head[i] = -1;
+    *link = cs;
+    return cs;
+}
+
+static void
+free_table (struct chan_stats *cs)
+{
+    n_rows -= cs->n;
+    free(cs->nick);
+    free(cs->hands);
+    free(cs->vpip);
+    free(cs->raised);
+    free(cs->won);
+    free(cs->net);
+    free(cs->biggest_pot);
+    free(cs->link);
+    free(cs->slot);
+    free(cs->channel);
+    free(cs);
+}
+
+/* the leaderboard. a row goes before another with more chips won, or as
+ * many but a later row. */
+
+static int
+goes_before (const struct chan_stats *cs, int a, int b)
+{
+    if (cs->net[a] != cs->net[b])
+        return cs->net[a] > cs->net[b];
+    return a < b;
+}
+
+static int *
+next_of (struct chan_stats *cs, int row, int level)
+{
+    return row < 0 ? &cs->head[level] : &cs->link[row][level];
+}
+
+static void
+board_remove (struct chan_stats *cs, int row)
+{
+    /* before its chips change: they're what it's found by */
+    int level, cur = -1, nx;
+
+    for (level = STATS_LEVELS - 1; level >= 0; level--) {
+        while ((nx = *next_of(cs, cur, level)) >= 0 && goes_before(cs, nx, row))
+            cur = nx;
+        if (nx == row)
+            *next_of(cs, cur, level) = cs->link[row][level];
+    }
+}
+
+static void
+board_insert (struct chan_stats *cs, int row)
+{
+    int level, height = 1, cur = -1, nx;
+
+    /* one level up for every other pair of bits: a quarter of the rows
+     * make it to the next level */
+    cs->rnd ^= cs->rnd << 13;
+    cs->rnd ^= cs->rnd >> 17;
+    cs->rnd ^= cs->rnd << 5;
+    while (height < STATS_LEVELS && ((cs->rnd >> (2 * height)) & 3) == 0)
+        height++;
+
+    for (level = STATS_LEVELS - 1; level >= 0; level--) {
+        while ((nx = *next_of(cs, cur, level)) >= 0 && goes_before(cs, nx, row))
+            cur = nx;
+        if (level < height) {
+            cs->link[row][level] = nx;
+            *next_of(cs, cur, level) = row;
+        } else {
+            cs->link[row][level] = -1;
+        }
+    }
+}
+
+static int
+get_row (struct chan_stats *cs, const char *nick)
+{
+    int *slot = nick_slot(cs, nick);
+    int row;
+
+    if (*slot)
+        return *slot - 1;
+    if (cs->n == cs->cap) {
+        if (grow(cs) != 0)
+            return -1;
+        slot = nick_slot(cs, nick);
+    }
+    row = cs->n++;
+    n_rows++;
+    memset(cs->nick[row], 0, NICK_LEN);
+    strncpy(cs->nick[row], nick, NICK_LEN - 1);
+    cs->hands[row] = cs->vpip[row] = cs->raised[row] = cs->won[row] = 0;
+    cs->net[row] = 0;
+    cs->biggest_pot[row] = 0;
+    *slot = row + 1;
+    board_insert(cs, row);
+    return row;
+}
+
+static void
+set_net (struct chan_stats *cs, int row, int64_t net)
+{
+    if (cs->net[row] == net)
+        return;
+    board_remove(cs, row);
+    cs->net[row] = net;
+    board_insert(cs, row);
+}
+
+int
+stats_add (const void *session, const char *server, const char *channel,
+           const struct hand_tally *t)
+{
+    struct chan_stats *cs;
+    int i, row;
+
+    if (!(cs = get_table(session, server, channel)))
+        return -1;
+    for (i = 0; i < t->n_seats; i++) {
+        if (!(t->dealt & SEAT_BIT(i)))
+            continue;
+        if ((row = get_row(cs, t->nick[i])) < 0)
+            return -1;
+        cs->hands[row]++;
+        cs->vpip[row] += !!(t->vpip & SEAT_BIT(i));
+        cs->raised[row] += !!(t->raised & SEAT_BIT(i));
+        cs->won[row] += !!(t->won & SEAT_BIT(i));
+        if (t->pot_won[i] > cs->biggest_pot[row])
+            cs->biggest_pot[row] = t->pot_won[i];
+        set_net(cs, row, cs->net[row] + t->chips_after[i] - t->chips[i]);
+    }
+    return 0;
+}
+
+static void
+get_stats (const struct chan_stats *cs, int row, struct player_stats *s)
+{
+    memset(s, 0, sizeof *s);        /* the padding too: it goes into snapshots */
+    memcpy(s->nick, cs->nick[row], NICK_LEN);
+    s->hands = cs->hands[row];
+    s->vpip = cs->vpip[row];
+    s->raised = cs->raised[row];
+    s->won = cs->won[row];
+    s->net = cs->net[row];
+    s->biggest_pot = cs->biggest_pot[row];
+}
+
+int
+stats_get (const void *session, const char *channel, const char *nick,
+           struct player_stats *s)
+{
+    struct chan_stats *cs = *find(session, channel);
+    int *slot;
+
+    if (!cs || !*(slot = nick_slot(cs, nick)))
+        return -1;
+    get_stats(cs, *slot - 1, s);
+    return 0;
+}
+
+int
+stats_top (const void *session, const char *channel,
+           struct player_stats top[], int n)
+{
+    struct chan_stats *cs = *find(session, channel);
+    int i, row;
+
+    if (!cs)
+        return 0;
+    for (i = 0, row = cs->head[0]; i < n && row >= 0; i++, row = cs->link[row][0])
+        get_stats(cs, row, &top[i]);
+    return i;
+}
+
+void
+stats_foreach (void (*fn) (const char *server, const char *channel,
+                           const struct player_stats *s, void *data),
+               void *data)
+{
+    struct player_stats s;
+    struct chan_stats *cs;
+    int i, row;
+
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        for (cs = buckets[i]; cs; cs = cs->next) {
+            for (row = 0; row < cs->n; row++) {
+                get_stats(cs, row, &s);
+                fn(cs->server, cs->channel, &s, data);
+            }
+        }
+    }
+}
+
+int
+stats_count (void)
+{
+    return n_rows;
+}
+
+int
+stats_restore (const void *session, const char *server, const char *channel,
+               const struct player_stats rows[], int n)
+{
+    struct chan_stats *cs;
+    int i, row;
+
+    if (!(cs = get_table(session, server, channel)))
+        return -1;
+    for (i = 0; i < n; i++) {
+        if ((row = get_row(cs, rows[i].nick)) < 0)
+            return -1;
+        cs->hands[row] = rows[i].hands;
+        cs->vpip[row] = rows[i].vpip;
+        cs->raised[row] = rows[i].raised;
+        cs->won[row] = rows[i].won;
+        cs->biggest_pot[row] = rows[i].biggest_pot;
+        set_net(cs, row, rows[i].net);
+    }
+    return 0;
+}
+
+void
+stats_drop_session (const void *session)
+{
+    struct chan_stats **link, *cs;
+    int i;
+
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        link = &buckets[i];
+        while ((cs = *link)) {
+            if (cs->session == session) {
+                *link = cs->next;
+                free_table(cs);
+            } else {
+                link = &cs->next;
+            }
+        }
+    }
+}
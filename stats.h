@@ -0,0 +1,85 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "game.h"
+#include "history.h"
+
+/* Who's been playing how, per channel.
+ *
+ * Every channel has a table with a row per nick that was ever dealt in
+ * there, kept as columns: one array per number, so going over a column
+ * touches nothing else. Nicks are compared like channels (see registry.h).
+ * Each hand adds itself when it's over; nothing is ever worked out from
+ * the history again.
+ *
+ * The leaderboard is a skip list over the rows, most chips won first, that
+ * a row moves in whenever its chips change: the top N are the first N
+ * rows on its lowest level.
+ *
+ * Like the registry, every thread has its own tables, so a channel's stats
+ * are where its game is. They outlast the game, and go into the snapshot
+ * (see snapshot.h). */
+
+#define STATS_LEVELS 16     /* enough for 4^16 rows */
+
+/* one hand, as far as the stats care: from the engine as it's played, or
+ * from a record in the history */
+struct hand_tally {
+    int n_seats;
+    char nick[MAX_PLAYERS][NICK_LEN];
+    int chips[MAX_PLAYERS], chips_after[MAX_PLAYERS];
+    int pot_won[MAX_PLAYERS];       /* all they took down */
+    seatmask_t dealt;
+    seatmask_t vpip;                /* put chips in before the flop, blinds aside */
+    seatmask_t raised;              /* raised before the flop */
+    seatmask_t won;
+    int street;                     /* community cards so far */
+};
+
+void tally_begin (struct hand_tally *t, game_tp g);     /* before the blinds */
+void tally_event (struct hand_tally *t, const struct event *e);
+void tally_end (struct hand_tally *t, game_tp g);
+void tally_record (struct hand_tally *t, const struct hand_record *r);
+
+/* a nick's row */
+struct player_stats {
+    char nick[NICK_LEN];
+    uint32_t hands;
+    uint32_t vpip, raised;          /* hands, see struct hand_tally */
+    uint32_t won;
+    int64_t net;                    /* chips won, less chips lost */
+    int32_t biggest_pot;
+};
+
+/* for the engine. they do nothing for games nobody is watching. */
+void stats_begin (game_tp g);
+void stats_event (game_tp g, const struct event *e);
+void stats_end (game_tp g);
+
+/* the hand into the channel's table. server has to stay put. returns -1 if
+ * there's no memory for it. */
+int stats_add (const void *session, const char *server, const char *channel,
+               const struct hand_tally *t);
+/* returns 0, or -1 if the nick has never played there */
+int stats_get (const void *session, const char *channel, const char *nick,
+               struct player_stats *s);
+/* the first n on the leaderboard. returns how many there are. */
+int stats_top (const void *session, const char *channel,
+               struct player_stats top[], int n);
+
+/* every row on this thread, a channel's rows one after the other */
+void stats_foreach (void (*fn) (const char *server, const char *channel,
+                                const struct player_stats *s, void *data),
+                    void *data);
+int stats_count (void);
+/* rows back into the channel's table, replacing any with the same nick */
+int stats_restore (const void *session, const char *server,
+                   const char *channel, const struct player_stats rows[], int n);
+/* forgets the session's tables, for when the connection is gone */
+void stats_drop_session (const void *session);
+
+#endif
@@ -0,0 +1,100 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the card atlas has to give back exactly what's in cards/ */
+
+#include <stdio.h>
+#include <string.h>
+#include "atlas.h"
+
+static int failed = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+int read_line(const char *path, int n, char *buf, int size)
+{
+    /* line n of the file, without the newline */
+    FILE *f = fopen(path, "rb");
+    int i, len;
+
+    if (!f)
+        return -1;
+    for (i = 0; i <= n; i++) {
+        if (!fgets(buf, size, f)) {
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    len = strcspn(buf, "\r\n");
+    buf[len] = '\0';
+    return len;
+}
+
+int main()
+{
+    pcard_t board[5] = { PCARD(HEARTS, 12), PCARD(SPADES, 11), ATLAS_BACK,
+                         PCARD(CLUBS, 0), PCARD(DIAMONDS, 8) };
+    const char *files[5] = { "cards/h01.txt", "cards/s13.txt", "cards/back.txt",
+                             "cards/c02.txt", "cards/d10.txt" };
+    char row[1024], want[1024], line[256];
+    FILE *f;
+    int i, j, len;
+
+    if (atlas_open(ATLAS_PATH) != 0) {
+        puts("cannot open " ATLAS_PATH "  FAIL");
+        return 1;
+    }
+    expect("height", atlas_height() == 12);
+
+    for (i = 0; i < atlas_height(); i++) {
+        want[0] = '\0';
+        for (j = 0; j < 5; j++) {
+            if (read_line(files[j], i, line, sizeof line) < 0)
+                break;
+            strcat(want, line);
+        }
+        len = atlas_row(row, sizeof row, 0, board, 5, i);
+        if (j < 5 || strcmp(row, want) != 0 || len != (int) strlen(want)) {
+            printf("line %d: ", i);
+            expect("row matches the files", 0);
+        }
+    }
+
+    /* only whole cards */
+    read_line(files[0], 1, line, sizeof line);
+    len = atlas_row(row, strlen(line) + 10, 0, board, 5, 1);
+    expect("stops at a whole card", len == (int) strlen(line));
+    expect("no such line", atlas_row(row, sizeof row, 0, board, 5, 12) == 0);
+
+    /* anything else gets turned down */
+    if ((f = fopen("testatlas.tmp", "wb"))) {
+        fputs("ircpatl1 but not really", f);
+        fclose(f);
+        expect("damaged atlas", atlas_open("testatlas.tmp") != 0);
+        expect("closed", atlas_height() == 0);
+        remove("testatlas.tmp");
+    }
+    if ((f = fopen("testatlas.tmp", "wb"))) {
+        /* a good header, and nothing after it */
+        struct atlas_header h;
+
+        memcpy(h.magic, ATLAS_MAGIC, 8);
+        h.n_glyphs = ATLAS_GLYPHS;
+        h.n_lines = 12;
+        h.size = sizeof h;
+        fwrite(&h, sizeof h, 1, f);
+        fclose(f);
+        expect("no room for the offsets", atlas_open("testatlas.tmp") != 0);
+        remove("testatlas.tmp");
+    }
+    atlas_close();
+
+    return failed;
+}
@@ -0,0 +1,75 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the server list: comments and blank lines are skipped, bad ports, shard
+ * counts and unknown lines are refused. */
+
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "log.h"
+
+static int failed = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+int try(const char *text, struct config *conf)
+{
+    static struct config zero;
+    const char *path = "testconfig.tmp";
+    FILE *f = fopen(path, "w");
+    int r;
+
+    fputs(text, f);
+    fclose(f);
+    *conf = zero;
+    r = read_config(path, conf);
+    remove(path);
+    return r;
+}
+
+int main()
+{
+    struct config conf;
+
+    expect("two servers",
+           try("# tables\n\nserver irc.one.net 6667 poker\n"
+               "  server\tirc.two.net 7000 dealer  # the other one\n",
+               &conf) == 0 && conf.n_servers == 2);
+    expect("host", strcmp(conf.servers[1].host, "irc.two.net") == 0);
+    expect("port", conf.servers[1].port == 7000);
+    expect("nick", strcmp(conf.servers[0].nick, "poker") == 0);
+    expect("no shards given", conf.n_shards == 0);
+    expect("no history given", conf.history[0] == '\0');
+    expect("no snapshot given", conf.snapshot[0] == '\0');
+    expect("no log level given", conf.log_level == 0);
+
+    expect("shards", try("shards 4\nserver irc.one.net 6667 poker\n", &conf) == 0
+                     && conf.n_shards == 4);
+    expect("history", try("history /var/hands\nserver irc.one.net 6667 poker\n", &conf) == 0
+                      && strcmp(conf.history, "/var/hands") == 0);
+    expect("snapshot", try("snapshot /var/tables\nserver irc.one.net 6667 poker\n", &conf) == 0
+                       && strcmp(conf.snapshot, "/var/tables") == 0
+                       && conf.history[0] == '\0');
+    expect("metrics", try("metrics /var/ircpoker.prom\nserver irc.one.net 6667 poker\n", &conf) == 0
+                      && strcmp(conf.metrics, "/var/ircpoker.prom") == 0);
+    expect("log level", try("log debug\nserver irc.one.net 6667 poker\n", &conf) == 0
+                        && conf.log_level == LOG_DEBUG);
+    expect("no such log level", try("log loud\nserver irc.one.net 6667 poker\n", &conf) != 0);
+    expect("no shards", try("shards 0\nserver irc.one.net 6667 poker\n", &conf) != 0);
+
+    expect("port 0", try("server irc.one.net 0 poker\n", &conf) != 0);
+    expect("port 65536", try("server irc.one.net 65536 poker\n", &conf) != 0);
+    expect("not a port", try("server irc.one.net 66x7 poker\n", &conf) != 0);
+    expect("missing nick", try("server irc.one.net 6667\n", &conf) != 0);
+    expect("unknown line", try("channel #poker\n", &conf) != 0);
+    expect("empty", try("# nothing\n", &conf) != 0);
+
+    return failed;
+}
@@ -1,11 +1,11 @@
 /* Copyright 2011 Tuna <tuna@supertunaman.com
  * This code is under the Chicken Dance License v0.1 */
 #include <stdio.h>
-#include <sys/time.h>
-#include <sys/resource.h>
+#include <string.h>
 #include "deck.h"
 #include "game.h"
 #include "hand.h"
+#include "pot.h"
 
 static game_tp testgame;
 
@@ -18,15 +18,6 @@ void deal_cards()
     }
 }
 
-double get_time()
-{
-    /* used for benchmarking */
-    struct timeval t;
-    struct timezone tz;
-    gettimeofday(&t, &tz);
-    return t.tv_sec + t.tv_usec*1e-6;
-}
-
 void print_community()
 {
     /* pretty prints the community hand */
@@ -35,18 +26,18 @@ void print_community()
     printf("Community has: ");
     for (i = 0; i < 5; i++)
     {
-        switch (testgame->community[i].suit) {
+        switch (card_unpack(testgame->community[i]).suit) {
             case CLUBS:
-                printf("%d of Clubs", testgame->community[i].value);
+                printf("%d of Clubs", card_unpack(testgame->community[i]).value);
                 break;
             case DIAMONDS:
-                printf("%d of Diamonds", testgame->community[i].value);
+                printf("%d of Diamonds", card_unpack(testgame->community[i]).value);
                 break;
             case HEARTS:
-                printf("%d of Hearts", testgame->community[i].value);
+                printf("%d of Hearts", card_unpack(testgame->community[i]).value);
                 break;
             case SPADES:
-                printf("%d of Spades", testgame->community[i].value);
+                printf("%d of Spades", card_unpack(testgame->community[i]).value);
                 break;
         }
         if (i < 4)
@@ -96,18 +87,18 @@ void print_deck()
     int i;
     for (i=0; i<52; i++)
     {
-        switch (testgame->deck[i].suit) {
+        switch (card_unpack(testgame->deck[i]).suit) {
             case CLUBS:
-                printf("%d of Clubs\n", testgame->deck[i].value);
+                printf("%d of Clubs\n", card_unpack(testgame->deck[i]).value);
                 break;
             case DIAMONDS:
-                printf("%d of Diamonds\n", testgame->deck[i].value);
+                printf("%d of Diamonds\n", card_unpack(testgame->deck[i]).value);
                 break;
             case HEARTS:
-                printf("%d of Hearts\n", testgame->deck[i].value);
+                printf("%d of Hearts\n", card_unpack(testgame->deck[i]).value);
                 break;
             case SPADES:
-                printf("%d of Spades\n", testgame->deck[i].value);
+                printf("%d of Spades\n", card_unpack(testgame->deck[i]).value);
                 break;
         }
     }
@@ -123,18 +114,18 @@ void print_hands()
         printf("Player %d has ", i);
         for (c = 0; c < 2; c++)
         {
-            switch (testgame->players[i].hand[c].suit) {
+            switch (card_unpack(testgame->players[i].hand[c]).suit) {
                 case CLUBS:
-                    printf("%02d of Clubs ", testgame->players[i].hand[c].value);
+                    printf("%02d of Clubs ", card_unpack(testgame->players[i].hand[c]).value);
                     break;
                 case DIAMONDS:
-                    printf("%02d of Diamonds ", testgame->players[i].hand[c].value);
+                    printf("%02d of Diamonds ", card_unpack(testgame->players[i].hand[c]).value);
                     break;
                 case HEARTS:
-                    printf("%02d of Hearts ", testgame->players[i].hand[c].value);
+                    printf("%02d of Hearts ", card_unpack(testgame->players[i].hand[c]).value);
                     break;
                 case SPADES:
-                    printf("%02d of Spades ", testgame->players[i].hand[c].value);
+                    printf("%02d of Spades ", card_unpack(testgame->players[i].hand[c]).value);
                     break;
             }
             if (c < 1) { printf("and "); }
@@ -176,11 +167,87 @@ void print_hands()
     }
 }
 
+int check_seats()
+{
+    /* seating by nick, on a separate table */
+    game_tp g = new_game(0);
+    char nick[NICK_LEN];
+    int i, failed = 0;
+
+    for (i = 0; i < MAX_PLAYERS; i++) {
+        sprintf(nick, "player%d", i);
+        failed |= add_player(g, nick) != i;
+    }
+    failed |= add_player(g, "latecomer") != -1;
+    failed |= add_player(g, "player3") != 3;
+    failed |= find_player(g, "player17") != 17;
+    failed |= find_player(g, "Player17") != -1;
+    failed |= rename_player(g, "player17", "newnick") != 17;
+    failed |= find_player(g, "player17") != -1;
+    failed |= find_player(g, "newnick") != 17;
+    failed |= find_player(g, "player5") != 5;
+    free_game(g);
+
+    puts(failed ? "Seating by nick: FAIL" : "Seating by nick: OK");
+    return failed;
+}
+
+int check_glyphs()
+{
+    pcard_t cards[3] = { PCARD(HEARTS, 12), PCARD(CLUBS, 8), PCARD(SPADES, 0) };
+    char buf[CARDS_STR_MAX(3)];
+    int failed = 0, len;
+
+    len = append_cards(buf, sizeof buf, 0, cards, 3, 0, 0);
+    failed |= strcmp(buf, " A Hearts 10 Clubs  2 Spades") != 0;
+    failed |= len != (int) strlen(buf);
+    failed |= strcmp(irc_print_card(cards[0], 1, 1), "\x03" "4  A\xe2\x99\xa5\x03") != 0;
+    /* doesn't fit: stops after a whole card */
+    len = append_cards(buf, 12, 0, cards, 3, 0, 0);
+    failed |= strcmp(buf, " A Hearts") != 0;
+
+    puts(failed ? "Card glyphs: FAIL" : "Card glyphs: OK");
+    return failed;
+}
+
+int check_pots()
+{
+    /* three players bet, one can't cover: a side pot splits off. the
+     * chips all have to end up somewhere, every hand. */
+    game_tp g = new_game(3);
+    int hand, i, total, failed = 0;
+
+    for (hand = 0; hand < 3; hand++) {
+        new_hand(g);
+        for (i = 0; i < 3; i++) {
+            g->players[i].chips = i == 1 ? 30 : 100;
+            g->players[i].bet = g->players[i].allin = 0;
+        }
+        bet(g, 0, 50);
+        bet(g, 1, 50);
+        bet(g, 2, 50);
+        end_betting_round(g);
+
+        total = 0;
+        for (i = 0; i < g->n_pots; i++)
+            total += g->pots[i].content;
+        failed |= total != 130;
+        failed |= !g->players[1].allin || g->n_pots < 2;
+        failed |= g->pots[0].seats != (SEAT_BIT(0) | SEAT_BIT(1) | SEAT_BIT(2));
+        failed |= g->pots[0].content != 90;
+        failed |= hand_alloc(g, HAND_SCRATCH) == NULL;
+    }
+    failed |= hand_alloc(g, HAND_SCRATCH) != NULL;
+    free_game(g);
+
+    puts(failed ? "Pots: FAIL" : "Pots: OK");
+    return failed;
+}
+
 int main()
 {
-    double start_time[10];
-    int i, j;
-    int sorted_players[10];
+    int i;
+    player_rank_t sorted_players[10];
     
     testgame = new_game(10);
     for (i = 0; i < 10; i++) {
@@ -199,24 +266,16 @@ int main()
 
     puts("*** SORTING PLAYERS ***");
     get_player_ranks(testgame, sorted_players);
-    puts("In order of card ranking (low to high):");
-    for (i = 0; i < 10; i++)
-        printf("Player %d\n", sorted_players[i]);
-
-    /*
-    puts("*** BENCHMARKING ***");
-    start_time[0] = get_time();
-    for (i = 0; i < 5000; i++)
-        shuffle_deck();
-    printf("Shuffled deck 5,000 times in %f\n", get_time() - start_time[0]);
-
+    puts("In order of card ranking (high to low):");
     for (i = 0; i < 10; i++) {
-        start_time[i] = get_time();
-        for (j = 0; j < 100000; j++)
-            get_best_player_hand(i);
-        printf("Calculated best hand for Player %d 100,000 times in %f\n", i, get_time() - start_time[i]);
+        printf("Player %d (group %d)\n", sorted_players[i].player,
+                                         sorted_players[i].group);
+        if (i > 0 && sorted_players[i].strength > sorted_players[i - 1].strength)
+            return 1;
     }
-    */
+
+    if (check_seats() || check_glyphs() || check_pots())
+        return 1;
 
     return 0;
 }
@@ -0,0 +1,207 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the betting engine: a heads-up hand step by step, a table going all in
+ * in one go, a player running out of time, and then a headless table of
+ * six playing at random. no chip may ever get lost, and the engine must
+ * always end up waiting for somebody or done with the hand.
+ *
+ * usage: testengine [number of hands]   (default 100,000) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "engine.h"
+
+static int failed = 0;
+
+double get_time()
+{
+    /* used for benchmarking */
+    struct timeval t;
+    struct timezone tz;
+    gettimeofday(&t, &tz);
+    return t.tv_sec + t.tv_usec*1e-6;
+}
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+game_tp table(int n, int chips)
+{
+    game_tp g = new_game(0);
+    char nick[16];
+    int i;
+
+    for (i = 0; i < n; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = chips;
+        g->players[i].active = 1;
+    }
+    return g;
+}
+
+int count_events(game_tp g, int type, int player)
+{
+    /* and drops them all */
+    struct event e;
+    int n = 0;
+
+    while (engine_next_event(g, &e))
+        if (e.type == type && (player < 0 || e.player == player))
+            n++;
+    return n;
+}
+
+int chips_in_play(game_tp g)
+{
+    int i, n = 0;
+
+    for (i = 0; i < g->n_players; i++)
+        n += g->players[i].chips;
+    return n;
+}
+
+void check_heads_up()
+{
+    /* the button is 0, so 1 pays the small blind and acts first */
+    game_tp g = table(2, 100);
+    struct event e;
+
+    expect("deal", engine_deal(g) == 0);
+    expect("small blind", engine_next_event(g, &e) && e.type == EV_SMALL_BLIND
+                          && e.player == 1 && e.amount == 1);
+    expect("big blind", engine_next_event(g, &e) && e.type == EV_BIG_BLIND
+                        && e.player == 0 && e.amount == 2);
+    expect("dealt", count_events(g, EV_PROMPT_CALL, 1) == 1);
+    expect("waiting for 1", engine_waiting(g) && g->turn == 1);
+    expect("no deal mid-hand", engine_deal(g) != 0);
+    expect("not 0's turn", engine_act(g, 0, ACT_CALL, 0) == ACT_NOT_YOUR_TURN);
+    expect("can't check", engine_act(g, 1, ACT_CHECK, 0) == ACT_CANNOT_CHECK);
+
+    expect("call", engine_act(g, 1, ACT_CALL, 0) == ACT_OK);
+    expect("option", count_events(g, EV_PROMPT_OPTION, 0) == 1);
+    expect("check the option", engine_act(g, 0, ACT_CALL, 0) == ACT_OK);
+    expect("flop", engine_next_event(g, &e) && e.type == EV_CHECK
+                   && engine_next_event(g, &e) && e.type == EV_STREET
+                   && e.amount == 3);
+    expect("after the flop", count_events(g, EV_PROMPT_CHECK, 1) == 1);
+
+    expect("bet too low", engine_act(g, 1, ACT_BET, -1) == ACT_TOO_LOW);
+    expect("raise", engine_act(g, 1, ACT_RAISE, 10) == ACT_OK);
+    expect("raised", engine_next_event(g, &e) && e.type == EV_RAISE
+                     && e.amount == 10 && e.total == 10);
+    engine_drop_events(g);
+    expect("fold", engine_act(g, 0, ACT_FOLD, 0) == ACT_OK);
+    expect("by default", count_events(g, EV_AWARD, 1) == 1);
+    expect("hand over", !engine_waiting(g) && g->turn == -1);
+    expect("won the pot", g->players[1].chips == 102 && g->players[0].chips == 98);
+    expect("button moved", g->button == 1);
+    free_game(g);
+}
+
+void check_all_in()
+{
+    /* everybody all in: the rest of the hand runs out in one call */
+    game_tp g = table(4, 50);
+    struct event e;
+    int i, streets = 0, shows = 0, over = 0;
+
+    engine_deal(g);
+    engine_drop_events(g);
+    for (i = 0; i < 3; i++)
+        engine_act(g, g->turn, ACT_ALL_IN, 0);
+    engine_drop_events(g);
+    engine_act(g, g->turn, ACT_ALL_IN, 0);
+    while (engine_next_event(g, &e)) {
+        streets += e.type == EV_STREET;
+        shows += e.type == EV_SHOW;
+        over += e.type == EV_HAND_OVER;
+    }
+    expect("three streets", streets == 3);
+    expect("four hands shown", shows == 4);
+    expect("over", over == 1 && !engine_waiting(g));
+    expect("all chips there", chips_in_play(g) == 200);
+    free_game(g);
+}
+
+void check_timeout()
+{
+    game_tp g = table(3, 100);
+    int away;
+
+    engine_deal(g);
+    engine_drop_events(g);
+    away = g->turn;
+    expect("timeout", engine_act(g, away, ACT_TIMEOUT, 0) == ACT_OK);
+    expect("folds facing a bet", count_events(g, EV_TIMEOUT_FOLD, away) == 1);
+    expect("and goes away", g->players[away].folded && !g->players[away].active);
+    free_game(g);
+}
+
+int main(int argc, char **argv)
+{
+    static const enum action moves[] = {
+        ACT_CHECK, ACT_CHECK, ACT_CALL, ACT_CALL, ACT_CALL, ACT_RAISE,
+        ACT_BET, ACT_FOLD, ACT_FOLD, ACT_ALL_IN
+    };
+    long n = 100000;
+    long hands, actions = 0, stuck = 0, lost = 0;
+    unsigned long x = 88172645463325252UL;
+    double start_time;
+    game_tp g;
+    int i, r;
+
+    if (argc > 1)
+        n = atol(argv[1]);
+
+    check_heads_up();
+    check_all_in();
+    check_timeout();
+
+    g = table(6, 200);
+    start_time = get_time();
+    for (hands = 0; hands < n; hands++) {
+        if (engine_deal(g) != 0) {
+            /* somebody won everything. again! */
+            for (i = 0; i < g->n_players; i++)
+                g->players[i].chips = 200;
+            engine_drop_events(g);
+            continue;
+        }
+        while (engine_waiting(g)) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            r = engine_act(g, g->turn, moves[x % 10], (x >> 8) % 40);
+            if (r == ACT_CANNOT_CHECK || r == ACT_TOO_LOW)
+                r = engine_act(g, g->turn, ACT_CALL, 0);
+            if (r != ACT_OK) {
+                stuck++;
+                break;
+            }
+            engine_drop_events(g);
+            actions++;
+        }
+        engine_drop_events(g);
+        if (g->state != ENGINE_IDLE)
+            stuck++;
+        if (chips_in_play(g) != 6 * 200)
+            lost++;
+        if (stuck || lost)
+            break;
+    }
+    printf("Played %ld hands (%ld actions) in %f\n", hands, actions,
+           get_time() - start_time);
+    expect("never stuck", stuck == 0);
+    expect("no chips lost", lost == 0);
+    free_game(g);
+
+    return failed;
+}
@@ -0,0 +1,160 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* testing the equity calculator in equity.h against some well-known odds */
+
+#include <math.h>
+#include <stdio.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include "equity.h"
+#include "hand.h"
+#include "sim.h"
+
+static int jobs_done = 0;
+
+double get_time()
+{
+    /* used for benchmarking */
+    struct timeval t;
+    struct timezone tz;
+    gettimeofday(&t, &tz);
+    return t.tv_sec + t.tv_usec*1e-6;
+}
+
+pcard_t card(int value, suit_t suit)
+{
+    card_t c;
+    c.value = value;
+    c.suit = suit;
+    return card_pack(c);
+}
+
+void new_query(struct equity_query *q)
+{
+    q->n_known = 0;
+    q->n_unknown = 0;
+    q->n_board = 0;
+    q->dead = 0;
+    q->max_trials = 1000000;
+    q->max_seconds = 10;
+    q->seed = 42;
+}
+
+void add_hole(struct equity_query *q, pcard_t c1, pcard_t c2)
+{
+    q->hole[q->n_known][0] = c1;
+    q->hole[q->n_known][1] = c2;
+    q->n_known++;
+}
+
+int expect(const char *what, double got, double want, double tolerance)
+{
+    printf("%-34s %6.2f%% (expected %6.2f%%)", what, 100 * got, 100 * want);
+    if (fabs(got - want) > tolerance) {
+        puts("  FAIL");
+        return 1;
+    }
+    puts("");
+    return 0;
+}
+
+void pool_done(struct equity_job *ej)
+{
+    struct equity_result *res = ej->data;
+
+    *res = ej->res;
+    if (ej->failed)
+        res->trials = -1;
+    jobs_done++;
+}
+
+int main()
+{
+    struct equity_query q;
+    struct equity_result res;
+    int failed = 0;
+    double start_time;
+
+    /* aces against kings of the other suits, pre-flop: sampled. counting
+     * all 1,712,304 boards gives 81.26%. */
+    new_query(&q);
+    add_hole(&q, card(1, SPADES), card(1, HEARTS));
+    add_hole(&q, card(13, CLUBS), card(13, DIAMONDS));
+    start_time = get_time();
+    failed |= calc_equity(&q, &res) != 0;
+    printf("Sampled %ld deals in %f\n", res.trials, get_time() - start_time);
+    failed |= expect("AA vs KK, pre-flop:", res.equity[0], 0.8126, 0.005);
+    failed |= expect("KK vs AA, pre-flop:", res.equity[1], 0.1874, 0.005);
+
+    /* on the turn: 44 rivers, all of them counted. the flush draw hits 9
+     * times, the gutshot adds 3 more. */
+    new_query(&q);
+    add_hole(&q, card(1, SPADES), card(1, HEARTS));
+    add_hole(&q, card(9, CLUBS), card(8, CLUBS));
+    q.board[0] = card(10, CLUBS);
+    q.board[1] = card(2, CLUBS);
+    q.board[2] = card(13, DIAMONDS);
+    q.board[3] = card(6, HEARTS);
+    q.n_board = 4;
+    failed |= calc_equity(&q, &res) != 0;
+    failed |= !res.exhaustive || res.trials != 44;
+    failed |= expect("98c vs AA, flush and gutshot draw:", res.win[1], 12 / 44.0, 1e-9);
+
+    /* the board plays: always a split */
+    new_query(&q);
+    add_hole(&q, card(2, SPADES), card(3, HEARTS));
+    add_hole(&q, card(2, CLUBS), card(3, DIAMONDS));
+    q.board[0] = card(10, CLUBS);
+    q.board[1] = card(11, HEARTS);
+    q.board[2] = card(12, DIAMONDS);
+    q.board[3] = card(13, SPADES);
+    q.board[4] = card(1, SPADES);
+    q.n_board = 5;
+    failed |= calc_equity(&q, &res) != 0;
+    failed |= expect("Broadway on the board:", res.tie[0], 1.0, 1e-9);
+
+    /* the nuts against one random hand on the river: 990 hands, all won */
+    new_query(&q);
+    add_hole(&q, card(1, CLUBS), card(13, CLUBS));
+    q.n_unknown = 1;
+    q.board[0] = card(10, CLUBS);
+    q.board[1] = card(11, CLUBS);
+    q.board[2] = card(12, CLUBS);
+    q.board[3] = card(4, SPADES);
+    q.board[4] = card(7, HEARTS);
+    q.n_board = 5;
+    failed |= calc_equity(&q, &res) != 0;
+    failed |= !res.exhaustive || res.trials != 990;
+    failed |= expect("Royal flush vs a random hand:", res.win[0], 1.0, 1e-9);
+
+    /* aces against kings again, this time split over the worker pool */
+    new_query(&q);
+    add_hole(&q, card(1, SPADES), card(1, HEARTS));
+    add_hole(&q, card(13, CLUBS), card(13, DIAMONDS));
+    if (pool_start(4) != 0 || submit_equity(&q, pool_done, &res) != 0) {
+        puts("Cannot use the worker pool  FAIL");
+        return 1;
+    }
+    while (!jobs_done) {
+        fd_set in;
+        FD_ZERO(&in);
+        FD_SET(pool_completion_fd(), &in);
+        select(pool_completion_fd() + 1, &in, NULL, NULL, NULL);
+        pool_drain();
+    }
+    printf("Sampled %ld deals on %d workers\n", res.trials, pool_size());
+    pool_stop();
+    failed |= res.trials < q.max_trials / 2;
+    failed |= expect("AA vs KK, on the pool:", res.equity[0], 0.8126, 0.005);
+
+    /* the same card twice makes no sense */
+    new_query(&q);
+    add_hole(&q, card(1, CLUBS), card(1, CLUBS));
+    if (calc_equity(&q, &res) != -1) {
+        puts("Accepted a duplicate card  FAIL");
+        failed = 1;
+    }
+
+    return failed;
+}
@@ -0,0 +1,315 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the evaluator against a slow, obvious one written from scratch here.
+ *
+ * every one of the 2,598,960 five-card hands has to get exactly the
+ * strength the reference gives it; the hands of each rank have to come
+ * out in the well-known numbers, with 7462 different strengths between
+ * them; rank_hand() and handcmp() have to agree. then random seven-card
+ * hands have to be worth the best of their 21 five-card hands, and
+ * eval_best_hand() has to pick five of the seven cards that are worth
+ * that much. last, eval_masks() has to agree with eval_mask() on batches
+ * of five to seven cards. the work is split over one thread per core.
+ *
+ * usage: testeval [number of seven-card hands]   (default 200,000) */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "hand.h"
+
+#define MAX_THREADS 64
+#define N_STRENGTHS (1 << 24)
+#define BATCH 67        /* not a multiple of anything */
+
+/* five-card hands of each rank */
+static const long class_count[ROYALFLUSH + 1] = {
+    1302540, 1098240, 123552, 54912, 10200, 5108, 3744, 624, 36, 4
+};
+
+struct worker {
+    pthread_t thread;
+    int id, n;
+    long n7;
+    /* results */
+    long count[ROYALFLUSH + 1];
+    long wrong5, wrong_rank, wrong_cmp, wrong7, wrong_best, wrong_batch;
+    unsigned char *seen;    /* a bit per strength */
+};
+
+static int failed = 0;
+static pcard_t deck[52];
+
+double get_time()
+{
+    /* used for benchmarking */
+    struct timeval t;
+    struct timezone tz;
+    gettimeofday(&t, &tz);
+    return t.tv_sec + t.tv_usec*1e-6;
+}
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+int key(ranks_t rank, const int cards[], int n)
+{
+    int i, s = rank << 20;
+
+    for (i = 0; i < n; i++)
+        s |= cards[i] << (16 - 4 * i);
+    return s;
+}
+
+int ref_eval5(const pcard_t c[])
+{
+    /* by the book: sort the ranks by how often they come, then by rank */
+    int count[13] = { 0 };
+    int order[5];
+    int mask = 0, flush = 1, straight = -1;
+    int i, k, r, n = 0;
+
+    for (i = 0; i < 5; i++) {
+        count[PCARD_RANK(c[i])]++;
+        mask |= 1 << PCARD_RANK(c[i]);
+        if (PCARD_SUIT(c[i]) != PCARD_SUIT(c[0]))
+            flush = 0;
+    }
+    for (k = 4; k >= 1; k--)
+        for (r = 12; r >= 0; r--)
+            if (count[r] == k)
+                order[n++] = r;
+
+    if (n == 5) {
+        if (mask == 0x100f)         /* A 2 3 4 5: five high */
+            straight = 3;
+        else if (order[0] - order[4] == 4)
+            straight = order[0];
+    }
+
+    if (straight >= 0 && flush)
+        return key(straight == 12 ? ROYALFLUSH : STRAIGHTFLUSH, &straight, 1);
+    if (count[order[0]] == 4)
+        return key(FOURKIND, order, 2);
+    if (count[order[0]] == 3 && count[order[1]] == 2)
+        return key(FULLHOUSE, order, 2);
+    if (flush)
+        return key(FLUSH, order, 5);
+    if (straight >= 0)
+        return key(STRAIGHT, &straight, 1);
+    if (count[order[0]] == 3)
+        return key(THREEKIND, order, 3);
+    if (count[order[0]] == 2 && count[order[1]] == 2)
+        return key(TWOPAIR, order, 3);
+    if (count[order[0]] == 2)
+        return key(ONEPAIR, order, 4);
+    return key(HIGHCARD, order, 5);
+}
+
+int ref_eval7(const pcard_t c[])
+{
+    /* the best of the 21 ways to leave out two cards */
+    pcard_t five[5];
+    int i, j, k, n, s, best = -1;
+
+    for (i = 0; i < 7; i++)
+        for (j = i + 1; j < 7; j++) {
+            for (k = n = 0; k < 7; k++)
+                if (k != i && k != j)
+                    five[n++] = c[k];
+            if ((s = ref_eval5(five)) > best)
+                best = s;
+        }
+    return best;
+}
+
+void check_five(struct worker *w)
+{
+    /* this worker's share: hands whose lowest card is a, for every n-th a */
+    pcard_t h[5], prev[5];
+    int a, b, c, d, e, s, r, have_prev = 0;
+    int prev_s = 0;
+
+    for (a = w->id; a < 48; a += w->n)
+      for (b = a + 1; b < 49; b++)
+        for (c = b + 1; c < 50; c++)
+          for (d = c + 1; d < 51; d++)
+            for (e = d + 1; e < 52; e++) {
+                h[0] = deck[a]; h[1] = deck[b]; h[2] = deck[c];
+                h[3] = deck[d]; h[4] = deck[e];
+
+                r = ref_eval5(h);
+                s = eval_hand(h, 5);
+                w->wrong5 += s != r;
+                w->count[STRENGTH_RANK(r)]++;
+                w->seen[r >> 3] |= 1 << (r & 7);
+                w->wrong_rank += rank_hand(h) != STRENGTH_RANK(r);
+
+                if (have_prev)
+                    w->wrong_cmp += handcmp(h, prev) != (r > prev_s) - (r < prev_s);
+                memcpy(prev, h, sizeof h);
+                prev_s = r;
+                have_prev = 1;
+            }
+}
+
+cardmask_t random_hand(uint64_t *x, pcard_t h[], int n)
+{
+    cardmask_t mask = 0;
+    int i, j;
+
+    for (i = 0; i < n; i++) {
+        do {
+            *x ^= *x >> 12;
+            *x ^= *x << 25;
+            *x ^= *x >> 27;
+            j = (int) ((*x * 0x2545f4914f6cdd1dULL) >> 32) % 52;
+        } while (mask & PCARD_BIT(deck[j]));
+        h[i] = deck[j];
+        mask |= PCARD_BIT(h[i]);
+    }
+    return mask;
+}
+
+void check_seven(struct worker *w)
+{
+    uint64_t x = 0x9e3779b97f4a7c15ULL * (w->id + 1);
+    pcard_t h[7], best[5];
+    cardmask_t mask;
+    long t;
+    int i, s;
+
+    for (t = 0; t < w->n7; t++) {
+        mask = random_hand(&x, h, 7);
+
+        s = eval_hand(h, 7);
+        w->wrong7 += s != ref_eval7(h);
+
+        eval_best_hand(mask, s, best);
+        for (i = 0; i < 5; i++)
+            if (!(mask & PCARD_BIT(best[i])))
+                break;
+        w->wrong_best += i < 5 || ref_eval5(best) != s;
+    }
+}
+
+void check_batch(struct worker *w)
+{
+    /* batches of every length up to BATCH, to get at the leftovers too */
+    uint64_t x = 0x2545f4914f6cdd1dULL * (w->id + 1);
+    cardmask_t masks[BATCH];
+    int strength[BATCH + 1];
+    pcard_t h[7];
+    long t;
+    int i, n;
+
+    for (t = 0; t < w->n7 / BATCH; t++) {
+        n = t % (BATCH + 1);
+        for (i = 0; i < n; i++)
+            masks[i] = random_hand(&x, h, 5 + i % 3);
+        strength[n] = -1;
+        eval_masks(masks, strength, n);
+        for (i = 0; i < n; i++)
+            w->wrong_batch += strength[i] != eval_mask(masks[i]);
+        w->wrong_batch += strength[n] != -1;
+    }
+}
+
+void *work(void *arg)
+{
+    struct worker *w = arg;
+
+    check_five(w);
+    check_seven(w);
+    check_batch(w);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static struct worker workers[MAX_THREADS];
+    long n7 = 200000;
+    long count[ROYALFLUSH + 1] = { 0 };
+    long wrong5 = 0, wrong_rank = 0, wrong_cmp = 0, wrong7 = 0, wrong_best = 0;
+    long wrong_batch = 0;
+    long total = 0;
+    int n, i, r, distinct = 0;
+    unsigned char *seen;
+    double start_time;
+
+    if (argc > 1)
+        n7 = atol(argv[1]);
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        n = 1;
+    if (n > MAX_THREADS)
+        n = MAX_THREADS;
+
+    init_deck(deck);
+    /* read-only from here on, so the threads can share them */
+    init_hand_tables();
+
+    start_time = get_time();
+    for (i = 0; i < n; i++) {
+        workers[i].id = i;
+        workers[i].n = n;
+        workers[i].n7 = n7 / n + (i < n7 % n);
+        workers[i].seen = calloc(N_STRENGTHS / 8, 1);
+        if (pthread_create(&workers[i].thread, NULL, work, &workers[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    seen = calloc(N_STRENGTHS / 8, 1);
+    for (i = 0; i < n; i++) {
+        struct worker *w = &workers[i];
+
+        pthread_join(w->thread, NULL);
+        for (r = 0; r <= ROYALFLUSH; r++)
+            count[r] += w->count[r];
+        wrong5 += w->wrong5;
+        wrong_rank += w->wrong_rank;
+        wrong_cmp += w->wrong_cmp;
+        wrong7 += w->wrong7;
+        wrong_best += w->wrong_best;
+        wrong_batch += w->wrong_batch;
+        for (r = 0; r < N_STRENGTHS / 8; r++)
+            seen[r] |= w->seen[r];
+        free(w->seen);
+    }
+    for (r = 0; r < N_STRENGTHS / 8; r++)
+        distinct += __builtin_popcount(seen[r]);
+    free(seen);
+    printf("Checked all five-card hands and %ld seven-card hands on %d threads in %f\n",
+           n7, n, get_time() - start_time);
+
+    for (r = 0; r <= ROYALFLUSH; r++) {
+        total += count[r];
+        if (count[r] != class_count[r]) {
+            printf("%ld hands of rank %d instead of %ld  FAIL\n", count[r], r,
+                   class_count[r]);
+            failed = 1;
+        }
+    }
+    expect("2,598,960 hands", total == 2598960);
+    expect("7462 strengths", distinct == 7462);
+    expect("five cards like the reference", wrong5 == 0);
+    expect("rank_hand like the reference", wrong_rank == 0);
+    expect("handcmp like the reference", wrong_cmp == 0);
+    expect("seven cards like the best five", wrong7 == 0);
+    expect("eval_best_hand picks the best five", wrong_best == 0);
+    expect("eval_masks like eval_mask", wrong_batch == 0);
+
+    return failed;
+}
@@ -22,7 +22,7 @@ double get_time()
     return t.tv_sec + t.tv_usec*1e-6;
 }
 
-void print_hand(card_t hand[])
+void print_hand(pcard_t hand[])
 {
     /* pretty prints the given hand */
     int i;
@@ -61,7 +61,7 @@ void print_hand(card_t hand[])
     }
     
     for (i = 0; i < 5; i++) {
-        switch (hand[i].value) {
+        switch (card_unpack(hand[i]).value) {
             case 1:
                 printf(" A");
                 break;
@@ -78,9 +78,9 @@ void print_hand(card_t hand[])
                 printf(" K");
                 break;
             default:
-                printf(" %d", hand[i].value);
+                printf(" %d", card_unpack(hand[i]).value);
         }
-        switch(hand[i].suit) {
+        switch(card_unpack(hand[i]).suit) {
             case CLUBS:
                 putchar('C');
                 break;
@@ -102,27 +102,27 @@ void print_hand(card_t hand[])
 int main() {
     int i;
     double start_time;
-    card_t high_card1[5];   /* now we're going to generate several hands and test the ranking stuff */
-    card_t high_card2[5];
-    card_t one_pair1[5];
-    card_t one_pair2[5];
-    card_t two_pair1[5];
-    card_t two_pair2[5];
-    card_t three_kind1[5];
-    card_t three_kind2[5];
-    card_t straight1[5];
-    card_t straight2[5];
-    card_t flush1[5];
-    card_t flush2[5];
-    card_t full_house1[5];
-    card_t full_house2[5];
-    card_t four_kind1[5];
-    card_t four_kind2[5];
-    card_t straight_flush1[5];
-    card_t straight_flush2[5];
-    card_t royal_flush1[5];
-    card_t royal_flush2[5];
-    card_t deck[52];
+    pcard_t high_card1[5];   /* now we're going to generate several hands and test the ranking stuff */
+    pcard_t high_card2[5];
+    pcard_t one_pair1[5];
+    pcard_t one_pair2[5];
+    pcard_t two_pair1[5];
+    pcard_t two_pair2[5];
+    pcard_t three_kind1[5];
+    pcard_t three_kind2[5];
+    pcard_t straight1[5];
+    pcard_t straight2[5];
+    pcard_t flush1[5];
+    pcard_t flush2[5];
+    pcard_t full_house1[5];
+    pcard_t full_house2[5];
+    pcard_t four_kind1[5];
+    pcard_t four_kind2[5];
+    pcard_t straight_flush1[5];
+    pcard_t straight_flush2[5];
+    pcard_t royal_flush1[5];
+    pcard_t royal_flush2[5];
+    pcard_t deck[52];
 
     init_deck(deck);
 
@@ -0,0 +1,195 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* hand histories: a table plays hands at random with the writer running,
+ * then the file has to hold one record per hand, with the deck, the seats
+ * and every event just as the engine put them, Hold'em or Omaha. a flipped
+ * byte has to be caught, a record cut short has to be told from a
+ * broken one, and one left at the end by a crash mustn't hide the hands
+ * written after it. */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "engine.h"
+#include "history.h"
+
+#define HANDS 200
+#define MAX_EVENTS 1024
+
+static int failed = 0;
+
+/* what the engine said, hand by hand */
+static struct event seen[HANDS][MAX_EVENTS];
+static int n_seen[HANDS];
+static pcard_t decks[HANDS][52];
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void drain(game_tp g, int hand)
+{
+    struct event e;
+
+    while (engine_next_event(g, &e))
+        if (n_seen[hand] < MAX_EVENTS)
+            seen[hand][n_seen[hand]++] = e;
+}
+
+void play(game_tp g)
+{
+    static const enum action moves[] = {
+        ACT_CHECK, ACT_CALL, ACT_CALL, ACT_RAISE, ACT_FOLD
+    };
+    unsigned x = 12345;
+    int h, i;
+
+    for (h = 0; h < HANDS; h++) {
+        if (h == HANDS / 2)
+            set_variant(g, &variants[VARIANT_OMAHA]);
+        for (i = 0; i < g->n_players; i++)
+            if (g->players[i].chips < 20)
+                g->players[i].chips = 500;
+        engine_deal(g);
+        memcpy(decks[h], g->deck, 52);
+        drain(g, h);
+        while (engine_waiting(g)) {
+            x = x * 1103515245 + 12345;
+            if (engine_act(g, g->turn, moves[(x >> 16) % 5], 10) != ACT_OK)
+                engine_act(g, g->turn, ACT_CALL, 0);
+            drain(g, h);
+        }
+    }
+}
+
+int same_events(const struct hand_record *r, int h)
+{
+    int i;
+
+    if (r->n_events != n_seen[h])
+        return 0;
+    for (i = 0; i < r->n_events; i++)
+        if (r->events[i].type != seen[h][i].type
+                || r->events[i].player != seen[h][i].player
+                || r->events[i].amount != seen[h][i].amount
+                || r->events[i].total != seen[h][i].total)
+            return 0;
+    return 1;
+}
+
+void count(const struct hand_record *r, void *data)
+{
+    ++*(int *) data;
+}
+
+int main()
+{
+    static struct hand_record r;
+    char dir[] = "/tmp/testhistory.XXXXXX";
+    char path[1024];
+    unsigned char *buf;
+    struct dirent *d;
+    game_tp g;
+    DIR *dh;
+    FILE *f;
+    long size, off, n;
+    int h, i, k, events_ok = 1, decks_ok = 1, numbers_ok = 1, cards_ok = 1;
+    int variants_ok = 1, records = 0;
+    char nick[16];
+
+    if (!mkdtemp(dir)) {
+        perror(dir);
+        return 1;
+    }
+    expect("start", history_start(dir) == 0);
+
+    g = new_game(0);
+    g->channel = strdup("#test");
+    for (i = 0; i < 4; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = 500;
+        g->players[i].active = 1;
+    }
+    play(g);
+    free_game(g);
+    history_stop();
+
+    /* one file, for today */
+    path[0] = '\0';
+    dh = opendir(dir);
+    while (dh && (d = readdir(dh)))
+        if (strstr(d->d_name, ".hh"))
+            snprintf(path, sizeof path, "%s/%s", dir, d->d_name);
+    if (dh)
+        closedir(dh);
+    expect("a file", *path);
+    if (!*path || !(f = fopen(path, "rb")))
+        return 1;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    buf = malloc(size);
+    expect("read", fread(buf, 1, size, f) == (size_t) size);
+    fclose(f);
+    expect("magic", size >= 8 && memcmp(buf, HISTORY_MAGIC, 8) == 0);
+
+    for (h = 0, off = 8; off < size && h < HANDS; h++, off += n) {
+        if ((n = history_unpack(buf + off, size - off, &r)) <= 0)
+            break;
+        numbers_ok &= r.hand == (uint32_t) h + 1 && strcmp(r.channel, "#test") == 0
+                      && r.n_seats == 4 && strcmp(r.seats[3].nick, "p3") == 0;
+        decks_ok &= memcmp(r.deck, decks[h], 52) == 0;
+        events_ok &= same_events(&r, h);
+        variants_ok &= r.variant == (h < HANDS / 2 ? VARIANT_HOLDEM : VARIANT_OMAHA)
+                       && r.n_hole == variants[r.variant].n_hole;
+        for (i = 0; i < r.n_seats; i++)
+            for (k = 0; k < r.n_hole; k++)
+                cards_ok &= r.seats[i].hole[k] == HISTORY_NO_CARD
+                            || memchr(r.deck, r.seats[i].hole[k], 52) != NULL;
+    }
+    expect("a record per hand", h == HANDS && off == size);
+    expect("hand numbers, channel, seats", numbers_ok);
+    expect("decks", decks_ok);
+    expect("events", events_ok);
+    expect("hole cards", cards_ok);
+    expect("variants", variants_ok);
+
+    /* the first record, damaged */
+    n = history_unpack(buf + 8, size - 8, &r);
+    expect("cut short", history_unpack(buf + 8, n - 1, &r) == 0);
+    buf[8 + n / 2] ^= 1;
+    expect("flipped byte", history_unpack(buf + 8, size - 8, &r) == -1);
+
+    /* half a record at the end, then more hands */
+    f = fopen(path, "ab");
+    expect("torn", f && fwrite(buf + 8, 1, n / 2, f) == (size_t) (n / 2));
+    if (f)
+        fclose(f);
+    expect("restart", history_start(dir) == 0);
+    g = new_game(0);
+    g->channel = strdup("#test");
+    for (i = 0; i < 4; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = 500;
+        g->players[i].active = 1;
+    }
+    play(g);
+    free_game(g);
+    history_stop();
+    expect("appended after it", history_read(path, count, &records) == 0
+                                && records == 2 * HANDS);
+
+    free(buf);
+    unlink(path);
+    rmdir(dir);
+    return failed;
+}
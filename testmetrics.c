@@ -0,0 +1,151 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* metrics and the log: what threads count has to add up, after they're
+ * gone too; values have to land in the right buckets; and the log has to
+ * keep its lines in order and leave out the ones below its level. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "deck.h"
+#include "hand.h"
+#include "log.h"
+#include "metrics.h"
+#include "rng.h"
+
+#define THREADS 4
+#define COUNTS 10000
+
+static int failed = 0;
+static char text[1 << 16];
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void *count(void *arg)
+{
+    int i;
+
+    for (i = 0; i < COUNTS; i++)
+        METRIC_INC(C_COMMANDS);
+    metric_observe(H_DISPATCH, 3e-6);
+    return NULL;
+}
+
+/* the value on the line starting with name, or -1 */
+double value(const char *name)
+{
+    char *p = text;
+    size_t len = strlen(name);
+
+    while (p && *p) {
+        if (strncmp(p, name, len) == 0 && p[len] == ' ')
+            return atof(p + len + 1);
+        if ((p = strchr(p, '\n')))
+            p++;
+    }
+    return -1;
+}
+
+void read_metrics(void)
+{
+    FILE *f = tmpfile();
+    size_t n;
+
+    metrics_write(f);
+    rewind(f);
+    n = fread(text, 1, sizeof text - 1, f);
+    text[n] = '\0';
+    fclose(f);
+}
+
+int main()
+{
+    pthread_t threads[THREADS];
+    cardmask_t masks[10] = { 0 };
+    int strength[10];
+    pcard_t decks[3][52];
+    rng_t rng;
+    char path[] = "/tmp/testmetrics.XXXXXX";
+    char line[LOG_LINE + 64];
+    FILE *f;
+    int i, fd, out, in_order;
+
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, count, NULL);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    for (i = 0; i < 10; i++)
+        masks[i] = (cardmask_t) 0x1f << i;
+    eval_masks(masks, strength, 10);
+    eval_mask(masks[0]);
+    for (i = 0; i < 3; i++)
+        init_deck(decks[i]);
+    rng.interval = 0;
+    rng_seed(&rng, (const unsigned char *) "seed", 4);
+    shuffle_decks(&rng, decks, 3);
+    metric_observe(H_RESPONSE, 0.5e-6);
+    metric_observe(H_RESPONSE, 3e-6);
+    metric_observe(H_RESPONSE, 1e9);
+
+    read_metrics();
+    expect("counted on every thread", value("ircpoker_commands_total") == THREADS * COUNTS);
+    expect("evaluations", value("ircpoker_evals_total") == 11);
+    expect("shuffles", value("ircpoker_shuffles_total") == 3);
+    expect("histogram of gone threads", value("ircpoker_dispatch_seconds_count") == THREADS);
+    expect("smallest bucket", value("ircpoker_response_seconds_bucket{le=\"1e-06\"}") == 1);
+    expect("buckets add up", value("ircpoker_response_seconds_bucket{le=\"2e-06\"}") == 1
+                             && value("ircpoker_response_seconds_bucket{le=\"4e-06\"}") == 2);
+    expect("beyond the buckets", value("ircpoker_response_seconds_bucket{le=\"+Inf\"}") == 3
+                                 && value("ircpoker_response_seconds_count") == 3);
+    expect("sum", value("ircpoker_response_seconds_sum") > 1e8);
+    expect("types", strstr(text, "# TYPE ircpoker_evals_total counter\n")
+                    && strstr(text, "# TYPE ircpoker_sendq_depth histogram\n"));
+
+    expect("level names", log_level_named("warning") == LOG_WARNING
+                          && log_level_named("loud") == -1);
+
+    /* the log, into a file instead of stdout */
+    if ((fd = mkstemp(path)) < 0) {
+        perror(path);
+        return 1;
+    }
+    fflush(stdout);
+    out = dup(1);
+    dup2(fd, 1);
+    log_level = LOG_INFO;
+    expect("log start", log_start() == 0);
+    for (i = 0; i < LOG_RING / 2; i++) {
+        log_msg(LOG_DEBUG, "left out %d", i);
+        log_msg(LOG_INFO, "line %d", i);
+    }
+    log_stop();
+    fflush(stdout);
+    dup2(out, 1);
+    close(out);
+
+    f = fdopen(fd, "r");
+    rewind(f);
+    in_order = 1;
+    for (i = 0; fgets(line, sizeof line, f); i++) {
+        char want[32];
+
+        sprintf(want, " line %d\n", i);
+        in_order &= strstr(line, " info ") && strstr(line, want)
+                    && !strstr(line, "left out");
+    }
+    fclose(f);
+    unlink(path);
+    expect("lines in order", in_order);
+    expect("every line, or lost ones counted", i + log_dropped() == LOG_RING / 2);
+    return failed;
+}
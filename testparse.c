@@ -0,0 +1,82 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the tokenizer and the verb tables behind the chat commands */
+
+#include <stdio.h>
+#include <string.h>
+#include "parse.h"
+
+static int failed = 0;
+static const char *called;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void do_join(struct cmd_ctx *c, const struct line *l) { called = "join"; }
+void do_raise(struct cmd_ctx *c, const struct line *l) { called = "raise"; }
+void do_fold(struct cmd_ctx *c, const struct line *l) { called = "fold"; }
+void do_whats(struct cmd_ctx *c, const struct line *l) { called = "what's"; }
+
+static const struct verb verbs[] = {
+    { "join",   "game",      do_join },
+    { "raise",  NULL,        do_raise },
+    { "fold",   "",          do_fold },
+    { "what's", "the game?", do_whats }
+};
+static struct verb_table table = VERB_TABLE(verbs);
+
+const char *dispatch(const char *s)
+{
+    struct line l;
+    const struct verb *v;
+
+    called = NULL;
+    tokenize(s, &l);
+    if ((v = match_verb(&table, &l)))
+        v->fn(NULL, &l);
+    return called ? called : "";
+}
+
+int main()
+{
+    struct line l;
+    struct token t;
+    const char *s = "  raise\t25  chips 007 99999999999 -3";
+    const char *p;
+
+    expect("token count", tokenize(s, &l) == 6);
+    expect("spans point into the line", l.tok[0].s == s + 2 && l.tok[0].len == 5);
+    expect("number", l.tok[1].is_num && l.tok[1].num == 25);
+    expect("word is no number", !l.tok[2].is_num);
+    expect("leading zeroes", l.tok[3].is_num && l.tok[3].num == 7);
+    expect("too big", !l.tok[4].is_num);
+    expect("no negative numbers", !l.tok[5].is_num);
+    expect("token_is", token_is(&l.tok[0], "RAISE") && !token_is(&l.tok[0], "rais")
+                       && !token_is(&l.tok[0], "raises"));
+    expect("blank line", tokenize(" \t ", &l) == 0);
+
+    p = "a b c d e f g h i j";
+    expect("at most MAX_TOKENS", tokenize(p, &l) == MAX_TOKENS);
+    p = "first rest of it";
+    next_token(&p, &t);
+    expect("next_token leaves the rest", strcmp(p, " rest of it") == 0);
+
+    expect("exact tail", strcmp(dispatch("Join GAME"), "join") == 0);
+    expect("tail too long", strcmp(dispatch("join game now"), "") == 0);
+    expect("tail too short", strcmp(dispatch("join"), "") == 0);
+    expect("no tail", strcmp(dispatch("fold"), "fold") == 0);
+    expect("empty tail", strcmp(dispatch("fold now"), "") == 0);
+    expect("anything goes", strcmp(dispatch("raise 10 more"), "raise") == 0);
+    expect("two word tail", strcmp(dispatch("what's the game?"), "what's") == 0);
+    expect("not a verb", strcmp(dispatch("hello there"), "") == 0);
+    expect("prefix of a verb", strcmp(dispatch("rai 10"), "") == 0);
+    expect("empty line", strcmp(dispatch(""), "") == 0);
+
+    return failed;
+}
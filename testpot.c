@@ -0,0 +1,174 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* side pots and showdowns, then a benchmark: ten players all in with
+ * random stacks, over and over. no chip may ever get lost.
+ *
+ * usage: testpot [number of hands]   (default 200,000) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "pot.h"
+
+static int failed = 0;
+
+double get_time()
+{
+    /* used for benchmarking */
+    struct timeval t;
+    struct timezone tz;
+    gettimeofday(&t, &tz);
+    return t.tv_sec + t.tv_usec*1e-6;
+}
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+game_tp table(int n, const int chips[])
+{
+    game_tp g = new_game(n);
+    int i;
+
+    for (i = 0; i < n; i++) {
+        g->players[i].chips = chips[i];
+        g->players[i].active = 1;
+    }
+    new_hand(g);
+    return g;
+}
+
+void check_side_pots()
+{
+    /* 0 has 100, 1 has 30, 2 has 60. everybody goes all in. 1 has the best
+     * hand, then 2, then 0. */
+    int chips[3] = { 100, 30, 60 };
+    int strength[3] = { 1, 3, 2 };
+    int won[3] = { 0, 0, 0 };
+    game_tp g = table(3, chips);
+
+    bet(g, 0, 100);
+    bet(g, 1, 100);
+    bet(g, 2, 100);
+    end_betting_round(g);
+
+    expect("three pots", g->n_pots == 3);
+    expect("main pot", g->pots[0].content == 90 && g->pots[0].seats == 7);
+    expect("side pot", g->pots[1].content == 60 && g->pots[1].seats == 5);
+    expect("uncalled", g->pots[2].content == 40 && g->pots[2].seats == 1);
+    expect("bets cleared", g->players[0].bet == 0 && g->round_bet == 0);
+
+    award_pots(g, strength, won);
+    expect("main pot to 1", won[1] == 90);
+    expect("side pot to 2", won[2] == 60);
+    expect("excess back to 0", won[0] == 40);
+    free_game(g);
+}
+
+void check_rounds()
+{
+    /* pots survive from one round to the next, and folded chips stay in */
+    int chips[3] = { 100, 100, 100 };
+    int strength[3] = { -1, 5, 5 };
+    int won[3] = { 0, 0, 0 };
+    game_tp g = table(3, chips);
+
+    bet(g, 0, 10);
+    bet(g, 1, 10);
+    bet(g, 2, 10);
+    end_betting_round(g);
+    bet(g, 1, 25);
+    bet(g, 2, 25);
+    bet(g, 0, 5);
+    g->players[0].folded = 1;
+    end_betting_round(g);
+
+    expect("one pot", g->n_pots == 1 && g->pots[0].content == 85);
+    expect("folded player has no claim", g->pots[0].seats == 6);
+    expect("pot_total", pot_total(g) == 85);
+
+    /* a tie: 85 doesn't split evenly. the odd chip goes to the first
+     * winner left of the button (seat 0), which is seat 1. */
+    g->button = 0;
+    award_pots(g, strength, won);
+    expect("odd chip", won[1] == 43 && won[2] == 42);
+    free_game(g);
+}
+
+void check_odd_chips()
+{
+    /* 100 three ways, button on seat 1: 2 gets the odd chip */
+    int chips[4] = { 50, 50, 50, 50 };
+    int strength[4] = { 7, -1, 7, 7 };
+    int won[4] = { 0, 0, 0, 0 };
+    game_tp g = table(4, chips);
+    int i;
+
+    for (i = 0; i < 4; i++)
+        bet(g, i, 25);
+    end_betting_round(g);
+    g->button = 1;
+    award_pots(g, strength, won);
+    expect("split three ways", won[2] == 34 && won[3] == 33 && won[0] == 33);
+    free_game(g);
+}
+
+void bench_allin(long n)
+{
+    int chips[10], strength[10], before, after;
+    game_tp g;
+    double start;
+    long t;
+    int i;
+
+    srand(1);
+    for (i = 0; i < 10; i++)
+        chips[i] = 0;
+    g = table(10, chips);
+
+    start = get_time();
+    for (t = 0; t < n; t++) {
+        new_hand(g);
+        before = 0;
+        for (i = 0; i < 10; i++) {
+            g->players[i].chips = 1 + rand() % 1000;
+            g->players[i].bet = 0;
+            g->players[i].allin = g->players[i].folded = 0;
+            before += g->players[i].chips;
+            strength[i] = rand() % 8;
+        }
+        for (i = 0; i < 10; i++)
+            bet(g, i, 1000);
+        end_betting_round(g);
+        award_pots(g, strength, NULL);
+
+        after = 0;
+        for (i = 0; i < 10; i++)
+            after += g->players[i].chips;
+        if (after != before) {
+            expect("chips conserved", 0);
+            break;
+        }
+    }
+    printf("Settled %ld 10-way all-ins in %f\n", t, get_time() - start);
+    free_game(g);
+}
+
+int main(int argc, char **argv)
+{
+    long n = 200000;
+
+    if (argc > 1)
+        n = atol(argv[1]);
+
+    check_side_pots();
+    check_rounds();
+    check_odd_chips();
+    bench_allin(n);
+    return failed;
+}
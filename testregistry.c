@@ -0,0 +1,73 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the channel registry: lookups have to follow IRC's idea of case, keep
+ * sessions apart, and survive the table growing and games ending. */
+
+#include <stdio.h>
+#include "registry.h"
+
+#define N_CHANNELS 1000
+
+static int failed = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void count_game(struct channel_game *cg, void *data)
+{
+    (*(int *) data)++;
+}
+
+int main()
+{
+    static struct game games[N_CHANNELS];
+    int session_a = 0, session_b = 0;    /* only their addresses matter */
+    char name[32];
+    int i, n;
+
+    expect("add", registry_add(&session_a, "#Poker[1]", &games[0]) == 0);
+    expect("casefolded lookup",
+           registry_get(&session_a, "#pOKER{1}") == &games[0]);
+    expect("add twice", registry_add(&session_a, "#poker{1}", &games[1]) != 0);
+    expect("other session", registry_get(&session_b, "#poker[1]") == NULL);
+    expect("add on other session",
+           registry_add(&session_b, "#poker[1]", &games[1]) == 0);
+    expect("lookup on other session",
+           registry_get(&session_b, "#POKER[1]") == &games[1]);
+    expect("no channel", registry_get(&session_a, NULL) == NULL);
+
+    for (i = 2; i < N_CHANNELS; i++) {
+        sprintf(name, "#chan%d", i);
+        registry_add(&session_a, name, &games[i]);
+    }
+    expect("count", registry_count() == N_CHANNELS);
+    for (i = 2; i < N_CHANNELS; i++) {
+        sprintf(name, "#CHAN%d", i);
+        if (registry_get(&session_a, name) != &games[i]) {
+            expect("lookup after growing", 0);
+            break;
+        }
+    }
+
+    expect("remove", registry_remove(&session_a, "#POKER[1]") == &games[0]);
+    expect("gone", registry_get(&session_a, "#poker[1]") == NULL);
+    expect("remove twice", registry_remove(&session_a, "#poker[1]") == NULL);
+    expect("still there", registry_get(&session_b, "#poker[1]") == &games[1]);
+
+    n = 0;
+    registry_foreach(count_game, &n);
+    expect("foreach", n == N_CHANNELS - 1 && n == registry_count());
+
+    registry_drop_session(&session_a, NULL);
+    expect("drop session", registry_count() == 1);
+    expect("other session kept",
+           registry_get(&session_b, "#poker[1]") == &games[1]);
+
+    return failed;
+}
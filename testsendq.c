@@ -0,0 +1,95 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the send queue: merging, fairness between targets, and pacing */
+
+#include <stdio.h>
+#include <string.h>
+#include "sendq.h"
+
+static int failed = 0;
+static char sent[64][SENDQ_LINE_MAX + 64];
+static int n_sent = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void record(void *arg, const char *target, const char *text)
+{
+    if (n_sent < 64)
+        snprintf(sent[n_sent++], sizeof sent[0], "%s: %s", target, text);
+}
+
+int main()
+{
+    struct sendq *q = sendq_new(record, NULL);
+    char long_line[1000];
+    double t = 100.0;
+    int i, room;
+
+    /* consecutive lines to one target become one message */
+    sendq_push(q, "#poker", "Alice pays small blind of 1.");
+    sendq_push(q, "#poker", "Bob pays big blind of 2.");
+    sendq_push(q, "#Poker", "Hands dealt.");
+    expect("pending", sendq_pending(q) == 3);
+    expect("nothing left", sendq_flush(q, t) < 0);
+    expect("merged", n_sent == 1 && strcmp(sent[0], "#poker: Alice pays small "
+           "blind of 1. | Bob pays big blind of 2. | Hands dealt.") == 0);
+
+    /* targets take turns */
+    n_sent = 0;
+    for (i = 0; i < 3; i++) {
+        memset(long_line, 'a' + i, 300);
+        long_line[300] = '\0';
+        sendq_push(q, "#busy", long_line);
+    }
+    sendq_push(q, "carol", "Your cards: 2c 7d");
+    sendq_flush(q, t += SENDQ_BURST * SENDQ_INTERVAL);
+    expect("round robin", n_sent >= 2 && strncmp(sent[1], "carol: ", 7) == 0);
+
+    /* the bucket runs dry and fills up again */
+    for (i = 0; i < 2 * SENDQ_BURST; i++) {
+        memset(long_line, 'x', 300);
+        long_line[300] = '\0';
+        sendq_push(q, "#flood", long_line);
+    }
+    n_sent = 0;
+    expect("has to wait", sendq_flush(q, t) > 0);
+    expect("no more than a burst", n_sent <= SENDQ_BURST);
+    i = n_sent;
+    sendq_flush(q, t += SENDQ_INTERVAL);
+    expect("one more per interval", n_sent == i + 1);
+    while (sendq_flush(q, t += SENDQ_INTERVAL) >= 0);
+    expect("drained", sendq_pending(q) == 0);
+
+    /* too long for one message: cut at a space */
+    n_sent = 0;
+    room = sendq_room("dave");
+    for (i = 0; i < 999; i++)
+        long_line[i] = i % 10 == 9 ? ' ' : 'w';
+    long_line[999] = '\0';
+    sendq_push(q, "dave", long_line);
+    while (sendq_flush(q, t += SENDQ_INTERVAL) >= 0);
+    expect("split", n_sent == 3);
+    for (i = 0; i < n_sent; i++)
+        expect("fits", (int) strlen(sent[i]) - 6 <= room);
+    expect("at a space", sent[0][strlen(sent[0]) - 1] == 'w');
+
+    /* pictures go out line by line */
+    n_sent = 0;
+    sendq_push(q, "#art", "Flop.");
+    sendq_push_solo(q, "#art", "/\\");
+    sendq_push_solo(q, "#art", "\\/");
+    sendq_push(q, "#art", "Your turn.");
+    while (sendq_flush(q, t += SENDQ_INTERVAL) >= 0);
+    expect("solo lines", n_sent == 4 && strcmp(sent[1], "#art: /\\") == 0
+                         && strcmp(sent[3], "#art: Your turn.") == 0);
+
+    sendq_free(q);
+    return failed;
+}
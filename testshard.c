@@ -0,0 +1,180 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the shards: a task runs on the shard it was posted to, tasks for one
+ * shard run in order, and replies come back through the main mailbox. a
+ * private "game <channel>" has to go where the channel's game is, not to
+ * the nick's shard. */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "parse.h"
+#include "registry.h"
+#include "shard.h"
+
+#define N_SHARDS 4
+#define N_TASKS 10000
+
+struct test_task {
+    struct task task;
+    int shard;
+    int seq;
+};
+
+static int failed = 0;
+static int wrong_shard = 0;     /* only written on the shards... */
+static int out_of_order = 0;
+static int last_seq[N_SHARDS];  /* ...one element per shard */
+static int replies = 0;         /* main thread only */
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void reply(struct task *task)
+{
+    replies++;
+    free(task);
+}
+
+void on_shard(struct task *task)
+{
+    struct test_task *t = (struct test_task *) task;
+
+    if (current_shard() != t->shard)
+        __atomic_store_n(&wrong_shard, 1, __ATOMIC_RELAXED);
+    if (t->seq != last_seq[t->shard] + 1)
+        __atomic_store_n(&out_of_order, 1, __ATOMIC_RELAXED);
+    last_seq[t->shard] = t->seq;
+
+    /* back to the main thread, in the same block */
+    t->task.run = reply;
+    main_post(&t->task);
+}
+
+/* something to do with a channel's game on a shard, and the answer */
+struct game_task {
+    struct task task;
+    const void *session;
+    char channel[64];
+    int (*fn) (struct game_task *);
+    int result;
+};
+
+static int answered = 0;        /* main thread only */
+static int answer;
+
+void game_answered(struct task *task)
+{
+    answer = ((struct game_task *) task)->result;
+    answered = 1;
+    free(task);
+}
+
+void on_game_shard(struct task *task)
+{
+    struct game_task *t = (struct game_task *) task;
+
+    t->result = t->fn(t);
+    t->task.run = game_answered;
+    main_post(&t->task);
+}
+
+int run_on(int shard, const void *session, const char *channel,
+           int (*fn) (struct game_task *))
+{
+    struct game_task *t = calloc(1, sizeof *t);
+    struct pollfd pfd;
+
+    t->task.run = on_game_shard;
+    t->session = session;
+    snprintf(t->channel, sizeof t->channel, "%s", channel);
+    t->fn = fn;
+    answered = 0;
+    shard_post(shard, &t->task);
+    pfd.fd = main_mailbox_fd();
+    pfd.events = POLLIN;
+    while (!answered && poll(&pfd, 1, 1000) > 0)
+        main_drain();
+    return answered && answer;
+}
+
+int open_game(struct game_task *t)
+{
+    return registry_add(t->session, t->channel, new_game(0)) == 0;
+}
+
+int has_game(struct game_task *t)
+{
+    return registry_get(t->session, t->channel) != NULL;
+}
+
+int close_game(struct game_task *t)
+{
+    game_tp g = registry_remove(t->session, t->channel);
+
+    if (g)
+        free_game(g);
+    return g != NULL;
+}
+
+int main()
+{
+    struct test_task *t;
+    struct pollfd pfd;
+    int seq[N_SHARDS] = { 0 };
+    int session = 0;
+    char nick[16], chan[64];
+    int i, s;
+
+    expect("start", shards_start(N_SHARDS) == 0);
+    expect("count", shard_count() == N_SHARDS);
+    expect("not a shard", current_shard() == -1);
+    expect("same channel, same shard",
+           shard_of(&session, "#Poker") == shard_of(&session, "#pOKER"));
+
+    for (i = 0; i < N_SHARDS; i++)
+        last_seq[i] = 0;
+    for (i = 0; i < N_TASKS; i++) {
+        t = malloc(sizeof *t);
+        t->shard = s = i % N_SHARDS;
+        t->seq = ++seq[s];
+        t->task.run = on_shard;
+        shard_post(s, &t->task);
+    }
+
+    pfd.fd = main_mailbox_fd();
+    pfd.events = POLLIN;
+    while (replies < N_TASKS && poll(&pfd, 1, 1000) > 0)
+        main_drain();
+    shards_stop();
+
+    expect("all replies", replies == N_TASKS);
+    expect("right shard", !wrong_shard);
+    expect("in order", !out_of_order);
+
+    /* asked in private, from a nick on the other shard */
+    expect("two shards", shards_start(2) == 0);
+    for (i = 0; i < 100; i++) {
+        sprintf(nick, "n%d", i);
+        if (shard_of(&session, nick) != shard_of(&session, "#poker"))
+            break;
+    }
+    expect("a nick elsewhere", i < 100);
+    expect("game opened", run_on(shard_of(&session, "#poker"), &session, "#poker",
+                                 open_game));
+    s = private_channel("game #Poker", chan, sizeof chan)
+        ? shard_of(&session, chan) : shard_of(&session, nick);
+    expect("where the game is", run_on(s, &session, chan, has_game));
+    expect("not a channel", !private_channel("game", chan, sizeof chan)
+                            && !private_channel("top 5", chan, sizeof chan));
+    expect("game closed", run_on(shard_of(&session, "#poker"), &session, "#poker",
+                                 close_game));
+    shards_stop();
+    return failed;
+}
@@ -0,0 +1,154 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* statistical self-test for the shuffle.
+ *
+ * shuffles a sorted deck over and over (64 decks per shuffle_decks() call)
+ * and runs chi-squared tests on where each card ends up and on which two
+ * cards end up on top. with a fair shuffle, each statistic is close to its
+ * degrees of freedom; more than 5 standard deviations off counts as a
+ * failure. rng_below(), which seats tournaments, gets the same treatment.
+ *
+ * usage: testshuffle [number of shuffles]   (default 1,000,000) */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "deck.h"
+#include "rng.h"
+
+#define BATCH 64
+
+static long position_count[52][52];    /* [position][card] */
+static long top_two_count[52][52];     /* [top card][second card] */
+
+double get_time()
+{
+    /* used for benchmarking */
+    struct timeval t;
+    struct timezone tz;
+    gettimeofday(&t, &tz);
+    return t.tv_sec + t.tv_usec*1e-6;
+}
+
+int card_index(pcard_t c)
+{
+    return PCARD_SUIT(c) * 13 + PCARD_RANK(c);
+}
+
+int check(const char *what, double chi2, int dof)
+{
+    /* the chi-squared distribution has mean dof and variance 2 dof */
+    double z = (chi2 - dof) / sqrt(2.0 * dof);
+
+    printf("%-22s chi2 = %10.1f, dof = %d, z = %+.2f", what, chi2, dof, z);
+    if (fabs(z) > 5.0) {
+        puts("  FAIL");
+        return 1;
+    }
+    puts("");
+    return 0;
+}
+
+int check_bytes()
+{
+    /* shuffle_with_bytes() has to throw away biased bytes, and say so when
+     * it runs out */
+    pcard_t deck[52];
+    unsigned char rnd[200];
+    int used;
+
+    init_deck(deck);
+
+    /* 255 is always rejected for 52 cards (256 % 52 = 48) */
+    memset(rnd, 255, sizeof rnd);
+    if (shuffle_with_bytes(deck, 52, rnd, sizeof rnd) != -1) {
+        puts("shuffle_with_bytes() accepted only biased bytes  FAIL");
+        return 1;
+    }
+
+    /* zeroes are never rejected: one per swap */
+    memset(rnd, 0, sizeof rnd);
+    if ((used = shuffle_with_bytes(deck, 52, rnd, sizeof rnd)) != 51) {
+        printf("shuffle_with_bytes() used %d bytes instead of 51  FAIL\n", used);
+        return 1;
+    }
+    return 0;
+}
+
+int check_below(rng_t *rng)
+{
+    /* rng_below() over three quarters of the 32 bit numbers: with plain
+     * modulo, the first third would come up half the time */
+    const uint32_t n = 3u << 30;
+    long low = 0, i, draws = 30000;
+    int ok = 1;
+
+    for (i = 0; i < draws; i++)
+        low += rng_below(rng, n) < (1u << 30);
+    ok &= fabs(low - draws / 3.0) < 5 * sqrt(draws * 2.0 / 9.0);
+    for (i = 0; i < 1000; i++)
+        ok &= rng_below(rng, 7) < 7 && rng_below(rng, 1) == 0;
+    printf("%-22s %ld of %ld in the first third", "rng_below():", low, draws);
+    puts(ok ? "" : "  FAIL");
+    return !ok;
+}
+
+int main(int argc, char **argv)
+{
+    static pcard_t decks[BATCH][52];
+    pcard_t sorted[52];
+    unsigned char key[] = "testshuffle";
+    rng_t rng;
+    long n = 1000000;
+    long done;
+    int b, i, c;
+    int failed = 0;
+    double start_time, chi2, expected;
+
+    if (argc > 1)
+        n = atol(argv[1]);
+    n -= n % BATCH;
+
+    /* fixed key: same run every time */
+    rng.interval = 0;
+    rng_seed(&rng, key, sizeof key - 1);
+    init_deck(sorted);
+
+    start_time = get_time();
+    for (done = 0; done < n; done += BATCH) {
+        for (b = 0; b < BATCH; b++)
+            memcpy(decks[b], sorted, sizeof sorted);
+        shuffle_decks(&rng, decks, BATCH);
+        for (b = 0; b < BATCH; b++) {
+            for (i = 0; i < 52; i++)
+                position_count[i][card_index(decks[b][i])]++;
+            top_two_count[card_index(decks[b][0])][card_index(decks[b][1])]++;
+        }
+    }
+    printf("Shuffled %ld decks in %f\n", n, get_time() - start_time);
+
+    chi2 = 0;
+    expected = n / 52.0;
+    for (i = 0; i < 52; i++)
+        for (c = 0; c < 52; c++)
+            chi2 += (position_count[i][c] - expected)
+                  * (position_count[i][c] - expected) / expected;
+    /* every row and every column adds up to n */
+    failed |= check("card by position:", chi2, 51 * 51);
+
+    chi2 = 0;
+    expected = n / (52.0 * 51.0);
+    for (i = 0; i < 52; i++)
+        for (c = 0; c < 52; c++)
+            if (i != c)
+                chi2 += (top_two_count[i][c] - expected)
+                      * (top_two_count[i][c] - expected) / expected;
+    failed |= check("top two cards:", chi2, 52 * 51 - 1);
+
+    failed |= check_bytes();
+    failed |= check_below(&rng);
+
+    return failed;
+}
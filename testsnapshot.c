@@ -0,0 +1,256 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* snapshots: a table goes into a snapshot and plays on with the history
+ * running. the snapshot, caught up with the history, has to give every
+ * seat the chips the live table has, and the game restored from it has to
+ * be the same table. the stats go along, and caught up the same way have
+ * to come out as the live ones, along with a hand dealt where there was no
+ * table after the snapshot was taken but before it was written. a hand
+ * still going on is called off, and a file that's been tampered with is
+ * turned away. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "engine.h"
+#include "snapshot.h"
+
+#define HANDS 100
+
+/* where the stats are caught up, apart from the live ones */
+#define REPLAYED ((const void *) 1)
+
+static int failed = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void play(game_tp g, int hands)
+{
+    static const enum action moves[] = {
+        ACT_CHECK, ACT_CALL, ACT_CALL, ACT_RAISE, ACT_FOLD
+    };
+    static unsigned x = 12345;
+    struct event e;
+    int h, i;
+
+    for (h = 0; h < hands; h++) {
+        for (i = 0; i < g->n_players; i++)
+            if (g->players[i].chips < 20)
+                g->players[i].chips = 500;
+        engine_deal(g);
+        while (engine_next_event(g, &e))
+            ;
+        while (engine_waiting(g)) {
+            x = x * 1103515245 + 12345;
+            if (engine_act(g, g->turn, moves[(x >> 16) % 5], 10) != ACT_OK)
+                engine_act(g, g->turn, ACT_CALL, 0);
+            while (engine_next_event(g, &e))
+                ;
+        }
+    }
+}
+
+int same_chips(game_tp g, const struct snap_table *t)
+{
+    int i;
+
+    if (t->n_seats != g->n_players)
+        return 0;
+    for (i = 0; i < g->n_players; i++)
+        if (strcmp(t->seats[i].nick, g->players[i].nick) != 0
+                || t->seats[i].chips != g->players[i].chips)
+            return 0;
+    return 1;
+}
+
+void add_row(const char *server, const char *channel,
+             const struct player_stats *s, void *data)
+{
+    struct snap_stat *rows = data;
+    int i;
+
+    for (i = 0; rows[i].channel[0]; i++)
+        ;
+    snapshot_stat(server, channel, s, &rows[i]);
+}
+
+void replay_stats(const struct hand_record *r, void *data)
+{
+    struct hand_tally t;
+
+    tally_record(&t, r);
+    stats_add(REPLAYED, "irc.test.net", r->channel, &t);
+    ++*(int *) data;
+}
+
+int same_stats(game_tp g)
+{
+    struct player_stats live, replayed;
+    int i;
+
+    for (i = 0; i < g->n_players; i++) {
+        if (stats_get(NULL, "#test", g->players[i].nick, &live) != 0
+                || stats_get(REPLAYED, "#test", g->players[i].nick, &replayed) != 0
+                || memcmp(&live, &replayed, sizeof live) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+int main()
+{
+    static struct snap_table tables[2];
+    static struct snap_stat rows[8];
+    struct snapshot snap;
+    struct player_stats live;
+    char dir[] = "/tmp/testsnapshot.XXXXXX";
+    char path[1024], tmp[1040], hh[1040];
+    game_tp g, r, late;
+    FILE *f;
+    time_t taken;
+    int i, before, after, n, fed;
+    char nick[16];
+
+    if (!mkdtemp(dir)) {
+        perror(dir);
+        return 1;
+    }
+    snprintf(path, sizeof path, "%s/tables", dir);
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    expect("start", history_start(dir) == 0);
+
+    g = new_game(0);
+    g->server = "irc.test.net";
+    g->channel = strdup("#Test");
+    set_variant(g, &variants[VARIANT_SHORT_DECK]);
+    g->small_blind = 5;
+    g->big_blind = 10;
+    for (i = 0; i < 4; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = 500;
+        g->players[i].active = 1;
+    }
+    g->house = &g->players[0];
+    play(g, 10);
+
+    /* the table as it is */
+    taken = time(NULL);
+    snapshot_table(g, &tables[0]);
+    expect("server", strcmp(tables[0].server, "irc.test.net") == 0);
+    expect("channel", strcmp(tables[0].channel, "#Test") == 0);
+    expect("hands", tables[0].hands == 10);
+    expect("blinds", tables[0].small_blind == 5 && tables[0].big_blind == 10);
+    expect("house", tables[0].house == 0);
+    expect("button", tables[0].button == g->button);
+    expect("seats", same_chips(g, &tables[0]));
+
+    /* in the middle of a hand, everybody gets back what they put in */
+    for (i = 0, before = 0; i < g->n_players; i++)
+        before += g->players[i].chips;
+    engine_deal(g);
+    snapshot_table(g, &tables[1]);
+    expect("a row per player", stats_count() == 4);
+    stats_foreach(add_row, rows);
+    for (i = 0, after = 0; i < tables[1].n_seats; i++)
+        after += tables[1].seats[i].chips;
+    expect("hand called off", g->state != ENGINE_IDLE && after == before
+                              && tables[1].hands == 10);
+    while (engine_waiting(g))
+        if (engine_act(g, g->turn, ACT_FOLD, 0) != ACT_OK)
+            engine_act(g, g->turn, ACT_CALL, 0);
+
+    /* a hand where there was no table, before the file is written */
+    late = new_game(0);
+    late->server = "irc.test.net";
+    late->channel = strdup("#late");
+    for (i = 0; i < 2; i++) {
+        sprintf(nick, "q%d", i);
+        add_player(late, nick);
+        late->players[i].chips = 500;
+        late->players[i].active = 1;
+    }
+    play(late, 1);
+    free_game(late);
+
+    strcpy(tables[1].channel, "#other");
+    expect("write", snapshot_write(path, tables, 2, rows, 4, taken) == 0);
+    expect("no temporary file", access(tmp, F_OK) != 0);
+
+    /* the table plays on after the snapshot */
+    play(g, HANDS);
+    history_stop();
+
+    expect("open", snapshot_open(path, &snap) == 0);
+    expect("two tables", snap.n_tables == 2);
+    expect("stats rows", snap.n_stats == 4
+                         && strcmp(snap.stats[0].channel, "#Test") == 0
+                         && strcmp(snap.stats[0].server, "irc.test.net") == 0
+                         && memcmp(&snap.stats[0].stats, &rows[0].stats,
+                                   sizeof rows[0].stats) == 0);
+    for (i = 0; i < snap.n_stats; i++)
+        stats_restore(REPLAYED, snap.stats[i].server, snap.stats[i].channel,
+                      &snap.stats[i].stats, 1);
+    fed = 0;
+    n = snapshot_replay(&snap, dir, replay_stats, &fed);
+    /* the hand at the snapshot, then the rest, all on #Test */
+    expect("hands replayed", n == HANDS + 1);
+    expect("caught up", snap.n_tables == 2 && snap.tables[0].hands == g->hands);
+    expect("chips after replay", snap.n_tables == 2
+                                 && same_chips(g, &snap.tables[0]));
+    expect("every hand to the stats", fed == n + 1);
+    expect("the late hand", stats_get(REPLAYED, "#late", "q1", &live) == 0
+                            && live.hands == 1);
+    expect("stats caught up", same_stats(g));
+    expect("other table untouched", snap.n_tables == 2
+                                    && snap.tables[1].hands == 10);
+
+    /* and back into a game */
+    r = snapshot_restore(&snap.tables[0]);
+    expect("restore", r != NULL);
+    if (r) {
+        expect("restored channel", strcmp(r->channel, "#Test") == 0);
+        expect("restored hands", r->hands == g->hands);
+        expect("restored blinds", r->small_blind == 5 && r->big_blind == 10);
+        expect("restored variant", r->variant == g->variant);
+        expect("restored house", r->house == &r->players[0]);
+        snapshot_table(r, &tables[0]);
+        expect("restored chips", same_chips(g, &tables[0]));
+        free_game(r);
+    }
+    snapshot_close(&snap);
+    free_game(g);
+    stats_drop_session(NULL);
+    stats_drop_session(REPLAYED);
+
+    /* a flipped byte */
+    if ((f = fopen(path, "r+b"))) {
+        fseek(f, sizeof (struct snap_header) + 10, SEEK_SET);
+        fputc('x', f);
+        fclose(f);
+    }
+    expect("tampered", snapshot_open(path, &snap) != 0);
+    expect("missing", snapshot_open(tmp, &snap) != 0);
+
+    unlink(path);
+    for (i = 0; i < 2; i++) {
+        /* the history of today, and maybe of yesterday */
+        time_t now = time(NULL) - i * 86400;
+        char day[32];
+
+        strftime(day, sizeof day, "%Y%m%d.hh", gmtime(&now));
+        snprintf(hh, sizeof hh, "%s/%s", dir, day);
+        unlink(hh);
+    }
+    rmdir(dir);
+    return failed;
+}
@@ -0,0 +1,183 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the stats: a channel game played through the engine has to add up to
+ * what the chips did, and the leaderboard has to stay sorted by chips won
+ * while rows come, go up and down, and are restored. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "stats.h"
+
+#define HANDS 200
+#define NICKS 300
+#define TALLIES 5000
+
+static int failed = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+static unsigned x = 12345;
+
+unsigned next(void)
+{
+    x = x * 1103515245 + 12345;
+    return x >> 16;
+}
+
+int sorted(const struct player_stats *top, int n)
+{
+    int i;
+
+    for (i = 1; i < n; i++)
+        if (top[i - 1].net < top[i].net)
+            return 0;
+    return 1;
+}
+
+int main()
+{
+    static const enum action moves[] = {
+        ACT_CHECK, ACT_CALL, ACT_CALL, ACT_RAISE, ACT_FOLD
+    };
+    static struct player_stats top[NICKS + 1];
+    static int64_t net[NICKS];
+    struct player_stats st, row;
+    struct hand_tally t;
+    const void *channels = (const void *) 1;
+    int64_t game_net[4] = { 0 };
+    struct event e;
+    game_tp g;
+    char nick[16];
+    int h, i, ok, n;
+
+    /* a game through the engine */
+    g = new_game(0);
+    g->server = "irc.test.net";
+    g->channel = strdup("#Test");
+    g->small_blind = 5;
+    g->big_blind = 10;
+    for (i = 0; i < 4; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = 500;
+        g->players[i].active = 1;
+    }
+    for (h = 0; h < HANDS; h++) {
+        for (i = 0; i < g->n_players; i++) {
+            if (g->players[i].chips < 20)
+                g->players[i].chips = 500;
+            game_net[i] -= g->players[i].chips;
+        }
+        engine_deal(g);
+        while (engine_next_event(g, &e))
+            ;
+        while (engine_waiting(g)) {
+            if (engine_act(g, g->turn, moves[next() % 5], 10) != ACT_OK)
+                engine_act(g, g->turn, ACT_CALL, 0);
+            while (engine_next_event(g, &e))
+                ;
+        }
+        for (i = 0; i < g->n_players; i++)
+            game_net[i] += g->players[i].chips;
+    }
+
+    expect("a row per player", stats_count() == 4);
+    for (i = 0, ok = 1, n = 0; i < g->n_players; i++) {
+        ok &= stats_get(NULL, "#test", g->players[i].nick, &st) == 0
+              && st.hands == HANDS && st.net == game_net[i]
+              && st.raised <= st.vpip && st.vpip <= st.hands
+              && st.won <= st.hands && st.biggest_pot >= 0;
+        n += st.won;
+    }
+    expect("counted from the engine", ok);
+    expect("every hand won by somebody", n >= HANDS);
+    expect("nicks in any case", stats_get(NULL, "#TEST", "P1", &st) == 0
+                                && strcmp(st.nick, "p1") == 0);
+    expect("no such nick", stats_get(NULL, "#test", "nobody", &st) != 0);
+    expect("no such channel", stats_get(NULL, "#nowhere", "p1", &st) != 0);
+    free_game(g);
+
+    /* a limped pot: the big blind only checks its option */
+    g = new_game(0);
+    g->server = "irc.test.net";
+    g->channel = strdup("#limp");
+    g->small_blind = 5;
+    g->big_blind = 10;
+    for (i = 0; i < 3; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = 500;
+        g->players[i].active = 1;
+    }
+    engine_deal(g);
+    for (n = -1; engine_waiting(g); ) {
+        while (engine_next_event(g, &e))
+            if (e.type == EV_PROMPT_OPTION)
+                n = e.player;
+        engine_act(g, g->turn, ACT_CALL, 0);
+    }
+    for (i = 0, ok = n >= 0; n >= 0 && i < g->n_players; i++)
+        ok &= stats_get(NULL, "#limp", g->players[i].nick, &st) == 0
+              && st.hands == 1 && st.vpip == (i != n);
+    expect("the big blind's option isn't voluntary", ok);
+    free_game(g);
+
+    /* made up hands, many nicks at a table */
+    for (h = 0; h < TALLIES; h++) {
+        int first = next() % NICKS;
+
+        memset(&t, 0, sizeof t);
+        t.n_seats = 2 + next() % 8;
+        for (i = 0; i < t.n_seats; i++) {
+            int who = (first + i) % NICKS;
+
+            sprintf(t.nick[i], "n%d", who);
+            t.chips[i] = 1000;
+            t.chips_after[i] = 1000 + (int) (next() % 201) - 100;
+            if (next() % 2)
+                t.dealt |= SEAT_BIT(i);
+            else
+                continue;
+            net[who] += t.chips_after[i] - t.chips[i];
+        }
+        expect("add", stats_add(channels, "irc.test.net", "#many", &t) == 0);
+    }
+    n = stats_top(channels, "#many", top, NICKS + 1);
+    expect("everybody on the board", n <= NICKS && n == stats_count() - 7);
+    expect("sorted", sorted(top, n));
+    for (i = 0, ok = 1; i < n; i++)
+        ok &= net[atoi(top[i].nick + 1)] == top[i].net;
+    expect("chips won", ok);
+    expect("top few", stats_top(channels, "#many", top, 3) == 3 && sorted(top, 3));
+
+    /* the last one to the top, and back down */
+    n = stats_top(channels, "#many", top, NICKS);
+    row = top[n - 1];
+    row.net = top[0].net + 1;
+    expect("restore", stats_restore(channels, "irc.test.net", "#many", &row, 1) == 0);
+    expect("to the top", stats_top(channels, "#many", top, NICKS) == n
+                         && strcmp(top[0].nick, row.nick) == 0 && sorted(top, n));
+    row.net = top[n - 1].net - 1;
+    stats_restore(channels, "irc.test.net", "#many", &row, 1);
+    expect("to the bottom", stats_top(channels, "#many", top, NICKS) == n
+                            && strcmp(top[n - 1].nick, row.nick) == 0
+                            && sorted(top, n));
+    expect("restored row", stats_get(channels, "#many", row.nick, &st) == 0
+                           && memcmp(&st, &row, sizeof st) == 0);
+
+    stats_drop_session(channels);
+    expect("dropped", stats_count() == 7
+                      && stats_top(channels, "#many", top, 1) == 0);
+    stats_drop_session(NULL);
+    expect("all gone", stats_count() == 0);
+    return failed;
+}
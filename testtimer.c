@@ -0,0 +1,136 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the timer wheel: timers go off on time (never early, at most a tick
+ * late) on every level of the wheel, cancelled ones don't, and a timer
+ * may reschedule itself. then a million adds and cancels, for speed. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer.h"
+
+#define N_TIMERS 2000
+#define N_BENCH 1000000
+
+struct test_timer {
+    struct timer timer;
+    double due;
+    double fired;       /* when, or -1 */
+    int times;
+};
+
+static int failed = 0;
+static double clock_now;    /* the wheel's idea of now, in this test */
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void fire(struct timer *t)
+{
+    struct test_timer *tt = (struct test_timer *) t;
+
+    tt->fired = clock_now;
+    tt->times++;
+}
+
+void again(struct timer *t)
+{
+    /* three times, a second apart */
+    struct test_timer *tt = (struct test_timer *) t;
+
+    if (++tt->times < 3)
+        timer_add(t->wheel, t, clock_now, 1.0);
+}
+
+int main()
+{
+    static struct test_timer timers[N_TIMERS];
+    static struct timer bench[1024];
+    struct timer_wheel w;
+    struct test_timer re = { { 0 } };
+    int i, early = 0, late = 0, cancelled_fired = 0;
+    double start, delay;
+
+    timer_wheel_init(&w, 1000.0);
+    expect("nothing pending", timer_next(&w, 1000.0) < 0);
+
+    /* from a tenth of a second up to about a week */
+    srand(1);
+    clock_now = 1000.0;
+    for (i = 0; i < N_TIMERS; i++) {
+        delay = (i % 4 == 0) ? rand() % 100 / 10.0
+              : (i % 4 == 1) ? rand() % 5000 / 10.0
+              : (i % 4 == 2) ? rand() % 40000 / 10.0
+              : rand() % 6000000 / 10.0;
+        timers[i].timer.fn = fire;
+        timers[i].due = clock_now + delay;
+        timers[i].fired = -1;
+        timer_add(&w, &timers[i].timer, clock_now, delay);
+    }
+    /* every fifth one is called off */
+    for (i = 0; i < N_TIMERS; i += 5)
+        timer_cancel(&timers[i].timer);
+    expect("cancel twice is fine", (timer_cancel(&timers[0].timer), 1));
+    expect("pending", timer_pending(&timers[1].timer)
+                      && !timer_pending(&timers[0].timer));
+
+    /* in uneven steps, as an event loop would */
+    while (w.n_pending > 0) {
+        clock_now += (rand() % 7 + 1) / 10.0;
+        timer_run(&w, clock_now);
+        if (clock_now > 1000.0 + 700000) {
+            expect("all done", 0);
+            break;
+        }
+    }
+    for (i = 0; i < N_TIMERS; i++) {
+        if (i % 5 == 0) {
+            cancelled_fired |= timers[i].fired >= 0;
+            continue;
+        }
+        if (timers[i].fired < timers[i].due - 1e-9)
+            early = 1;
+        /* a tick, plus the step it fell into */
+        if (timers[i].fired > timers[i].due + TIMER_TICK + 0.7 + 1e-9
+                || timers[i].times != 1)
+            late = 1;
+    }
+    expect("never early", !early);
+    expect("on time, once", !late);
+    expect("cancelled ones stay quiet", !cancelled_fired);
+
+    /* rescheduling from inside fn */
+    re.timer.fn = again;
+    timer_add(&w, &re.timer, clock_now, 1.0);
+    /* may wake up early, when the wheel goes round, but never late */
+    delay = timer_next(&w, clock_now);
+    expect("next", delay > 0 && delay <= 1.0 + TIMER_TICK);
+    for (i = 0; i < 50; i++) {
+        clock_now += TIMER_TICK;
+        timer_run(&w, clock_now);
+    }
+    expect("rescheduled", re.times == 3 && !timer_pending(&re.timer));
+
+    /* adding and cancelling shouldn't depend on how full the wheel is */
+    start = timer_now();
+    for (i = 0; i < N_BENCH; i++) {
+        struct timer *t = &bench[i % 1024];
+
+        t->fn = fire;
+        timer_add(&w, t, clock_now, (i % 9973) * 0.7);
+        if (i % 3 == 0)
+            timer_cancel(t);
+    }
+    printf("%d adds and %d cancels in %f\n", N_BENCH, N_BENCH / 3,
+           timer_now() - start);
+    for (i = 0; i < 1024; i++)
+        timer_cancel(&bench[i]);
+    expect("empty", w.n_pending == 0);
+
+    return failed;
+}
@@ -0,0 +1,329 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the tournaments: a field spread over tables on every shard has to play
+ * down to one winner, with everybody else placed exactly once, no table
+ * ever over its seats and the blinds going up on the clock; and a table
+ * that goes away by itself takes its players out with it. */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "engine.h"
+#include "registry.h"
+#include "shard.h"
+#include "tourney.h"
+
+#define N_SHARDS 4
+#define ENTRANTS 300
+#define SEATS 9
+#define STACK 300
+#define SIDE_ENTRANTS 20
+#define SECONDS 30          /* for it all to be over */
+
+static int failed = 0;
+static int session;         /* only its address matters */
+static const char *lobby = "#tourney";
+static const char *side = "#side";
+
+/* on the shards: */
+static int overfull = 0;
+static int max_big_blind = 0;
+static int hands = 0;
+/* on the lobby's shard only, read after the shards stop */
+static int placed[ENTRANTS + 1];
+static int n_placed = 0;
+static int winner = -1;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+void say(void *s, const char *to, const char *text)
+{
+    char nick[NICK_LEN];
+    int who, place;
+
+    if (strcmp(to, lobby) != 0)
+        return;
+    if (sscanf(text, "n%d finishes %d", &who, &place) == 2) {
+        if (place >= 1 && place <= ENTRANTS)
+            placed[place] = who;
+        n_placed++;
+    } else if (sscanf(text, "%31s wins the tournament!", nick) == 1) {
+        winner = atoi(nick + 1);
+    }
+}
+
+void dealt(game_tp g)
+{
+    /* loose, and all in every so often */
+    static __thread unsigned x = 12345;
+    struct event e;
+    int a;
+
+    if (g->n_players > SEATS)
+        __atomic_store_n(&overfull, 1, __ATOMIC_RELAXED);
+    while (engine_next_event(g, &e))
+        ;
+    while (engine_waiting(g)) {
+        x = x * 1103515245 + 12345;
+        a = (x >> 16) % 10;
+        if (a < 1)
+            engine_act(g, g->turn, ACT_ALL_IN, 0);
+        else if (a < 6 || engine_act(g, g->turn, ACT_CHECK, 0) != ACT_OK)
+            engine_act(g, g->turn, a < 6 ? ACT_CALL : ACT_FOLD, 0);
+        while (engine_next_event(g, &e))
+            ;
+    }
+    if (g->n_players > SEATS)
+        __atomic_store_n(&overfull, 1, __ATOMIC_RELAXED);
+    if (g->big_blind > __atomic_load_n(&max_big_blind, __ATOMIC_RELAXED))
+        __atomic_store_n(&max_big_blind, g->big_blind, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hands, 1, __ATOMIC_RELAXED);
+    tourney_hand_over(g);
+}
+
+/* something to do on a shard, and the answer back on the main thread */
+struct call {
+    struct task task;
+    void (*fn) (struct call *);
+    const char *lobby;
+    struct tourney_info info;
+    int result;
+};
+
+static int answered = 0;    /* main thread only */
+static struct call answer;
+
+void called(struct task *task)
+{
+    answer = *(struct call *) task;
+    answered = 1;
+    free(task);
+}
+
+void run_call(struct task *task)
+{
+    struct call *c = (struct call *) task;
+
+    c->fn(c);
+    c->task.run = called;
+    main_post(&c->task);
+}
+
+struct call *call(int shard, void (*fn) (struct call *), const char *where)
+{
+    struct call *c = calloc(1, sizeof *c);
+    struct pollfd pfd;
+
+    c->task.run = run_call;
+    c->fn = fn;
+    c->lobby = where;
+    answered = 0;
+    shard_post(shard, &c->task);
+    pfd.fd = main_mailbox_fd();
+    pfd.events = POLLIN;
+    while (!answered && poll(&pfd, 1, 1000) > 0)
+        main_drain();
+    return &answer;
+}
+
+void get_info(struct call *c)
+{
+    tourney_get(&session, c->lobby, &c->info);
+}
+
+void count_games(struct call *c)
+{
+    c->result = registry_count();
+}
+
+void end_table(struct call *c)
+{
+    /* like being kicked out of the channel */
+    game_tp g = registry_remove(&session, c->lobby);
+
+    c->result = g != NULL;
+    if (g)
+        free_game(g);
+}
+
+void open_main(struct call *c)
+{
+    struct tourney_rules rules = tourney_defaults;
+    char nick[16];
+    int i, ok = 1;
+
+    rules.seats = SEATS;
+    rules.stack = STACK;
+    rules.level_seconds = 1;
+    rules.turn_seconds = 0;
+    rules.pause = 0;
+    ok &= tourney_open(&session, "irc.test.net", lobby, "boss", &rules) == TOURNEY_OK;
+    ok &= tourney_open(&session, "irc.test.net", lobby, "boss", &rules) == TOURNEY_ALREADY_ON;
+    ok &= tourney_start(&session, lobby, "boss") == TOURNEY_TOO_FEW;
+    for (i = 0; i < ENTRANTS; i++) {
+        sprintf(nick, "n%d", i);
+        ok &= tourney_join(&session, lobby, nick) == TOURNEY_OK;
+    }
+    ok &= tourney_join(&session, lobby, "N7") == TOURNEY_ALREADY_IN;
+    ok &= tourney_leave(&session, lobby, "n7") == TOURNEY_OK;
+    ok &= tourney_leave(&session, lobby, "n7") == TOURNEY_NOT_IN;
+    ok &= tourney_join(&session, lobby, "n7") == TOURNEY_OK;
+    ok &= tourney_start(&session, lobby, "n1") == TOURNEY_NOT_HOUSE;
+    ok &= tourney_start(&session, lobby, "Boss") == TOURNEY_OK;
+    ok &= tourney_join(&session, lobby, "late") == TOURNEY_NOT_OPEN;
+    c->result = ok;
+}
+
+void open_side(struct call *c)
+{
+    /* nobody gets dealt a hand here */
+    struct tourney_rules rules = tourney_defaults;
+    char nick[16];
+    int i, ok = 1;
+
+    rules.seats = SIDE_ENTRANTS / 2;
+    rules.pause = 3600;
+    ok &= tourney_open(&session, "irc.test.net", side, "boss", &rules) == TOURNEY_OK;
+    for (i = 0; i < SIDE_ENTRANTS; i++) {
+        sprintf(nick, "s%d", i);
+        ok &= tourney_join(&session, side, nick) == TOURNEY_OK;
+    }
+    ok &= tourney_start(&session, side, "boss") == TOURNEY_OK;
+    c->result = ok;
+}
+
+void stop_side(struct call *c)
+{
+    c->result = tourney_stop(&session, side, "boss") == TOURNEY_OK;
+}
+
+void drop(struct call *c)
+{
+    tourney_drop_session(&session);
+}
+
+const struct tourney_info *info(const char *where)
+{
+    return &call(shard_of(&session, where), get_info, where)->info;
+}
+
+int games(void)
+{
+    int i, n = 0;
+
+    for (i = 0; i < shard_count(); i++)
+        n += call(i, count_games, NULL)->result;
+    return n;
+}
+
+/* asks until cond() or it's taking too long */
+int wait_for(const char *where, int (*cond) (const struct tourney_info *))
+{
+    double until = timer_now() + SECONDS;
+
+    while (!cond(info(where))) {
+        if (timer_now() > until)
+            return 0;
+        usleep(20000);
+    }
+    return 1;
+}
+
+int all_open(void)
+{
+    double until = timer_now() + SECONDS;
+    int n = (ENTRANTS + SEATS - 1) / SEATS;
+
+    while (games() != n) {
+        if (timer_now() > until)
+            return 0;
+        usleep(20000);
+    }
+    return 1;
+}
+
+int is_over(const struct tourney_info *i) { return i->state == TOURNEY_OVER && i->tables == 0; }
+int half_out(const struct tourney_info *i) { return i->left == SIDE_ENTRANTS / 2 && i->tables == 1; }
+
+int main()
+{
+    static const struct tourney_hooks hooks = { say, NULL, dealt };
+    const struct tourney_info *in;
+    struct tourney_info over;
+    int seen[ENTRANTS];
+    game_tp g;
+    char nick[16];
+    int i, ok;
+
+    /* out of the middle of the table, the button stays with its player */
+    g = new_game(0);
+    for (i = 0; i < 5; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+    }
+    g->house = &g->players[3];
+    g->button = 2;
+    remove_player(g, 1);
+    expect("button stays", strcmp(g->players[g->button].nick, "p2") == 0);
+    expect("house moves down", strcmp(g->house->nick, "p3") == 0);
+    expect("seats moved", find_player(g, "p4") == 3 && find_player(g, "p1") == -1);
+    remove_player(g, g->button);
+    expect("next in line", strcmp(g->players[next_player(g, g->button)].nick, "p3") == 0);
+    remove_player(g, find_player(g, "p3"));
+    expect("no house", g->house == NULL && g->n_players == 2);
+    free_game(g);
+
+    for (i = 0; i <= ENTRANTS; i++)
+        placed[i] = -1;
+    tourney_set_hooks(&hooks);
+    expect("start", shards_start(N_SHARDS) == 0);
+
+    /* a table gone, then the lot stopped */
+    expect("side open", call(shard_of(&session, side), open_side, NULL)->result);
+    in = info(side);
+    expect("two tables", in->state == TOURNEY_RUNNING && in->tables == 2
+                         && in->left == SIDE_ENTRANTS);
+    expect("kicked out", call(shard_of(&session, "#side-1"), end_table, "#side-1")->result);
+    expect("with its players", wait_for(side, half_out));
+    expect("stop", call(shard_of(&session, side), stop_side, NULL)->result);
+    expect("stopped", wait_for(side, is_over));
+    expect("tables closed", games() == 0);
+
+    /* the real thing */
+    expect("open", call(shard_of(&session, lobby), open_main, NULL)->result);
+    in = info(lobby);
+    expect("running", in->state == TOURNEY_RUNNING && in->entrants == ENTRANTS
+                      && in->tables == (ENTRANTS + SEATS - 1) / SEATS);
+    expect("opened", all_open());
+    expect("over", wait_for(lobby, is_over));
+    over = *info(lobby);
+    expect("one left", over.left == 1);
+    expect("every table closed", games() == 0);
+    call(shard_of(&session, lobby), drop, NULL);
+    expect("dropped", info(lobby)->state == TOURNEY_NONE);
+    shards_stop();
+
+    memset(seen, 0, sizeof seen);
+    for (i = 2, ok = n_placed == ENTRANTS - 1; i <= ENTRANTS; i++)
+        if (placed[i] >= 0 && placed[i] < ENTRANTS)
+            seen[placed[i]]++;
+    ok &= winner >= 0 && winner < ENTRANTS && seen[winner] == 0;
+    for (i = 0; i < ENTRANTS; i++)
+        ok &= seen[i] == (i != winner);
+    expect("everybody placed once", ok);
+    expect("winner first", over.places[0][0] == 'n' && atoi(over.places[0] + 1) == winner);
+    expect("never more than the seats", !overfull);
+    expect("blinds went up", max_big_blind > 20 * STACK / TOURNEY_STACK);
+    if (failed)
+        printf("%d hands\n", hands);
+    return failed;
+}
@@ -0,0 +1,242 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+
+/* the variants: Omaha has to find the same best hand as trying every two
+ * hole cards with every three of the board, and no other; the short deck
+ * has to have its own straights and flushes; and games of each have to be
+ * dealt from the right deck, with the right number of cards. */
+
+#include <stdio.h>
+#include <string.h>
+#include "deck.h"
+#include "engine.h"
+#include "hand.h"
+
+#define DEALS 2000
+#define HANDS 200
+
+static int failed = 0;
+
+void expect(const char *what, int ok)
+{
+    if (!ok) {
+        printf("%s  FAIL\n", what);
+        failed = 1;
+    }
+}
+
+int omaha_by_hand(const pcard_t hole[], const pcard_t board[])
+{
+    /* the slow and obvious way */
+    pcard_t five[5];
+    int a, b, i, j, k, s, best = -1;
+
+    for (a = 0; a < 4; a++)
+        for (b = a + 1; b < 4; b++)
+            for (i = 0; i < 5; i++)
+                for (j = i + 1; j < 5; j++)
+                    for (k = j + 1; k < 5; k++) {
+                        five[0] = hole[a];
+                        five[1] = hole[b];
+                        five[2] = board[i];
+                        five[3] = board[j];
+                        five[4] = board[k];
+                        if ((s = eval_hand(five, 5)) > best)
+                            best = s;
+                    }
+    return best;
+}
+
+int eval(const struct variant *v, const pcard_t hole[], const pcard_t board[],
+         cardmask_t *best)
+{
+    return v->eval(hole, board, 5, best);
+}
+
+/* plays some hands. returns whether the cards dealt were
+ * all different and all from the variant's deck. */
+int play(game_tp g, int hands)
+{
+    static const enum action moves[] = {
+        ACT_CHECK, ACT_CALL, ACT_CALL, ACT_RAISE, ACT_FOLD
+    };
+    static unsigned x = 12345;
+    cardmask_t seen;
+    struct event e;
+    int h, i, k, ok = 1;
+
+    for (h = 0; h < hands; h++) {
+        for (i = 0; i < g->n_players; i++)
+            if (g->players[i].chips < 20)
+                g->players[i].chips = 500;
+        engine_deal(g);
+        seen = 0;
+        for (i = 0; i < g->n_players; i++) {
+            for (k = 0; k < g->variant->n_hole; k++) {
+                pcard_t c = g->players[i].hand[k];
+
+                ok &= !(seen & PCARD_BIT(c)) && PCARD_RANK(c) >= g->variant->low_rank;
+                seen |= PCARD_BIT(c);
+            }
+        }
+        while (engine_next_event(g, &e))
+            ;
+        while (engine_waiting(g)) {
+            x = x * 1103515245 + 12345;
+            if (engine_act(g, g->turn, moves[(x >> 16) % 5], 10) != ACT_OK)
+                engine_act(g, g->turn, ACT_CALL, 0);
+            while (engine_next_event(g, &e))
+                ;
+        }
+        for (i = 0; i < g->n_community; i++) {
+            pcard_t c = g->community[i];
+
+            ok &= !(seen & PCARD_BIT(c)) && PCARD_RANK(c) >= g->variant->low_rank;
+            seen |= PCARD_BIT(c);
+        }
+    }
+    return ok;
+}
+
+game_tp table(enum variant_id v, int n)
+{
+    game_tp g = new_game(0);
+    char nick[16];
+    int i;
+
+    set_variant(g, &variants[v]);
+    g->small_blind = 5;
+    g->big_blind = 10;
+    for (i = 0; i < n; i++) {
+        sprintf(nick, "p%d", i);
+        add_player(g, nick);
+        g->players[i].chips = 500;
+        g->players[i].active = 1;
+    }
+    return g;
+}
+
+int main()
+{
+    const struct variant *omaha = &variants[VARIANT_OMAHA];
+    const struct variant *shortdeck = &variants[VARIANT_SHORT_DECK];
+    pcard_t deck[52], full[52];
+    pcard_t hand[4], board[5], best[5];
+    cardmask_t used, all, mask;
+    rng_t rng;
+    struct event e;
+    game_tp g;
+    int d, i, ok, same, legal, s1, s2;
+
+    expect("by name", variant_named("OMAHA", 5) == omaha
+                      && variant_named("omah", 4) == NULL);
+
+    /* decks */
+    init_deck(full);
+    variant_deck(&variants[VARIANT_HOLDEM], deck);
+    expect("full deck", memcmp(deck, full, 52) == 0);
+    variant_deck(shortdeck, deck);
+    for (i = 0, ok = 1, all = 0; i < 36; i++) {
+        ok &= PCARD_RANK(deck[i]) >= 4 && !(all & PCARD_BIT(deck[i]));
+        all |= PCARD_BIT(deck[i]);
+    }
+    for (; i < 52; i++)
+        ok &= deck[i] == 0xff;
+    expect("sixes and up", ok);
+
+    /* Omaha, against every way there is */
+    rng.interval = 0;
+    rng_seed(&rng, (const unsigned char *) "omaha", 5);
+    for (d = 0, same = 1, legal = 1; d < DEALS; d++) {
+        init_deck(deck);
+        shuffle_decks(&rng, (pcard_t (*)[52]) deck, 1);
+        memcpy(hand, deck, 4);
+        memcpy(board, deck + 4, 5);
+        s1 = eval(omaha, hand, board, &used);
+        same &= s1 == omaha_by_hand(hand, board);
+        for (i = 0, mask = 0; i < 4; i++)
+            mask |= PCARD_BIT(hand[i]);
+        legal &= MASK_COUNT(used) == 5 && MASK_COUNT(used & mask) == 2;
+    }
+    expect("Omaha best hands", same);
+    expect("two from the hand", legal);
+
+    /* four hearts on the board and one in the hand are no flush */
+    board[0] = PCARD(HEARTS, 12);
+    board[1] = PCARD(HEARTS, 9);
+    board[2] = PCARD(HEARTS, 5);
+    board[3] = PCARD(HEARTS, 2);
+    board[4] = PCARD(CLUBS, 0);
+    hand[0] = PCARD(HEARTS, 11);
+    hand[1] = PCARD(SPADES, 7);
+    hand[2] = PCARD(DIAMONDS, 4);
+    hand[3] = PCARD(CLUBS, 3);
+    s1 = eval(omaha, hand, board, &used);
+    expect("no one card flush", STRENGTH_RANK(s1) != FLUSH);
+    s1 = variants[VARIANT_HOLDEM].eval(hand, board, 5, &used);
+    expect("in Hold'em it is", STRENGTH_RANK(s1) == FLUSH);
+
+    /* A 6 7 8 9 */
+    board[0] = PCARD(HEARTS, 12);
+    board[1] = PCARD(CLUBS, 4);
+    board[2] = PCARD(SPADES, 5);
+    board[3] = PCARD(DIAMONDS, 9);
+    board[4] = PCARD(CLUBS, 11);
+    hand[0] = PCARD(HEARTS, 6);
+    hand[1] = PCARD(SPADES, 7);
+    s1 = eval(shortdeck, hand, board, &used);
+    expect("short wheel", STRENGTH_RANK(s1) == STRAIGHT);
+    eval_best_hand(used, s1, best);
+    for (i = 0, mask = 0; i < 5; i++)
+        mask |= PCARD_BIT(best[i]);
+    expect("the ace in it", best[0] == PCARD(SPADES, 7) && best[4] == PCARD(HEARTS, 12)
+                            && MASK_COUNT(mask) == 5);
+    hand[0] = PCARD(HEARTS, 9);
+    hand[1] = PCARD(SPADES, 9);
+    s2 = eval(shortdeck, hand, board, &used);
+    expect("trips below the wheel", STRENGTH_RANK(s2) == THREEKIND && s2 < s1);
+    board[3] = PCARD(DIAMONDS, 6);
+    hand[0] = PCARD(HEARTS, 7);
+    hand[1] = PCARD(SPADES, 8);
+    s2 = eval(shortdeck, hand, board, &used);
+    expect("wheel lowest", STRENGTH_RANK(s2) == STRAIGHT && s2 > s1);
+
+    /* a flush over a full house */
+    board[0] = PCARD(HEARTS, 12);
+    board[1] = PCARD(HEARTS, 4);
+    board[2] = PCARD(HEARTS, 6);
+    board[3] = PCARD(CLUBS, 12);
+    board[4] = PCARD(CLUBS, 6);
+    hand[0] = PCARD(HEARTS, 10);
+    hand[1] = PCARD(HEARTS, 8);
+    s1 = eval(shortdeck, hand, board, &used);
+    hand[0] = PCARD(SPADES, 12);
+    hand[1] = PCARD(SPADES, 8);
+    s2 = eval(shortdeck, hand, board, &used);
+    expect("flush and full house", STRENGTH_RANK(s1) == FLUSH
+                                   && STRENGTH_RANK(s2) == FULLHOUSE && s1 > s2);
+    hand[1] = PCARD(DIAMONDS, 12);
+    s2 = eval(shortdeck, hand, board, &used);
+    expect("four of a kind", STRENGTH_RANK(s2) == FOURKIND && s2 > s1);
+
+    /* and at the table */
+    g = table(VARIANT_OMAHA, 6);
+    expect("Omaha hands", play(g, HANDS));
+    free_game(g);
+    g = table(VARIANT_SHORT_DECK, 6);
+    expect("short deck hands", play(g, HANDS));
+    free_game(g);
+    g = table(VARIANT_HOLDEM, 6);
+    expect("Hold'em hands", play(g, HANDS));
+    free_game(g);
+
+    g = table(VARIANT_OMAHA, omaha->max_players + 1);
+    expect("too many", engine_deal(g) != 0);
+    for (ok = 0; engine_next_event(g, &e); )
+        ok |= e.type == EV_TOO_MANY_PLAYERS && e.amount == omaha->max_players;
+    expect("said so", ok);
+    g->players[0].active = 0;
+    expect("one less", engine_deal(g) == 0);
+    free_game(g);
+    return failed;
+}
@@ -0,0 +1,158 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "timer.h"
+
+#include <string.h>
+#include <time.h>
+
+#define SLOT_BITS 6
+#define SLOT_MASK (TIMER_SLOTS - 1)
+#define MAX_DELAY ((1UL << (TIMER_LEVELS * SLOT_BITS)) - 1)
+/* the slot tick t falls into on level l */
+#define SLOT_OF(t, l) (((t) >> ((l) * SLOT_BITS)) & SLOT_MASK)
+
+static __thread struct timer_wheel thread_wheel;
+static __thread int thread_wheel_ready = 0;
+
+double
+timer_now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void
+timer_wheel_init (struct timer_wheel *w, double now)
+{
+    memset(w, 0, sizeof *w);
+    w->start = now;
+}
+
+struct timer_wheel *
+thread_timers (void)
+{
+    if (!thread_wheel_ready) {
+        timer_wheel_init(&thread_wheel, timer_now());
+        thread_wheel_ready = 1;
+    }
+    return &thread_wheel;
+}
+
+static void
+place (struct timer_wheel *w, struct timer *t)
+{
+    unsigned long d = t->expires - w->ticks;
+    struct timer **slot;
+    int l;
+
+    for (l = 0; l < TIMER_LEVELS - 1; l++)
+        if (d < 1UL << ((l + 1) * SLOT_BITS))
+            break;
+    slot = &w->slot[l][SLOT_OF(t->expires, l)];
+
+    if ((t->next = *slot))
+        t->next->pprev = &t->next;
+    *slot = t;
+    t->pprev = slot;
+}
+
+void
+timer_add (struct timer_wheel *w, struct timer *t, double now, double delay)
+{
+    /* in ticks from the next one to run. rounded up: never early. */
+    double at = (now + delay - w->start) / TIMER_TICK;
+    unsigned long d = 0;
+
+    if (at - w->ticks >= MAX_DELAY) {
+        d = MAX_DELAY;
+    } else if (at > w->ticks) {
+        d = at - w->ticks;
+        if (w->ticks + d < at)
+            d++;
+    }
+
+    timer_cancel(t);
+    t->expires = w->ticks + d;
+    t->wheel = w;
+    place(w, t);
+    w->n_pending++;
+}
+
+void
+timer_cancel (struct timer *t)
+{
+    if (!t->pprev)
+        return;
+    if ((*t->pprev = t->next))
+        t->next->pprev = t->pprev;
+    t->pprev = NULL;
+    t->wheel->n_pending--;
+}
+
+int
+timer_pending (const struct timer *t)
+{
+    return t->pprev != NULL;
+}
+
+static int
+cascade (struct timer_wheel *w, int l)
+{
+    /* spreads the current slot of level l out over the levels below.
+     * returns the slot, so the caller knows whether to go on up. */
+    int i = SLOT_OF(w->ticks, l);
+    struct timer *t = w->slot[l][i], *next;
+
+    w->slot[l][i] = NULL;
+    for (; t; t = next) {
+        next = t->next;
+        place(w, t);
+    }
+    return i;
+}
+
+void
+timer_run (struct timer_wheel *w, double now)
+{
+    double upto = (now - w->start) / TIMER_TICK;
+    struct timer *t;
+    int i, l;
+
+    while (w->ticks <= upto) {
+        /* at the start of every round of level 0, the layers above move
+         * down */
+        i = SLOT_OF(w->ticks, 0);
+        for (l = 1; l < TIMER_LEVELS && i == 0; l++)
+            i = cascade(w, l);
+
+        /* all of them due now. fn() may add more, even into this slot. */
+        i = SLOT_OF(w->ticks, 0);
+        while ((t = w->slot[0][i])) {
+            timer_cancel(t);
+            t->fn(t);
+        }
+        w->ticks++;
+    }
+}
+
+double
+timer_next (const struct timer_wheel *w, double now)
+{
+    /* the first busy slot before level 0 goes round, or else when it
+     * does: timers further out may come down then. */
+    unsigned long t = w->ticks;
+    double wait;
+
+    if (w->n_pending == 0)
+        return -1;
+    do {
+        if (w->slot[0][SLOT_OF(t, 0)])
+            break;
+        t++;
+    } while (SLOT_OF(t, 0) != 0);
+
+    wait = w->start + t * TIMER_TICK - now;
+    return wait > 0 ? wait : 0;
+}
@@ -0,0 +1,59 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+/* Timers on a hierarchical wheel, the way old Linux kernels did it.
+ *
+ * Time goes by in ticks. The first level has a slot for each of the next
+ * 64 ticks; every level above has slots 64 times as wide. A timer goes
+ * into the slot its deadline falls into, and whenever a level has gone
+ * round once, the next slot of the level above gets spread out over it.
+ * Adding and cancelling are a couple of pointer moves, whatever the number
+ * of timers, and an event loop only has to ask timer_next() how long it
+ * may sleep.
+ *
+ * A wheel belongs to one thread. thread_timers() is the one the running
+ * event loop drives. */
+
+#define TIMER_TICK 0.1      /* seconds */
+#define TIMER_LEVELS 4      /* 64^4 ticks: about 19 days */
+#define TIMER_SLOTS 64
+
+struct timer_wheel;
+
+struct timer {
+    void (*fn) (struct timer *);    /* called once, after it's off the wheel */
+    unsigned long expires;          /* tick */
+    struct timer *next, **pprev;    /* pprev is NULL when not pending */
+    struct timer_wheel *wheel;
+};
+
+struct timer_wheel {
+    double start;           /* when tick 0 was */
+    unsigned long ticks;    /* the next tick to run */
+    struct timer *slot[TIMER_LEVELS][TIMER_SLOTS];
+    int n_pending;
+};
+
+/* seconds, on a clock that never goes back */
+double timer_now (void);
+
+void timer_wheel_init (struct timer_wheel *w, double now);
+/* this thread's wheel, started the first time it's asked for */
+struct timer_wheel *thread_timers (void);
+
+/* (re)schedules t to go off `delay' seconds after now. t->fn has to be set. */
+void timer_add (struct timer_wheel *w, struct timer *t, double now, double delay);
+/* fine to call on a timer that isn't pending */
+void timer_cancel (struct timer *t);
+int timer_pending (const struct timer *t);
+
+/* runs every timer that's due by now */
+void timer_run (struct timer_wheel *w, double now);
+/* seconds until timer_run() may have something to do, or -1 if nothing's
+ * pending */
+double timer_next (const struct timer_wheel *w, double now);
+
+#endif
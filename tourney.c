@@ -0,0 +1,1067 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#include "tourney.h"
+#include "engine.h"
+#include "log.h"
+#include "registry.h"
+#include "shard.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_NAMES 16
+#define SAY_MAX 512
+
+/* the blinds, for a TOURNEY_STACK stack and in proportion to any other.
+ * after the last level they double with every one. */
+static const int blind_levels[][2] = {
+    { 10, 20 }, { 15, 30 }, { 25, 50 }, { 50, 100 }, { 75, 150 },
+    { 100, 200 }, { 150, 300 }, { 200, 400 }, { 300, 600 }, { 400, 800 },
+    { 500, 1000 }, { 700, 1400 }, { 1000, 2000 }
+};
+#define N_LEVELS ((int) (sizeof blind_levels / sizeof blind_levels[0]))
+
+const struct tourney_rules tourney_defaults = {
+    TOURNEY_SEATS, TOURNEY_STACK, TOURNEY_LEVEL, TOURNEY_TURN, TOURNEY_PAUSE,
+    &variants[VARIANT_HOLDEM]
+};
+
+static struct tourney_hooks hooks;
+
+struct seat {
+    char nick[NICK_LEN];
+    int chips;
+};
+
+/* Between the director and the tables. One kind of task for all of it, like
+ * the IRC side's: whoever runs it frees it, unless it's an order that has
+ * to wait for the end of the hand. */
+enum msg_op {
+    /* to a table */
+    MSG_OPEN,       /* a new table, with the seats in it */
+    MSG_BLINDS,     /* from the next hand on */
+    MSG_MOVE,       /* a seat to the table in `to' */
+    MSG_CLOSE,
+    MSG_SEAT,       /* from another table: the seat, or nobody */
+    /* to the director */
+    MSG_REPORT      /* after a hand: how the table stands, who went out */
+};
+
+struct tourney_msg {
+    struct task task;
+    enum msg_op op;
+    void *session;
+    char lobby[TOURNEY_CHANNEL];    /* the tournament's */
+    unsigned id;
+    int table;                      /* at the director, or -1 */
+    char channel[TOURNEY_CHANNEL];  /* the table's */
+    char to[TOURNEY_CHANNEL];       /* MSG_MOVE */
+    struct tourney_msg *next;       /* orders waiting at the table */
+    const char *server;             /* MSG_OPEN */
+    struct tourney_rules rules;
+    int small_blind, big_blind, level;
+    /* MSG_REPORT */
+    int seated, gone;
+    unsigned moved_out, moved_in;
+    struct seat leader;
+    int n;
+    struct seat seats[];
+};
+
+/* a table's side, owned by its thread */
+struct tourney_table {
+    game_tp game;
+    char lobby[TOURNEY_CHANNEL];
+    unsigned id;
+    int index;
+    int small_blind, big_blind, level;  /* from the next hand on */
+    int shown_level;
+    unsigned moved_out, moved_in;       /* seats, all told */
+    struct tourney_msg *orders, **orders_tail;
+    int closing;
+    double pause;
+    struct timer deal_timer;
+};
+
+/* a table, as the director sees it */
+struct table_count {
+    char channel[TOURNEY_CHANNEL];
+    int shard;
+    /* as it last said */
+    int seated;
+    unsigned moved_out, moved_in;
+    struct seat leader;
+    /* as it was told */
+    unsigned sent_out, sent_in;
+    int closed;                     /* told to, or gone */
+    int count;                      /* what it will have: its bucket */
+    struct table_count *next, **pprev;
+};
+
+struct tourney {
+    struct tourney *next;           /* on this thread */
+    void *session;
+    const char *server;
+    char lobby[TOURNEY_CHANNEL];
+    unsigned id;
+    char house[NICK_LEN];
+    struct tourney_rules rules;
+    enum tourney_state state;
+    char (*entrants)[NICK_LEN];
+    int n_entrants, cap;
+    char (*places)[NICK_LEN];       /* first place first, filled from the back */
+    int left;
+    struct table_count *tables;
+    int n_tables, n_open;
+    struct table_count *bucket[MAX_PLAYERS + 1];    /* by count */
+    int level;
+    struct timer level_timer;
+    double level_at;                /* when the next one is */
+    rng_t rng;
+};
+
+static __thread struct tourney *tourneys;
+static __thread unsigned last_id;
+
+static void run_msg (struct task *task);
+
+void
+tourney_set_hooks (const struct tourney_hooks *h)
+{
+    hooks = *h;
+}
+
+static void
+say (void *session, const char *to, const char *fmt, ...)
+{
+    char text[SAY_MAX];
+    va_list ap;
+
+    if (!hooks.say)
+        return;
+    va_start(ap, fmt);
+    vsnprintf(text, sizeof text, fmt, ap);
+    va_end(ap);
+    hooks.say(session, to, text);
+}
+
+static const char *
+ordinal (int n)
+{
+    if (n % 100 >= 11 && n % 100 <= 13)
+        return "th";
+    switch (n % 10) {
+        case 1: return "st";
+        case 2: return "nd";
+        case 3: return "rd";
+        default: return "th";
+    }
+}
+
+static void
+get_blinds (const struct tourney_rules *rules, int level, int *small, int *big)
+{
+    int i = level < N_LEVELS ? level : N_LEVELS - 1;
+    long s = blind_levels[i][0], b = blind_levels[i][1];
+
+    for (; i < level && b < INT_MAX / 4; i++) {
+        s *= 2;
+        b *= 2;
+    }
+    s = s * rules->stack / TOURNEY_STACK;
+    b = b * rules->stack / TOURNEY_STACK;
+    *small = s > 0 ? s : 1;
+    *big = b > *small ? b : *small + 1;
+}
+
+static struct tourney_msg *
+new_msg (enum msg_op op, void *session, const char *lobby, unsigned id,
+         int table, const char *channel, int n)
+{
+    struct tourney_msg *m = calloc(1, sizeof *m + n * sizeof m->seats[0]);
+
+    if (!m) {
+        log_msg(LOG_ERROR, "out of memory, a tournament in %s loses track.", lobby);
+        return NULL;
+    }
+    m->task.run = run_msg;
+    m->op = op;
+    m->session = session;
+    strcpy(m->lobby, lobby);
+    m->id = id;
+    m->table = table;
+    if (channel)
+        strcpy(m->channel, channel);
+    m->n = n;
+    return m;
+}
+
+static void
+post_director (struct tourney_msg *m)
+{
+    /* the director is where the lobby's commands go */
+    shard_post(shard_of(m->session, m->lobby), &m->task);
+}
+
+/*
+ * The director's side.
+ */
+
+static struct tourney *
+find_tourney (const void *session, const char *lobby)
+{
+    struct tourney *t;
+
+    for (t = tourneys; t; t = t->next)
+        if (t->session == session && irc_casecmp(t->lobby, lobby) == 0)
+            return t;
+    return NULL;
+}
+
+static void
+free_tourney (struct tourney *t)
+{
+    struct tourney **pp;
+
+    for (pp = &tourneys; *pp; pp = &(*pp)->next)
+        if (*pp == t) {
+            *pp = t->next;
+            break;
+        }
+    timer_cancel(&t->level_timer);
+    free(t->entrants);
+    free(t->places);
+    free(t->tables);
+    free(t);
+}
+
+static int
+expected (const struct table_count *tc)
+{
+    /* what it has, once every order so far has been carried out */
+    long n = (long) tc->seated - (long) (tc->sent_out - tc->moved_out)
+                               + (long) (tc->sent_in - tc->moved_in);
+
+    return n < 0 ? 0 : n > MAX_PLAYERS ? MAX_PLAYERS : (int) n;
+}
+
+static int
+none_leaving (const struct table_count *tc)
+{
+    return tc->sent_out == tc->moved_out;
+}
+
+static int
+none_coming (const struct table_count *tc)
+{
+    return tc->sent_in == tc->moved_in;
+}
+
+static int
+quiet (const struct table_count *tc)
+{
+    return none_leaving(tc) && none_coming(tc);
+}
+
+static void
+unbucket (struct table_count *tc)
+{
+    if (!tc->pprev)
+        return;
+    if ((*tc->pprev = tc->next))
+        tc->next->pprev = tc->pprev;
+    tc->pprev = NULL;
+}
+
+static void
+rebucket (struct tourney *t, struct table_count *tc)
+{
+    unbucket(tc);
+    if (tc->closed)
+        return;
+    tc->count = expected(tc);
+    if ((tc->next = t->bucket[tc->count]))
+        tc->next->pprev = &tc->next;
+    tc->pprev = &t->bucket[tc->count];
+    t->bucket[tc->count] = tc;
+}
+
+static struct table_count *
+pick (struct tourney *t, int fullest, int (*ok) (const struct table_count *))
+{
+    /* the emptiest or the fullest table that's ok() */
+    struct table_count *tc;
+    int i;
+
+    for (i = 0; i <= MAX_PLAYERS; i++)
+        for (tc = t->bucket[fullest ? MAX_PLAYERS - i : i]; tc; tc = tc->next)
+            if (ok(tc))
+                return tc;
+    return NULL;
+}
+
+static struct tourney_msg *
+table_msg (struct tourney *t, enum msg_op op, struct table_count *tc, int n)
+{
+    return new_msg(op, t->session, t->lobby, t->id, tc - t->tables, tc->channel, n);
+}
+
+static int
+order_move (struct tourney *t, struct table_count *from, struct table_count *to)
+{
+    struct tourney_msg *m = table_msg(t, MSG_MOVE, from, 0);
+
+    if (!m)
+        return -1;
+    strcpy(m->to, to->channel);
+    from->sent_out++;
+    to->sent_in++;
+    if (from->pprev)
+        rebucket(t, from);
+    rebucket(t, to);
+    shard_post(from->shard, &m->task);
+    return 0;
+}
+
+static void
+close_table (struct tourney *t, struct table_count *tc)
+{
+    struct tourney_msg *m;
+
+    if (tc->closed)
+        return;
+    tc->closed = 1;
+    unbucket(tc);
+    t->n_open--;
+    if ((m = table_msg(t, MSG_CLOSE, tc, 0)))
+        shard_post(tc->shard, &m->task);
+}
+
+static void
+balance (struct tourney *t)
+{
+    struct table_count *from, *to;
+    int need = (t->left + t->rules.seats - 1) / t->rules.seats;
+    int c;
+
+    /* more tables than it takes: break up the emptiest. only one that has
+     * nothing on its way, or its seats could come to nothing. */
+    while (t->n_open > need && (from = pick(t, 0, quiet))) {
+        unbucket(from);
+        for (c = from->count; c > 0; c--)
+            if (!(to = pick(t, 0, none_leaving)) || to->count >= t->rules.seats
+                    || order_move(t, from, to) != 0)
+                break;
+        if (c > 0) {
+            rebucket(t, from);
+            break;
+        }
+        close_table(t, from);
+    }
+
+    /* then even out the rest. seats only go one way at a table, so none
+     * ever has more than it should, even while a hand is on */
+    while ((from = pick(t, 1, none_coming)) && (to = pick(t, 0, none_leaving))
+            && from->count - to->count > 1)
+        if (order_move(t, from, to) != 0)
+            break;
+}
+
+static int
+by_chips (const void *a, const void *b)
+{
+    /* most first */
+    const struct seat *x = a, *y = b;
+
+    return (y->chips > x->chips) - (y->chips < x->chips);
+}
+
+static void
+go_out (struct tourney *t, struct seat *out, int n)
+{
+    int i, place;
+
+    qsort(out, n, sizeof *out, by_chips);
+    for (i = 0; i < n; i++) {
+        place = t->left - n + 1 + i;
+        if (place < 1 || place > t->n_entrants)
+            continue;
+        strcpy(t->places[place - 1], out[i].nick);
+        say(t->session, t->lobby, "%s finishes %d%s.", out[i].nick, place,
+            ordinal(place));
+    }
+    t->left = t->left > n ? t->left - n : 0;
+}
+
+static int
+has_players (const struct table_count *tc)
+{
+    return tc && !tc->closed && tc->seated > 0;
+}
+
+static void
+finish (struct tourney *t, const struct table_count *last)
+{
+    /* the winner is at the table that reported last, unless that one's
+     * gone: then at the first with anybody left */
+    int i;
+
+    t->state = TOURNEY_OVER;
+    timer_cancel(&t->level_timer);
+    for (i = 0; !has_players(last) && i < t->n_tables; i++)
+        last = &t->tables[i];
+    if (has_players(last))
+        strcpy(t->places[0], last->leader.nick);
+    if (t->places[0][0])
+        say(t->session, t->lobby, "%s wins the tournament!", t->places[0]);
+    else
+        say(t->session, t->lobby, "The tournament is over.");
+    for (i = 0; i < t->n_tables; i++)
+        close_table(t, &t->tables[i]);
+}
+
+static void
+run_report (struct tourney *t, struct tourney_msg *m)
+{
+    struct table_count *tc = NULL;
+
+    if (m->table >= 0 && m->table < t->n_tables)
+        tc = &t->tables[m->table];
+    if (tc) {
+        tc->seated = m->seated;
+        tc->moved_out = m->moved_out;
+        tc->moved_in = m->moved_in;
+        tc->leader = m->leader;
+        if (m->gone && !tc->closed) {
+            tc->closed = 1;
+            unbucket(tc);
+            t->n_open--;
+        }
+        rebucket(t, tc);
+    }
+    if (t->state != TOURNEY_RUNNING)
+        return;
+
+    if (m->n > 0)
+        go_out(t, m->seats, m->n);
+    if (t->left <= 1)
+        finish(t, tc);
+    else
+        balance(t);
+}
+
+static void
+level_up (struct timer *timer)
+{
+    struct tourney *t = (struct tourney *)
+                        ((char *) timer - offsetof(struct tourney, level_timer));
+    struct tourney_msg *m;
+    int i, small, big;
+
+    t->level++;
+    get_blinds(&t->rules, t->level, &small, &big);
+    for (i = 0; i < t->n_tables; i++) {
+        if (t->tables[i].closed || !(m = table_msg(t, MSG_BLINDS, &t->tables[i], 0)))
+            continue;
+        m->small_blind = small;
+        m->big_blind = big;
+        m->level = t->level;
+        shard_post(t->tables[i].shard, &m->task);
+    }
+    say(t->session, t->lobby, "Level %d: the blinds go up to %d / %d.",
+        t->level + 1, small, big);
+    t->level_at = timer_now() + t->rules.level_seconds;
+    timer_add(thread_timers(), timer, timer_now(), t->rules.level_seconds);
+}
+
+enum tourney_result
+tourney_open (void *session, const char *server, const char *lobby,
+              const char *house, const struct tourney_rules *rules)
+{
+    struct tourney *t = find_tourney(session, lobby);
+    int max;
+
+    if (t && t->state != TOURNEY_OVER)
+        return TOURNEY_ALREADY_ON;
+    if (strlen(lobby) + 2 >= TOURNEY_CHANNEL)
+        return TOURNEY_BAD_NAME;
+    if (t)
+        free_tourney(t);
+
+    if (!(t = calloc(1, sizeof *t)))
+        return TOURNEY_NO_MEMORY;
+    t->session = session;
+    t->server = server;
+    strcpy(t->lobby, lobby);
+    strncpy(t->house, house, NICK_LEN - 1);
+    t->id = ++last_id;
+    t->rules = *rules;
+    max = t->rules.variant->max_players;
+    if (max > MAX_PLAYERS)
+        max = MAX_PLAYERS;
+    if (t->rules.seats < 2 || t->rules.seats > max)
+        t->rules.seats = t->rules.seats < 2 ? 2 : max;
+    if (t->rules.stack < 1)
+        t->rules.stack = TOURNEY_STACK;
+    if (t->rules.level_seconds < 1)
+        t->rules.level_seconds = 1;
+    t->state = TOURNEY_OPEN;
+    t->level_timer.fn = level_up;
+    rng_init(&t->rng, 0);
+    t->next = tourneys;
+    tourneys = t;
+    return TOURNEY_OK;
+}
+
+static int
+find_entrant (const struct tourney *t, const char *nick)
+{
+    int i;
+
+    for (i = 0; i < t->n_entrants; i++)
+        if (irc_casecmp(t->entrants[i], nick) == 0)
+            return i;
+    return -1;
+}
+
+enum tourney_result
+tourney_join (const void *session, const char *lobby, const char *nick)
+{
+    struct tourney *t = find_tourney(session, lobby);
+    char (*e)[NICK_LEN];
+
+    if (!t)
+        return TOURNEY_NO_TOURNEY;
+    if (t->state != TOURNEY_OPEN)
+        return TOURNEY_NOT_OPEN;
+    if (find_entrant(t, nick) >= 0)
+        return TOURNEY_ALREADY_IN;
+    if (t->n_entrants == t->cap) {
+        int cap = t->cap ? 2 * t->cap : MIN_NAMES;
+
+        if (!(e = realloc(t->entrants, cap * sizeof *e)))
+            return TOURNEY_NO_MEMORY;
+        t->entrants = e;
+        t->cap = cap;
+    }
+    memset(t->entrants[t->n_entrants], 0, NICK_LEN);
+    strncpy(t->entrants[t->n_entrants++], nick, NICK_LEN - 1);
+    return TOURNEY_OK;
+}
+
+enum tourney_result
+tourney_leave (const void *session, const char *lobby, const char *nick)
+{
+    struct tourney *t = find_tourney(session, lobby);
+    int i;
+
+    if (!t)
+        return TOURNEY_NO_TOURNEY;
+    if (t->state != TOURNEY_OPEN)
+        return TOURNEY_NOT_OPEN;
+    if ((i = find_entrant(t, nick)) < 0)
+        return TOURNEY_NOT_IN;
+    memmove(t->entrants[i], t->entrants[i + 1],
+            (t->n_entrants - i - 1) * sizeof t->entrants[0]);
+    t->n_entrants--;
+    return TOURNEY_OK;
+}
+
+static void
+draw_seats (struct tourney *t)
+{
+    /* Fisher-Yates, as fair as the deck */
+    char nick[NICK_LEN];
+    int i, j;
+
+    for (i = t->n_entrants - 1; i > 0; i--) {
+        j = rng_below(&t->rng, i + 1);
+        memcpy(nick, t->entrants[i], NICK_LEN);
+        memcpy(t->entrants[i], t->entrants[j], NICK_LEN);
+        memcpy(t->entrants[j], nick, NICK_LEN);
+    }
+}
+
+enum tourney_result
+tourney_start (const void *session, const char *lobby, const char *nick)
+{
+    struct tourney *t = find_tourney(session, lobby);
+    struct tourney_msg **open;
+    struct table_count *tc;
+    char name[TOURNEY_CHANNEL];
+    int i, j, n, small, big;
+
+    if (!t)
+        return TOURNEY_NO_TOURNEY;
+    if (irc_casecmp(t->house, nick) != 0)
+        return TOURNEY_NOT_HOUSE;
+    if (t->state != TOURNEY_OPEN)
+        return TOURNEY_NOT_OPEN;
+    if (t->n_entrants < 2)
+        return TOURNEY_TOO_FEW;
+    n = (t->n_entrants + t->rules.seats - 1) / t->rules.seats;
+    if (snprintf(name, sizeof name, "%s-%d", t->lobby, n) >= (int) sizeof name)
+        return TOURNEY_BAD_NAME;
+
+    /* everything first, so it either all goes out or nothing does */
+    t->tables = calloc(n, sizeof *t->tables);
+    t->places = calloc(t->n_entrants, sizeof *t->places);
+    open = calloc(n, sizeof *open);
+    for (i = 0; t->tables && t->places && open && i < n; i++) {
+        /* no longer than the last one's, see above */
+        if (snprintf(t->tables[i].channel, TOURNEY_CHANNEL, "%s-%d", t->lobby,
+                     i + 1) >= TOURNEY_CHANNEL
+                || !(open[i] = new_msg(MSG_OPEN, t->session, t->lobby, t->id, i,
+                                       t->tables[i].channel,
+                                       (t->n_entrants - i + n - 1) / n)))
+            break;
+    }
+    if (i < n) {
+        while (open && i-- > 0)
+            free(open[i]);
+        free(open);
+        free(t->tables);
+        free(t->places);
+        t->tables = NULL;
+        t->places = NULL;
+        return TOURNEY_NO_MEMORY;
+    }
+
+    draw_seats(t);
+    get_blinds(&t->rules, 0, &small, &big);
+    t->n_tables = t->n_open = n;
+    t->left = t->n_entrants;
+    t->state = TOURNEY_RUNNING;
+    for (i = 0; i < n; i++) {
+        /* dealt round the tables, so none has more than one over another */
+        tc = &t->tables[i];
+        tc->shard = shard_of(t->session, tc->channel);
+        tc->seated = open[i]->n;
+        for (j = 0; j < open[i]->n; j++) {
+            strcpy(open[i]->seats[j].nick, t->entrants[i + j * n]);
+            open[i]->seats[j].chips = t->rules.stack;
+        }
+        open[i]->server = t->server;
+        open[i]->rules = t->rules;
+        open[i]->small_blind = small;
+        open[i]->big_blind = big;
+        rebucket(t, tc);
+    }
+
+    say(t->session, t->lobby, "The tournament is on: %d players at %d tables, "
+        "%d chips each. The blinds are %d / %d, and go up every %d seconds.",
+        t->n_entrants, n, t->rules.stack, small, big, t->rules.level_seconds);
+    t->level_at = timer_now() + t->rules.level_seconds;
+    timer_add(thread_timers(), &t->level_timer, timer_now(), t->rules.level_seconds);
+    for (i = 0; i < n; i++)
+        shard_post(t->tables[i].shard, &open[i]->task);
+    free(open);
+    return TOURNEY_OK;
+}
+
+enum tourney_result
+tourney_stop (const void *session, const char *lobby, const char *nick)
+{
+    struct tourney *t = find_tourney(session, lobby);
+    int i;
+
+    if (!t)
+        return TOURNEY_NO_TOURNEY;
+    if (irc_casecmp(t->house, nick) != 0)
+        return TOURNEY_NOT_HOUSE;
+    if (t->state == TOURNEY_OVER)
+        return TOURNEY_NOT_OPEN;
+    t->state = TOURNEY_OVER;
+    timer_cancel(&t->level_timer);
+    for (i = 0; i < t->n_tables; i++)
+        close_table(t, &t->tables[i]);
+    say(t->session, t->lobby, "The tournament is off.");
+    return TOURNEY_OK;
+}
+
+enum tourney_state
+tourney_get (const void *session, const char *lobby, struct tourney_info *info)
+{
+    struct tourney *t = find_tourney(session, lobby);
+    struct table_count *tc;
+    int i;
+
+    memset(info, 0, sizeof *info);
+    if (!t)
+        return info->state = TOURNEY_NONE;
+    info->state = t->state;
+    memcpy(info->house, t->house, NICK_LEN);
+    info->entrants = t->n_entrants;
+    info->left = t->left;
+    info->tables = t->n_open;
+    info->level = t->level + 1;
+    get_blinds(&t->rules, t->level, &info->small_blind, &info->big_blind);
+    info->next_level = t->level_at - timer_now();
+    info->leader_chips = -1;
+    for (i = 0, tc = t->tables; i < t->n_tables; i++, tc++)
+        if (!tc->closed && tc->leader.chips > info->leader_chips) {
+            memcpy(info->leader, tc->leader.nick, NICK_LEN);
+            info->leader_chips = tc->leader.chips;
+        }
+    for (i = 0; t->places && i < 3 && i < t->n_entrants; i++)
+        memcpy(info->places[i], t->places[i], NICK_LEN);
+    return t->state;
+}
+
+void
+tourney_drop_session (const void *session)
+{
+    struct tourney *t, *next;
+
+    for (t = tourneys; t; t = next) {
+        next = t->next;
+        if (t->session == session)
+            free_tourney(t);
+    }
+}
+
+/*
+ * The tables' side.
+ */
+
+static struct tourney_table *
+find_table (const struct tourney_msg *m)
+{
+    game_tp g = registry_get(m->session, m->channel);
+
+    if (!g || !g->tourney || g->tourney->id != m->id
+            || irc_casecmp(g->tourney->lobby, m->lobby) != 0)
+        return NULL;
+    return g->tourney;
+}
+
+static void
+report (struct tourney_table *tt, const struct seat *out, int n_out, int gone)
+{
+    /* everybody still at a table that's gone is out too */
+    game_tp g = tt->game;
+    struct tourney_msg *m;
+    int i;
+
+    if (!(m = new_msg(MSG_REPORT, g->session, tt->lobby, tt->id, tt->index,
+                      g->channel, n_out + (gone ? g->n_players : 0))))
+        return;
+    memcpy(m->seats, out, n_out * sizeof *out);
+    m->leader.chips = -1;
+    for (i = 0; i < g->n_players; i++) {
+        if (g->players[i].chips > m->leader.chips) {
+            memcpy(m->leader.nick, g->players[i].nick, NICK_LEN);
+            m->leader.chips = g->players[i].chips;
+        }
+        if (gone) {
+            memcpy(m->seats[n_out + i].nick, g->players[i].nick, NICK_LEN);
+            m->seats[n_out + i].chips = g->players[i].chips;
+        }
+    }
+    m->seated = gone ? 0 : g->n_players;
+    m->gone = gone;
+    m->moved_out = tt->moved_out;
+    m->moved_in = tt->moved_in;
+    post_director(m);
+}
+
+static void
+lost_seat (const struct tourney_msg *seat, const char *why)
+{
+    /* it has nowhere to go, so it's out */
+    struct tourney_msg *m;
+
+    log_msg(LOG_WARNING, "%s loses their seat in the %s tournament: %s.",
+            seat->seats[0].nick, seat->lobby, why);
+    if (!(m = new_msg(MSG_REPORT, seat->session, seat->lobby, seat->id, -1,
+                      NULL, 1)))
+        return;
+    m->seats[0] = seat->seats[0];
+    post_director(m);
+}
+
+static void
+send_seat (struct tourney_table *tt, const char *to, int nobody)
+{
+    /* the next big blind goes, so nobody gets to skip it by moving */
+    game_tp g = tt->game;
+    struct tourney_msg *m;
+    int i;
+
+    if (!(m = new_msg(MSG_SEAT, g->session, tt->lobby, tt->id, -1, to, 1)))
+        return;
+    m->n = 0;
+    if (!nobody && g->n_players > 0) {
+        i = (g->button + 2) % g->n_players;
+        memcpy(m->seats[0].nick, g->players[i].nick, NICK_LEN);
+        m->seats[0].chips = g->players[i].chips;
+        m->n = 1;
+        say(g->session, g->channel, "%s moves to %s.", m->seats[0].nick, to);
+        say(g->session, m->seats[0].nick, "Your seat in the tournament is at %s now.", to);
+        remove_player(g, i);
+    }
+    tt->moved_out++;
+    shard_post(shard_of(g->session, to), &m->task);
+}
+
+static void
+take_seat (struct tourney_msg *m)
+{
+    struct tourney_table *tt = find_table(m);
+    game_tp g;
+    int i;
+
+    if (!tt) {
+        if (m->n > 0)
+            lost_seat(m, "the table is gone");
+        return;
+    }
+    tt->moved_in++;
+    if (m->n == 0)
+        return;
+    g = tt->game;
+    if ((i = add_player(g, m->seats[0].nick)) < 0) {
+        lost_seat(m, "the table is full");
+        return;
+    }
+    /* not in this hand, if there is one */
+    g->players[i].chips = m->seats[0].chips;
+    g->players[i].active = 1;
+    g->players[i].folded = 1;
+    say(g->session, g->channel, "%s takes a seat with %d chips.",
+        g->players[i].nick, g->players[i].chips);
+}
+
+static void
+free_table (struct tourney_table *tt)
+{
+    /* orders it won't carry out any more: their seats come to nothing */
+    struct tourney_msg *m, *next;
+
+    for (m = tt->orders; m; m = next) {
+        next = m->next;
+        send_seat(tt, m->to, 1);
+        free(m);
+    }
+    timer_cancel(&tt->deal_timer);
+    tt->game->tourney = NULL;
+    free(tt);
+}
+
+static void
+close_here (struct tourney_table *tt, const struct seat *out, int n_out)
+{
+    game_tp g = tt->game;
+
+    report(tt, out, n_out, 1);
+    say(g->session, g->channel, "This table is closed. Thanks for playing!");
+    free_table(tt);
+    registry_remove(g->session, g->channel);
+    free_game(g);
+}
+
+static void
+between_hands (struct tourney_table *tt, const struct seat *out, int n_out)
+{
+    struct tourney_msg *m;
+
+    while ((m = tt->orders)) {
+        if (!(tt->orders = m->next))
+            tt->orders_tail = &tt->orders;
+        send_seat(tt, m->to, 0);
+        free(m);
+    }
+    if (tt->closing) {
+        close_here(tt, out, n_out);
+        return;
+    }
+    report(tt, out, n_out, 0);
+    timer_add(thread_timers(), &tt->deal_timer, timer_now(), tt->pause);
+}
+
+static int
+table_order (struct tourney_msg *m)
+{
+    /* returns 1 if it has to wait for the hand to end */
+    struct tourney_table *tt = find_table(m);
+    int idle;
+
+    if (!tt)
+        return 0;
+    idle = tt->game->state == ENGINE_IDLE;
+    switch (m->op) {
+        case MSG_BLINDS:
+            tt->small_blind = m->small_blind;
+            tt->big_blind = m->big_blind;
+            tt->level = m->level;
+            break;
+        case MSG_MOVE:
+            if (idle) {
+                send_seat(tt, m->to, 0);
+                break;
+            }
+            m->next = NULL;
+            *tt->orders_tail = m;
+            tt->orders_tail = &m->next;
+            return 1;
+        case MSG_CLOSE:
+            tt->closing = 1;
+            if (idle)
+                close_here(tt, NULL, 0);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void
+deal_next (struct timer *timer)
+{
+    struct tourney_table *tt = (struct tourney_table *)
+                               ((char *) timer - offsetof(struct tourney_table, deal_timer));
+    game_tp g = tt->game;
+    int i;
+
+    g->small_blind = tt->small_blind;
+    g->big_blind = tt->big_blind;
+    if (tt->level != tt->shown_level) {
+        say(g->session, g->channel, "Level %d: the blinds are %d / %d.",
+            tt->level + 1, g->small_blind, g->big_blind);
+        tt->shown_level = tt->level;
+    }
+    /* nobody sits out: whoever's away gets blinded away */
+    for (i = 0; i < g->n_players; i++)
+        g->players[i].active = 1;
+    if (engine_deal(g) != 0) {
+        /* too few here: the director will send more, or close the table */
+        engine_drop_events(g);
+        report(tt, NULL, 0, 0);
+        timer_add(thread_timers(), timer, timer_now(), tt->pause);
+        return;
+    }
+    if (hooks.dealt)
+        hooks.dealt(g);
+}
+
+static void
+open_table (struct tourney_msg *m)
+{
+    struct tourney_table *tt = NULL;
+    game_tp g = NULL;
+    int i;
+
+    if (registry_get(m->session, m->channel)
+            || !(g = new_game(0)) || !(tt = calloc(1, sizeof *tt))
+            || !(g->channel = strdup(m->channel))
+            || registry_add(m->session, m->channel, g) != 0) {
+        /* its players are out before they've played */
+        struct tourney_msg *r = new_msg(MSG_REPORT, m->session, m->lobby,
+                                        m->id, m->table, m->channel, m->n);
+
+        log_msg(LOG_ERROR, "can't open %s for the %s tournament.", m->channel, m->lobby);
+        free(tt);
+        if (g)
+            free_game(g);
+        if (r) {
+            memcpy(r->seats, m->seats, m->n * sizeof m->seats[0]);
+            r->gone = 1;
+            post_director(r);
+        }
+        return;
+    }
+
+    set_variant(g, m->rules.variant);
+    g->session = m->session;
+    g->server = m->server;
+    g->turn_seconds = m->rules.turn_seconds;
+    g->base_stock = m->rules.stack;
+    g->small_blind = tt->small_blind = m->small_blind;
+    g->big_blind = tt->big_blind = m->big_blind;
+    for (i = 0; i < m->n; i++) {
+        int p = add_player(g, m->seats[i].nick);
+
+        g->players[p].chips = m->seats[i].chips;
+        g->players[p].active = 1;
+    }
+    tt->game = g;
+    strcpy(tt->lobby, m->lobby);
+    tt->id = m->id;
+    tt->index = m->table;
+    tt->orders_tail = &tt->orders;
+    tt->pause = m->rules.pause;
+    tt->deal_timer.fn = deal_next;
+    g->tourney = tt;
+
+    if (hooks.opened)
+        hooks.opened(g);
+    say(g->session, g->channel, "Table %d of the tournament in %s. The blinds are %d / %d.",
+        m->table + 1, m->lobby, g->small_blind, g->big_blind);
+    for (i = 0; i < g->n_players; i++)
+        say(g->session, g->players[i].nick, "Your seat in the tournament is at %s.",
+            g->channel);
+    timer_add(thread_timers(), &tt->deal_timer, timer_now(), tt->pause);
+}
+
+void
+tourney_hand_over (game_tp g)
+{
+    struct tourney_table *tt = g->tourney;
+    struct seat out[MAX_PLAYERS];
+    int i, n = 0;
+
+    if (!tt || g->state != ENGINE_IDLE)
+        return;
+    for (i = g->n_players - 1; i >= 0; i--) {
+        if (g->players[i].chips > 0)
+            continue;
+        /* all they had went in this hand */
+        memcpy(out[n].nick, g->players[i].nick, NICK_LEN);
+        out[n++].chips = g->players[i].committed;
+        say(g->session, g->channel, "%s is out of the tournament.", g->players[i].nick);
+        remove_player(g, i);
+    }
+    between_hands(tt, out, n);
+}
+
+void
+tourney_forget (game_tp g)
+{
+    /* the game is going away by itself: the director has to hear of it */
+    if (!g->tourney)
+        return;
+    report(g->tourney, NULL, 0, 1);
+    free_table(g->tourney);
+}
+
+static void
+run_msg (struct task *task)
+{
+    struct tourney_msg *m = (struct tourney_msg *) task;
+    struct tourney *t;
+
+    switch (m->op) {
+        case MSG_OPEN:
+            open_table(m);
+            break;
+        case MSG_BLINDS:
+        case MSG_MOVE:
+        case MSG_CLOSE:
+            if (table_order(m))
+                return;
+            break;
+        case MSG_SEAT:
+            take_seat(m);
+            break;
+        case MSG_REPORT:
+            if ((t = find_tourney(m->session, m->lobby)) && t->id == m->id)
+                run_report(t, m);
+            break;
+    }
+    free(m);
+}
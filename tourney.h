@@ -0,0 +1,135 @@
+/* Copyright 2011 Tom Jollans <t@jollybox.de>
+ * This code is under the Chicken Dance License v0.1 */
+
+#ifndef TOURNEY_H
+#define TOURNEY_H
+
+#include "game.h"
+
+/* Tournaments: one field of players over many tables.
+ *
+ * A tournament is run from the channel it was opened in, the lobby, by a
+ * director that lives on the lobby's shard and is only ever touched there.
+ * Its tables are games on channels of their own (the lobby's name, a dash
+ * and a number), each on whichever shard its channel hashes to, like any
+ * other game. The two only ever talk through tasks: when a hand is over, a
+ * table tells the director how many are left and who went out, and the
+ * director answers with blinds, seats to send elsewhere, and when to
+ * close. Seats go from table to table as tasks too. Nothing is locked, and
+ * nobody looks at anybody else's memory.
+ *
+ * The blinds go up on a timer on the director's wheel; tables post the new
+ * ones from their next hand on. Tables deal on a timer of their own, a
+ * pause after every hand.
+ *
+ * A table only changes between hands. The director counts what each table
+ * has as it last said, less the seats it has been told to send away, plus
+ * the seats on their way to it, so orders that haven't been carried out
+ * yet are never given twice. The tables sit in buckets by that count, so
+ * the fullest and the emptiest are at hand however many there are. With
+ * more tables than the players left need, the emptiest one that has
+ * nothing on its way breaks up, a seat at a time to the emptiest of the
+ * rest; otherwise seats go from the fullest table to the emptiest until
+ * no two are more than one apart. Seats only ever go one way at a table
+ * until they've all got there, so none holds more than its seats even in
+ * the middle of a hand. A seat that has busted by the time its order comes
+ * is sent as nobody, so the counts stay right.
+ *
+ * Players go out when they have no chips left at the end of a hand. Out
+ * in the same hand, the one who started it with more finishes higher.
+ *
+ * Tournaments aren't in the snapshot: after a restart, there is none. */
+
+#define TOURNEY_SEATS 9
+#define TOURNEY_STACK 1500
+#define TOURNEY_LEVEL 600       /* seconds */
+#define TOURNEY_TURN 30
+#define TOURNEY_PAUSE 5.0       /* between hands */
+#define TOURNEY_CHANNEL 64      /* for a table's name, with the nul */
+
+enum tourney_state {
+    TOURNEY_NONE,
+    TOURNEY_OPEN,       /* taking names */
+    TOURNEY_RUNNING,
+    TOURNEY_OVER
+};
+
+enum tourney_result {
+    TOURNEY_OK,
+    TOURNEY_NO_TOURNEY,
+    TOURNEY_ALREADY_ON,     /* open or running */
+    TOURNEY_NOT_HOUSE,
+    TOURNEY_NOT_OPEN,       /* too late to sign up, or to start */
+    TOURNEY_ALREADY_IN,
+    TOURNEY_NOT_IN,
+    TOURNEY_TOO_FEW,
+    TOURNEY_BAD_NAME,       /* no room for the tables' names */
+    TOURNEY_NO_MEMORY
+};
+
+struct tourney_rules {
+    int seats;          /* per table, at most the variant's max_players */
+    int stack;          /* everybody's, to start with */
+    int level_seconds;  /* between raises of the blinds */
+    int turn_seconds;   /* see struct game */
+    double pause;
+    const struct variant *variant;
+};
+
+extern const struct tourney_rules tourney_defaults;
+
+/* how the IRC side hears of the tables. all of them are called on the
+ * table's thread, say() on the director's as well. */
+struct tourney_hooks {
+    void (*say) (void *session, const char *to, const char *text);
+    /* a new table: its game is on its channel now */
+    void (*opened) (game_tp g);
+    /* a hand has been dealt. whoever plays it calls tourney_hand_over()
+     * when it's over */
+    void (*dealt) (game_tp g);
+};
+
+/* before the shards start */
+void tourney_set_hooks (const struct tourney_hooks *hooks);
+
+/* what "tourney status" shows */
+struct tourney_info {
+    enum tourney_state state;
+    char house[NICK_LEN];
+    int entrants, left, tables;
+    int level, small_blind, big_blind;
+    double next_level;                  /* seconds from now */
+    /* the most chips, as of the last hand */
+    char leader[NICK_LEN];
+    int leader_chips;
+    char places[3][NICK_LEN];           /* when it's over */
+};
+
+/* on the lobby's thread. server has to stay put. a tournament that's over
+ * makes way for a new one. */
+enum tourney_result tourney_open (void *session, const char *server,
+                                  const char *lobby, const char *house,
+                                  const struct tourney_rules *rules);
+enum tourney_result tourney_join (const void *session, const char *lobby,
+                                  const char *nick);
+enum tourney_result tourney_leave (const void *session, const char *lobby,
+                                   const char *nick);
+/* seats everybody at random, and starts the clock. House only. */
+enum tourney_result tourney_start (const void *session, const char *lobby,
+                                   const char *nick);
+/* closes every table. House only. */
+enum tourney_result tourney_stop (const void *session, const char *lobby,
+                                  const char *nick);
+/* TOURNEY_NONE if there's none */
+enum tourney_state tourney_get (const void *session, const char *lobby,
+                                struct tourney_info *info);
+/* forgets every tournament of the session on this thread */
+void tourney_drop_session (const void *session);
+
+/* on the table's thread, after the hand's events have been seen to. the
+ * game may be gone afterwards. */
+void tourney_hand_over (game_tp g);
+/* from free_game() */
+void tourney_forget (game_tp g);
+
+#endif
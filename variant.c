@@ -0,0 +1,152 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#include "variant.h"
+#include "deck.h"
+#include "hand.h"
+
+#include <string.h>
+#include <strings.h>
+
+static int eval_holdem(const pcard_t hole[], const pcard_t board[], int n_board,
+                       cardmask_t *best);
+static int eval_omaha(const pcard_t hole[], const pcard_t board[], int n_board,
+                      cardmask_t *best);
+static int eval_short(const pcard_t hole[], const pcard_t board[], int n_board,
+                      cardmask_t *best);
+
+/* 22 hands, a board and three burns take up the whole deck; with four
+ * hole cards, 11 do, and 14 in the 36 card deck */
+const struct variant variants[N_VARIANTS] = {
+    [VARIANT_HOLDEM] = {
+        "holdem", "Texas Hold'em, nothing wild", 2, 0, 52, 22, eval_holdem
+    },
+    [VARIANT_OMAHA] = {
+        "omaha", "Omaha: two from the hand and three from the board", 4, 0, 52,
+        11, eval_omaha
+    },
+    [VARIANT_SHORT_DECK] = {
+        "shortdeck", "Short deck Hold'em, sixes and up. Flushes beat full houses",
+        2, 4, 36, 14, eval_short
+    }
+};
+
+const struct variant *variant_named(const char *name, int len)
+{
+    int i;
+
+    for (i = 0; i < N_VARIANTS; i++)
+        if ((int) strlen(variants[i].name) == len
+                && strncasecmp(variants[i].name, name, len) == 0)
+            return &variants[i];
+    return NULL;
+}
+
+void variant_deck(const struct variant *v, pcard_t deck[])
+{
+    int i, n = 0;
+
+    init_deck(deck);
+    for (i = 0; i < 52; i++)
+        if (PCARD_RANK(deck[i]) >= v->low_rank)
+            deck[n++] = deck[i];
+    while (n < 52)
+        deck[n++] = 0xff;
+}
+
+static cardmask_t mask_of(const pcard_t cards[], int n)
+{
+    cardmask_t mask = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        mask |= PCARD_BIT(cards[i]);
+    return mask;
+}
+
+static int eval_holdem(const pcard_t hole[], const pcard_t board[], int n_board,
+                       cardmask_t *best)
+{
+    /* as it was before there were variants: this one has to stay fast */
+    cardmask_t cards = PCARD_BIT(hole[0]) | PCARD_BIT(hole[1]);
+    int i;
+
+    for (i = 0; i < n_board; i++)
+        cards |= PCARD_BIT(board[i]);
+    *best = cards;
+    return eval_mask(cards);
+}
+
+/* two of the four hole cards */
+static const unsigned char hole_pairs[6][2] = {
+    { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 }
+};
+/* three of the board, the ones out of the first n before the rest: the
+ * flop has 1 of them, the turn 4, the river all 10 */
+static const unsigned char board_threes[10][3] = {
+    { 0, 1, 2 },
+    { 0, 1, 3 }, { 0, 2, 3 }, { 1, 2, 3 },
+    { 0, 1, 4 }, { 0, 2, 4 }, { 1, 2, 4 }, { 0, 3, 4 }, { 1, 3, 4 }, { 2, 3, 4 }
+};
+static const int n_threes[6] = { 0, 0, 0, 1, 4, 10 };
+
+static int eval_omaha(const pcard_t hole[], const pcard_t board[], int n_board,
+                      cardmask_t *best)
+{
+    cardmask_t pairs[6], masks[60];
+    int strength[60];
+    int i, t, n = 0, top = 0;
+
+    for (i = 0; i < 6; i++)
+        pairs[i] = PCARD_BIT(hole[hole_pairs[i][0]])
+                 | PCARD_BIT(hole[hole_pairs[i][1]]);
+    for (t = 0; t < n_threes[n_board]; t++) {
+        cardmask_t three = PCARD_BIT(board[board_threes[t][0]])
+                         | PCARD_BIT(board[board_threes[t][1]])
+                         | PCARD_BIT(board[board_threes[t][2]]);
+
+        for (i = 0; i < 6; i++)
+            masks[n++] = pairs[i] | three;
+    }
+    if (n == 0) {
+        /* no flop yet: no hand */
+        *best = 0;
+        return 0;
+    }
+
+    eval_masks(masks, strength, n);
+    for (i = 1; i < n; i++)
+        if (strength[i] > strength[top])
+            top = i;
+    *best = masks[top];
+    return strength[top];
+}
+
+/* A 6 7 8 9, which the evaluator doesn't know: in a full deck, its nine
+ * high straight is 5 6 7 8 9, which can't be had with sixes and up */
+#define SHORT_WHEEL (1 << 12 | 0xf << 4)
+#define SHORT_WHEEL_TOP 7
+
+/* a flush goes between a full house and four of a kind */
+static const int short_order[ROYALFLUSH + 1] = {
+    [HIGHCARD] = 0, [ONEPAIR] = 2, [TWOPAIR] = 4, [THREEKIND] = 6,
+    [STRAIGHT] = 8, [FLUSH] = 13, [FULLHOUSE] = 12, [FOURKIND] = 14,
+    [STRAIGHTFLUSH] = 16, [ROYALFLUSH] = 18
+};
+
+static int eval_short(const pcard_t hole[], const pcard_t board[], int n_board,
+                      cardmask_t *best)
+{
+    int s, suit;
+
+    *best = mask_of(hole, 2) | mask_of(board, n_board);
+    s = eval_mask(*best);
+
+    if (STRENGTH_RANK(s) < STRAIGHTFLUSH) {
+        for (suit = 0; suit < 4; suit++)
+            if ((MASK_SUIT(*best, suit) & SHORT_WHEEL) == SHORT_WHEEL)
+                s = STRAIGHTFLUSH << 20 | SHORT_WHEEL_TOP << 16;
+    }
+    if (STRENGTH_RANK(s) < STRAIGHT && (MASK_RANKS(*best) & SHORT_WHEEL) == SHORT_WHEEL)
+        s = STRAIGHT << 20 | SHORT_WHEEL_TOP << 16;
+    return short_order[STRENGTH_RANK(s)] << 24 | s;
+}
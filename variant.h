@@ -0,0 +1,48 @@
+/* Copyright 2011 Tuna <tuna@supertunaman.com
+ * This code is under the Chicken Dance License v0.1 */
+#ifndef VARIANT_H
+#define VARIANT_H
+
+#include "card.h"
+
+/* The games a table can play. Everything that differs between them is in
+ * the variant: how many hole cards, which cards are in the deck, and how
+ * the best hand is found. The deal, the betting and the showdown ask the
+ * table's variant; the House picks one with "set variant".
+ *
+ * Hold'em:     2 hole cards, 52 cards. the best 5 of all 7.
+ * Omaha:       4 hole cards, 52 cards, exactly 2 of them and 3 of the board.
+ *              the 6 pairs and the 10 threes are in tables, and all 60
+ *              hands go through eval_masks() in one batch.
+ * Short deck:  2 hole cards, sixes and up. A 6 7 8 9 is the lowest
+ *              straight, and a flush beats a full house: the strength gets
+ *              a bit above its rank to say so (see hand.h). */
+
+enum variant_id {
+    VARIANT_HOLDEM,
+    VARIANT_OMAHA,
+    VARIANT_SHORT_DECK,
+    N_VARIANTS
+};
+
+struct variant {
+    const char *name;       /* for "set variant" */
+    const char *title;      /* for "what's the game?" */
+    int n_hole;             /* hole cards per player, at most MAX_HOLE */
+    int low_rank;           /* the deck is every card from here up */
+    int n_deck;
+    int max_players;        /* all the deck has hole cards for */
+    /* the strength of the best hand out of hole and n_board of board, and
+     * the cards it's made of */
+    int (*eval) (const pcard_t hole[], const pcard_t board[], int n_board,
+                 cardmask_t *best);
+};
+
+extern const struct variant variants[N_VARIANTS];
+
+/* by name, any case, or NULL */
+const struct variant *variant_named(const char *name, int len);
+/* the variant's deck in init_deck() order, the rest of the 52 0xff */
+void variant_deck(const struct variant *v, pcard_t deck[]);
+
+#endif